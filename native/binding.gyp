@@ -1,10 +1,39 @@
 {
+  "variables": {
+    "native_tests%": 0,
+    "discord_tracing%": 0
+  },
   "targets": [
     {
       "target_name": "discord_social_sdk",
       "sources": [
         "src/discord_social_sdk.cc",
-        "src/discord_client.cc"
+        "src/discord_client.cc",
+        "src/logger.cc",
+        "src/metrics.cc",
+        "src/trace.cc",
+        "src/flight_recorder.cc",
+        "src/events.cc",
+        "src/watchdog.cc",
+        "src/sdk_loader.cc",
+        "src/timer_queue.cc",
+        "src/connection.cc",
+        "src/token_manager.cc",
+        "src/request_scheduler.cc",
+        "src/send_pipeline.cc",
+        "src/record_log.cc",
+        "src/outbox.cc",
+        "src/code_codec.cc",
+        "src/presence.cc",
+        "src/voice.cc",
+        "src/lobby_registry.cc",
+        "src/fan_out.cc",
+        "src/message_history.cc",
+        "src/message_log.cc",
+        "src/name_index.cc",
+        "src/relationship_store.cc",
+        "src/search_index.cc",
+        "src/shutdown.cc"
       ],
       "include_dirs": [
         "<!(node -p \"require('node-addon-api').include_dir\")",
@@ -32,18 +61,20 @@
       },
       "msbuild_toolset": "v143",
       "conditions": [
+        [
+          "discord_tracing==1",
+          {
+            "defines": [
+              "DISCORD_ENABLE_TRACING"
+            ]
+          }
+        ],
         [
           "OS==\"win\"",
           {
             "include_dirs": [
               "<!(node find-sdk.js)/include"
             ],
-            "library_dirs": [
-              "<!(node find-sdk.js)/lib/release"
-            ],
-            "libraries": [
-              "discord_partner_sdk.lib"
-            ],
             "msbuild_toolset": "v143",
             "msvs_settings": {
               "VCCLCompilerTool": {
@@ -67,17 +98,19 @@
             "include_dirs": [
               "<!(node find-sdk.js)/include"
             ],
-            "library_dirs": [
-              "<!(node find-sdk.js)/lib/release"
-            ],
-            "libraries": [
-              "discord_partner_sdk"
-            ],
             "xcode_settings": {
               "GCC_ENABLE_CPP_RTTI": "YES",
               "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
               "MACOSX_DEPLOYMENT_TARGET": "10.13"
-            }
+            },
+            "copies": [
+              {
+                "destination": "build/Release",
+                "files": [
+                  "<!(node find-sdk.js)/lib/release/libdiscord_partner_sdk.dylib"
+                ]
+              }
+            ]
           }
         ],
         [
@@ -88,24 +121,86 @@
             ],
             "link_settings": {
               "libraries": [
-                "<!(node find-sdk.js)/lib/release/libdiscord_partner_sdk.so"
-              ],
-              "ldflags": [
-                "-Wl,-rpath,<!(pwd)/build/Release"
+                "-ldl"
               ]
-            }
+            },
+            "copies": [
+              {
+                "destination": "build/Release",
+                "files": [
+                  "<!(node find-sdk.js)/lib/release/libdiscord_partner_sdk.so"
+                ]
+              }
+            ]
           }
         ]
-      ],
-      "copies": [
-        {
-          "destination": "build/Release",
-          "files": [
-            "<!(node find-sdk.js)/lib/release/libdiscord_partner_sdk.so"
-          ],
-          "conditions": [["OS==\"linux\"", {}]]
-        }
       ]
     }
+  ],
+  "conditions": [
+    [
+      "native_tests==1",
+      {
+        "targets": [
+          {
+            "target_name": "native_tests",
+            "type": "executable",
+            "sources": [
+              "test/test_main.cc",
+              "test/record_log_test.cc",
+              "test/message_log_test.cc",
+              "test/outbox_test.cc",
+              "test/send_pipeline_test.cc",
+              "test/search_index_test.cc",
+              "test/relationship_store_test.cc",
+              "test/code_codec_test.cc",
+              "test/events_test.cc",
+              "src/logger.cc",
+              "src/metrics.cc",
+              "src/events.cc",
+              "src/record_log.cc",
+              "src/message_log.cc",
+              "src/timer_queue.cc",
+              "src/flight_recorder.cc",
+              "src/outbox.cc",
+              "src/send_pipeline.cc",
+              "src/search_index.cc",
+              "src/relationship_store.cc",
+              "src/code_codec.cc"
+            ],
+            "include_dirs": [
+              "src"
+            ],
+            "cflags_cc": [
+              "-std=c++17",
+              "-fexceptions"
+            ],
+            "msvs_settings": {
+              "VCCLCompilerTool": {
+                "ExceptionHandling": 1,
+                "AdditionalOptions": ["/std:c++17"]
+              }
+            },
+            "xcode_settings": {
+              "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+              "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+              "MACOSX_DEPLOYMENT_TARGET": "10.15"
+            },
+            "conditions": [
+              [
+                "OS==\"linux\"",
+                {
+                  "link_settings": {
+                    "libraries": [
+                      "-lpthread"
+                    ]
+                  }
+                }
+              ]
+            ]
+          }
+        ]
+      }
+    ]
   ]
 }
@@ -0,0 +1,15 @@
+#!/usr/bin/env node
+// Runs the native unit tests built by `npm test` (node-gyp with -Dnative_tests=1).
+// Extra arguments are passed through, e.g. `npm test -- RecordLog` to filter.
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+const binary = path.join(__dirname, 'build', 'Release', process.platform === 'win32' ? 'native_tests.exe' : 'native_tests');
+if (!fs.existsSync(binary)) {
+  console.error(`❌ ${binary} not found; build it with: node-gyp configure -- -Dnative_tests=1 && node-gyp build`);
+  process.exit(1);
+}
+
+const result = spawnSync(binary, process.argv.slice(2), { stdio: 'inherit' });
+process.exit(result.status === null ? 1 : result.status);
@@ -0,0 +1,503 @@
+#include "code_codec.h"
+#include "events.h"
+#include "logger.h"
+#include "metrics.h"
+#include "record_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+
+static const char kMagic[] = "dvc1";
+static const uint32_t kMaxChunks = 1000;  // accepted from peers, whatever they were configured with
+
+const char* CodeEncodingName(CodeEncoding encoding) {
+  switch (encoding) {
+    case CodeEncoding::Text: return "text";
+    case CodeEncoding::Lz4: return "lz4";
+    default: return "unknown";
+  }
+}
+
+// ---- LZ4 block format ------------------------------------------------------
+// Sequences of [token][literal length+][literals][offset LE16][match length+].
+// The last 5 bytes are always literals and no match starts in the last 12.
+
+static const size_t kMinMatch = 4;
+static const size_t kLastLiterals = 5;
+static const size_t kMatchLimit = 12;
+static const int kHashBits = 12;
+
+static uint32_t Read32(const char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static void PutLength(std::string& out, size_t length) {
+  while (length >= 255) {
+    out.push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+static void EmitSequence(std::string& out, const char* literals, size_t literal_length, size_t offset,
+                         size_t match_length) {
+  uint8_t token = static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+  if (offset) token |= static_cast<uint8_t>(match_length - kMinMatch >= 15 ? 15 : match_length - kMinMatch);
+  out.push_back(static_cast<char>(token));
+  if (literal_length >= 15) PutLength(out, literal_length - 15);
+  out.append(literals, literal_length);
+  if (!offset) return;
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match_length - kMinMatch >= 15) PutLength(out, match_length - kMinMatch - 15);
+}
+
+std::string Lz4Compress(const std::string& input) {
+  const char* base = input.data();
+  const size_t size = input.size();
+  std::string out;
+  out.reserve(size / 2 + 16);
+
+  size_t anchor = 0;
+  if (size > kMatchLimit) {
+    std::vector<uint32_t> table(1u << kHashBits, 0);
+    auto hash = [](uint32_t sequence) { return (sequence * 2654435761u) >> (32 - kHashBits); };
+    const size_t match_end = size - kMatchLimit;
+    size_t pos = 0;
+    while (pos < match_end) {
+      uint32_t sequence = Read32(base + pos);
+      uint32_t& slot = table[hash(sequence)];
+      size_t candidate = slot;
+      slot = static_cast<uint32_t>(pos);
+      if (candidate >= pos || pos - candidate > 0xFFFF || Read32(base + candidate) != sequence) {
+        pos++;
+        continue;
+      }
+      size_t length = kMinMatch;
+      while (pos + length < size - kLastLiterals && base[candidate + length] == base[pos + length]) length++;
+      EmitSequence(out, base + anchor, pos - anchor, pos - candidate, length);
+      pos += length;
+      anchor = pos;
+    }
+  }
+  EmitSequence(out, base + anchor, size - anchor, 0, 0);
+  return out;
+}
+
+bool Lz4Decompress(const std::string& input, size_t raw_size, std::string& output) {
+  output.clear();
+  // raw_size comes from a peer; no block expands more than 255-fold, so a
+  // larger claim is corrupt and must not size the allocation
+  if (raw_size / 255 > input.size()) return false;
+  output.reserve(raw_size);
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(input.data());
+  const uint8_t* end = p + input.size();
+  auto read_length = [&](size_t& length) {
+    uint8_t byte;
+    do {
+      if (p >= end) return false;
+      byte = *p++;
+      length += byte;
+    } while (byte == 255);
+    return true;
+  };
+
+  while (p < end) {
+    uint8_t token = *p++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !read_length(literal_length)) return false;
+    if (static_cast<size_t>(end - p) < literal_length || output.size() + literal_length > raw_size) return false;
+    output.append(reinterpret_cast<const char*>(p), literal_length);
+    p += literal_length;
+    if (p == end) break;  // the last sequence has no match
+
+    if (end - p < 2) return false;
+    size_t offset = p[0] | (p[1] << 8);
+    p += 2;
+    size_t match_length = token & 0x0F;
+    if (match_length == 15 && !read_length(match_length)) return false;
+    match_length += kMinMatch;
+    if (offset == 0 || offset > output.size() || output.size() + match_length > raw_size) return false;
+    // Byte by byte: the match may overlap what it is copying
+    size_t from = output.size() - offset;
+    for (size_t i = 0; i < match_length; i++) output.push_back(output[from + i]);
+  }
+  return output.size() == raw_size;
+}
+
+// ---- Base64 ----------------------------------------------------------------
+
+static const char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Base64Encode(const std::string& input) {
+  std::string out;
+  out.reserve((input.size() + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 2 < input.size(); i += 3) {
+    uint32_t n = (static_cast<uint8_t>(input[i]) << 16) | (static_cast<uint8_t>(input[i + 1]) << 8) |
+                 static_cast<uint8_t>(input[i + 2]);
+    out.push_back(kBase64[(n >> 18) & 63]);
+    out.push_back(kBase64[(n >> 12) & 63]);
+    out.push_back(kBase64[(n >> 6) & 63]);
+    out.push_back(kBase64[n & 63]);
+  }
+  if (i < input.size()) {
+    uint32_t n = static_cast<uint8_t>(input[i]) << 16;
+    if (i + 1 < input.size()) n |= static_cast<uint8_t>(input[i + 1]) << 8;
+    out.push_back(kBase64[(n >> 18) & 63]);
+    out.push_back(kBase64[(n >> 12) & 63]);
+    out.push_back(i + 1 < input.size() ? kBase64[(n >> 6) & 63] : '=');
+    out.push_back('=');
+  }
+  return out;
+}
+
+bool Base64Decode(const std::string& input, std::string& output) {
+  static int8_t table[256];
+  static bool built = [] {
+    std::memset(table, -1, sizeof(table));
+    for (int i = 0; i < 64; i++) table[static_cast<uint8_t>(kBase64[i])] = static_cast<int8_t>(i);
+    return true;
+  }();
+  (void)built;
+
+  output.clear();
+  output.reserve(input.size() / 4 * 3);
+  uint32_t bits = 0;
+  int count = 0;
+  for (char c : input) {
+    if (c == '=') break;
+    if (c == '\n' || c == '\r' || c == ' ') continue;
+    int8_t value = table[static_cast<uint8_t>(c)];
+    if (value < 0) return false;
+    bits = (bits << 6) | static_cast<uint32_t>(value);
+    if (++count == 4) {
+      output.push_back(static_cast<char>((bits >> 16) & 0xFF));
+      output.push_back(static_cast<char>((bits >> 8) & 0xFF));
+      output.push_back(static_cast<char>(bits & 0xFF));
+      bits = 0;
+      count = 0;
+    }
+  }
+  if (count == 1) return false;
+  if (count == 2) output.push_back(static_cast<char>((bits >> 4) & 0xFF));
+  if (count == 3) {
+    output.push_back(static_cast<char>((bits >> 10) & 0xFF));
+    output.push_back(static_cast<char>((bits >> 2) & 0xFF));
+  }
+  return true;
+}
+
+// ---- Chunking --------------------------------------------------------------
+
+std::string NewTransferId() {
+  static std::mt19937_64 rng(std::random_device{}());
+  char id[17];
+  std::snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(rng()));
+  return id;
+}
+
+// Largest end <= limit that does not split a UTF-8 sequence, preferring to cut
+// just after a newline in the second half of the slice
+static size_t TextCut(const std::string& text, size_t start, size_t limit) {
+  if (limit >= text.size()) return text.size();
+  size_t newline = text.rfind('\n', limit - 1);
+  if (newline != std::string::npos && newline >= start && newline + 1 > start + (limit - start) / 2) {
+    return newline + 1;
+  }
+  size_t end = limit;
+  while (end > start && (static_cast<uint8_t>(text[end]) & 0xC0) == 0x80) end--;
+  return end > start ? end : limit;
+}
+
+// The file name may hold spaces but not a line break; it is capped without
+// splitting a character
+static std::string HeaderSafe(std::string value, size_t max_bytes) {
+  for (char& c : value) {
+    if (c == '\n' || c == '\r') c = ' ';
+  }
+  if (value.size() > max_bytes) {
+    size_t end = max_bytes;
+    while (end > 0 && (static_cast<uint8_t>(value[end]) & 0xC0) == 0x80) end--;
+    value.resize(end);
+  }
+  return value;
+}
+
+static std::string HeaderLine(const std::string& transfer_id, uint32_t seq, uint32_t total, CodeEncoding encoding,
+                              uint32_t crc, uint64_t raw_bytes, const std::string& language,
+                              const std::string& file_name) {
+  char line[96];
+  std::snprintf(line, sizeof(line), "%s %s %u/%u %c", kMagic, transfer_id.c_str(), seq, total,
+                encoding == CodeEncoding::Text ? 't' : 'z');
+  std::string header = line;
+  if (seq == 0) {
+    std::snprintf(line, sizeof(line), " %08x %llu ", crc, static_cast<unsigned long long>(raw_bytes));
+    header += line;
+    header += language.empty() ? "-" : language;
+    header += ' ';
+    header += file_name;
+  }
+  return header + "\n";
+}
+
+EncodedCode EncodeCode(const std::string& transfer_id, const std::string& code, const CodeShareOptions& options) {
+  EncodedCode encoded{ transfer_id, CodeEncoding::Text, code.size(), {}, "" };
+  std::string language = HeaderSafe(options.language, 32);
+  for (char& c : language) {
+    if (c == ' ') c = '_';
+  }
+  std::string file_name = HeaderSafe(options.file_name, 128);
+  uint32_t crc = Crc32(code.data(), code.size());
+
+  std::string payload = code;
+  if (options.compress && code.size() > 256) {
+    std::string packed = Base64Encode(Lz4Compress(code));
+    if (packed.size() * 5 < code.size() * 4) {
+      encoded.encoding = CodeEncoding::Lz4;
+      payload.swap(packed);
+    }
+  }
+  bool text = encoded.encoding == CodeEncoding::Text;
+
+  // Budget from the longest header any chunk can have: the seq and total
+  // fields never get wider than max_chunks
+  uint32_t widest = options.max_chunks > 0 ? options.max_chunks : 1;
+  std::string fence_open = "```" + language + "\n";
+  const std::string fence_close = "\n```";
+  size_t wrap = text ? fence_open.size() + fence_close.size() : 0;
+  size_t first_overhead = HeaderLine(transfer_id, 0, widest, encoded.encoding, crc, code.size(), language,
+                                     file_name).size() + wrap;
+  size_t overhead = HeaderLine(transfer_id, widest, widest, encoded.encoding, 0, 0, "", "").size() + wrap;
+  if (options.max_message_bytes <= first_overhead + 16) {
+    encoded.error = "Message size limit is too small for code chunks";
+    return encoded;
+  }
+
+  std::vector<std::pair<size_t, size_t>> slices;
+  size_t start = 0;
+  while (start < payload.size() || slices.empty()) {
+    size_t budget = options.max_message_bytes - (slices.empty() ? first_overhead : overhead);
+    size_t end = text ? TextCut(payload, start, start + budget) : std::min(payload.size(), start + budget);
+    slices.emplace_back(start, end);
+    start = end;
+    if (slices.size() > widest) {
+      encoded.error = "Code is too large to share (over " + std::to_string(widest) + " messages)";
+      return encoded;
+    }
+  }
+
+  uint32_t total = static_cast<uint32_t>(slices.size());
+  for (uint32_t seq = 0; seq < total; seq++) {
+    std::string message = HeaderLine(transfer_id, seq, total, encoded.encoding, crc, code.size(), language,
+                                     file_name);
+    std::string slice = payload.substr(slices[seq].first, slices[seq].second - slices[seq].first);
+    message += text ? fence_open + slice + fence_close : slice;
+    encoded.messages.push_back(std::move(message));
+  }
+  return encoded;
+}
+
+bool ParseCodeChunk(const std::string& message, CodeChunkHeader& header, std::string& payload) {
+  if (message.compare(0, sizeof(kMagic) - 1, kMagic) != 0 || message.size() <= sizeof(kMagic) ||
+      message[sizeof(kMagic) - 1] != ' ') {
+    return false;
+  }
+  size_t line_end = message.find('\n');
+  if (line_end == std::string::npos) return false;
+  std::string line = message.substr(0, line_end);
+
+  char id[33] = {};
+  unsigned seq = 0, total = 0;
+  char encoding = 0;
+  int consumed = 0;
+  if (std::sscanf(line.c_str(), "dvc1 %32s %u/%u %c%n", id, &seq, &total, &encoding, &consumed) != 4) return false;
+  if (total == 0 || total > kMaxChunks || seq >= total || (encoding != 't' && encoding != 'z')) return false;
+
+  header.transfer_id = id;
+  header.seq = seq;
+  header.total = total;
+  header.encoding = encoding == 't' ? CodeEncoding::Text : CodeEncoding::Lz4;
+  header.has_meta = false;
+  header.crc = 0;
+  header.raw_bytes = 0;
+  header.language.clear();
+  header.file_name.clear();
+
+  if (seq == 0) {
+    unsigned crc = 0;
+    unsigned long long raw_bytes = 0;
+    char language[40] = {};
+    int meta_consumed = 0;
+    if (std::sscanf(line.c_str() + consumed, " %x %llu %39s%n", &crc, &raw_bytes, language, &meta_consumed) != 3) {
+      return false;
+    }
+    header.has_meta = true;
+    header.crc = crc;
+    header.raw_bytes = raw_bytes;
+    header.language = std::strcmp(language, "-") == 0 ? "" : language;
+    size_t name_at = static_cast<size_t>(consumed + meta_consumed);
+    if (name_at < line.size() && line[name_at] == ' ') name_at++;
+    header.file_name = name_at < line.size() ? line.substr(name_at) : "";
+  }
+
+  payload = message.substr(line_end + 1);
+  if (header.encoding == CodeEncoding::Text) {
+    // Unwrap the code fence
+    if (payload.compare(0, 3, "```") == 0) {
+      size_t fence_end = payload.find('\n');
+      payload.erase(0, fence_end == std::string::npos ? payload.size() : fence_end + 1);
+    }
+    if (payload.size() >= 4 && payload.compare(payload.size() - 4, 4, "\n```") == 0) {
+      payload.resize(payload.size() - 4);
+    }
+  }
+  return true;
+}
+
+// ---- Reassembly ------------------------------------------------------------
+
+bool CodeReassembler::Feed(uint64_t lobby_id, uint64_t author_id, const std::string& message) {
+  CodeChunkHeader header;
+  std::string payload;
+  if (!ParseCodeChunk(message, header, payload)) return false;
+  METRIC_COUNTER("code.chunks_received").Add();
+
+  auto now = Clock::now();
+  Expire(now);
+
+  std::string key = std::to_string(author_id) + ":" + header.transfer_id;
+  auto it = transfers_.find(key);
+  if (it == transfers_.end()) {
+    if (transfers_.size() >= options_.max_transfers) {
+      auto oldest = transfers_.begin();
+      for (auto candidate = transfers_.begin(); candidate != transfers_.end(); ++candidate) {
+        if (candidate->second.started < oldest->second.started) oldest = candidate;
+      }
+      Fail(oldest->first, oldest->second, "Too many transfers in progress");
+    }
+    Transfer transfer;
+    transfer.lobby_id = lobby_id;
+    transfer.author_id = author_id;
+    transfer.transfer_id = header.transfer_id;
+    transfer.encoding = header.encoding;
+    transfer.total = header.total;
+    transfer.parts.resize(header.total);
+    transfer.have.resize(header.total, false);
+    transfer.started = now;
+    it = transfers_.emplace(key, std::move(transfer)).first;
+  }
+  Transfer& transfer = it->second;
+  if (header.encoding != transfer.encoding || header.total != transfer.total) {
+    METRIC_COUNTER("code.bad_chunks").Add();
+    return true;
+  }
+  if (transfer.have[header.seq]) return true;  // redelivered
+  if (header.has_meta && header.raw_bytes > options_.max_bytes) {
+    // Checked before anything is sized from it: the decoded size is the peer's claim
+    Fail(key, transfer, "Transfer exceeds " + std::to_string(options_.max_bytes) + " bytes");
+    return true;
+  }
+
+  transfer.bytes += payload.size();
+  if (transfer.bytes > options_.max_bytes) {
+    Fail(key, transfer, "Transfer exceeds " + std::to_string(options_.max_bytes) + " bytes");
+    return true;
+  }
+  if (header.has_meta) {
+    transfer.meta = header;
+    transfer.has_meta = true;
+  }
+  transfer.parts[header.seq] = std::move(payload);
+  transfer.have[header.seq] = true;
+  transfer.received++;
+
+  // Release whatever now extends the in-order prefix
+  std::string released;
+  uint32_t first = transfer.contiguous;
+  while (transfer.contiguous < transfer.total && transfer.have[transfer.contiguous]) {
+    if (transfer.encoding == CodeEncoding::Text) released += transfer.parts[transfer.contiguous];
+    transfer.contiguous++;
+  }
+  NativeEvent event("codeChunk");
+  event.String("transferId", transfer.transfer_id)
+      .String("lobbyId", std::to_string(lobby_id))
+      .String("authorId", std::to_string(author_id))
+      .Number("received", transfer.received)
+      .Number("total", transfer.total);
+  if (transfer.contiguous > first && transfer.encoding == CodeEncoding::Text) {
+    event.String("text", released);
+  }
+  EmitEvent(std::move(event));
+
+  if (transfer.received == transfer.total) Complete(key, transfer);
+  return true;
+}
+
+void CodeReassembler::Complete(const std::string& key, Transfer& transfer) {
+  if (!transfer.has_meta) {
+    Fail(key, transfer, "First chunk is missing its header");
+    return;
+  }
+  std::string joined;
+  joined.reserve(transfer.bytes);
+  for (const std::string& part : transfer.parts) joined += part;
+
+  std::string content;
+  if (transfer.encoding == CodeEncoding::Text) {
+    content.swap(joined);
+  } else {
+    std::string packed;
+    if (!Base64Decode(joined, packed) || !Lz4Decompress(packed, transfer.meta.raw_bytes, content)) {
+      Fail(key, transfer, "Compressed payload is corrupt");
+      return;
+    }
+  }
+  if (content.size() != transfer.meta.raw_bytes || Crc32(content.data(), content.size()) != transfer.meta.crc) {
+    Fail(key, transfer, "Checksum mismatch");
+    return;
+  }
+
+  METRIC_COUNTER("code.transfers_received").Add();
+  METRIC_HISTOGRAM("code.reassembly_us").Record(ElapsedMicros(transfer.started));
+  LOG_DEBUG("📥 Code share " << transfer.transfer_id << " complete: " << content.size() << " bytes in "
+            << transfer.total << " chunks");
+  EmitEvent(NativeEvent("codeReceived")
+                .String("transferId", transfer.transfer_id)
+                .String("lobbyId", std::to_string(transfer.lobby_id))
+                .String("authorId", std::to_string(transfer.author_id))
+                .String("fileName", transfer.meta.file_name)
+                .String("language", transfer.meta.language)
+                .String("encoding", CodeEncodingName(transfer.encoding))
+                .Number("chunks", transfer.total)
+                .String("content", content));
+  transfers_.erase(key);
+}
+
+void CodeReassembler::Fail(std::string key, const Transfer& transfer, const std::string& error) {
+  METRIC_COUNTER("code.transfers_failed").Add();
+  LOG_WARN("⚠️  Dropping code share " << transfer.transfer_id << ": " << error);
+  // key may alias the entry being dropped, hence the copy
+  EmitEvent(NativeEvent("codeTransferFailed")
+                .String("transferId", transfer.transfer_id)
+                .String("lobbyId", std::to_string(transfer.lobby_id))
+                .String("authorId", std::to_string(transfer.author_id))
+                .Number("received", transfer.received)
+                .Number("total", transfer.total)
+                .String("error", error));
+  transfers_.erase(key);
+}
+
+void CodeReassembler::Expire(Clock::time_point now) {
+  auto timeout = std::chrono::milliseconds(options_.timeout_ms);
+  for (auto it = transfers_.begin(); it != transfers_.end();) {
+    auto next = std::next(it);
+    if (now - it->second.started > timeout) Fail(it->first, it->second, "Timed out waiting for chunks");
+    it = next;
+  }
+}
@@ -0,0 +1,113 @@
+#ifndef DISCORD_CODE_CODEC_H
+#define DISCORD_CODE_CODEC_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Code shares larger than one message travel as a run of framed chunks. Every
+// chunk starts with a header line
+//
+//   dvc1 <transfer> <seq>/<total> <t|z>[ <crc32> <bytes> <language> <file name>]
+//
+// where the bracketed part is only on chunk 0. 't' chunks carry a slice of the
+// text in a code fence, cut after a newline where possible and never inside a
+// UTF-8 sequence, so they still read as code in any Discord client. 'z' chunks
+// carry a slice of the base64 of the whole text compressed as one LZ4 block.
+
+enum class CodeEncoding { Text, Lz4 };
+
+const char* CodeEncodingName(CodeEncoding encoding);
+
+// LZ4 block format (no frame header); raw_size must be the exact decoded size
+std::string Lz4Compress(const std::string& input);
+bool Lz4Decompress(const std::string& input, size_t raw_size, std::string& output);
+
+std::string Base64Encode(const std::string& input);
+bool Base64Decode(const std::string& input, std::string& output);
+
+struct CodeShareOptions {
+  std::string file_name;
+  std::string language;
+  bool compress = true;             // used only if it saves at least a fifth of the size
+  uint32_t max_message_bytes = 2000;
+  uint32_t max_chunks = 100;
+};
+
+struct EncodedCode {
+  std::string transfer_id;
+  CodeEncoding encoding;
+  uint64_t raw_bytes;
+  std::vector<std::string> messages;  // in order; empty with error set on failure
+  std::string error;
+};
+
+std::string NewTransferId();
+EncodedCode EncodeCode(const std::string& transfer_id, const std::string& code, const CodeShareOptions& options);
+
+struct CodeChunkHeader {
+  std::string transfer_id;
+  uint32_t seq = 0;
+  uint32_t total = 0;
+  CodeEncoding encoding = CodeEncoding::Text;
+  // chunk 0 only
+  bool has_meta = false;
+  uint32_t crc = 0;
+  uint64_t raw_bytes = 0;
+  std::string language;
+  std::string file_name;
+};
+
+// Splits a message into header and payload; false if it is not a code chunk
+bool ParseCodeChunk(const std::string& message, CodeChunkHeader& header, std::string& payload);
+
+struct CodeReassemblerOptions {
+  uint32_t max_transfers = 32;      // oldest incomplete transfer is dropped past this
+  uint32_t timeout_ms = 5 * 60 * 1000;
+  uint64_t max_bytes = 4 << 20;     // per transfer
+};
+
+// Rebuilds code shares from chunks as they arrive, in any order. Text chunks are
+// released as soon as they extend the in-order prefix ("codeChunk" with text),
+// so a long file can be shown while the rest is still in flight; the finished
+// share is checked against its CRC and emitted as "codeReceived".
+//
+// Like ConnectionManager, every method requires the client state lock.
+class CodeReassembler {
+public:
+  void Configure(const CodeReassemblerOptions& options) { options_ = options; }
+
+  // False if message is not a code chunk
+  bool Feed(uint64_t lobby_id, uint64_t author_id, const std::string& message);
+  uint32_t Pending() const { return static_cast<uint32_t>(transfers_.size()); }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Transfer {
+    uint64_t lobby_id;
+    uint64_t author_id;
+    std::string transfer_id;
+    CodeEncoding encoding;
+    uint32_t total;
+    CodeChunkHeader meta;
+    bool has_meta = false;
+    std::vector<std::string> parts;
+    std::vector<bool> have;
+    uint32_t received = 0;
+    uint32_t contiguous = 0;  // parts [0, contiguous) are all here
+    uint64_t bytes = 0;
+    Clock::time_point started;
+  };
+
+  void Expire(Clock::time_point now);
+  void Complete(const std::string& key, Transfer& transfer);
+  void Fail(std::string key, const Transfer& transfer, const std::string& error);
+
+  CodeReassemblerOptions options_;
+  std::unordered_map<std::string, Transfer> transfers_;  // by "<author>:<transfer>"
+};
+
+#endif // DISCORD_CODE_CODEC_H
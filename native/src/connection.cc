@@ -0,0 +1,167 @@
+#include "connection.h"
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+
+ConnectionManager::ConnectionManager(TimerQueue& timers, LockedRunner run_locked, ConnectFn connect)
+    : timers_(timers), run_locked_(std::move(run_locked)), connect_(std::move(connect)),
+      rng_(std::random_device{}()) {}
+
+void ConnectionManager::Configure(const ReconnectOptions& options) {
+  options_ = options;
+  if (options_.base_delay_ms == 0) options_.base_delay_ms = 1;
+  if (options_.max_delay_ms < options_.base_delay_ms) options_.max_delay_ms = options_.base_delay_ms;
+}
+
+const char* ConnectionManager::StateName(ConnectionState state) {
+  switch (state) {
+    case ConnectionState::Connecting: return "connecting";
+    case ConnectionState::Ready: return "ready";
+    case ConnectionState::Reconnecting: return "reconnecting";
+    case ConnectionState::Failed: return "failed";
+    default: return "idle";
+  }
+}
+
+uint32_t ConnectionManager::BackoffDelayMs(const ReconnectOptions& options, uint32_t attempt, std::mt19937& rng) {
+  uint64_t cap = options.base_delay_ms;
+  for (uint32_t i = 1; i < attempt && cap < options.max_delay_ms; i++) {
+    cap *= 2;
+  }
+  cap = std::min<uint64_t>(cap, options.max_delay_ms);
+  std::uniform_int_distribution<uint64_t> jitter(0, cap / 2);
+  return static_cast<uint32_t>(cap - cap / 2 + jitter(rng));
+}
+
+void ConnectionManager::Begin() {
+  if (retry_timer_) timers_.Cancel(retry_timer_);
+  retry_timer_ = 0;
+  generation_++;
+  attempt_ = 0;
+  outages_ = 0;
+  last_error_ = 0;
+  last_error_detail_ = 0;
+  SetState(ConnectionState::Connecting);
+}
+
+void ConnectionManager::Stop() {
+  if (retry_timer_) timers_.Cancel(retry_timer_);
+  retry_timer_ = 0;
+  generation_++;
+  SetState(ConnectionState::Idle);
+}
+
+ConnectionInfo ConnectionManager::Info() const {
+  auto now = std::chrono::steady_clock::now();
+  bool down = state_ == ConnectionState::Reconnecting || state_ == ConnectionState::Failed;
+  ConnectionInfo info;
+  info.state = state_;
+  info.attempt = attempt_;
+  info.last_error = last_error_;
+  info.last_error_detail = last_error_detail_;
+  info.down_ms = down ? std::chrono::duration_cast<std::chrono::milliseconds>(now - down_since_).count() : 0;
+  info.next_retry_ms = retry_timer_ && retry_at_ > now
+      ? std::chrono::duration_cast<std::chrono::milliseconds>(retry_at_ - now).count() : 0;
+  info.outages = outages_;
+  return info;
+}
+
+void ConnectionManager::SetState(ConnectionState state) {
+  if (state == state_) return;
+  ConnectionState previous = state_;
+  state_ = state;
+  FlightRecorder::Instance().Record(FlightEvent::Lifecycle, StateName(state), static_cast<uint32_t>(state),
+                                    attempt_, static_cast<uint64_t>(last_error_));
+  LOG_INFO("🔌 Connection " << StateName(previous) << " -> " << StateName(state)
+           << (attempt_ ? " (attempt " + std::to_string(attempt_) + ")" : ""));
+  EmitEvent(NativeEvent("connectionState").String("state", StateName(state)).String("previous", StateName(previous))
+                .Number("attempt", attempt_).Number("error", last_error_).Number("errorDetail", last_error_detail_));
+}
+
+ConnectionTransition ConnectionManager::OnStatus(Discord_Client_Status status, Discord_Client_Error error,
+                                                 int32_t error_detail) {
+  switch (status) {
+    case Discord_Client_Status_Ready: {
+      if (retry_timer_) timers_.Cancel(retry_timer_);
+      retry_timer_ = 0;
+      ConnectionState previous = state_;
+      if (previous == ConnectionState::Ready || previous == ConnectionState::Idle) {
+        return ConnectionTransition::None;
+      }
+      attempt_ = 0;
+      SetState(ConnectionState::Ready);
+      if (previous == ConnectionState::Connecting) {
+        return ConnectionTransition::Ready;
+      }
+      uint64_t down_us = ElapsedMicros(down_since_);
+      METRIC_COUNTER("connection.resumed").Add();
+      METRIC_HISTOGRAM("connection.downtime_us").Record(down_us);
+      LOG_INFO("✅ Connection resumed after " << down_us / 1000 << "ms");
+      EmitEvent(NativeEvent("connectionResumed").Number("downtimeMs", down_us / 1000.0));
+      return ConnectionTransition::Resumed;
+    }
+
+    // The SDK is retrying on its own; just enter the outage
+    case Discord_Client_Status_Reconnecting:
+      if (state_ != ConnectionState::Ready) return ConnectionTransition::None;
+      outages_++;
+      down_since_ = std::chrono::steady_clock::now();
+      METRIC_COUNTER("connection.drops").Add();
+      SetState(ConnectionState::Reconnecting);
+      return ConnectionTransition::Lost;
+
+    case Discord_Client_Status_Disconnected:
+      last_error_ = static_cast<int32_t>(error);
+      last_error_detail_ = error_detail;
+      if (state_ == ConnectionState::Ready) {
+        outages_++;
+        down_since_ = std::chrono::steady_clock::now();
+        METRIC_COUNTER("connection.drops").Add();
+        SetState(ConnectionState::Reconnecting);
+        ScheduleReconnect();
+        return ConnectionTransition::Lost;
+      }
+      if (state_ == ConnectionState::Reconnecting && !retry_timer_) {
+        ScheduleReconnect();  // our retry (or the SDK's own) failed
+      }
+      return ConnectionTransition::None;
+
+    default:
+      return ConnectionTransition::None;
+  }
+}
+
+void ConnectionManager::ScheduleReconnect() {
+  if (!options_.enabled) {
+    SetState(ConnectionState::Failed);
+    return;
+  }
+  if (options_.max_attempts && attempt_ >= options_.max_attempts) {
+    LOG_ERROR("❌ Giving up reconnecting after " << attempt_ << " attempts");
+    METRIC_COUNTER("connection.gave_up").Add();
+    SetState(ConnectionState::Failed);
+    return;
+  }
+
+  attempt_++;
+  uint32_t delay_ms = BackoffDelayMs(options_, attempt_, rng_);
+  retry_at_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+  LOG_INFO("⏳ Reconnect attempt " << attempt_ << " in " << delay_ms << "ms");
+  EmitEvent(NativeEvent("reconnectScheduled").Number("attempt", attempt_).Number("delayMs", delay_ms));
+
+  uint64_t generation = generation_;
+  retry_timer_ = timers_.Schedule(delay_ms, [this, generation]() {
+    run_locked_([this, generation]() { OnRetryTimer(generation); });
+  });
+}
+
+void ConnectionManager::OnRetryTimer(uint64_t generation) {
+  // Stop() or a resume may have won the race with this timer
+  if (generation != generation_ || state_ != ConnectionState::Reconnecting) return;
+  retry_timer_ = 0;
+  METRIC_COUNTER("connection.reconnects").Add();
+  FlightRecorder::Instance().Record(FlightEvent::SdkCall, "Reconnect", attempt_);
+  connect_();
+}
@@ -0,0 +1,84 @@
+#ifndef DISCORD_CONNECTION_H
+#define DISCORD_CONNECTION_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include "cdiscord.h"  // Discord_Client_Status / Discord_Client_Error
+#include "timer_queue.h"
+
+struct ReconnectOptions {
+  bool enabled = true;
+  uint32_t base_delay_ms = 1000;   // first retry waits between half and all of this
+  uint32_t max_delay_ms = 60000;   // cap for the doubling delay
+  uint32_t max_attempts = 0;       // consecutive failed attempts before giving up; 0 = never
+};
+
+enum class ConnectionState { Idle, Connecting, Ready, Reconnecting, Failed };
+
+struct ConnectionInfo {
+  ConnectionState state;
+  uint32_t attempt;          // reconnect attempts in the current outage
+  int32_t last_error;        // Discord_Client_Error of the last drop
+  int32_t last_error_detail;
+  uint64_t down_ms;          // length of the current outage, 0 while connected
+  uint64_t next_retry_ms;    // until the scheduled Connect, 0 if none pending
+  uint64_t outages;          // since Begin()
+};
+
+// What a status change meant for the caches
+enum class ConnectionTransition { None, Ready, Lost, Resumed };
+
+// Turns SDK status callbacks into a connection lifecycle and owns reconnects:
+// after the first Ready, any drop is retried with jittered exponential backoff
+// until Ready returns (Resumed) or max_attempts is exhausted (Failed).
+//
+// Every method must be called with the client state lock held. The backoff
+// timer re-enters through run_locked, which is expected to take that lock.
+class ConnectionManager {
+public:
+  using LockedRunner = std::function<void(std::function<void()>)>;
+  using ConnectFn = std::function<void()>;
+
+  ConnectionManager(TimerQueue& timers, LockedRunner run_locked, ConnectFn connect);
+
+  void Configure(const ReconnectOptions& options);
+  ReconnectOptions Options() const { return options_; }
+
+  void Begin();  // Connect was issued for a fresh client
+  void Stop();   // user-initiated disconnect: no further reconnects
+  ConnectionTransition OnStatus(Discord_Client_Status status, Discord_Client_Error error, int32_t error_detail);
+
+  bool IsReady() const { return state_ == ConnectionState::Ready; }
+  ConnectionState State() const { return state_; }
+  ConnectionInfo Info() const;
+
+  static const char* StateName(ConnectionState state);
+  // Equal jitter: half the capped exponential delay plus a random share of the other half
+  static uint32_t BackoffDelayMs(const ReconnectOptions& options, uint32_t attempt, std::mt19937& rng);
+
+private:
+  void SetState(ConnectionState state);
+  void ScheduleReconnect();
+  void OnRetryTimer(uint64_t generation);
+
+  TimerQueue& timers_;
+  LockedRunner run_locked_;
+  ConnectFn connect_;
+  ReconnectOptions options_;
+  std::mt19937 rng_;
+
+  ConnectionState state_ = ConnectionState::Idle;
+  uint64_t generation_ = 0;  // invalidates retry timers that fire after Stop()/Begin()
+  uint32_t attempt_ = 0;
+  int32_t last_error_ = 0;
+  int32_t last_error_detail_ = 0;
+  uint64_t outages_ = 0;
+  uint64_t retry_timer_ = 0;
+  std::chrono::steady_clock::time_point down_since_;
+  std::chrono::steady_clock::time_point retry_at_;
+};
+
+#endif // DISCORD_CONNECTION_H
@@ -1,15 +1,36 @@
 #include "discord_client.h"
-#include <iostream>
+#include "code_codec.h"
+#include "connection.h"
+#include "events.h"
+#include "fan_out.h"
+#include "flight_recorder.h"
+#include "lobby_registry.h"
+#include "logger.h"
+#include "message_history.h"
+#include "message_log.h"
+#include "outbox.h"
+#include "presence.h"
+#include "metrics.h"
+#include "request_scheduler.h"
+#include "sdk_loader.h"
+#include "send_pipeline.h"
+#include "shutdown.h"
+#include "timer_queue.h"
+#include "token_manager.h"
+#include "trace.h"
+#include "voice.h"
+#include "watchdog.h"
 #include <thread>
 #include <mutex>
 #include <chrono>
 #include <cctype>
 #include <cstdlib>
 #include <limits>
-#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
 
 // Helper function to validate string as uint64_t
-static bool IsValidUint64(const std::string& str, uint64_t& out_value) {
+bool IsValidUint64(const std::string& str, uint64_t& out_value) {
   if (str.empty()) return false;
   for (char c : str) {
     if (!std::isdigit(c)) return false;
@@ -29,218 +50,1926 @@ static bool g_client_initialized = false;
 static bool g_client_dropped = false;
 static std::mutex g_state_mutex;
 static std::vector<Guild> g_cached_guilds;
-static std::vector<Channel> g_cached_channels;
+static std::unordered_map<std::string, std::vector<Channel>> g_cached_channels;  // by guild ID
+static NameIndex g_names;  // quickSearch over the cached guild, channel, lobby and friend names
 static User g_cached_user;
+static Watchdog g_watchdog;
+static TimerQueue g_timers;
+static uint64_t g_app_id = 0;
+static std::atomic<bool> g_shutting_down{false};  // set once by Shutdown(); no new SDK requests after it
+
+// Timer callbacks re-enter the client through here
+static void RunLocked(std::function<void()> task) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (g_client_initialized) task();
+}
+
+// The access token is refreshed ahead of expiry and swapped in place with
+// UpdateToken, so the connection and caches survive it
+static bool StartTokenRefresh(uint64_t generation, const std::string& refresh_token);
+static void ApplyRefreshedToken(const std::string& access_token);
+static TokenManager g_tokens(g_timers, RunLocked, StartTokenRefresh, ApplyRefreshedToken);
+static TokenRefresher g_token_refresher;  // set from JS; preferred over the SDK refresh
+
+// Reconnects after the first Ready. Caches stay served while the connection is
+// down; they are only marked stale and revalidated once it resumes.
+static ConnectionManager g_connection(g_timers, RunLocked, []() {
+  // An expired token would only fail the reconnect; renew it first
+  g_tokens.WithValidToken([]() {
+    if (g_client_initialized) sdk::Api().Discord_Client_Connect(&g_client);
+  });
+});
+
+// Every outgoing fetch goes through here: per-route token buckets, served by priority
+static RequestScheduler g_scheduler(g_timers, RunLocked);
+
+static void IssueSend(uint64_t send_id, const SendDestination& destination, const std::string& content);
+static SendPipeline g_sender(IssueSend);
+
+// Sends are accepted while offline and delivered, in order, once Ready
+static Outbox g_outbox(g_timers, RunLocked, [](const std::string& nonce, const SendDestination& destination, const std::string& content) {
+  g_sender.Send(destination, content, [nonce](const SendResult& result) { g_outbox.OnResult(nonce, result); });
+});
+
+// Rich presence: latest activity wins, paced to what Discord accepts
+static void IssuePresence(uint64_t update_id, const PresenceActivity& activity);
+static PresenceEngine g_presence(g_timers, RunLocked, IssuePresence);
+
+// One voice call at a time, on the lobby call APIs
+static bool StartVoiceCall(uint64_t lobby_id);
+static void EndVoiceCall(uint64_t lobby_id);
+static VoiceCall g_voice(g_timers, RunLocked, {
+  StartVoiceCall,
+  EndVoiceCall,
+  [](bool mute) { if (g_client_initialized) sdk::Api().Discord_Client_SetSelfMuteAll(&g_client, mute); },
+  [](bool deaf) { if (g_client_initialized) sdk::Api().Discord_Client_SetSelfDeafAll(&g_client, deaf); },
+});
+
+// Incoming code shares, rebuilt from chunks as they arrive
+static CodeReassembler g_code_reassembler;
+
+// Lobbies and their metadata; handles are opened once and kept until the lobby goes
+static std::unordered_map<uint64_t, Discord_LobbyHandle> g_lobby_handles;
+static std::vector<uint64_t> ListLobbyIds();
+static bool ReadLobby(uint64_t lobby_id, LobbyMetadata& metadata, std::vector<uint64_t>* members);
+static void ReleaseLobby(uint64_t lobby_id);
+static LobbyRegistry g_lobbies({ ListLobbyIds, ReadLobby, ReleaseLobby });
+
+// Friends, requests and blocks with their presence; read once, then patched from callbacks
+static std::vector<uint64_t> ListRelationshipIds();
+static bool ReadRelationship(uint64_t user_id, Relationship& out);
+static RelationshipStore g_relationships({ ListRelationshipIds, ReadRelationship });
+
+// Full-text search over every message the client has seen; history feeds it
+// lobby messages and on_message_created the DMs
+static SearchIndex g_search;
+static std::unordered_map<uint64_t, std::string> g_author_names;
+static void IndexMessage(const HistoryMessage& message, bool lobby);
+
+// Lobby chat history, from MessageCreated and fetched pages, with a copy on
+// disk once a message log directory is configured
+static void IssueHistoryFetch(uint64_t lobby_id, uint32_t limit);
+static MessageLog g_message_log;
+static MessageHistory g_history(IssueHistoryFetch, {
+  [](uint64_t lobby_id, std::vector<HistoryMessage> messages) { g_message_log.Append(lobby_id, std::move(messages)); },
+  [](uint64_t lobby_id, uint64_t before_id, uint32_t limit, std::vector<HistoryMessage>& out, bool& more) {
+    return g_message_log.Read(lobby_id, before_id, limit, out, more);
+  } },
+  [](const std::vector<HistoryMessage>& messages) {
+    for (const HistoryMessage& message : messages) {
+      IndexMessage(message, true);
+    }
+  });
+
+static bool g_guilds_stale = false;
+static bool g_guilds_revalidating = false;
+static std::unordered_set<std::string> g_stale_channel_guilds;
+
+// Asynchronous startup. Initialize() hands the blocking SDK setup to
+// g_init_thread; every later phase is driven by SDK callbacks, and the
+// readiness waiters settle once the warm-up guild fetch lands.
+enum class InitState { Idle, Starting, Ready, Failed };
+static InitState g_init_state = InitState::Idle;
+static std::thread g_init_thread;
+static std::chrono::steady_clock::time_point g_init_started;
+static StartupTimings g_startup;
+static std::vector<DiscordClient::ReadyCallback> g_ready_waiters;
+
+// Passed as userData to async SDK requests so the callback can attribute
+// the round-trip to the operation that issued it
+struct PendingRequest {
+  const char* op;
+  Histogram* latency;
+  std::chrono::steady_clock::time_point started;
+  uint64_t target_id;  // guild or lobby the request is about, or the token generation for refreshes
+  uint64_t watchdog_id;
+  RequestPriority priority;  // class to requeue under if the request was rate limited
+};
+
+// retry is only set for idempotent requests the watchdog may re-issue
+static PendingRequest* NewPendingRequest(const char* op, Histogram& latency, uint64_t target_id = 0,
+                                         Watchdog::RetryFn retry = nullptr, uint32_t attempt = 0,
+                                         RequestPriority priority = RequestPriority::Interactive) {
+  METRIC_COUNTER("requests.issued").Add();
+  FlightRecorder::Instance().Record(FlightEvent::SdkCall, op, attempt, target_id);
+  uint64_t watchdog_id = g_watchdog.BeginRequest(op, std::move(retry), attempt);
+  return new PendingRequest{ op, &latency, std::chrono::steady_clock::now(), target_id, watchdog_id, priority };
+}
+
+static void FreePendingRequest(void* userData) {
+  delete static_cast<PendingRequest*>(userData);
+}
+
+static void CompletePendingRequest(void* userData, bool success) {
+  auto* request = static_cast<PendingRequest*>(userData);
+  if (!request) return;
+  g_watchdog.EndRequest(request->watchdog_id);
+  request->latency->Record(ElapsedMicros(request->started));
+  FlightRecorder::Instance().Record(FlightEvent::SdkCallback, request->op, success ? 1 : 0,
+                                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - request->started).count(),
+                                    request->target_id);
+  TRACE_COMPLETE("sdk", request->op, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      request->started.time_since_epoch()).count()));
+  if (!success) {
+    METRIC_COUNTER("requests.failed").Add();
+  }
+}
+
+// True if the failure was a rate limit; the request's route is paused for as
+// long as the server asked
+static bool NoteRateLimit(void* userData, Discord_ClientResult* result) {
+  auto* request = static_cast<PendingRequest*>(userData);
+  if (!request || !result || sdk::Api().Discord_ClientResult_Successful(result)) return false;
+  float retry_after_s = sdk::Api().Discord_ClientResult_RetryAfter(result);
+  if (retry_after_s <= 0) return false;
+  g_scheduler.OnRateLimited(request->op, static_cast<uint32_t>(retry_after_s * 1000));
+  return true;
+}
+
+static std::string ResultError(Discord_ClientResult* result) {
+  if (!result) return "no result";
+  Discord_String error;
+  sdk::Api().Discord_ClientResult_Error(result, &error);
+  return std::string((const char*)error.ptr, error.size);
+}
+
+const char* StartupPhaseName(StartupPhase phase) {
+  switch (phase) {
+    case StartupPhase::Init: return "init";
+    case StartupPhase::Token: return "token";
+    case StartupPhase::Connecting: return "connecting";
+    case StartupPhase::Connected: return "connected";
+    case StartupPhase::Ready: return "ready";
+    case StartupPhase::FirstGuilds: return "firstGuilds";
+    default: return "unknown";
+  }
+}
+
+static const char* InitStateName(InitState state) {
+  switch (state) {
+    case InitState::Starting: return "starting";
+    case InitState::Ready: return "ready";
+    case InitState::Failed: return "failed";
+    default: return "idle";
+  }
+}
+
+static bool PhaseReached(StartupPhase phase) {
+  return g_startup.phase_ms[static_cast<int>(phase)] >= 0;
+}
+
+// Startup helpers below require g_state_mutex
+static void MarkPhase(StartupPhase phase) {
+  if (g_init_state != InitState::Starting || PhaseReached(phase)) return;
+
+  uint64_t elapsed_us = ElapsedMicros(g_init_started);
+  g_startup.phase_ms[static_cast<int>(phase)] = elapsed_us / 1000.0;
+  const char* name = StartupPhaseName(phase);
+  Metrics::Instance().GetHistogram(std::string("startup.") + name + "_us").Record(elapsed_us);
+  FlightRecorder::Instance().Record(FlightEvent::Timing, name, static_cast<uint32_t>(phase), elapsed_us * 1000);
+  LOG_INFO("⏱️  Startup phase '" << name << "' reached after " << elapsed_us / 1000 << "ms");
+  EmitEvent(NativeEvent("startupPhase").String("phase", name).Number("elapsedMs", elapsed_us / 1000.0));
+}
+
+static void SettleStartup(bool ok, const std::string& error) {
+  if (g_init_state != InitState::Starting) return;
+
+  g_init_state = ok ? InitState::Ready : InitState::Failed;
+  g_startup.state = InitStateName(g_init_state);
+  g_startup.error = error;
+  if (ok) {
+    LOG_INFO("✅ Discord client ready in " << ElapsedMicros(g_init_started) / 1000 << "ms");
+  } else {
+    LOG_ERROR("❌ Discord client startup failed: " << error);
+    FlightRecorder::Instance().Record(FlightEvent::Error, "StartupFailed");
+    g_connection.Stop();  // reconnects only cover drops after the first Ready
+  }
+
+  // Waiters only post to the JS thread, so running them under the lock is cheap
+  std::vector<DiscordClient::ReadyCallback> waiters;
+  waiters.swap(g_ready_waiters);
+  for (auto& waiter : waiters) {
+    waiter(ok, g_startup);
+  }
+}
+
+static void IssueGetUserGuilds(RequestPriority priority, uint32_t attempt);
+static bool IssueGetGuildChannels(uint64_t guild_id, RequestPriority priority, uint32_t attempt);
+
+// Ready is the earliest point requests are accepted, so warm the caches now
+static void WarmUpCaches() {
+  Discord_UserHandle user;
+  sdk::Api().Discord_Client_GetCurrentUser(&g_client, &user);
+  g_cached_user.id = std::to_string(sdk::Api().Discord_UserHandle_Id(&user));
+  Discord_String name_str;
+  sdk::Api().Discord_UserHandle_Username(&user, &name_str);
+  g_cached_user.username = std::string((const char*)name_str.ptr, name_str.size);
+  Discord_String avatar_str;
+  if (sdk::Api().Discord_UserHandle_Avatar(&user, &avatar_str)) {
+    g_cached_user.avatar = std::string((const char*)avatar_str.ptr, avatar_str.size);
+  }
+  sdk::Api().Discord_UserHandle_Drop(&user);
+
+  // Startup waits on this one, so it is not bulk work
+  IssueGetUserGuilds(RequestPriority::Interactive, 0);
+}
+
+// Name index upkeep: each helper re-reads one cache, and the index only
+// touches the entries that changed
+static void IndexGuildNames() {
+  std::vector<NameEntry> entries;
+  entries.reserve(g_cached_guilds.size());
+  for (const Guild& guild : g_cached_guilds) {
+    entries.push_back({ guild.id, guild.name, "" });
+  }
+  g_names.Replace(NameKind::Guild, "", entries);
+}
+
+static void IndexChannelNames(const std::string& guild_id) {
+  std::vector<NameEntry> entries;
+  auto it = g_cached_channels.find(guild_id);
+  if (it != g_cached_channels.end()) {
+    entries.reserve(it->second.size());
+    for (const Channel& channel : it->second) {
+      entries.push_back({ channel.id, channel.name, guild_id });
+    }
+  }
+  g_names.Replace(NameKind::Channel, guild_id, entries);
+}
+
+// Lobbies have no name of their own; the "name" metadata key is used when set
+static void IndexLobbyName(uint64_t lobby_id) {
+  LobbyInfo lobby;
+  auto name = g_lobbies.Get(lobby_id, lobby) ? lobby.metadata.find("name") : lobby.metadata.end();
+  if (name == lobby.metadata.end() || name->second.empty()) {
+    g_names.Remove(NameKind::Lobby, std::to_string(lobby_id));
+  } else {
+    g_names.Put(NameKind::Lobby, { std::to_string(lobby_id), name->second, "" });
+  }
+}
+
+static size_t SyncLobbyRegistry() {
+  size_t count = g_lobbies.Sync();
+  std::vector<NameEntry> entries;
+  for (const LobbyInfo& lobby : g_lobbies.List()) {
+    auto name = lobby.metadata.find("name");
+    if (name != lobby.metadata.end() && !name->second.empty()) {
+      entries.push_back({ std::to_string(lobby.id), name->second, "" });
+    }
+  }
+  g_names.Replace(NameKind::Lobby, "", entries);
+  return count;
+}
+
+// Friend names follow the relationship store
+static void IndexFriendName(uint64_t user_id) {
+  Relationship relationship;
+  if (g_relationships.Get(user_id, relationship) && relationship.kind == RelationshipKind::Friend) {
+    g_names.Put(NameKind::Friend, { std::to_string(user_id), relationship.display_name, "" });
+  } else {
+    g_names.Remove(NameKind::Friend, std::to_string(user_id));
+  }
+}
+
+static size_t SyncRelationships() {
+  size_t count = g_relationships.Sync();
+  std::vector<NameEntry> entries;
+  for (const Relationship& relationship : g_relationships.List(RelationshipFilter()).relationships) {
+    entries.push_back({ std::to_string(relationship.user_id), relationship.display_name, "" });
+  }
+  g_names.Replace(NameKind::Friend, "", entries);
+  return count;
+}
+
+// Caches survive an outage; remember what to refresh once it ends
+static void MarkCachesStale() {
+  g_guilds_stale = true;
+  for (const auto& entry : g_cached_channels) {
+    g_stale_channel_guilds.insert(entry.first);
+  }
+  LOG_INFO("🕸️  Serving cached data (stale) while disconnected");
+}
+
+// On resume only the guild list is refetched eagerly; channel lists are
+// refreshed the next time each guild is opened
+static void RevalidateCaches() {
+  g_guilds_revalidating = true;
+  IssueGetUserGuilds(RequestPriority::Background, 0);
+}
+
+static void DiffRevalidatedGuilds(const std::vector<Guild>& fetched) {
+  std::unordered_map<std::string, const Guild*> previous;
+  for (const Guild& guild : g_cached_guilds) {
+    previous[guild.id] = &guild;
+  }
+
+  std::vector<std::string> added, removed, renamed;
+  for (const Guild& guild : fetched) {
+    auto it = previous.find(guild.id);
+    if (it == previous.end()) {
+      added.push_back(guild.id);
+    } else {
+      if (it->second->name != guild.name) renamed.push_back(guild.id);
+      previous.erase(it);
+    }
+  }
+  for (const auto& gone : previous) {
+    removed.push_back(gone.first);
+    g_cached_channels.erase(gone.first);
+    g_names.Replace(NameKind::Channel, gone.first, {});
+    g_stale_channel_guilds.erase(gone.first);
+  }
+
+  LOG_INFO("🔁 Revalidated guilds: " << added.size() << " added, " << removed.size() << " removed, "
+           << renamed.size() << " renamed");
+  EmitEvent(NativeEvent("cacheRevalidated").StringList("added", added).StringList("removed", removed)
+                .StringList("renamed", renamed).Number("staleChannelLists", g_stale_channel_guilds.size()));
+}
 
 // Callback for GetUserGuilds
 void on_user_guilds(Discord_ClientResult* result, Discord_GuildMinimalSpan guilds, void* userData) {
-  std::cout << "📍 on_user_guilds callback fired! guilds.size=" << guilds.size << std::endl;
+  TRACE_SCOPE("callback", "on_user_guilds");
+  LOG_DEBUG("📍 on_user_guilds callback fired! guilds.size=" << guilds.size);
+  ScopedLatency dispatch(METRIC_HISTOGRAM("callback.on_user_guilds_us"));
+  CompletePendingRequest(userData, result && sdk::Api().Discord_ClientResult_Successful(result));
   
   // NO LOCK HERE - RunCallbacks() already holds the mutex
   // Trying to lock again would cause deadlock
-  g_cached_guilds.clear();
+  bool revalidating = g_guilds_revalidating;
+  g_guilds_revalidating = false;
+  NoteRateLimit(userData, result);
   
-  if (result && Discord_ClientResult_Successful(result)) {
-    std::cout << "✅ Guild fetch successful" << std::endl;
+  if (result && sdk::Api().Discord_ClientResult_Successful(result)) {
+    LOG_DEBUG("✅ Guild fetch successful");
+    std::vector<Guild> fetched;
+    fetched.reserve(guilds.size);
     for (size_t i = 0; i < guilds.size; i++) {
       Guild g;
-      g.id = std::to_string(Discord_GuildMinimal_Id(&guilds.ptr[i]));
+      g.id = std::to_string(sdk::Api().Discord_GuildMinimal_Id(&guilds.ptr[i]));
       
       Discord_String name_str;
-      Discord_GuildMinimal_Name(&guilds.ptr[i], &name_str);
+      sdk::Api().Discord_GuildMinimal_Name(&guilds.ptr[i], &name_str);
       g.name = std::string((const char*)name_str.ptr, name_str.size);
       
       g.icon = "";  // Icon not available in GuildMinimal
       g.owner = false;  // Owner flag not available in GuildMinimal
-      g_cached_guilds.push_back(g);
-      std::cout << "  ➕ Guild: " << g.name << " (" << g.id << ")" << std::endl;
+      fetched.push_back(g);
+      LOG_TRACE("  ➕ Guild: " << g.name << " (" << g.id << ")");
+    }
+    LOG_INFO("📚 Loaded " << guilds.size << " guilds from SDK");
+
+    if (revalidating) {
+      DiffRevalidatedGuilds(fetched);
     }
-    std::cout << "📚 Loaded " << guilds.size << " guilds from SDK" << std::endl;
+    g_cached_guilds.swap(fetched);
+    g_guilds_stale = false;
+    IndexGuildNames();
   } else {
-    std::cout << "⚠️  Failed to fetch guilds (result=" << (result ? "set" : "null") << ")" << std::endl;
+    // Keep serving what we had; it is refetched on the next GetGuilds()
+    LOG_WARN("⚠️  Failed to fetch guilds (result=" << (result ? "set" : "null") << ")");
+    g_guilds_stale = g_guilds_stale || revalidating;
+  }
+
+  // The warm-up fetch completes startup even if it failed: the client is usable
+  if (PhaseReached(StartupPhase::Ready)) {
+    MarkPhase(StartupPhase::FirstGuilds);
+    SettleStartup(true, "");
   }
   
   if (result) {
-    Discord_ClientResult_Drop(result);
+    sdk::Api().Discord_ClientResult_Drop(result);
   }
 }
 
 // Callback for GetGuildChannels  
 void on_guild_channels(Discord_ClientResult* result, Discord_GuildChannelSpan channels, void* userData) {
+  TRACE_SCOPE("callback", "on_guild_channels");
+  ScopedLatency dispatch(METRIC_HISTOGRAM("callback.on_guild_channels_us"));
+  CompletePendingRequest(userData, result && sdk::Api().Discord_ClientResult_Successful(result));
+
   // NO LOCK HERE - RunCallbacks() already holds the mutex
   // Trying to lock again would cause deadlock
-  g_cached_channels.clear();
+  auto* request = static_cast<PendingRequest*>(userData);
+  std::string guild_id = std::to_string(request ? request->target_id : 0);
+  bool rate_limited = NoteRateLimit(userData, result);
   
-  if (result && Discord_ClientResult_Successful(result)) {
+  if (result && sdk::Api().Discord_ClientResult_Successful(result)) {
+    std::vector<Channel> cached;
+    cached.reserve(channels.size);
     for (size_t i = 0; i < channels.size; i++) {
       Channel c;
-      c.id = std::to_string(Discord_GuildChannel_Id(&channels.ptr[i]));
+      c.id = std::to_string(sdk::Api().Discord_GuildChannel_Id(&channels.ptr[i]));
       
       Discord_String name_str;
-      Discord_GuildChannel_Name(&channels.ptr[i], &name_str);
+      sdk::Api().Discord_GuildChannel_Name(&channels.ptr[i], &name_str);
       c.name = std::string((const char*)name_str.ptr, name_str.size);
       
-      c.type = Discord_GuildChannel_Type(&channels.ptr[i]);
-      c.position = Discord_GuildChannel_Position(&channels.ptr[i]);
+      c.type = sdk::Api().Discord_GuildChannel_Type(&channels.ptr[i]);
+      c.position = sdk::Api().Discord_GuildChannel_Position(&channels.ptr[i]);
       
       uint64_t parent_id;
-      if (Discord_GuildChannel_ParentId(&channels.ptr[i], &parent_id)) {
+      if (sdk::Api().Discord_GuildChannel_ParentId(&channels.ptr[i], &parent_id)) {
         c.parent_id = std::to_string(parent_id);
       } else {
         c.parent_id = "";
       }
       
-      g_cached_channels.push_back(c);
+      cached.push_back(c);
     }
-    std::cout << "📍 Loaded " << channels.size << " channels from SDK" << std::endl;
+    LOG_INFO("📍 Loaded " << channels.size << " channels from SDK");
+    g_cached_channels[guild_id].swap(cached);
+    g_stale_channel_guilds.erase(guild_id);
+    IndexChannelNames(guild_id);
+  } else if (rate_limited) {
+    // Goes back into the queue; the scheduler holds it until the pause ends
+    IssueGetGuildChannels(request->target_id, request->priority, 0);
   } else {
-    std::cout << "⚠️  Failed to fetch channels" << std::endl;
+    // A refresh that failed leaves the old list in place, still stale
+    LOG_WARN("⚠️  Failed to fetch channels");
+    if (g_cached_channels.count(guild_id)) {
+      g_stale_channel_guilds.insert(guild_id);
+    }
   }
   
   if (result) {
-    Discord_ClientResult_Drop(result);
+    sdk::Api().Discord_ClientResult_Drop(result);
   }
 }
 
-DiscordClient::DiscordClient() : initialized(false), ready(false) {
-  std::cout << "DiscordClient created (C API)" << std::endl;
+// Callback for SendUserMessage / SendLobbyMessage; target_id is the pipeline's send ID
+void on_message_sent(Discord_ClientResult* result, uint64_t messageId, void* userData) {
+  TRACE_SCOPE("callback", "on_message_sent");
+  bool ok = result && sdk::Api().Discord_ClientResult_Successful(result);
+  CompletePendingRequest(userData, ok);
+
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  auto* request = static_cast<PendingRequest*>(userData);
+  bool rate_limited = NoteRateLimit(userData, result);
+  bool retryable = !result || (!ok && sdk::Api().Discord_ClientResult_Retryable(result));
+  if (request) {
+    g_sender.OnSendComplete(request->target_id, ok, messageId, ok ? "" : ResultError(result), rate_limited,
+                            retryable);
+  }
+
+  if (result) {
+    sdk::Api().Discord_ClientResult_Drop(result);
+  }
 }
 
-DiscordClient::~DiscordClient() {
-  Disconnect();
+// Callback for UpdateRichPresence; target_id is the engine's update ID
+void on_presence_updated(Discord_ClientResult* result, void* userData) {
+  TRACE_SCOPE("callback", "on_presence_updated");
+  bool ok = result && sdk::Api().Discord_ClientResult_Successful(result);
+  CompletePendingRequest(userData, ok);
+
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  auto* request = static_cast<PendingRequest*>(userData);
+  uint32_t retry_after_ms = 0;
+  if (NoteRateLimit(userData, result)) {
+    retry_after_ms = static_cast<uint32_t>(sdk::Api().Discord_ClientResult_RetryAfter(result) * 1000);
+  }
+  if (request) {
+    g_presence.OnComplete(request->target_id, ok, ok ? "" : ResultError(result), retry_after_ms);
+  }
+
+  if (result) {
+    sdk::Api().Discord_ClientResult_Drop(result);
+  }
 }
 
-bool DiscordClient::Initialize(const std::string& application_id, const std::string& access_token) {
-  std::cout << "🚀 Initializing Discord Social SDK (C API) with app ID: " << application_id << std::endl;
+// Call callbacks carry the lobby ID they are about
+static void FreeCallChannel(void* userData) {
+  delete static_cast<uint64_t*>(userData);
+}
 
-  std::lock_guard<std::mutex> lock(g_state_mutex);
+void on_call_status_changed(Discord_Call_Status status, Discord_Call_Error error, int32_t errorDetail, void* userData) {
+  TRACE_SCOPE("callback", "on_call_status_changed");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  FlightRecorder::Instance().Record(FlightEvent::Status, "CallStatus", static_cast<uint32_t>(status),
+                                    static_cast<uint64_t>(error), static_cast<uint64_t>(errorDetail));
+  g_voice.OnCallStatus(*static_cast<uint64_t*>(userData), status, error, errorDetail);
+}
 
-  uint64_t app_id_value;
-  if (!IsValidUint64(application_id, app_id_value)) {
-    std::cerr << "❌ Invalid application ID" << std::endl;
-    return false;
+void on_call_ended(void* userData) {
+  TRACE_SCOPE("callback", "on_call_ended");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_voice.OnCallEnded(*static_cast<uint64_t*>(userData));
+}
+
+void on_lobby_created(uint64_t lobbyId, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_created");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_lobbies.Refresh(lobbyId);
+  IndexLobbyName(lobbyId);
+}
+
+void on_lobby_updated(uint64_t lobbyId, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_updated");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_lobbies.Refresh(lobbyId);
+  IndexLobbyName(lobbyId);
+}
+
+void on_lobby_deleted(uint64_t lobbyId, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_deleted");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_lobbies.Remove(lobbyId);
+  g_names.Remove(NameKind::Lobby, std::to_string(lobbyId));
+  g_history.Forget(lobbyId);
+  g_search.RemoveChannel(lobbyId);
+}
+
+// Member changes are batched until the end of the pump (see RunCallbacks)
+void on_lobby_member_added(uint64_t lobbyId, uint64_t memberId, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_member_added");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_lobbies.OnMemberAdded(lobbyId, memberId);
+}
+
+void on_lobby_member_removed(uint64_t lobbyId, uint64_t memberId, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_member_removed");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_lobbies.OnMemberRemoved(lobbyId, memberId);
+}
+
+void on_lobby_member_updated(uint64_t lobbyId, uint64_t memberId, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_member_updated");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_lobbies.OnMemberUpdated(lobbyId, memberId);
+}
+
+// Relationship changes are folded into one relationshipsChanged per pump (see RunCallbacks)
+void on_relationship_created(uint64_t userId, bool isDiscordRelationshipUpdate, void* userData) {
+  TRACE_SCOPE("callback", "on_relationship_created");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_relationships.Refresh(userId);
+  IndexFriendName(userId);
+}
+
+// Re-read rather than dropped: the user may still be related to us some other way
+void on_relationship_deleted(uint64_t userId, bool isDiscordRelationshipUpdate, void* userData) {
+  TRACE_SCOPE("callback", "on_relationship_deleted");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_relationships.Refresh(userId);
+  IndexFriendName(userId);
+}
+
+// Presence and profile changes; only users we have a relationship with are kept
+void on_user_updated(uint64_t userId, void* userData) {
+  TRACE_SCOPE("callback", "on_user_updated");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  g_author_names.erase(userId);
+  if (!g_relationships.Contains(userId)) return;
+  g_relationships.Refresh(userId);
+  IndexFriendName(userId);
+}
+
+static HistoryMessage ReadHistoryMessage(Discord_MessageHandle* message) {
+  Discord_String content_str;
+  sdk::Api().Discord_MessageHandle_Content(message, &content_str);
+  HistoryMessage read = { sdk::Api().Discord_MessageHandle_Id(message), sdk::Api().Discord_MessageHandle_ChannelId(message),
+                          sdk::Api().Discord_MessageHandle_AuthorId(message),
+                          sdk::Api().Discord_MessageHandle_SentTimestamp(message),
+                          std::string((const char*)content_str.ptr, content_str.size) };
+  sdk::Api().Discord_Free(content_str.ptr);
+  return read;
+}
+
+void on_lobby_messages(Discord_ClientResult* result, Discord_MessageHandleSpan messages, void* userData) {
+  TRACE_SCOPE("callback", "on_lobby_messages");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  bool ok = result && sdk::Api().Discord_ClientResult_Successful(result);
+  CompletePendingRequest(userData, ok);
+  NoteRateLimit(userData, result);
+  uint64_t lobby_id = static_cast<PendingRequest*>(userData)->target_id;
+
+  // The span and every handle in it are ours to release
+  std::vector<HistoryMessage> fetched;
+  if (ok) fetched.reserve(messages.size);
+  for (size_t i = 0; i < messages.size; i++) {
+    if (ok) fetched.push_back(ReadHistoryMessage(&messages.ptr[i]));
+    sdk::Api().Discord_MessageHandle_Drop(&messages.ptr[i]);
+  }
+  sdk::Api().Discord_Free(messages.ptr);
+  g_history.OnFetched(lobby_id, ok, ok ? "" : ResultError(result), fetched);
+  if (result) {
+    sdk::Api().Discord_ClientResult_Drop(result);
   }
+}
 
-  if (access_token.empty()) {
-    std::cerr << "❌ Access token is empty" << std::endl;
-    return false;
+// Usernames of message authors, looked up once; the SDK knows every author it delivered
+static const std::string& AuthorName(uint64_t author_id) {
+  auto it = g_author_names.find(author_id);
+  if (it != g_author_names.end()) return it->second;
+  if (g_author_names.size() >= 10000) g_author_names.clear();
+  std::string& name = g_author_names[author_id];
+  Discord_UserHandle user;
+  if (g_client_initialized && sdk::Api().Discord_Client_GetUser(&g_client, author_id, &user)) {
+    Discord_String name_str;
+    sdk::Api().Discord_UserHandle_Username(&user, &name_str);
+    name.assign((const char*)name_str.ptr, name_str.size);
+    sdk::Api().Discord_UserHandle_Drop(&user);
   }
+  return name;
+}
 
-  // Initialize the C API client
-  try {
-    // CRITICAL: Tell SDK we're in a multi-threaded environment (Node.js)
-    Discord_SetFreeThreaded();
-    std::cout << "📌 Set Discord SDK to free-threaded mode" << std::endl;
+static void IndexMessage(const HistoryMessage& message, bool lobby) {
+  if (message.content.empty()) return;
+  g_search.Add({ message.id, message.lobby_id, lobby, message.author_id, AuthorName(message.author_id),
+                 message.sent_ms, message.content });
+}
 
-    std::cout << "⏳ About to call Discord_Client_Init()..." << std::endl;
-    Discord_Client_Init(&g_client);
-    std::cout << "✅ Discord_Client_Init() completed" << std::endl;
-    g_client_initialized = true;
+// Every message the client sees: lobby messages go to history, code chunks to reassembly
+void on_message_created(uint64_t messageId, void* userData) {
+  TRACE_SCOPE("callback", "on_message_created");
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  Discord_MessageHandle handle;
+  if (!sdk::Api().Discord_Client_GetMessageHandle(&g_client, messageId, &handle)) return;
+  HistoryMessage message = ReadHistoryMessage(&handle);
+  sdk::Api().Discord_MessageHandle_Drop(&handle);
+  // ChannelId is the lobby ID for lobby messages; DMs are only searchable
+  if (g_lobbies.Contains(message.lobby_id)) {
+    g_history.Add(message);
+  } else {
+    IndexMessage(message, false);
+  }
 
-    std::cout << "⏳ About to call Discord_Client_SetApplicationId()..." << std::endl;
-    Discord_Client_SetApplicationId(&g_client, app_id_value);
-    std::cout << "✅ Discord_Client_SetApplicationId() completed" << std::endl;
+  // Our own shares echo back; there is nothing to rebuild
+  if (std::to_string(message.author_id) == g_cached_user.id) return;
+  g_code_reassembler.Feed(message.lobby_id, message.author_id, message.content);
+}
 
-    std::cout << "⏳ About to call Discord_Client_UpdateToken()..." << std::endl;
-    Discord_String token_str = { (uint8_t*)access_token.c_str(), access_token.length() };
-    Discord_Client_UpdateToken(&g_client, Discord_AuthorizationTokenType_Bearer, token_str, NULL, NULL, NULL);
-    std::cout << "✅ Discord_Client_UpdateToken() completed" << std::endl;
+// Status transitions from the SDK (Connecting -> Connected -> Ready, drops, ...)
+void on_status_changed(Discord_Client_Status status, Discord_Client_Error error, int32_t errorDetail, void* userData) {
+  TRACE_SCOPE("callback", "on_status_changed");
+  FlightRecorder::Instance().Record(FlightEvent::Status, "StatusChanged", static_cast<uint32_t>(status),
+                                    static_cast<uint64_t>(error), static_cast<uint64_t>(errorDetail));
+  LOG_INFO("🔄 Client status changed: " << static_cast<int>(status)
+           << " (error=" << static_cast<int>(error) << ", detail=" << errorDetail << ")");
 
-    // Now try to connect - this is what triggers async operations
-    std::cout << "⏳ About to call Discord_Client_Connect()..." << std::endl;
-    Discord_Client_Connect(&g_client);
-    std::cout << "✅ Discord_Client_Connect() completed successfully" << std::endl;
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  switch (g_connection.OnStatus(status, error, errorDetail)) {
+    case ConnectionTransition::Ready:
+      SyncLobbyRegistry();
+      SyncRelationships();
+      g_outbox.SetOnline(true);
+      g_presence.SetOnline(true);
+      break;
+    case ConnectionTransition::Lost:
+      g_outbox.SetOnline(false);
+      g_presence.SetOnline(false);
+      g_voice.Reset("Connection lost");
+      g_history.FailPending("Connection lost");
+      MarkCachesStale();
+      break;
+    case ConnectionTransition::Resumed:
+      RevalidateCaches();
+      SyncLobbyRegistry();  // lobbies and friends may have changed while we were away
+      SyncRelationships();
+      g_outbox.SetOnline(true);
+      g_presence.SetOnline(true);
+      break;
+    default:
+      break;
+  }
 
-    std::cout << "✅ Discord C API initialized successfully" << std::endl;
+  if (g_init_state != InitState::Starting) return;
+  switch (status) {
+    case Discord_Client_Status_Connecting:
+      MarkPhase(StartupPhase::Connecting);
+      break;
+    case Discord_Client_Status_Connected:
+      MarkPhase(StartupPhase::Connected);
+      break;
+    case Discord_Client_Status_Ready:
+      MarkPhase(StartupPhase::Ready);
+      WarmUpCaches();
+      break;
+    case Discord_Client_Status_Disconnected:
+      if (static_cast<int>(error) != 0) {
+        SettleStartup(false, "Connection failed (error=" + std::to_string(static_cast<int>(error)) +
+                                 ", detail=" + std::to_string(errorDetail) + ")");
+      }
+      break;
+    default:
+      break;
+  }
+}
 
-    initialized = true;
-    ready = true;
-    init_time = std::chrono::steady_clock::now();
+// Connect is pipelined behind the token update instead of blocking on it
+void on_token_updated(Discord_ClientResult* result, void* userData) {
+  TRACE_SCOPE("callback", "on_token_updated");
+  bool success = result && sdk::Api().Discord_ClientResult_Successful(result);
+  CompletePendingRequest(userData, success);
 
-    return true;
-  } catch (const std::exception& e) {
-    std::cerr << "❌ Exception during C API init: " << e.what() << std::endl;
-    return false;
-  } catch (...) {
-    std::cerr << "❌ Unknown error during C API init" << std::endl;
-    return false;
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  if (g_init_state == InitState::Starting) {
+    if (success) {
+      MarkPhase(StartupPhase::Token);
+      LOG_DEBUG("⏳ Token accepted, calling sdk::Api().Discord_Client_Connect()...");
+      sdk::Api().Discord_Client_Connect(&g_client);
+      FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "Connect");
+    } else {
+      SettleStartup(false, "Token update failed: " + ResultError(result));
+    }
+  }
+
+  if (result) {
+    sdk::Api().Discord_ClientResult_Drop(result);
   }
 }
 
-void DiscordClient::Disconnect() {
-  std::lock_guard<std::mutex> lock(g_state_mutex);
+// Hot swap of a refreshed token on a live connection
+void on_token_swapped(Discord_ClientResult* result, void* userData) {
+  TRACE_SCOPE("callback", "on_token_swapped");
+  bool success = result && sdk::Api().Discord_ClientResult_Successful(result);
+  CompletePendingRequest(userData, success);
+  if (!success) {
+    LOG_WARN("⚠️  UpdateToken with refreshed token failed: " << ResultError(result));
+  }
+  if (result) {
+    sdk::Api().Discord_ClientResult_Drop(result);
+  }
+}
 
-  if (g_client_initialized && !g_client_dropped) {
-    Discord_Client_Disconnect(&g_client);
-    Discord_Client_Drop(&g_client);
-    g_client_dropped = true;
-    g_client_initialized = false;
-    initialized = false;
-    ready = false;
-    std::cout << "🔌 Discord C API client disconnected" << std::endl;
+void on_token_refreshed(Discord_ClientResult* result, Discord_String accessToken, Discord_String refreshToken,
+                        Discord_AuthorizationTokenType tokenType, int32_t expiresIn, Discord_String scopes,
+                        void* userData) {
+  TRACE_SCOPE("callback", "on_token_refreshed");
+  bool success = result && sdk::Api().Discord_ClientResult_Successful(result);
+  CompletePendingRequest(userData, success);
+
+  // NO LOCK HERE - RunCallbacks() already holds the mutex
+  auto* request = static_cast<PendingRequest*>(userData);
+  uint64_t generation = request ? request->target_id : 0;
+  if (success) {
+    TokenInfo token;
+    token.access_token = std::string((const char*)accessToken.ptr, accessToken.size);
+    token.refresh_token = std::string((const char*)refreshToken.ptr, refreshToken.size);
+    token.expires_in_s = expiresIn > 0 ? static_cast<uint32_t>(expiresIn) : 0;
+    g_tokens.OnRefreshed(generation, token);
+  } else {
+    g_tokens.OnRefreshFailed(generation, ResultError(result));
+  }
+
+  if (result) {
+    sdk::Api().Discord_ClientResult_Drop(result);
   }
 }
 
-void DiscordClient::RunCallbacks() {
-  // CRITICAL: This MUST be called regularly to process SDK callbacks
-  // Discord_SetFreeThreaded() was set, so this should be safe from any thread
-  if (!g_client_initialized) {
-    return;
+static bool StartTokenRefresh(uint64_t generation, const std::string& refresh_token) {
+  if (g_shutting_down) return false;
+  // The JS side reports back on the main thread, outside any SDK callback
+  bool started = g_token_refresher &&
+                 g_token_refresher(refresh_token, [generation](bool ok, const TokenInfo& token, const std::string& error) {
+                   std::lock_guard<std::mutex> lock(g_state_mutex);
+                   if (ok && !token.access_token.empty()) {
+                     g_tokens.OnRefreshed(generation, token);
+                   } else {
+                     g_tokens.OnRefreshFailed(generation, ok ? "refresher returned no access token" : error);
+                   }
+                 });
+  if (started) return true;
+
+  if (refresh_token.empty() || !g_client_initialized) {
+    return false;
   }
-  
-  // Call the SDK's callback processor
-  Discord_RunCallbacks();
+  Discord_String refresh_str = { (uint8_t*)refresh_token.c_str(), refresh_token.length() };
+  sdk::Api().Discord_Client_RefreshToken(&g_client, g_app_id, refresh_str, on_token_refreshed, FreePendingRequest,
+                                         NewPendingRequest("RefreshToken", METRIC_HISTOGRAM("request.refresh_token_us"),
+                                                           generation));
+  return true;
 }
 
-void DiscordClient::FetchGuilds() {
+static void ApplyRefreshedToken(const std::string& access_token) {
+  if (!g_client_initialized) return;  // picked up by the next Initialize()
+  Discord_String token_str = { (uint8_t*)access_token.c_str(), access_token.length() };
+  sdk::Api().Discord_Client_UpdateToken(&g_client, Discord_AuthorizationTokenType_Bearer, token_str, on_token_swapped,
+                                        FreePendingRequest,
+                                        NewPendingRequest("UpdateToken", METRIC_HISTOGRAM("request.update_token_us")));
+}
+
+// Runs on g_init_thread: everything up to the token update, which is async
+static void RunInitPhase(uint64_t app_id, std::string access_token) {
+  TRACE_SCOPE("client", "RunInitPhase");
+  // The library is opened on first connect, never during require()
+  std::string load_error;
+  bool loaded = sdk::Load(&load_error);
+
   std::lock_guard<std::mutex> lock(g_state_mutex);
-  if (!g_client_initialized) {
-    std::cerr << "❌ Client not initialized, cannot fetch guilds" << std::endl;
+  if (g_init_state != InitState::Starting) return;  // disconnected in the meantime
+  if (!loaded) {
+    SettleStartup(false, load_error);
     return;
   }
-  
-  std::cout << "📤 Calling Discord_Client_GetUserGuilds with callback..." << std::endl;
-  Discord_Client_GetUserGuilds(&g_client, on_user_guilds, NULL, NULL);
-  std::cout << "📤 GetUserGuilds call completed (async, callback will fire later)" << std::endl;
-}
 
-std::vector<Guild> DiscordClient::GetGuilds() {
-  std::lock_guard<std::mutex> lock(g_state_mutex);
-  return g_cached_guilds;
+  try {
+    // CRITICAL: Tell SDK we're in a multi-threaded environment (Node.js)
+    sdk::Api().Discord_SetFreeThreaded();
+    LOG_DEBUG("📌 Set Discord SDK to free-threaded mode");
+
+    // A failed earlier attempt leaves a live client behind
+    if (g_client_initialized && !g_client_dropped) {
+      sdk::Api().Discord_Client_Drop(&g_client);
+    }
+
+    LOG_DEBUG("⏳ About to call sdk::Api().Discord_Client_Init()...");
+    sdk::Api().Discord_Client_Init(&g_client);
+    LOG_DEBUG("✅ sdk::Api().Discord_Client_Init() completed");
+    g_client_initialized = true;
+    g_client_dropped = false;
+    sdk::Api().Discord_Client_SetStatusChangedCallback(&g_client, on_status_changed, NULL, NULL);
+    sdk::Api().Discord_Client_SetMessageCreatedCallback(&g_client, on_message_created, NULL, NULL);
+    sdk::Api().Discord_Client_SetLobbyCreatedCallback(&g_client, on_lobby_created, NULL, NULL);
+    sdk::Api().Discord_Client_SetLobbyUpdatedCallback(&g_client, on_lobby_updated, NULL, NULL);
+    sdk::Api().Discord_Client_SetLobbyDeletedCallback(&g_client, on_lobby_deleted, NULL, NULL);
+    sdk::Api().Discord_Client_SetLobbyMemberAddedCallback(&g_client, on_lobby_member_added, NULL, NULL);
+    sdk::Api().Discord_Client_SetLobbyMemberRemovedCallback(&g_client, on_lobby_member_removed, NULL, NULL);
+    sdk::Api().Discord_Client_SetLobbyMemberUpdatedCallback(&g_client, on_lobby_member_updated, NULL, NULL);
+    sdk::Api().Discord_Client_SetRelationshipCreatedCallback(&g_client, on_relationship_created, NULL, NULL);
+    sdk::Api().Discord_Client_SetRelationshipDeletedCallback(&g_client, on_relationship_deleted, NULL, NULL);
+    sdk::Api().Discord_Client_SetUserUpdatedCallback(&g_client, on_user_updated, NULL, NULL);
+    sdk::Api().Discord_Client_SetApplicationId(&g_client, app_id);
+    MarkPhase(StartupPhase::Init);
+
+    LOG_DEBUG("⏳ About to call sdk::Api().Discord_Client_UpdateToken()...");
+    Discord_String token_str = { (uint8_t*)access_token.c_str(), access_token.length() };
+    sdk::Api().Discord_Client_UpdateToken(&g_client, Discord_AuthorizationTokenType_Bearer, token_str, on_token_updated,
+                               FreePendingRequest,
+                               NewPendingRequest("UpdateToken", METRIC_HISTOGRAM("request.update_token_us")));
+  } catch (const std::exception& e) {
+    LOG_ERROR("❌ Exception during C API init: " << e.what());
+    FlightRecorder::Instance().Record(FlightEvent::Error, "InitializeException");
+    SettleStartup(false, std::string("SDK initialization threw: ") + e.what());
+  } catch (...) {
+    LOG_ERROR("❌ Unknown error during C API init");
+    FlightRecorder::Instance().Record(FlightEvent::Error, "InitializeException");
+    SettleStartup(false, "SDK initialization threw");
+  }
 }
 
-std::vector<Channel> DiscordClient::GetGuildChannels(const std::string& guild_id) {
-  std::lock_guard<std::mutex> lock(g_state_mutex);
-  return g_cached_channels;
+// Request issuers - callers must hold g_state_mutex and have an initialized client.
+// The SDK call itself runs when the scheduler grants the route a token.
+static void IssueGetUserGuilds(RequestPriority priority, uint32_t attempt) {
+  if (g_shutting_down) return;
+  // There is only one guild list, so repeated fetches coalesce on a fixed key
+  g_scheduler.Submit("GetUserGuilds", priority, 1, [priority, attempt]() {
+    if (g_shutting_down || !g_client_initialized) return;
+    LOG_DEBUG("📤 Calling Discord_Client_GetUserGuilds with callback...");
+    Watchdog::RetryFn retry = [priority](uint32_t next_attempt) {
+      std::lock_guard<std::mutex> lock(g_state_mutex);
+      if (g_client_initialized) IssueGetUserGuilds(priority, next_attempt);
+    };
+    sdk::Api().Discord_Client_GetUserGuilds(&g_client, on_user_guilds, FreePendingRequest,
+                                 NewPendingRequest("GetUserGuilds", METRIC_HISTOGRAM("request.get_user_guilds_us"),
+                                                   0, retry, attempt, priority));
+    LOG_DEBUG("📤 GetUserGuilds call completed (async, callback will fire later)");
+  });
 }
 
-User DiscordClient::GetCurrentUser() {
-  std::lock_guard<std::mutex> lock(g_state_mutex);
-  return g_cached_user;
+static bool IssueGetGuildChannels(uint64_t guild_id, RequestPriority priority, uint32_t attempt) {
+  if (g_shutting_down) return false;
+  return g_scheduler.Submit("GetGuildChannels", priority, guild_id, [guild_id, priority, attempt]() {
+    if (g_shutting_down || !g_client_initialized) return;
+    LOG_DEBUG("📤 Calling Discord_Client_GetGuildChannels for guild " << guild_id);
+    Watchdog::RetryFn retry = [guild_id, priority](uint32_t next_attempt) {
+      std::lock_guard<std::mutex> lock(g_state_mutex);
+      if (g_client_initialized) IssueGetGuildChannels(guild_id, priority, next_attempt);
+    };
+    sdk::Api().Discord_Client_GetGuildChannels(&g_client, guild_id, on_guild_channels, FreePendingRequest,
+                                    NewPendingRequest("GetGuildChannels", METRIC_HISTOGRAM("request.get_guild_channels_us"),
+                                                      guild_id, retry, attempt, priority));
+  });
 }
 
-bool DiscordClient::SendMessage(const std::string& channel_id, const std::string& user_id, const std::string& content) {
-  // Not implemented in C API wrapper here; the Social SDK may not expose send message over this API.
-  std::cout << "⚠️  SendMessage not implemented (use REST or other API)" << std::endl;
-  return false;
+// Presence updates are paced by g_presence, so the scheduler rarely holds one
+static void IssuePresence(uint64_t update_id, const PresenceActivity& activity) {
+  g_scheduler.Submit("UpdateRichPresence", RequestPriority::Interactive, 0, [update_id, activity]() {
+    if (g_shutting_down || !g_client_initialized) {
+      g_presence.OnComplete(update_id, false, "Client not connected", 0);
+      return;
+    }
+    if (activity.cleared) {
+      sdk::Api().Discord_Client_ClearRichPresence(&g_client);
+      g_presence.OnComplete(update_id, true, "", 0);
+      return;
+    }
+
+    auto to_sdk = [](const std::string& value) { return Discord_String{ (uint8_t*)value.data(), value.size() }; };
+    Discord_Activity sdk_activity;
+    sdk::Api().Discord_Activity_Init(&sdk_activity);
+    sdk::Api().Discord_Activity_SetType(&sdk_activity, Discord_ActivityTypes_Playing);
+    Discord_String details = to_sdk(activity.details);
+    Discord_String state = to_sdk(activity.state);
+    sdk::Api().Discord_Activity_SetDetails(&sdk_activity, activity.details.empty() ? nullptr : &details);
+    sdk::Api().Discord_Activity_SetState(&sdk_activity, activity.state.empty() ? nullptr : &state);
+
+    Discord_ActivityTimestamps timestamps;
+    sdk::Api().Discord_ActivityTimestamps_Init(&timestamps);
+    sdk::Api().Discord_ActivityTimestamps_SetStart(&timestamps, activity.start_ms);
+    sdk::Api().Discord_Activity_SetTimestamps(&sdk_activity, activity.start_ms ? &timestamps : nullptr);
+
+    Discord_ActivityAssets assets;
+    sdk::Api().Discord_ActivityAssets_Init(&assets);
+    Discord_String large_image = to_sdk(activity.large_image), large_text = to_sdk(activity.large_text);
+    Discord_String small_image = to_sdk(activity.small_image), small_text = to_sdk(activity.small_text);
+    sdk::Api().Discord_ActivityAssets_SetLargeImage(&assets, activity.large_image.empty() ? nullptr : &large_image);
+    sdk::Api().Discord_ActivityAssets_SetLargeText(&assets, activity.large_text.empty() ? nullptr : &large_text);
+    sdk::Api().Discord_ActivityAssets_SetSmallImage(&assets, activity.small_image.empty() ? nullptr : &small_image);
+    sdk::Api().Discord_ActivityAssets_SetSmallText(&assets, activity.small_text.empty() ? nullptr : &small_text);
+    sdk::Api().Discord_Activity_SetAssets(&sdk_activity, &assets);
+
+    // The activity keeps its own copies of the parts
+    sdk::Api().Discord_Client_UpdateRichPresence(&g_client, &sdk_activity, on_presence_updated, FreePendingRequest,
+                                                 NewPendingRequest("UpdateRichPresence",
+                                                                   METRIC_HISTOGRAM("request.update_rich_presence_us"),
+                                                                   update_id));
+    sdk::Api().Discord_ActivityAssets_Drop(&assets);
+    sdk::Api().Discord_ActivityTimestamps_Drop(&timestamps);
+    sdk::Api().Discord_Activity_Drop(&sdk_activity);
+  });
 }
 
-bool DiscordClient::JoinVoiceChannel(const std::string& guild_id, const std::string& channel_id) {
-  std::lock_guard<std::mutex> lock(g_state_mutex);
-  if (!g_client_initialized) return false;
-  // Implement voice join via SDK if available; returning true for now
+// StartCall is synchronous; the call reports its progress through status changes
+static bool StartVoiceCall(uint64_t lobby_id) {
+  if (g_shutting_down || !g_client_initialized) return false;
+  Discord_Call call;
+  if (!sdk::Api().Discord_Client_StartCall(&g_client, lobby_id, &call)) return false;
+  sdk::Api().Discord_Call_SetStatusChangedCallback(&call, on_call_status_changed, FreeCallChannel,
+                                                   new uint64_t(lobby_id));
+  sdk::Api().Discord_Call_Drop(&call);  // only the handle; the call lives on in the client
   return true;
 }
 
-bool DiscordClient::LeaveVoiceChannel() {
-  std::lock_guard<std::mutex> lock(g_state_mutex);
-  if (!g_client_initialized) return false;
-  return true;
+static void EndVoiceCall(uint64_t lobby_id) {
+  if (!g_client_initialized) {
+    g_voice.OnCallEnded(lobby_id);
+    return;
+  }
+  sdk::Api().Discord_Client_EndCall(&g_client, lobby_id, on_call_ended, FreeCallChannel, new uint64_t(lobby_id));
+}
+
+static std::vector<uint64_t> ListLobbyIds() {
+  if (!g_client_initialized) return {};
+  Discord_UInt64Span ids;
+  sdk::Api().Discord_Client_GetLobbyIds(&g_client, &ids);
+  std::vector<uint64_t> lobby_ids(ids.ptr, ids.ptr + ids.size);
+  sdk::Api().Discord_Free(ids.ptr);
+  return lobby_ids;
+}
+
+// Handles read through to the client's lobby state, so a cached one stays current
+static std::vector<uint64_t> ListRelationshipIds() {
+  if (!g_client_initialized) return {};
+  Discord_RelationshipHandleSpan relationships;
+  sdk::Api().Discord_Client_GetRelationships(&g_client, &relationships);
+  std::vector<uint64_t> ids;
+  ids.reserve(relationships.size);
+  for (size_t i = 0; i < relationships.size; i++) {
+    ids.push_back(sdk::Api().Discord_RelationshipHandle_Id(&relationships.ptr[i]));
+    sdk::Api().Discord_RelationshipHandle_Drop(&relationships.ptr[i]);
+  }
+  sdk::Api().Discord_Free(relationships.ptr);
+  return ids;
 }
 
-bool DiscordClient::SetActivityRichPresence(const std::string& details, const std::string& state) {
-  // Rich presence is not available in basic C API wrapper
-  // This would require advanced Activity management APIs
-  std::cout << "⚠️  SetActivityRichPresence not available in C API" << std::endl;
-  return false;
+static FriendStatus ToFriendStatus(Discord_StatusType status) {
+  switch (status) {
+    case Discord_StatusType_Online:
+    case Discord_StatusType_Streaming:
+      return FriendStatus::Online;
+    case Discord_StatusType_Idle:
+      return FriendStatus::Idle;
+    case Discord_StatusType_Dnd:
+      return FriendStatus::Dnd;
+    default:
+      return FriendStatus::Offline;  // invisible looks offline to everyone else
+  }
+}
+
+static RelationshipKind ToRelationshipKind(Discord_RelationshipType type) {
+  switch (type) {
+    case Discord_RelationshipType_Friend:
+      return RelationshipKind::Friend;
+    case Discord_RelationshipType_PendingIncoming:
+      return RelationshipKind::Incoming;
+    case Discord_RelationshipType_PendingOutgoing:
+      return RelationshipKind::Outgoing;
+    case Discord_RelationshipType_Blocked:
+      return RelationshipKind::Blocked;
+    default:
+      return RelationshipKind::Other;
+  }
+}
+
+static bool ReadRelationship(uint64_t user_id, Relationship& out) {
+  if (!g_client_initialized) return false;
+  Discord_RelationshipHandle handle;
+  if (!sdk::Api().Discord_Client_GetRelationshipHandle(&g_client, user_id, &handle)) return false;
+  Discord_RelationshipType type = sdk::Api().Discord_RelationshipHandle_DiscordRelationshipType(&handle);
+  if (type == Discord_RelationshipType_None) {
+    sdk::Api().Discord_RelationshipHandle_Drop(&handle);
+    return false;
+  }
+  out.kind = ToRelationshipKind(type);
+  Discord_UserHandle user;
+  if (sdk::Api().Discord_RelationshipHandle_User(&handle, &user)) {
+    Discord_String name_str;
+    sdk::Api().Discord_UserHandle_Username(&user, &name_str);
+    out.username.assign((const char*)name_str.ptr, name_str.size);
+    sdk::Api().Discord_Free(name_str.ptr);
+    Discord_String global_str;
+    bool has_global = sdk::Api().Discord_UserHandle_GlobalName(&user, &global_str);
+    if (has_global && global_str.size > 0) {
+      out.display_name.assign((const char*)global_str.ptr, global_str.size);
+    } else {
+      out.display_name = out.username;
+    }
+    if (has_global) sdk::Api().Discord_Free(global_str.ptr);
+    out.status = ToFriendStatus(sdk::Api().Discord_UserHandle_Status(&user));
+    sdk::Api().Discord_UserHandle_Drop(&user);
+  }
+  sdk::Api().Discord_RelationshipHandle_Drop(&handle);
+  return true;
+}
+
+static bool ReadLobby(uint64_t lobby_id, LobbyMetadata& metadata, std::vector<uint64_t>* members) {
+  if (!g_client_initialized) return false;
+  auto it = g_lobby_handles.find(lobby_id);
+  if (it == g_lobby_handles.end()) {
+    Discord_LobbyHandle handle;
+    if (!sdk::Api().Discord_Client_GetLobbyHandle(&g_client, lobby_id, &handle)) return false;
+    it = g_lobby_handles.emplace(lobby_id, handle).first;
+  }
+  Discord_Properties properties;
+  sdk::Api().Discord_LobbyHandle_Metadata(&it->second, &properties);
+  for (size_t i = 0; i < properties.size; i++) {
+    metadata[std::string((const char*)properties.keys[i].ptr, properties.keys[i].size)] =
+        std::string((const char*)properties.values[i].ptr, properties.values[i].size);
+  }
+  sdk::Api().Discord_FreeProperties(properties);
+  if (members) {
+    Discord_UInt64Span ids;
+    sdk::Api().Discord_LobbyHandle_LobbyMemberIds(&it->second, &ids);
+    members->assign(ids.ptr, ids.ptr + ids.size);
+    sdk::Api().Discord_Free(ids.ptr);
+  }
+  return true;
+}
+
+static void ReleaseLobby(uint64_t lobby_id) {
+  auto it = g_lobby_handles.find(lobby_id);
+  if (it == g_lobby_handles.end()) return;
+  if (g_client_initialized) sdk::Api().Discord_LobbyHandle_Drop(&it->second);
+  g_lobby_handles.erase(it);
+}
+
+// One fetch per lobby is in flight (see MessageHistory), so the lobby is the key
+static void IssueHistoryFetch(uint64_t lobby_id, uint32_t limit, uint32_t attempt) {
+  bool queued = !g_shutting_down &&
+                g_scheduler.Submit("GetLobbyMessages", RequestPriority::Interactive, lobby_id, [lobby_id, limit, attempt]() {
+    if (g_shutting_down || !g_client_initialized) {
+      g_history.OnFetched(lobby_id, false, "Client not connected", {});
+      return;
+    }
+    Watchdog::RetryFn retry = [lobby_id, limit](uint32_t next_attempt) {
+      std::lock_guard<std::mutex> lock(g_state_mutex);
+      if (g_client_initialized) IssueHistoryFetch(lobby_id, limit, next_attempt);
+    };
+    sdk::Api().Discord_Client_GetLobbyMessagesWithLimit(&g_client, lobby_id, static_cast<int32_t>(limit),
+                                                        on_lobby_messages, FreePendingRequest,
+                                                        NewPendingRequest("GetLobbyMessages",
+                                                                          METRIC_HISTOGRAM("request.get_lobby_messages_us"),
+                                                                          lobby_id, retry, attempt));
+  });
+  if (!queued) g_history.OnFetched(lobby_id, false, "Request queue is full", {});
+}
+
+static void IssueHistoryFetch(uint64_t lobby_id, uint32_t limit) {
+  IssueHistoryFetch(lobby_id, limit, 0);
+}
+
+// Sends are not idempotent, so the watchdog never retries them
+static void IssueSend(uint64_t send_id, const SendDestination& destination, const std::string& content) {
+  bool to_user = destination.target == SendTarget::User;
+  const char* route = to_user ? "SendUserMessage" : "SendLobbyMessage";
+  g_scheduler.Submit(route, RequestPriority::Interactive, 0, [send_id, destination, content, to_user, route]() {
+    if (g_shutting_down || !g_client_initialized) {
+      g_sender.OnSendComplete(send_id, false, 0, g_shutting_down ? "Client is shutting down" : "Client not connected",
+                              false, true);
+      return;
+    }
+    Histogram& latency = to_user ? METRIC_HISTOGRAM("request.send_user_message_us")
+                                 : METRIC_HISTOGRAM("request.send_lobby_message_us");
+    Discord_String text{ (uint8_t*)content.data(), content.size() };
+    PendingRequest* request = NewPendingRequest(route, latency, send_id);
+    if (to_user) {
+      sdk::Api().Discord_Client_SendUserMessage(&g_client, destination.id, text, on_message_sent, FreePendingRequest,
+                                                request);
+    } else {
+      sdk::Api().Discord_Client_SendLobbyMessage(&g_client, destination.id, text, on_message_sent, FreePendingRequest,
+                                                 request);
+    }
+  });
+}
+
+DiscordClient::DiscordClient() : initialized(false), ready(false) {
+  for (double& phase : g_startup.phase_ms) {
+    phase = -1;
+  }
+  g_startup.state = InitStateName(g_init_state);
+
+  // Whatever is still queued must be on disk before the process goes away
+  static std::once_flag hooks_registered;
+  std::call_once(hooks_registered, []() {
+    RegisterFlushHook("outbox", [](std::chrono::steady_clock::time_point deadline) {
+      std::lock_guard<std::mutex> lock(g_state_mutex);
+      if (g_outbox.Sync(deadline)) g_outbox.Close();
+    });
+    RegisterFlushHook("messagelog", [](std::chrono::steady_clock::time_point deadline) {
+      std::lock_guard<std::mutex> lock(g_state_mutex);
+      if (g_message_log.Sync(deadline)) g_message_log.Close();
+    });
+  });
+  LOG_DEBUG("DiscordClient created (C API)");
+}
+
+DiscordClient::~DiscordClient() {
+  Disconnect();
+}
+
+bool DiscordClient::Initialize(const std::string& application_id, const std::string& access_token,
+                               const std::string& refresh_token, uint32_t expires_in_s) {
+  TRACE_SCOPE("client", "DiscordClient::Initialize");
+  LOG_INFO("🚀 Initializing Discord Social SDK (C API) with app ID: " << application_id);
+
+  uint64_t app_id_value;
+  if (!IsValidUint64(application_id, app_id_value)) {
+    LOG_ERROR("❌ Invalid application ID");
+    return false;
+  }
+
+  if (access_token.empty()) {
+    LOG_ERROR("❌ Access token is empty");
+    return false;
+  }
+
+  if (g_shutting_down) {
+    LOG_ERROR("❌ Client is shut down");
+    return false;
+  }
+
+  // Reap the previous session's init thread; it never outlives its own phase
+  if (g_init_thread.joinable()) {
+    g_init_thread.join();
+  }
+
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (g_init_state == InitState::Starting || g_init_state == InitState::Ready) {
+    LOG_WARN("⚠️  Initialize() called while already " << InitStateName(g_init_state) << ", ignoring");
+    return true;
+  }
+
+  FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "Initialize");
+  g_init_state = InitState::Starting;
+  g_init_started = std::chrono::steady_clock::now();
+  g_startup.state = InitStateName(g_init_state);
+  g_startup.error.clear();
+  for (double& phase : g_startup.phase_ms) {
+    phase = -1;
+  }
+
+  // SDK setup can take a while; keep it off the caller's (JS) thread
+  g_init_thread = std::thread(RunInitPhase, app_id_value, access_token);
+
+  g_app_id = app_id_value;
+  g_tokens.SetToken(TokenInfo{ access_token, refresh_token, expires_in_s });
+  g_connection.Begin();
+  g_guilds_stale = false;
+  g_stale_channel_guilds.clear();
+
+  initialized = true;
+  init_time = g_init_started;
+  g_watchdog.Start();
+  return true;
+}
+
+void DiscordClient::WhenReady(ReadyCallback callback) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  switch (g_init_state) {
+    case InitState::Starting:
+      g_ready_waiters.push_back(std::move(callback));
+      break;
+    case InitState::Ready:
+      callback(true, g_startup);
+      break;
+    case InitState::Failed:
+      callback(false, g_startup);
+      break;
+    case InitState::Idle: {
+      StartupTimings timings = g_startup;
+      timings.error = "Client not initialized";
+      callback(false, timings);
+      break;
+    }
+  }
+}
+
+StartupTimings DiscordClient::GetStartupTimings() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_startup;
+}
+
+void DiscordClient::Disconnect() {
+  TRACE_SCOPE("client", "DiscordClient::Disconnect");
+  DisconnectClient();
+  initialized = false;
+  ready = false;
+}
+
+void DiscordClient::DisconnectClient() {
+  // Stop before taking the lock: a retry on the watchdog thread may be waiting for it
+  g_watchdog.Stop();
+  if (g_init_thread.joinable()) {
+    g_init_thread.join();
+  }
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  SettleStartup(false, "Disconnected before the client became ready");
+  g_connection.Stop();
+  g_tokens.Reset();
+  g_scheduler.Clear();
+  // Offline first, so the failed sends go back to the outbox instead of being retried
+  g_outbox.SetOnline(false);
+  g_sender.FailAll("Disconnected");
+  g_presence.SetOnline(false);
+  g_voice.Reset("Disconnected");
+  g_history.FailPending("Disconnected");
+  g_lobbies.Clear();  // handles must go before the client
+  g_relationships.Clear();
+  g_relationships.Flush();
+  g_names.Replace(NameKind::Lobby, "", {});
+  g_names.Replace(NameKind::Friend, "", {});
+  g_init_state = InitState::Idle;
+  g_startup.state = InitStateName(g_init_state);
+
+  if (g_client_initialized && !g_client_dropped) {
+    FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "Disconnect");
+    sdk::Api().Discord_Client_Disconnect(&g_client);
+    sdk::Api().Discord_Client_Drop(&g_client);
+    g_client_dropped = true;
+    g_client_initialized = false;
+    LOG_INFO("🔌 Discord C API client disconnected");
+  }
+}
+
+ShutdownReport DiscordClient::Shutdown(uint32_t timeout_ms) {
+  TRACE_SCOPE("client", "DiscordClient::Shutdown");
+  ShutdownReport report;
+  if (g_shutting_down.exchange(true)) {
+    return report;  // already shut down
+  }
+  report.performed = true;
+
+  auto started = std::chrono::steady_clock::now();
+  auto deadline = started + std::chrono::milliseconds(timeout_ms);
+  // Draining gets at most half the budget; flushing and teardown must still fit
+  auto drain_deadline = started + std::chrono::milliseconds(timeout_ms / 2);
+  LOG_INFO("🚪 Shutting down Discord client (budget " << timeout_ms << "ms)");
+  FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "Shutdown", timeout_ms);
+
+  {
+    ShutdownStageTimer stage(report, "stopAccepting");
+    std::lock_guard<std::mutex> lock(g_state_mutex);
+    SettleStartup(false, "Client is shutting down");
+    g_connection.Stop();
+    g_tokens.Reset();
+    g_scheduler.Clear();
+    g_outbox.SetOnline(false);  // sends already at the SDK still drain below
+    g_presence.SetOnline(false);
+    g_voice.Reset("Client is shutting down");
+  }
+
+  {
+    ShutdownStageTimer stage(report, "drain");
+    // Let callbacks for requests already sent land (they may update caches that get flushed next)
+    for (;;) {
+      size_t pending = g_watchdog.InFlight().size();
+      if (pending == 0) break;
+      if (std::chrono::steady_clock::now() >= drain_deadline) {
+        report.abandoned_requests = static_cast<uint32_t>(pending);
+        LOG_WARN("⚠️  Abandoning " << pending << " in-flight SDK requests at shutdown");
+        break;
+      }
+      {
+        std::lock_guard<std::mutex> lock(g_state_mutex);
+        if (!g_client_initialized) break;
+        sdk::Api().Discord_RunCallbacks();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+
+  RunFlushHooks(deadline, report);
+
+  {
+    ShutdownStageTimer stage(report, "disconnect");
+    DiscordClient::DisconnectClient();
+  }
+
+  {
+    ShutdownStageTimer stage(report, "timers");
+    g_timers.Stop();
+    g_search.Stop();
+  }
+
+  uint64_t elapsed_us = ElapsedMicros(started);
+  report.total_ms = elapsed_us / 1000.0;
+  report.within_deadline = std::chrono::steady_clock::now() <= deadline;
+  METRIC_HISTOGRAM("shutdown.total_us").Record(elapsed_us);
+  FlightRecorder::Instance().Record(FlightEvent::Timing, "Shutdown", report.abandoned_requests, elapsed_us * 1000);
+  LOG_INFO("🚪 Shutdown finished in " << elapsed_us / 1000 << "ms"
+           << (report.within_deadline ? "" : " (over budget)"));
+  Logger::Instance().Flush();
+  return report;
+}
+
+void DiscordClient::RunCallbacks() {
+  TRACE_SCOPE("client", "DiscordClient::RunCallbacks");
+  // CRITICAL: This MUST be called regularly to process SDK callbacks
+  // sdk::Api().Discord_SetFreeThreaded() was set, so this should be safe from any thread.
+  // Callbacks rely on this lock; if the init thread holds it, skip this pump
+  // rather than stall the caller - the next one picks the callbacks up.
+  if (g_shutting_down) {
+    return;  // Shutdown() pumps the drain itself
+  }
+  std::unique_lock<std::mutex> lock(g_state_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    METRIC_COUNTER("callbacks.pump_skipped").Add();
+    return;
+  }
+  if (!g_client_initialized) {
+    return;
+  }
+  
+  // Call the SDK's callback processor
+  g_watchdog.NotePump();
+  auto started = std::chrono::steady_clock::now();
+  sdk::Api().Discord_RunCallbacks();
+  g_lobbies.FlushMemberDiffs();  // one roster diff per lobby per pump
+  g_relationships.Flush();
+  uint64_t elapsed_us = ElapsedMicros(started);
+  METRIC_HISTOGRAM("callbacks.run_us").Record(elapsed_us);
+
+  // Only slow pumps are worth a flight-recorder slot
+  if (elapsed_us >= 10000) {
+    FlightRecorder::Instance().Record(FlightEvent::Timing, "RunCallbacks", 0, elapsed_us * 1000);
+  }
+}
+
+void DiscordClient::FetchGuilds() {
+  TRACE_SCOPE("client", "DiscordClient::FetchGuilds");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (!g_client_initialized) {
+    LOG_ERROR("❌ Client not initialized, cannot fetch guilds");
+    return;
+  }
+  
+  IssueGetUserGuilds(RequestPriority::Interactive, 0);
+}
+
+std::vector<Guild> DiscordClient::GetGuilds() {
+  TRACE_SCOPE("client", "DiscordClient::GetGuilds");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  (g_cached_guilds.empty() ? METRIC_COUNTER("cache.guilds.miss") : METRIC_COUNTER("cache.guilds.hit")).Add();
+
+  // Stale-while-revalidate: a failed revalidation is retried by the next read
+  if (g_guilds_stale) {
+    METRIC_COUNTER("cache.guilds.stale").Add();
+    if (g_connection.IsReady() && !g_guilds_revalidating) {
+      RevalidateCaches();
+    }
+  }
+  return g_cached_guilds;
+}
+
+std::vector<Channel> DiscordClient::GetGuildChannels(const std::string& guild_id) {
+  TRACE_SCOPE("client", "DiscordClient::GetGuildChannels");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+
+  uint64_t gid;
+  bool can_fetch = g_client_initialized && g_connection.IsReady() && IsValidUint64(guild_id, gid);
+
+  auto it = g_cached_channels.find(guild_id);
+  if (it != g_cached_channels.end()) {
+    METRIC_COUNTER("cache.channels.hit").Add();
+    // Served as-is; the refresh lands in the cache for the next call
+    if (g_stale_channel_guilds.count(guild_id)) {
+      METRIC_COUNTER("cache.channels.stale").Add();
+      if (can_fetch) {
+        g_stale_channel_guilds.erase(guild_id);
+        IssueGetGuildChannels(gid, RequestPriority::Interactive, 0);
+      }
+    }
+    return it->second;
+  }
+  METRIC_COUNTER("cache.channels.miss").Add();
+
+  // Cold guild - request its channels; they are served from cache on the next call
+  if (can_fetch) {
+    IssueGetGuildChannels(gid, RequestPriority::Interactive, 0);
+  }
+  return {};
+}
+
+uint32_t DiscordClient::PrefetchGuildChannels(const std::vector<std::string>& guild_ids, RequestPriority priority) {
+  TRACE_SCOPE("client", "DiscordClient::PrefetchGuildChannels");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (!g_client_initialized || !g_connection.IsReady()) {
+    return 0;
+  }
+
+  uint32_t queued = 0;
+  for (const std::string& guild_id : guild_ids) {
+    uint64_t gid;
+    // Fresh lists are skipped; stale ones are refreshed like an open would
+    if (!IsValidUint64(guild_id, gid)) continue;
+    if (g_cached_channels.count(guild_id) && !g_stale_channel_guilds.count(guild_id)) continue;
+    if (!IssueGetGuildChannels(gid, priority, 0)) break;  // class is full; the rest would be rejected too
+    g_stale_channel_guilds.erase(guild_id);
+    queued++;
+  }
+  return queued;
+}
+
+User DiscordClient::GetCurrentUser() {
+  TRACE_SCOPE("client", "DiscordClient::GetCurrentUser");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_cached_user;
+}
+
+// Checked before the outbox so a message that can never be sent is not persisted
+static const char* RejectSend(const std::string& content) {
+  if (g_shutting_down) return "Client is shutting down";
+  if (content.empty()) return "Message content is empty";
+  if (MessageLength(content) > g_sender.Options().max_content_length) return "Message content is too long";
+  return nullptr;
+}
+
+// One payload to many destinations through the outbox, window at a time
+// (0 = the pipeline's in-flight limit). Every item gets its own nonce.
+static void FanOutMessage(std::vector<SendDestination> destinations, std::string content, uint32_t window,
+                          std::function<void(const FanOutResult& result)> done) {
+  const char* rejected = RejectSend(content);
+  if (rejected) METRIC_COUNTER("send.rejected").Add();
+  std::string batch_id = NewTransferId();
+  FanOutSend(std::move(destinations), std::move(content), window ? window : g_sender.Options().max_in_flight,
+             [rejected, batch_id](size_t index, const SendDestination& destination, const std::string& content,
+                                  SendDone sent) {
+    if (rejected) {
+      sent({ false, 0, rejected, 0, false });
+      return;
+    }
+    g_outbox.Enqueue(batch_id + "-" + std::to_string(index), destination, content, std::move(sent));
+  }, std::move(done));
+}
+
+std::string DiscordClient::SendMessage(const SendDestination& destination, const std::string& content,
+                                       const std::string& nonce, SendDone done) {
+  TRACE_SCOPE("client", "DiscordClient::SendMessage");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  const char* rejected = RejectSend(content);
+  if (rejected) {
+    METRIC_COUNTER("send.rejected").Add();
+    done({ false, 0, rejected, 0, false });
+    return nonce;
+  }
+  return g_outbox.Enqueue(nonce, destination, content, std::move(done));
+}
+
+void DiscordClient::SendCode(uint64_t lobby_id, const std::string& code, CodeShareOptions options,
+                             std::function<void(const CodeShareResult& result)> done) {
+  TRACE_SCOPE("client", "DiscordClient::SendCode");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  std::string rejected = g_shutting_down ? "Client is shutting down" : code.empty() ? "Code is empty" : "";
+  EncodedCode encoded;
+  if (rejected.empty()) {
+    // Chunks are cut to fit the pipeline's message limit; a byte budget of the
+    // same size always fits, since no code point is shorter than a byte
+    options.max_message_bytes = g_sender.Options().max_content_length;
+    encoded = EncodeCode(NewTransferId(), code, options);
+    rejected = encoded.error;
+  }
+  if (!rejected.empty()) {
+    METRIC_COUNTER("send.rejected").Add();
+    done({ false, rejected, "", CodeEncoding::Text, code.size(), 0, {}, 0 });
+    return;
+  }
+
+  // Settled once the last chunk is; the outbox keeps them in order per lobby
+  struct Share {
+    CodeShareResult result;
+    size_t outstanding;
+    std::chrono::steady_clock::time_point started;
+    std::function<void(const CodeShareResult& result)> done;
+  };
+  auto share = std::make_shared<Share>();
+  share->result = { true, "", encoded.transfer_id, encoded.encoding, encoded.raw_bytes, 0,
+                    std::vector<uint64_t>(encoded.messages.size(), 0), 0 };
+  share->outstanding = encoded.messages.size();
+  share->started = std::chrono::steady_clock::now();
+  share->done = std::move(done);
+  for (const std::string& message : encoded.messages) {
+    share->result.sent_bytes += message.size();
+  }
+  METRIC_COUNTER("code.transfers_sent").Add();
+  METRIC_HISTOGRAM("code.chunks_per_transfer").Record(encoded.messages.size());
+  LOG_DEBUG("📤 Sharing " << code.size() << " bytes of code as " << encoded.messages.size() << " "
+            << CodeEncodingName(encoded.encoding) << " chunks (transfer " << encoded.transfer_id << ")");
+
+  for (size_t seq = 0; seq < encoded.messages.size(); seq++) {
+    std::string nonce = encoded.transfer_id + "-" + std::to_string(seq);
+    g_outbox.Enqueue(nonce, { SendTarget::Lobby, lobby_id }, std::move(encoded.messages[seq]),
+                     [share, seq](const SendResult& sent) {
+      if (sent.ok) {
+        share->result.message_ids[seq] = sent.message_id;
+      } else if (share->result.ok) {
+        share->result.ok = false;
+        share->result.error = sent.error;
+      }
+      if (--share->outstanding > 0) return;
+      share->result.latency_us = ElapsedMicros(share->started);
+      METRIC_HISTOGRAM("code.transfer_us").Record(share->result.latency_us);
+      share->done(share->result);
+    });
+  }
+}
+
+// Same text the extension's single invite command sends
+static std::string FormatLobbyInvite(uint64_t lobby_id, const LobbyInvite& invite) {
+  std::string text = invite.message;
+  if (text.empty()) {
+    text = "🎮 You're invited to join" + (invite.title.empty() ? "" : ": " + invite.title) + "!";
+  }
+  return text + "\nLobby ID: " + std::to_string(lobby_id) + "\nSecret: " + invite.secret;
+}
+
+void DiscordClient::InviteMany(uint64_t lobby_id, const std::vector<uint64_t>& user_ids, const LobbyInvite& invite,
+                               std::function<void(const FanOutResult& result)> done) {
+  TRACE_SCOPE("client", "DiscordClient::InviteMany");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  // A user listed twice gets one invite
+  std::unordered_set<uint64_t> seen;
+  std::vector<SendDestination> destinations;
+  for (uint64_t user_id : user_ids) {
+    if (seen.insert(user_id).second) destinations.push_back({ SendTarget::User, user_id });
+  }
+  LOG_DEBUG("📨 Inviting " << destinations.size() << " users to lobby " << lobby_id);
+  METRIC_COUNTER("lobby.invites").Add(destinations.size());
+  FanOutMessage(std::move(destinations), FormatLobbyInvite(lobby_id, invite), invite.concurrency, std::move(done));
+}
+
+void DiscordClient::BroadcastLobbyMessage(const std::vector<uint64_t>& lobby_ids, const std::string& content,
+                                          uint32_t concurrency, std::function<void(const FanOutResult& result)> done) {
+  TRACE_SCOPE("client", "DiscordClient::BroadcastLobbyMessage");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  std::unordered_set<uint64_t> seen;
+  std::vector<SendDestination> destinations;
+  for (uint64_t lobby_id : lobby_ids) {
+    if (seen.insert(lobby_id).second) destinations.push_back({ SendTarget::Lobby, lobby_id });
+  }
+  LOG_DEBUG("📣 Broadcasting " << content.size() << " bytes to " << destinations.size() << " lobbies");
+  METRIC_COUNTER("send.broadcasts").Add();
+  FanOutMessage(std::move(destinations), content, concurrency, std::move(done));
+}
+
+bool DiscordClient::FeedCodeMessage(uint64_t lobby_id, uint64_t author_id, const std::string& content) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_code_reassembler.Feed(lobby_id, author_id, content);
+}
+
+int DiscordClient::OpenOutbox(const std::string& path, const OutboxOptions& options, std::string& error) {
+  TRACE_SCOPE("client", "DiscordClient::OpenOutbox");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_outbox.Configure(options);
+  if (path.empty()) {
+    g_outbox.Close();
+    return 0;
+  }
+  return g_outbox.Open(path, &error);
+}
+
+OutboxOptions DiscordClient::GetOutboxOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_outbox.Options();
+}
+
+OutboxStatus DiscordClient::GetOutboxStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_outbox.Status();
+}
+
+void DiscordClient::ConfigureSendPipeline(const SendPipelineOptions& options) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_sender.Configure(options);
+}
+
+SendPipelineOptions DiscordClient::GetSendPipelineOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_sender.Options();
+}
+
+SendPipelineStatus DiscordClient::GetSendPipelineStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_sender.Status();
+}
+
+void DiscordClient::JoinVoice(uint64_t lobby_id, VoiceDone done) {
+  TRACE_SCOPE("client", "DiscordClient::JoinVoice");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (g_shutting_down || !g_client_initialized) {
+    done(false, g_shutting_down ? "Client is shutting down" : "Client not connected", 0);
+    return;
+  }
+  g_voice.Join(lobby_id, std::move(done));
+}
+
+void DiscordClient::LeaveVoice(VoiceDone done) {
+  TRACE_SCOPE("client", "DiscordClient::LeaveVoice");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_voice.Leave(std::move(done));
+}
+
+void DiscordClient::SetSelfMute(bool mute) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_voice.SetSelfMute(mute);
+}
+
+void DiscordClient::SetSelfDeaf(bool deaf) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_voice.SetSelfDeaf(deaf);
+}
+
+void DiscordClient::ConfigureVoice(const VoiceOptions& options) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_voice.Configure(options);
+}
+
+VoiceOptions DiscordClient::GetVoiceOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_voice.Options();
+}
+
+VoiceStatus DiscordClient::GetVoiceStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_voice.Status();
+}
+
+void DiscordClient::ConfigureReconnect(const ReconnectOptions& options) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_connection.Configure(options);
+}
+
+ReconnectOptions DiscordClient::GetReconnectOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_connection.Options();
+}
+
+ConnectionInfo DiscordClient::GetConnectionInfo(bool& caches_stale) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  caches_stale = g_guilds_stale || !g_stale_channel_guilds.empty();
+  return g_connection.Info();
+}
+
+bool DiscordClient::UpdateToken(const TokenInfo& token) {
+  TRACE_SCOPE("client", "DiscordClient::UpdateToken");
+  if (token.access_token.empty()) {
+    LOG_ERROR("❌ Access token is empty");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (!g_client_initialized) {
+    LOG_ERROR("❌ Client not initialized, cannot update token");
+    return false;
+  }
+  // A swap that omits the refresh token keeps the one we already have
+  TokenInfo next = token;
+  if (next.refresh_token.empty()) next.refresh_token = g_tokens.RefreshTokenValue();
+  ApplyRefreshedToken(next.access_token);
+  g_tokens.SetToken(next);
+  return true;
+}
+
+bool DiscordClient::RefreshToken() {
+  TRACE_SCOPE("client", "DiscordClient::RefreshToken");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_tokens.RefreshNow("requested");
+}
+
+void DiscordClient::SetTokenRefresher(TokenRefresher refresher) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_token_refresher = std::move(refresher);
+}
+
+void DiscordClient::ConfigureTokenRefresh(const TokenRefreshOptions& options) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_tokens.Configure(options);
+}
+
+TokenRefreshOptions DiscordClient::GetTokenRefreshOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_tokens.Options();
+}
+
+TokenStatus DiscordClient::GetTokenStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_tokens.Status();
+}
+
+void DiscordClient::ConfigureScheduler(const SchedulerOptions& options,
+                                       const std::vector<std::pair<std::string, RouteLimit>>& routes) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_scheduler.Configure(options);
+  for (const auto& route : routes) {
+    g_scheduler.SetRouteLimit(route.first, route.second);
+  }
+}
+
+SchedulerOptions DiscordClient::GetSchedulerOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_scheduler.Options();
+}
+
+SchedulerStatus DiscordClient::GetSchedulerStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_scheduler.Status();
+}
+
+void DiscordClient::ConfigureWatchdog(const WatchdogOptions& options) {
+  g_watchdog.Configure(options);
+}
+
+WatchdogOptions DiscordClient::GetWatchdogOptions() {
+  return g_watchdog.Options();
+}
+
+std::vector<InFlightRequest> DiscordClient::GetInFlightRequests() {
+  return g_watchdog.InFlight();
+}
+
+bool DiscordClient::SetActivityRichPresence(const PresenceActivity& activity) {
+  TRACE_SCOPE("client", "DiscordClient::SetActivityRichPresence");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (g_shutting_down) return false;
+  return g_presence.Set(activity);
+}
+
+void DiscordClient::ConfigurePresence(const PresenceOptions& options) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_presence.Configure(options);
+}
+
+PresenceOptions DiscordClient::GetPresenceOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_presence.Options();
+}
+
+PresenceStatus DiscordClient::GetPresenceStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_presence.Status();
+}
+
+std::vector<LobbyInfo> DiscordClient::GetLobbies(const LobbyFilter& filter) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_lobbies.List(filter);
+}
+
+std::vector<uint64_t> DiscordClient::FindLobbies(const LobbyFilter& filter) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_lobbies.Find(filter);
+}
+
+bool DiscordClient::GetLobby(uint64_t lobby_id, LobbyInfo& out) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_lobbies.Get(lobby_id, out);
+}
+
+size_t DiscordClient::SyncLobbies() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  if (!g_client_initialized) return 0;
+  return SyncLobbyRegistry();
+}
+
+bool DiscordClient::IsLobbyMember(uint64_t lobby_id, uint64_t user_id) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_lobbies.IsMember(lobby_id, user_id);
+}
+
+bool DiscordClient::GetLobbyMembers(uint64_t lobby_id, std::vector<uint64_t>& out) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_lobbies.Members(lobby_id, out);
+}
+
+RelationshipPage DiscordClient::GetFriends(const RelationshipFilter& filter) {
+  TRACE_SCOPE("client", "DiscordClient::GetFriends");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_relationships.List(filter);
+}
+
+RelationshipChanges DiscordClient::GetFriendChanges(uint64_t since) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_relationships.Changes(since);
+}
+
+void DiscordClient::GetHistory(uint64_t lobby_id, uint64_t before_id, uint32_t limit, HistoryDone done) {
+  TRACE_SCOPE("client", "DiscordClient::GetHistory");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_history.Get(lobby_id, before_id, limit, std::move(done));
+}
+
+void DiscordClient::ConfigureHistory(const HistoryOptions& options) {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_history.Configure(options);
+}
+
+HistoryOptions DiscordClient::GetHistoryOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_history.Options();
+}
+
+HistoryStatus DiscordClient::GetHistoryStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_history.Status();
+}
+
+bool DiscordClient::OpenMessageLog(const std::string& path, const MessageLogOptions& options, std::string& error) {
+  TRACE_SCOPE("client", "DiscordClient::OpenMessageLog");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  g_message_log.Configure(options);
+  if (path == g_message_log.Status().path) return true;
+  if (path.empty()) {
+    g_message_log.Close();
+    return true;
+  }
+  return g_message_log.Open(path, &error);
+}
+
+MessageLogOptions DiscordClient::GetMessageLogOptions() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_message_log.Options();
+}
+
+MessageLogStatus DiscordClient::GetMessageLogStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_message_log.Status();
+}
+
+// The index has its own lock; searches never wait on the client state lock
+void DiscordClient::SearchMessages(SearchQuery query, SearchDone done) {
+  TRACE_SCOPE("client", "DiscordClient::SearchMessages");
+  g_search.Search(std::move(query), std::move(done));
+}
+
+void DiscordClient::ConfigureSearch(const SearchOptions& options) {
+  g_search.Configure(options);
+}
+
+SearchOptions DiscordClient::GetSearchOptions() {
+  return g_search.Options();
+}
+
+SearchStatus DiscordClient::GetSearchStatus() {
+  return g_search.Status();
+}
+
+std::vector<NameMatch> DiscordClient::QuickSearch(const std::string& query, uint32_t kinds, uint32_t limit) {
+  TRACE_SCOPE("client", "DiscordClient::QuickSearch");
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_names.Search(query, kinds, limit);
+}
+
+NameIndexStatus DiscordClient::GetNameIndexStatus() {
+  std::lock_guard<std::mutex> lock(g_state_mutex);
+  return g_names.Status();
 }
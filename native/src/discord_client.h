@@ -5,11 +5,29 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <functional>
 #include <atomic>
 #include <chrono>
 #include <mutex>
 #include <thread>
 #include "cdiscord.h"  // Discord SDK C API
+#include "code_codec.h"
+#include "connection.h"
+#include "fan_out.h"
+#include "lobby_registry.h"
+#include "message_history.h"
+#include "message_log.h"
+#include "name_index.h"
+#include "outbox.h"
+#include "presence.h"
+#include "relationship_store.h"
+#include "request_scheduler.h"
+#include "search_index.h"
+#include "send_pipeline.h"
+#include "shutdown.h"
+#include "token_manager.h"
+#include "voice.h"
+#include "watchdog.h"
 
 struct Channel {
   std::string id;
@@ -33,27 +51,164 @@ struct User {
   std::string discriminator;
 };
 
+// Invites are DMs carrying the lobby ID and secret, which the recipient joins with
+struct LobbyInvite {
+  std::string secret;
+  std::string title;        // optional, shown in the default text
+  std::string message;      // replaces the default first line when set
+  uint32_t concurrency = 0; // invites outstanding at once; 0 = the send pipeline's limit
+};
+
+// Startup milestones, in the order a healthy connection reaches them
+enum class StartupPhase { Init, Token, Connecting, Connected, Ready, FirstGuilds, Count };
+
+const char* StartupPhaseName(StartupPhase phase);
+
+struct StartupTimings {
+  std::string state;  // idle, starting, ready or failed
+  std::string error;
+  double phase_ms[static_cast<int>(StartupPhase::Count)];  // since Initialize(); < 0 until reached
+};
+
+struct CodeShareResult {
+  bool ok;
+  std::string error;  // first chunk that failed
+  std::string transfer_id;
+  CodeEncoding encoding;
+  uint64_t raw_bytes;
+  uint64_t sent_bytes;                  // framed chunks as sent
+  std::vector<uint64_t> message_ids;    // one per chunk, in order
+  uint64_t latency_us;
+};
+
+// Discord IDs travel as decimal strings; false if str is not a valid uint64
+bool IsValidUint64(const std::string& str, uint64_t& out_value);
+
 class DiscordClient {
 public:
+  // Invoked once startup settles: after the warm-up guild fetch, or on failure
+  using ReadyCallback = std::function<void(bool ok, const StartupTimings& timings)>;
+
   DiscordClient();
   ~DiscordClient();
 
-  // Initialize with app ID and OAuth access token (from TypeScript layer)
-  bool Initialize(const std::string& application_id, const std::string& access_token);
+  // Initialize with app ID and OAuth access token (from TypeScript layer).
+  // Only validates and starts the connection; use WhenReady() to learn the outcome.
+  // refresh_token / expires_in_s (OAuth expires_in) enable proactive refresh.
+  bool Initialize(const std::string& application_id, const std::string& access_token,
+                  const std::string& refresh_token = "", uint32_t expires_in_s = 0);
+  void WhenReady(ReadyCallback callback);
+  StartupTimings GetStartupTimings();
   void Disconnect();
   void RunCallbacks();
+
+  // Process-wide ordered teardown: stop accepting work, drain in-flight SDK
+  // requests, run flush hooks, disconnect, stop timers. Runs at most once;
+  // later calls return a report with performed = false.
+  static ShutdownReport Shutdown(uint32_t timeout_ms);
   void FetchGuilds();  // Request guilds from Discord (async - requires RunCallbacks to be called)
 
   std::vector<Guild> GetGuilds();
   std::vector<Channel> GetGuildChannels(const std::string& guild_id);
+  // Queues channel fetches for guilds not cached yet (or stale); returns how many were queued
+  uint32_t PrefetchGuildChannels(const std::vector<std::string>& guild_ids, RequestPriority priority);
   User GetCurrentUser();
 
-  bool SendMessage(const std::string& channel_id, const std::string& user_id, const std::string& content);
-  bool JoinVoiceChannel(const std::string& guild_id, const std::string& channel_id);
-  bool LeaveVoiceChannel();
-  bool SetActivityRichPresence(const std::string& details, const std::string& state);
+  // Goes through the outbox, so it is accepted while offline; done runs once
+  // with the message ID or an error. Returns the nonce (generated if empty).
+  std::string SendMessage(const SendDestination& destination, const std::string& content, const std::string& nonce,
+                          SendDone done);
+  // Persists the outbox at path (empty = memory only); returns restored messages or -1
+  int OpenOutbox(const std::string& path, const OutboxOptions& options, std::string& error);
+  // Sends code to a lobby as framed chunks (compressed when that pays off),
+  // each through the outbox; done runs once every chunk has settled
+  void SendCode(uint64_t lobby_id, const std::string& code, CodeShareOptions options,
+                std::function<void(const CodeShareResult& result)> done);
+  // One DM per distinct user, pipelined; done runs once with every user's result
+  void InviteMany(uint64_t lobby_id, const std::vector<uint64_t>& user_ids, const LobbyInvite& invite,
+                  std::function<void(const FanOutResult& result)> done);
+  // The same message to each distinct lobby, pipelined; each lobby keeps its own order
+  void BroadcastLobbyMessage(const std::vector<uint64_t>& lobby_ids, const std::string& content, uint32_t concurrency,
+                             std::function<void(const FanOutResult& result)> done);
+  // For messages read outside MessageCreated (e.g. fetched history); false if not a code chunk
+  bool FeedCodeMessage(uint64_t lobby_id, uint64_t author_id, const std::string& content);
+  OutboxOptions GetOutboxOptions();
+  OutboxStatus GetOutboxStatus();
+  void ConfigureSendPipeline(const SendPipelineOptions& options);
+  SendPipelineOptions GetSendPipelineOptions();
+  SendPipelineStatus GetSendPipelineStatus();
+  // Lobby voice; done runs once the call is connected / ended, or failed
+  void JoinVoice(uint64_t lobby_id, VoiceDone done);
+  void LeaveVoice(VoiceDone done);
+  void SetSelfMute(bool mute);
+  void SetSelfDeaf(bool deaf);
+  void ConfigureVoice(const VoiceOptions& options);
+  VoiceOptions GetVoiceOptions();
+  VoiceStatus GetVoiceStatus();
+  // Coalesced and rate limited; false if it changes nothing. cleared = remove the activity.
+  bool SetActivityRichPresence(const PresenceActivity& activity);
+  void ConfigurePresence(const PresenceOptions& options);
+  PresenceOptions GetPresenceOptions();
+  PresenceStatus GetPresenceStatus();
+  // Lobbies from the in-memory registry; filter is key = value pairs that must all match
+  std::vector<LobbyInfo> GetLobbies(const LobbyFilter& filter);
+  std::vector<uint64_t> FindLobbies(const LobbyFilter& filter);
+  bool GetLobby(uint64_t lobby_id, LobbyInfo& out);
+  // Re-reads every lobby from the SDK; returns how many there are
+  size_t SyncLobbies();
+  // Member rosters, kept current from the member callbacks
+  bool IsLobbyMember(uint64_t lobby_id, uint64_t user_id);
+  bool GetLobbyMembers(uint64_t lobby_id, std::vector<uint64_t>& out);
+  // Friends, requests and blocks from the native store, sorted by status then name
+  RelationshipPage GetFriends(const RelationshipFilter& filter);
+  // What changed after version since; full if since is too old to diff against
+  RelationshipChanges GetFriendChanges(uint64_t since);
+  // A page of lobby history older than before_id (0 = newest); from memory once warm
+  void GetHistory(uint64_t lobby_id, uint64_t before_id, uint32_t limit, HistoryDone done);
+  void ConfigureHistory(const HistoryOptions& options);
+  HistoryOptions GetHistoryOptions();
+  HistoryStatus GetHistoryStatus();
+  // Keeps lobby history on disk under path ("" to stop), so it survives restarts
+  bool OpenMessageLog(const std::string& path, const MessageLogOptions& options, std::string& error);
+  MessageLogOptions GetMessageLogOptions();
+  MessageLogStatus GetMessageLogStatus();
+  // Full-text search over seen messages; done runs on the search thread
+  void SearchMessages(SearchQuery query, SearchDone done);
+  void ConfigureSearch(const SearchOptions& options);
+  SearchOptions GetSearchOptions();
+  SearchStatus GetSearchStatus();
+  // Fuzzy type-ahead over cached guild, channel, lobby and friend names; kinds is a NameKindBit() mask
+  std::vector<NameMatch> QuickSearch(const std::string& query, uint32_t kinds, uint32_t limit);
+  NameIndexStatus GetNameIndexStatus();
+
+  // Token lifecycle: swap in a new token without reconnecting, force a refresh,
+  // or let JS perform refreshes instead of the SDK
+  bool UpdateToken(const TokenInfo& token);
+  bool RefreshToken();
+  void SetTokenRefresher(TokenRefresher refresher);
+  void ConfigureTokenRefresh(const TokenRefreshOptions& options);
+  TokenRefreshOptions GetTokenRefreshOptions();
+  TokenStatus GetTokenStatus();
+
+  // Reconnect policy and the current connection lifecycle
+  void ConfigureReconnect(const ReconnectOptions& options);
+  ReconnectOptions GetReconnectOptions();
+  ConnectionInfo GetConnectionInfo(bool& caches_stale);
+
+  // Pacing and prioritisation of outgoing SDK requests
+  void ConfigureScheduler(const SchedulerOptions& options,
+                          const std::vector<std::pair<std::string, RouteLimit>>& routes);
+  SchedulerOptions GetSchedulerOptions();
+  SchedulerStatus GetSchedulerStatus();
+
+  // Stall detection for the callback pump and in-flight SDK requests
+  void ConfigureWatchdog(const WatchdogOptions& options);
+  WatchdogOptions GetWatchdogOptions();
+  std::vector<InFlightRequest> GetInFlightRequests();
 
 private:
+  static void DisconnectClient();
+
   bool initialized = false;
   bool ready = false;
   std::chrono::steady_clock::time_point init_time;
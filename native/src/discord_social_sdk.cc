@@ -1,14 +1,212 @@
 #include <napi.h>
 #include "discord_client.h"
-#include <iostream>
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+#include "sdk_loader.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
-// Suppress Discord SDK cleanup-related crashes by exiting before cleanup
-void suppress_discord_cleanup_crash() {
-  // Just exit the process hard to skip any cleanup that could segfault
-  // This is a workaround for Discord SDK cleanup issues
-  std::cerr << "🚪 Forcing clean exit to prevent Discord SDK cleanup segfault" << std::endl;
-  std::exit(0);
+// Budget for the teardown that runs when the environment exits without an
+// explicit shutdown() from JS
+static const uint32_t kExitShutdownTimeoutMs = 2000;
+
+// Optional fields on JS options objects keep their current value when absent
+static uint32_t ReadUint32Option(const Napi::Object& options, const char* key, uint32_t current) {
+  if (options.Has(key) && options.Get(key).IsNumber()) {
+    return options.Get(key).As<Napi::Number>().Uint32Value();
+  }
+  return current;
+}
+
+static double ReadDoubleOption(const Napi::Object& options, const char* key, double current) {
+  if (options.Has(key) && options.Get(key).IsNumber()) {
+    return options.Get(key).As<Napi::Number>().DoubleValue();
+  }
+  return current;
+}
+
+static bool ReadBoolOption(const Napi::Object& options, const char* key, bool current) {
+  if (options.Has(key) && options.Get(key).IsBoolean()) {
+    return options.Get(key).As<Napi::Boolean>().Value();
+  }
+  return current;
+}
+
+static std::string ReadStringOption(const Napi::Object& options, const char* key, const std::string& current) {
+  if (options.Has(key) && options.Get(key).IsString()) {
+    return options.Get(key).As<Napi::String>();
+  }
+  return current;
+}
+
+// The JS names of enum values, in enum order
+static const char* const kNameKindNames[] = { "guild", "channel", "lobby", "friend" };
+static const char* const kFriendStatusNames[] = { "online", "idle", "dnd", "offline" };
+static const char* const kRelationshipKindNames[] = { "friend", "incoming", "outgoing", "blocked", "other" };
+
+// ['online', 'idle'] -> one bit per name, by its index in names; false on an unknown name
+template <size_t N>
+static bool ReadNameMask(const Napi::Array& array, const char* const (&names)[N], uint32_t& mask) {
+  mask = 0;
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    std::string name = array.Get(i).IsString() ? array.Get(i).As<Napi::String>().Utf8Value() : "";
+    auto known = std::find(std::begin(names), std::end(names), name);
+    if (known == std::end(names)) return false;
+    mask |= 1u << (known - std::begin(names));
+  }
+  return true;
+}
+
+// { accessToken, refreshToken?, expiresIn? } as returned by OAuth token endpoints
+static bool TokenInfoFromValue(const Napi::Value& value, TokenInfo& token) {
+  if (!value.IsObject()) return false;
+  Napi::Object object = value.As<Napi::Object>();
+  token.access_token = ReadStringOption(object, "accessToken", "");
+  token.refresh_token = ReadStringOption(object, "refreshToken", "");
+  token.expires_in_s = ReadUint32Option(object, "expiresIn", 0);
+  return !token.access_token.empty();
+}
+
+// A JS refresher may return the token directly or a promise of it
+static void SettleTokenRefresh(Napi::Env env, const Napi::Value& result, TokenRefreshDone done) {
+  if (!result.IsPromise()) {
+    TokenInfo token;
+    bool ok = TokenInfoFromValue(result, token);
+    done(ok, token, ok ? "" : "refresher must return { accessToken, refreshToken?, expiresIn? }");
+    return;
+  }
+
+  Napi::Function on_fulfilled = Napi::Function::New(env, [done](const Napi::CallbackInfo& info) {
+    TokenInfo token;
+    bool ok = info.Length() > 0 && TokenInfoFromValue(info[0], token);
+    done(ok, token, ok ? "" : "refresher must resolve to { accessToken, refreshToken?, expiresIn? }");
+  });
+  Napi::Function on_rejected = Napi::Function::New(env, [done](const Napi::CallbackInfo& info) {
+    std::string reason = "refresher rejected";
+    if (info.Length() > 0 && info[0].IsObject() && info[0].As<Napi::Object>().Has("message")) {
+      reason = info[0].As<Napi::Object>().Get("message").ToString();
+    } else if (info.Length() > 0) {
+      reason = info[0].ToString();
+    }
+    done(false, TokenInfo(), reason);
+  });
+  Napi::Object promise = result.As<Napi::Object>();
+  promise.Get("then").As<Napi::Function>().Call(promise, { on_fulfilled, on_rejected });
+}
+
+static Napi::Object EventToObject(Napi::Env env, const NativeEvent& event) {
+  Napi::Object payload = Napi::Object::New(env);
+  payload.Set("type", Napi::String::New(env, event.Type()));
+  for (const EventField& field : event.Fields()) {
+    switch (field.type) {
+      case EventField::Type::String:
+        payload.Set(field.key, Napi::String::New(env, field.string_value));
+        break;
+      case EventField::Type::Number:
+        payload.Set(field.key, Napi::Number::New(env, field.number_value));
+        break;
+      case EventField::Type::Bool:
+        payload.Set(field.key, Napi::Boolean::New(env, field.bool_value));
+        break;
+      case EventField::Type::StringList: {
+        Napi::Array list = Napi::Array::New(env, field.list_value.size());
+        for (uint32_t i = 0; i < field.list_value.size(); i++) {
+          list.Set(i, Napi::String::New(env, field.list_value[i]));
+        }
+        payload.Set(field.key, list);
+        break;
+      }
+    }
+  }
+  return payload;
+}
+
+// Offsets of the startup phases reached so far, in milliseconds
+static Napi::Object StartupTimingsToObject(Napi::Env env, const StartupTimings& timings) {
+  Napi::Object phases = Napi::Object::New(env);
+  double total_ms = 0;
+  for (int i = 0; i < static_cast<int>(StartupPhase::Count); i++) {
+    if (timings.phase_ms[i] < 0) continue;
+    phases.Set(StartupPhaseName(static_cast<StartupPhase>(i)), Napi::Number::New(env, timings.phase_ms[i]));
+    total_ms = std::max(total_ms, timings.phase_ms[i]);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("state", Napi::String::New(env, timings.state));
+  if (!timings.error.empty()) {
+    result.Set("error", Napi::String::New(env, timings.error));
+  }
+  result.Set("totalMs", Napi::Number::New(env, total_ms));
+  result.Set("phases", phases);
+  return result;
+}
+
+// Native threads reach JS through this thread-safe function. Callbacks hold it
+// by shared_ptr rather than capturing the addon: a parked outbox send, a
+// FailAll on disconnect or a history fetch may complete after the addon is
+// collected, and then finds the bridge released instead of a dangling pointer.
+class JsBridge {
+public:
+  using Task = std::function<void(Napi::Env)>;
+
+  explicit JsBridge(Napi::Env env);
+
+  // False if the task was dropped (bridge released or its queue closing)
+  bool Post(Task task);
+  void Release();
+
+private:
+  std::mutex mutex_;
+  Napi::ThreadSafeFunction tsfn_;
+  bool released_ = false;
+};
+
+JsBridge::JsBridge(Napi::Env env) {
+  tsfn_ = Napi::ThreadSafeFunction::New(
+      env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "DiscordAddonEvents", 0, 1);
+  // Pending events must not keep the extension host alive
+  tsfn_.Unref(env);
+}
+
+bool JsBridge::Post(Task task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (released_) {
+    METRIC_COUNTER("events.dropped").Add();
+    return false;
+  }
+  auto* data = new Task(std::move(task));
+  napi_status status = tsfn_.NonBlockingCall(data, [](Napi::Env env, Napi::Function, Task* queued) {
+    // env is null when the bridge is torn down with calls still queued
+    if (env != nullptr) {
+      (*queued)(env);
+    }
+    delete queued;
+  });
+  if (status != napi_ok) {
+    METRIC_COUNTER("events.dropped").Add();
+    delete data;
+    return false;
+  }
+  return true;
+}
+
+void JsBridge::Release() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (released_) return;
+  released_ = true;
+  tsfn_.Release();
 }
 
 class DiscordAddon : public Napi::ObjectWrap<DiscordAddon> {
@@ -30,8 +228,80 @@ private:
   Napi::Value FetchGuilds(const Napi::CallbackInfo& info);
   Napi::Value JoinVoiceChannel(const Napi::CallbackInfo& info);
   Napi::Value LeaveVoiceChannel(const Napi::CallbackInfo& info);
+  Napi::Value SetSelfMute(const Napi::CallbackInfo& info);
+  Napi::Value SetSelfDeaf(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureVoice(const Napi::CallbackInfo& info);
+  Napi::Value GetVoiceState(const Napi::CallbackInfo& info);
   Napi::Value SetActivityRichPresence(const Napi::CallbackInfo& info);
+  Napi::Value ClearActivity(const Napi::CallbackInfo& info);
+  Napi::Value ConfigurePresence(const Napi::CallbackInfo& info);
+  Napi::Value GetPresenceState(const Napi::CallbackInfo& info);
+  Napi::Value GetLobbies(const Napi::CallbackInfo& info);
+  Napi::Value GetLobbyIds(const Napi::CallbackInfo& info);
+  Napi::Value GetLobby(const Napi::CallbackInfo& info);
+  Napi::Value SyncLobbies(const Napi::CallbackInfo& info);
+  Napi::Value GetLobbyMembers(const Napi::CallbackInfo& info);
+  Napi::Value IsLobbyMember(const Napi::CallbackInfo& info);
+  Napi::Value GetFriends(const Napi::CallbackInfo& info);
+  Napi::Value GetFriendChanges(const Napi::CallbackInfo& info);
+  Napi::Value GetHistory(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureHistory(const Napi::CallbackInfo& info);
+  Napi::Value GetHistoryState(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureMessageLog(const Napi::CallbackInfo& info);
+  Napi::Value GetMessageLogState(const Napi::CallbackInfo& info);
+  Napi::Value SearchMessages(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureSearch(const Napi::CallbackInfo& info);
+  Napi::Value GetSearchState(const Napi::CallbackInfo& info);
+  Napi::Value QuickSearch(const Napi::CallbackInfo& info);
+  Napi::Value GetQuickSearchState(const Napi::CallbackInfo& info);
   Napi::Value Disconnect(const Napi::CallbackInfo& info);
+  Napi::Value SetLogLevel(const Napi::CallbackInfo& info);
+  Napi::Value FlushLogs(const Napi::CallbackInfo& info);
+  Napi::Value GetMetrics(const Napi::CallbackInfo& info);
+  Napi::Value StartTracing(const Napi::CallbackInfo& info);
+  Napi::Value StopTracing(const Napi::CallbackInfo& info);
+  Napi::Value ExportTrace(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureFlightRecorder(const Napi::CallbackInfo& info);
+  Napi::Value DumpFlightRecorder(const Napi::CallbackInfo& info);
+  Napi::Value GetFlightRecords(const Napi::CallbackInfo& info);
+  Napi::Value On(const Napi::CallbackInfo& info);
+  Napi::Value Off(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureWatchdog(const Napi::CallbackInfo& info);
+  Napi::Value GetInFlightRequests(const Napi::CallbackInfo& info);
+  Napi::Value WhenReady(const Napi::CallbackInfo& info);
+  Napi::Value GetStartupTimings(const Napi::CallbackInfo& info);
+  Napi::Value SetSdkLibraryPath(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureReconnect(const Napi::CallbackInfo& info);
+  Napi::Value SetToken(const Napi::CallbackInfo& info);
+  Napi::Value RefreshToken(const Napi::CallbackInfo& info);
+  Napi::Value SetTokenRefresher(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureTokenRefresh(const Napi::CallbackInfo& info);
+  Napi::Value GetTokenState(const Napi::CallbackInfo& info);
+  Napi::Value GetConnectionState(const Napi::CallbackInfo& info);
+  Napi::Value Shutdown(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureScheduler(const Napi::CallbackInfo& info);
+  Napi::Value GetSchedulerState(const Napi::CallbackInfo& info);
+  Napi::Value PrefetchGuildChannels(const Napi::CallbackInfo& info);
+  Napi::Value SendLobbyMessage(const Napi::CallbackInfo& info);
+  Napi::Value SendCodeToLobby(const Napi::CallbackInfo& info);
+  Napi::Value InviteMany(const Napi::CallbackInfo& info);
+  Napi::Value BroadcastLobbyMessage(const Napi::CallbackInfo& info);
+  Napi::Value FeedCodeMessage(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureSendPipeline(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureOutbox(const Napi::CallbackInfo& info);
+  Napi::Value GetOutbox(const Napi::CallbackInfo& info);
+
+  // Listeners live in a shared table so queued events stay valid if the addon
+  // is collected
+  using ListenerTable = std::multimap<std::string, Napi::FunctionReference>;
+  static void DispatchEvent(Napi::Env env, ListenerTable& listeners, const NativeEvent& event);
+  Napi::Promise ReadinessPromise(Napi::Env env);
+  Napi::Promise SendPromise(Napi::Env env, const SendDestination& destination, const std::string& content,
+                            const Napi::Value& options);
+
+  std::shared_ptr<JsBridge> js_bridge;
+  std::shared_ptr<ListenerTable> listeners;
+  uint64_t event_sink = 0;  // this instance's entry in the event sinks
   
   DiscordClient client;
 };
@@ -39,9 +309,13 @@ private:
 Napi::FunctionReference DiscordAddon::constructor;
 
 Napi::Object DiscordAddon::Init(Napi::Env env, Napi::Object exports) {
-  // Register cleanup handler to prevent Discord SDK crash on exit
-  std::atexit(suppress_discord_cleanup_crash);
-  
+  // Tear the client down in order while the environment is still alive,
+  // instead of letting static destructors race the SDK's own cleanup
+  env.AddCleanupHook([]() {
+    DiscordClient::Shutdown(kExitShutdownTimeoutMs);
+    Logger::Instance().Shutdown();
+  });
+
   Napi::Function func = DefineClass(env, "DiscordAddon", {
     InstanceMethod("initialize", &DiscordAddon::Initialize),
     InstanceMethod("getGuildChannels", &DiscordAddon::GetGuildChannels),
@@ -52,10 +326,80 @@ Napi::Object DiscordAddon::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("fetchGuilds", &DiscordAddon::FetchGuilds),
     InstanceMethod("joinVoiceChannel", &DiscordAddon::JoinVoiceChannel),
     InstanceMethod("leaveVoiceChannel", &DiscordAddon::LeaveVoiceChannel),
+    InstanceMethod("setSelfMute", &DiscordAddon::SetSelfMute),
+    InstanceMethod("setSelfDeaf", &DiscordAddon::SetSelfDeaf),
+    InstanceMethod("configureVoice", &DiscordAddon::ConfigureVoice),
+    InstanceMethod("getVoiceState", &DiscordAddon::GetVoiceState),
     InstanceMethod("setActivityRichPresence", &DiscordAddon::SetActivityRichPresence),
+    InstanceMethod("clearActivity", &DiscordAddon::ClearActivity),
+    InstanceMethod("configurePresence", &DiscordAddon::ConfigurePresence),
+    InstanceMethod("getPresenceState", &DiscordAddon::GetPresenceState),
+    InstanceMethod("getLobbies", &DiscordAddon::GetLobbies),
+    InstanceMethod("getLobbyIds", &DiscordAddon::GetLobbyIds),
+    InstanceMethod("getLobby", &DiscordAddon::GetLobby),
+    InstanceMethod("syncLobbies", &DiscordAddon::SyncLobbies),
+    InstanceMethod("getLobbyMembers", &DiscordAddon::GetLobbyMembers),
+    InstanceMethod("isLobbyMember", &DiscordAddon::IsLobbyMember),
+    InstanceMethod("getFriends", &DiscordAddon::GetFriends),
+    InstanceMethod("getFriendChanges", &DiscordAddon::GetFriendChanges),
+    InstanceMethod("getHistory", &DiscordAddon::GetHistory),
+    InstanceMethod("configureHistory", &DiscordAddon::ConfigureHistory),
+    InstanceMethod("getHistoryState", &DiscordAddon::GetHistoryState),
+    InstanceMethod("configureMessageLog", &DiscordAddon::ConfigureMessageLog),
+    InstanceMethod("getMessageLogState", &DiscordAddon::GetMessageLogState),
+    InstanceMethod("searchMessages", &DiscordAddon::SearchMessages),
+    InstanceMethod("configureSearch", &DiscordAddon::ConfigureSearch),
+    InstanceMethod("getSearchState", &DiscordAddon::GetSearchState),
+    InstanceMethod("quickSearch", &DiscordAddon::QuickSearch),
+    InstanceMethod("getQuickSearchState", &DiscordAddon::GetQuickSearchState),
     InstanceMethod("disconnect", &DiscordAddon::Disconnect),
+    InstanceMethod("setLogLevel", &DiscordAddon::SetLogLevel),
+    InstanceMethod("flushLogs", &DiscordAddon::FlushLogs),
+    InstanceMethod("getMetrics", &DiscordAddon::GetMetrics),
+    InstanceMethod("startTracing", &DiscordAddon::StartTracing),
+    InstanceMethod("stopTracing", &DiscordAddon::StopTracing),
+    InstanceMethod("exportTrace", &DiscordAddon::ExportTrace),
+    InstanceMethod("configureFlightRecorder", &DiscordAddon::ConfigureFlightRecorder),
+    InstanceMethod("dumpFlightRecorder", &DiscordAddon::DumpFlightRecorder),
+    InstanceMethod("getFlightRecords", &DiscordAddon::GetFlightRecords),
+    InstanceMethod("on", &DiscordAddon::On),
+    InstanceMethod("off", &DiscordAddon::Off),
+    InstanceMethod("configureWatchdog", &DiscordAddon::ConfigureWatchdog),
+    InstanceMethod("getInFlightRequests", &DiscordAddon::GetInFlightRequests),
+    InstanceMethod("whenReady", &DiscordAddon::WhenReady),
+    InstanceMethod("getStartupTimings", &DiscordAddon::GetStartupTimings),
+    InstanceMethod("setSdkLibraryPath", &DiscordAddon::SetSdkLibraryPath),
+    InstanceMethod("configureReconnect", &DiscordAddon::ConfigureReconnect),
+    InstanceMethod("setToken", &DiscordAddon::SetToken),
+    InstanceMethod("refreshToken", &DiscordAddon::RefreshToken),
+    InstanceMethod("setTokenRefresher", &DiscordAddon::SetTokenRefresher),
+    InstanceMethod("configureTokenRefresh", &DiscordAddon::ConfigureTokenRefresh),
+    InstanceMethod("getTokenState", &DiscordAddon::GetTokenState),
+    InstanceMethod("getConnectionState", &DiscordAddon::GetConnectionState),
+    InstanceMethod("shutdown", &DiscordAddon::Shutdown),
+    InstanceMethod("configureScheduler", &DiscordAddon::ConfigureScheduler),
+    InstanceMethod("getSchedulerState", &DiscordAddon::GetSchedulerState),
+    InstanceMethod("prefetchGuildChannels", &DiscordAddon::PrefetchGuildChannels),
+    InstanceMethod("sendLobbyMessage", &DiscordAddon::SendLobbyMessage),
+    InstanceMethod("sendCodeToLobby", &DiscordAddon::SendCodeToLobby),
+    InstanceMethod("inviteMany", &DiscordAddon::InviteMany),
+    InstanceMethod("broadcastLobbyMessage", &DiscordAddon::BroadcastLobbyMessage),
+    InstanceMethod("feedCodeMessage", &DiscordAddon::FeedCodeMessage),
+    InstanceMethod("configureSendPipeline", &DiscordAddon::ConfigureSendPipeline),
+    InstanceMethod("configureOutbox", &DiscordAddon::ConfigureOutbox),
+    InstanceMethod("getOutbox", &DiscordAddon::GetOutbox),
   });
 
+  // Recording is always on; crash handlers wait until JS picks a dump location
+  const char* tmp_dir = std::getenv("TMPDIR");
+  if (!tmp_dir) tmp_dir = std::getenv("TEMP");
+  std::string default_dump = std::string(tmp_dir ? tmp_dir : "/tmp") + "/discord-native-flight.bin";
+  FlightRecorder::Instance().Configure(default_dump, false);
+
+  Metrics& metrics = Metrics::Instance();
+  metrics.RegisterProbe("queue.log.depth", []() { return static_cast<int64_t>(Logger::Instance().Depth()); });
+  metrics.RegisterProbe("queue.log.dropped", []() { return static_cast<int64_t>(Logger::Instance().Dropped()); });
+
   constructor = Napi::Persistent(func);
   constructor.SuppressDestruct();
 
@@ -64,18 +408,69 @@ Napi::Object DiscordAddon::Init(Napi::Env env, Napi::Object exports) {
 }
 
 DiscordAddon::DiscordAddon(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<DiscordAddon>(info) {
-  std::cout << "🔧 DiscordAddon constructor called" << std::endl;
+    : Napi::ObjectWrap<DiscordAddon>(info),
+      js_bridge(std::make_shared<JsBridge>(info.Env())),
+      listeners(std::make_shared<ListenerTable>()) {
+  LOG_DEBUG("🔧 DiscordAddon constructor called");
+
+  std::shared_ptr<JsBridge> bridge = js_bridge;
+  std::shared_ptr<ListenerTable> table = listeners;
+  event_sink = AddEventSink([bridge, table](NativeEvent event) {
+    bridge->Post([table, event](Napi::Env env) { DispatchEvent(env, *table, event); });
+  });
 }
 
 DiscordAddon::~DiscordAddon() {
-  // NOTE: Discord Social SDK has issues with cleanup on process exit
-  // We intentionally don't call client.Disconnect() here to avoid segfaults
-  // The OS will clean up the process memory anyway
-  std::cout << "🧹 DiscordAddon destructor called (not calling disconnect)" << std::endl;
+  // Process-exit teardown belongs to the env cleanup hook (DiscordClient::Shutdown),
+  // which runs before finalizers; by the time we get here the client is gone
+  LOG_DEBUG("🧹 DiscordAddon destructor called");
+  RemoveEventSink(event_sink);  // other instances keep theirs
+  // Sends, fetches and voice calls still pending for this instance complete
+  // into a released bridge and are dropped; their Promises were unreachable
+  // once the addon could be collected
+  js_bridge->Release();
+}
+
+void DiscordAddon::DispatchEvent(Napi::Env env, ListenerTable& listeners, const NativeEvent& event) {
+  Napi::HandleScope scope(env);
+
+  // Copy first: a listener may call off() while we iterate
+  std::vector<Napi::Function> targets;
+  auto range = listeners.equal_range(event.Type());
+  for (auto it = range.first; it != range.second; ++it) {
+    targets.push_back(it->second.Value());
+  }
+  if (targets.empty()) return;
+
+  Napi::Object payload = EventToObject(env, event);
+  for (Napi::Function& target : targets) {
+    try {
+      target.Call({ payload });
+    } catch (const Napi::Error& e) {
+      LOG_ERROR("❌ '" << event.Type() << "' listener threw: " << e.Message());
+    }
+  }
+}
+
+Napi::Promise DiscordAddon::ReadinessPromise(Napi::Env env) {
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.WhenReady([bridge = js_bridge, deferred](bool ok, const StartupTimings& timings) {
+    bridge->Post([deferred, ok, timings](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (ok) {
+        deferred->Resolve(StartupTimingsToObject(env, timings));
+      } else {
+        Napi::Error error = Napi::Error::New(env, timings.error);
+        error.Value().Set("timings", StartupTimingsToObject(env, timings));
+        deferred->Reject(error.Value());
+      }
+    });
+  });
+  return deferred->Promise();
 }
 
 Napi::Value DiscordAddon::Initialize(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "initialize");
   Napi::Env env = info.Env();
 
   if (info.Length() < 2) {
@@ -85,16 +480,27 @@ Napi::Value DiscordAddon::Initialize(const Napi::CallbackInfo& info) {
 
   std::string app_id = info[0].As<Napi::String>();
   std::string access_token = info[1].As<Napi::String>();
+
+  // Optional { refreshToken, expiresIn } enables proactive refresh
+  std::string refresh_token;
+  uint32_t expires_in_s = 0;
+  if (info.Length() > 2 && info[2].IsObject()) {
+    Napi::Object options = info[2].As<Napi::Object>();
+    refresh_token = ReadStringOption(options, "refreshToken", refresh_token);
+    expires_in_s = ReadUint32Option(options, "expiresIn", expires_in_s);
+  }
   
-  if (!client.Initialize(app_id, access_token)) {
+  if (!client.Initialize(app_id, access_token, refresh_token, expires_in_s)) {
     Napi::Error::New(env, "Failed to initialize Discord client").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  return Napi::Boolean::New(env, true);
+  // Connecting continues in the background; the promise settles once guilds are loaded
+  return ReadinessPromise(env);
 }
 
 Napi::Value DiscordAddon::GetGuildChannels(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getGuildChannels");
   Napi::Env env = info.Env();
 
   if (info.Length() < 1) {
@@ -105,6 +511,7 @@ Napi::Value DiscordAddon::GetGuildChannels(const Napi::CallbackInfo& info) {
   std::string guild_id = info[0].As<Napi::String>();
   auto channels = client.GetGuildChannels(guild_id);
 
+  ScopedLatency marshal(METRIC_HISTOGRAM("napi.get_guild_channels_us"));
   Napi::Array result = Napi::Array::New(env);
   uint32_t index = 0;
 
@@ -121,27 +528,324 @@ Napi::Value DiscordAddon::GetGuildChannels(const Napi::CallbackInfo& info) {
   return result;
 }
 
+Napi::Promise DiscordAddon::SendPromise(Napi::Env env, const SendDestination& destination, const std::string& content,
+                                        const Napi::Value& options) {
+  std::string nonce;
+  if (options.IsObject()) {
+    nonce = ReadStringOption(options.As<Napi::Object>(), "nonce", nonce);
+  }
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.SendMessage(destination, content, nonce, [bridge = js_bridge, deferred](const SendResult& result) {
+    bridge->Post([deferred, result](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (result.ok) {
+        deferred->Resolve(Napi::String::New(env, std::to_string(result.message_id)));
+      } else {
+        deferred->Reject(Napi::Error::New(env, result.error).Value());
+      }
+    });
+  });
+  return deferred->Promise();
+}
+
+// channelId is accepted for compatibility; the SDK addresses DMs by recipient
 Napi::Value DiscordAddon::SendMessage(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "sendMessage");
   Napi::Env env = info.Env();
 
-  if (info.Length() < 3) {
+  if (info.Length() < 3 || !info[1].IsString() || !info[2].IsString()) {
     Napi::TypeError::New(env, "Expected channel ID, user ID, and message content").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  std::string channel_id = info[0].As<Napi::String>();
-  std::string user_id = info[1].As<Napi::String>();
-  std::string content = info[2].As<Napi::String>();
+  uint64_t user_id;
+  if (!IsValidUint64(info[1].As<Napi::String>(), user_id)) {
+    Napi::TypeError::New(env, "Invalid user ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return SendPromise(env, { SendTarget::User, user_id }, info[2].As<Napi::String>(), info[3]);
+}
+
+Napi::Value DiscordAddon::SendLobbyMessage(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "sendLobbyMessage");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID and message content").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint64_t lobby_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id)) {
+    Napi::TypeError::New(env, "Invalid lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return SendPromise(env, { SendTarget::Lobby, lobby_id }, info[1].As<Napi::String>(), info[2]);
+}
+
+Napi::Value DiscordAddon::SendCodeToLobby(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "sendCodeToLobby");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID and code").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint64_t lobby_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id)) {
+    Napi::TypeError::New(env, "Invalid lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  CodeShareOptions share;
+  if (info.Length() > 2 && info[2].IsObject()) {
+    Napi::Object options = info[2].As<Napi::Object>();
+    share.file_name = ReadStringOption(options, "fileName", share.file_name);
+    share.language = ReadStringOption(options, "language", share.language);
+    share.compress = ReadBoolOption(options, "compress", share.compress);
+    share.max_chunks = ReadUint32Option(options, "maxChunks", share.max_chunks);
+  }
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.SendCode(lobby_id, info[1].As<Napi::String>(), share, [bridge = js_bridge, deferred](const CodeShareResult& result) {
+    bridge->Post([deferred, result](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (!result.ok) {
+        deferred->Reject(Napi::Error::New(env, result.error).Value());
+        return;
+      }
+      Napi::Array message_ids = Napi::Array::New(env, result.message_ids.size());
+      for (uint32_t i = 0; i < result.message_ids.size(); i++) {
+        message_ids.Set(i, Napi::String::New(env, std::to_string(result.message_ids[i])));
+      }
+      Napi::Object share_obj = Napi::Object::New(env);
+      share_obj.Set("transferId", Napi::String::New(env, result.transfer_id));
+      share_obj.Set("encoding", Napi::String::New(env, CodeEncodingName(result.encoding)));
+      share_obj.Set("chunks", Napi::Number::New(env, result.message_ids.size()));
+      share_obj.Set("rawBytes", Napi::Number::New(env, static_cast<double>(result.raw_bytes)));
+      share_obj.Set("sentBytes", Napi::Number::New(env, static_cast<double>(result.sent_bytes)));
+      share_obj.Set("messageIds", message_ids);
+      share_obj.Set("latencyMs", Napi::Number::New(env, result.latency_us / 1000.0));
+      deferred->Resolve(share_obj);
+    });
+  });
+  return deferred->Promise();
+}
+
+// Per-destination outcomes of a fan-out, keyed by id_key (userId / lobbyId)
+static Napi::Object FanOutResultToObject(Napi::Env env, const FanOutResult& result, const char* id_key) {
+  Napi::Array items = Napi::Array::New(env, result.items.size());
+  uint32_t index = 0;
+  for (const FanOutItem& item : result.items) {
+    Napi::Object item_obj = Napi::Object::New(env);
+    item_obj.Set(id_key, Napi::String::New(env, std::to_string(item.destination.id)));
+    item_obj.Set("ok", Napi::Boolean::New(env, item.ok));
+    item_obj.Set("messageId", item.ok ? Napi::Value(Napi::String::New(env, std::to_string(item.message_id)))
+                                      : env.Null());
+    if (!item.ok) item_obj.Set("error", Napi::String::New(env, item.error));
+    item_obj.Set("latencyMs", Napi::Number::New(env, item.latency_us / 1000.0));
+    items.Set(index++, item_obj);
+  }
+  Napi::Object result_obj = Napi::Object::New(env);
+  result_obj.Set("results", items);
+  result_obj.Set("sent", Napi::Number::New(env, result.sent));
+  result_obj.Set("failed", Napi::Number::New(env, result.failed));
+  result_obj.Set("latencyMs", Napi::Number::New(env, result.latency_us / 1000.0));
+  return result_obj;
+}
+
+// Resolves with every user's outcome; individual failures do not reject
+Napi::Value DiscordAddon::InviteMany(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "inviteMany");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3 || !info[0].IsString() || !info[1].IsArray() || !info[2].IsObject()) {
+    Napi::TypeError::New(env, "Expected lobby ID, user IDs, and invite options").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint64_t lobby_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id)) {
+    Napi::TypeError::New(env, "Invalid lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array ids = info[1].As<Napi::Array>();
+  std::vector<uint64_t> user_ids;
+  user_ids.reserve(ids.Length());
+  for (uint32_t i = 0; i < ids.Length(); i++) {
+    uint64_t user_id;
+    if (!ids.Get(i).IsString() || !IsValidUint64(ids.Get(i).As<Napi::String>(), user_id)) {
+      Napi::TypeError::New(env, "Invalid user ID at index " + std::to_string(i)).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    user_ids.push_back(user_id);
+  }
+
+  Napi::Object options = info[2].As<Napi::Object>();
+  LobbyInvite invite;
+  invite.secret = ReadStringOption(options, "secret", invite.secret);
+  invite.title = ReadStringOption(options, "title", invite.title);
+  invite.message = ReadStringOption(options, "message", invite.message);
+  invite.concurrency = ReadUint32Option(options, "concurrency", invite.concurrency);
+  if (invite.secret.empty()) {
+    Napi::TypeError::New(env, "Expected options.secret").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.InviteMany(lobby_id, user_ids, invite, [bridge = js_bridge, deferred](const FanOutResult& result) {
+    bridge->Post([deferred, result](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      deferred->Resolve(FanOutResultToObject(env, result, "userId"));
+    });
+  });
+  return deferred->Promise();
+}
+
+// The content crosses from JS once, however many lobbies it goes to
+Napi::Value DiscordAddon::BroadcastLobbyMessage(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "broadcastLobbyMessage");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby IDs and message content").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array ids = info[0].As<Napi::Array>();
+  std::vector<uint64_t> lobby_ids;
+  lobby_ids.reserve(ids.Length());
+  for (uint32_t i = 0; i < ids.Length(); i++) {
+    uint64_t lobby_id;
+    if (!ids.Get(i).IsString() || !IsValidUint64(ids.Get(i).As<Napi::String>(), lobby_id)) {
+      Napi::TypeError::New(env, "Invalid lobby ID at index " + std::to_string(i)).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    lobby_ids.push_back(lobby_id);
+  }
+
+  uint32_t concurrency = 0;
+  if (info.Length() > 2 && info[2].IsObject()) {
+    concurrency = ReadUint32Option(info[2].As<Napi::Object>(), "concurrency", concurrency);
+  }
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.BroadcastLobbyMessage(lobby_ids, info[1].As<Napi::String>(), concurrency,
+                               [bridge = js_bridge, deferred](const FanOutResult& result) {
+    bridge->Post([deferred, result](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      deferred->Resolve(FanOutResultToObject(env, result, "lobbyId"));
+    });
+  });
+  return deferred->Promise();
+}
+
+Napi::Value DiscordAddon::FeedCodeMessage(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "feedCodeMessage");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID, author ID, and message content").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint64_t lobby_id, author_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id) || !IsValidUint64(info[1].As<Napi::String>(), author_id)) {
+    Napi::TypeError::New(env, "Invalid lobby or author ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, client.FeedCodeMessage(lobby_id, author_id, info[2].As<Napi::String>()));
+}
+
+Napi::Value DiscordAddon::ConfigureSendPipeline(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureSendPipeline");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
 
-  if (!client.SendMessage(channel_id, user_id, content)) {
-    Napi::Error::New(env, "Failed to send message").ThrowAsJavaScriptException();
+  Napi::Object options = info[0].As<Napi::Object>();
+  SendPipelineOptions pipeline = client.GetSendPipelineOptions();
+  pipeline.max_in_flight = ReadUint32Option(options, "maxInFlight", pipeline.max_in_flight);
+  pipeline.max_in_flight_per_destination =
+      ReadUint32Option(options, "maxInFlightPerDestination", pipeline.max_in_flight_per_destination);
+  pipeline.max_queued_per_destination =
+      ReadUint32Option(options, "maxQueuedPerDestination", pipeline.max_queued_per_destination);
+  pipeline.rate_limit_retries = ReadUint32Option(options, "rateLimitRetries", pipeline.rate_limit_retries);
+  if (pipeline.max_in_flight == 0 || pipeline.max_in_flight_per_destination == 0) {
+    Napi::RangeError::New(env, "In-flight limits must be at least 1").ThrowAsJavaScriptException();
     return env.Null();
   }
+  client.ConfigureSendPipeline(pipeline);
 
   return Napi::Boolean::New(env, true);
 }
 
+Napi::Value DiscordAddon::ConfigureOutbox(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureOutbox");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  OutboxOptions outbox = client.GetOutboxOptions();
+  outbox.max_pending = ReadUint32Option(options, "maxPending", outbox.max_pending);
+  outbox.max_attempts = ReadUint32Option(options, "maxAttempts", outbox.max_attempts);
+  outbox.retry_base_ms = ReadUint32Option(options, "retryBaseMs", outbox.retry_base_ms);
+  outbox.retry_max_ms = ReadUint32Option(options, "retryMaxMs", outbox.retry_max_ms);
+  outbox.remember_sent = ReadUint32Option(options, "rememberSent", outbox.remember_sent);
+  outbox.log.sync_interval_ms = ReadUint32Option(options, "syncIntervalMs", outbox.log.sync_interval_ms);
+  outbox.log.sync_batch = ReadUint32Option(options, "syncBatch", outbox.log.sync_batch);
+  std::string path = ReadStringOption(options, "path", client.GetOutboxStatus().path);
+
+  std::string error;
+  int restored = client.OpenOutbox(path, outbox, error);
+  if (restored < 0) {
+    Napi::Error::New(env, "Failed to open outbox: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Number::New(env, restored);
+}
+
+Napi::Value DiscordAddon::GetOutbox(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getOutbox");
+  Napi::Env env = info.Env();
+  OutboxStatus status = client.GetOutboxStatus();
+
+  Napi::Array messages = Napi::Array::New(env, status.messages.size());
+  uint32_t index = 0;
+  for (const auto& message : status.messages) {
+    Napi::Object message_obj = Napi::Object::New(env);
+    message_obj.Set("nonce", Napi::String::New(env, message.nonce));
+    message_obj.Set("state", Napi::String::New(env, OutboxStateName(message.state)));
+    message_obj.Set("destination", Napi::String::New(env, message.destination.target == SendTarget::User ? "user" : "lobby"));
+    message_obj.Set("targetId", Napi::String::New(env, std::to_string(message.destination.id)));
+    message_obj.Set("attempts", Napi::Number::New(env, message.attempts));
+    message_obj.Set("ageMs", Napi::Number::New(env, static_cast<double>(message.age_ms)));
+    message_obj.Set("retryInMs", Napi::Number::New(env, static_cast<double>(message.retry_in_ms)));
+    messages.Set(index++, message_obj);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("persistent", Napi::Boolean::New(env, status.persistent));
+  result.Set("path", Napi::String::New(env, status.path));
+  result.Set("fileBytes", Napi::Number::New(env, static_cast<double>(status.file_bytes)));
+  result.Set("sent", Napi::Number::New(env, static_cast<double>(status.sent)));
+  result.Set("failed", Napi::Number::New(env, static_cast<double>(status.failed)));
+  result.Set("deduped", Napi::Number::New(env, static_cast<double>(status.deduped)));
+  result.Set("messages", messages);
+  return result;
+}
+
 Napi::Value DiscordAddon::GetCurrentUser(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getCurrentUser");
   Napi::Env env = info.Env();
   auto user = client.GetCurrentUser();
 
@@ -155,9 +859,11 @@ Napi::Value DiscordAddon::GetCurrentUser(const Napi::CallbackInfo& info) {
 }
 
 Napi::Value DiscordAddon::GetGuilds(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getGuilds");
   Napi::Env env = info.Env();
   auto guilds = client.GetGuilds();
 
+  ScopedLatency marshal(METRIC_HISTOGRAM("napi.get_guilds_us"));
   Napi::Array result = Napi::Array::New(env);
   uint32_t index = 0;
 
@@ -174,71 +880,1286 @@ Napi::Value DiscordAddon::GetGuilds(const Napi::CallbackInfo& info) {
 }
 
 Napi::Value DiscordAddon::RunCallbacks(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "runCallbacks");
   Napi::Env env = info.Env();
   client.RunCallbacks();
   return env.Undefined();
 }
 
 Napi::Value DiscordAddon::FetchGuilds(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "fetchGuilds");
   Napi::Env env = info.Env();
   client.FetchGuilds();
   return env.Undefined();
 }
 
+// Settles once the call is connected. Lobby voice is addressed by lobby ID;
+// guildId is accepted for compatibility.
 Napi::Value DiscordAddon::JoinVoiceChannel(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "joinVoiceChannel");
   Napi::Env env = info.Env();
 
-  if (info.Length() < 2) {
+  if (info.Length() < 2 || !info[1].IsString()) {
     Napi::TypeError::New(env, "Expected guild ID and channel ID").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  std::string guild_id = info[0].As<Napi::String>();
   std::string channel_id = info[1].As<Napi::String>();
+  uint64_t lobby_id;
+  if (!IsValidUint64(channel_id, lobby_id)) {
+    Napi::TypeError::New(env, "Invalid channel ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.JoinVoice(lobby_id, [bridge = js_bridge, deferred, channel_id](bool ok, const std::string& error, double elapsed_ms) {
+    bridge->Post([deferred, channel_id, ok, error, elapsed_ms](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (!ok) {
+        deferred->Reject(Napi::Error::New(env, error).Value());
+        return;
+      }
+      Napi::Object result = Napi::Object::New(env);
+      result.Set("channelId", Napi::String::New(env, channel_id));
+      result.Set("joinMs", Napi::Number::New(env, elapsed_ms));
+      deferred->Resolve(result);
+    });
+  });
+  return deferred->Promise();
+}
+
+Napi::Value DiscordAddon::LeaveVoiceChannel(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "leaveVoiceChannel");
+  Napi::Env env = info.Env();
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.LeaveVoice([bridge = js_bridge, deferred](bool ok, const std::string& error, double elapsed_ms) {
+    bridge->Post([deferred, ok, error, elapsed_ms](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (!ok) {
+        deferred->Reject(Napi::Error::New(env, error).Value());
+        return;
+      }
+      Napi::Object result = Napi::Object::New(env);
+      result.Set("leaveMs", Napi::Number::New(env, elapsed_ms));
+      deferred->Resolve(result);
+    });
+  });
+  return deferred->Promise();
+}
+
+Napi::Value DiscordAddon::SetSelfMute(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setSelfMute");
+  Napi::Env env = info.Env();
 
-  if (!client.JoinVoiceChannel(guild_id, channel_id)) {
-    Napi::Error::New(env, "Failed to join voice channel").ThrowAsJavaScriptException();
+  if (info.Length() < 1 || !info[0].IsBoolean()) {
+    Napi::TypeError::New(env, "Expected boolean").ThrowAsJavaScriptException();
     return env.Null();
   }
+  client.SetSelfMute(info[0].As<Napi::Boolean>());
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::SetSelfDeaf(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setSelfDeaf");
+  Napi::Env env = info.Env();
 
+  if (info.Length() < 1 || !info[0].IsBoolean()) {
+    Napi::TypeError::New(env, "Expected boolean").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  client.SetSelfDeaf(info[0].As<Napi::Boolean>());
   return Napi::Boolean::New(env, true);
 }
 
-Napi::Value DiscordAddon::LeaveVoiceChannel(const Napi::CallbackInfo& info) {
+Napi::Value DiscordAddon::ConfigureVoice(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureVoice");
   Napi::Env env = info.Env();
 
-  if (!client.LeaveVoiceChannel()) {
-    Napi::Error::New(env, "Failed to leave voice channel").ThrowAsJavaScriptException();
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
     return env.Null();
   }
 
+  Napi::Object options = info[0].As<Napi::Object>();
+  VoiceOptions voice = client.GetVoiceOptions();
+  voice.join_timeout_ms = ReadUint32Option(options, "joinTimeoutMs", voice.join_timeout_ms);
+  voice.leave_timeout_ms = ReadUint32Option(options, "leaveTimeoutMs", voice.leave_timeout_ms);
+  client.ConfigureVoice(voice);
   return Napi::Boolean::New(env, true);
 }
 
+Napi::Value DiscordAddon::GetVoiceState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getVoiceState");
+  Napi::Env env = info.Env();
+  VoiceStatus status = client.GetVoiceStatus();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("state", Napi::String::New(env, VoiceStateName(status.state)));
+  result.Set("channelId", status.channel_id ? Napi::Value(Napi::String::New(env, std::to_string(status.channel_id)))
+                                            : env.Null());
+  result.Set("callStatus", Napi::String::New(env, status.call_status));
+  result.Set("selfMute", Napi::Boolean::New(env, status.self_mute));
+  result.Set("selfDeaf", Napi::Boolean::New(env, status.self_deaf));
+  result.Set("lastJoinMs", status.last_join_ms >= 0 ? Napi::Value(Napi::Number::New(env, status.last_join_ms))
+                                                    : env.Null());
+  result.Set("connectedMs", Napi::Number::New(env, static_cast<double>(status.connected_ms)));
+  result.Set("joins", Napi::Number::New(env, static_cast<double>(status.joins)));
+  result.Set("failures", Napi::Number::New(env, static_cast<double>(status.failures)));
+  return result;
+}
+
+// null / undefined clears the activity
 Napi::Value DiscordAddon::SetActivityRichPresence(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setActivityRichPresence");
   Napi::Env env = info.Env();
 
-  if (info.Length() < 1) {
+  if (info.Length() < 1 || !(info[0].IsObject() || info[0].IsNull() || info[0].IsUndefined())) {
     Napi::TypeError::New(env, "Expected activity object").ThrowAsJavaScriptException();
     return env.Null();
   }
 
-  Napi::Object activity = info[0].As<Napi::Object>();
-  std::string details = activity.Get("details").As<Napi::String>();
-  std::string state = activity.Get("state").As<Napi::String>();
+  PresenceActivity activity;
+  if (info[0].IsObject()) {
+    Napi::Object fields = info[0].As<Napi::Object>();
+    activity.cleared = false;
+    activity.details = ReadStringOption(fields, "details", "");
+    activity.state = ReadStringOption(fields, "state", "");
+    activity.start_ms = static_cast<uint64_t>(ReadDoubleOption(fields, "startTimestamp", 0));
+    activity.large_image = ReadStringOption(fields, "largeImageKey", "");
+    activity.large_text = ReadStringOption(fields, "largeImageText", "");
+    activity.small_image = ReadStringOption(fields, "smallImageKey", "");
+    activity.small_text = ReadStringOption(fields, "smallImageText", "");
+  }
+  return Napi::Boolean::New(env, client.SetActivityRichPresence(activity));
+}
+
+Napi::Value DiscordAddon::ClearActivity(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "clearActivity");
+  return Napi::Boolean::New(info.Env(), client.SetActivityRichPresence(PresenceActivity()));
+}
+
+Napi::Value DiscordAddon::ConfigurePresence(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configurePresence");
+  Napi::Env env = info.Env();
 
-  if (!client.SetActivityRichPresence(details, state)) {
-    Napi::Error::New(env, "Failed to set rich presence").ThrowAsJavaScriptException();
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
     return env.Null();
   }
 
+  Napi::Object options = info[0].As<Napi::Object>();
+  PresenceOptions presence = client.GetPresenceOptions();
+  presence.min_interval_ms = ReadUint32Option(options, "minIntervalMs", presence.min_interval_ms);
+  presence.max_retry_delay_ms = ReadUint32Option(options, "maxRetryDelayMs", presence.max_retry_delay_ms);
+  client.ConfigurePresence(presence);
   return Napi::Boolean::New(env, true);
 }
 
-Napi::Value DiscordAddon::Disconnect(const Napi::CallbackInfo& info) {
+Napi::Value DiscordAddon::GetPresenceState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getPresenceState");
   Napi::Env env = info.Env();
-  client.Disconnect();
-  return Napi::Boolean::New(env, true);
+  PresenceStatus status = client.GetPresenceStatus();
+
+  Napi::Value activity = env.Null();
+  if (!status.applied.cleared) {
+    Napi::Object activity_obj = Napi::Object::New(env);
+    activity_obj.Set("details", Napi::String::New(env, status.applied.details));
+    activity_obj.Set("state", Napi::String::New(env, status.applied.state));
+    if (status.applied.start_ms) {
+      activity_obj.Set("startTimestamp", Napi::Number::New(env, static_cast<double>(status.applied.start_ms)));
+    }
+    activity_obj.Set("largeImageKey", Napi::String::New(env, status.applied.large_image));
+    activity_obj.Set("largeImageText", Napi::String::New(env, status.applied.large_text));
+    activity_obj.Set("smallImageKey", Napi::String::New(env, status.applied.small_image));
+    activity_obj.Set("smallImageText", Napi::String::New(env, status.applied.small_text));
+    activity = activity_obj;
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("online", Napi::Boolean::New(env, status.online));
+  result.Set("inFlight", Napi::Boolean::New(env, status.in_flight));
+  result.Set("pending", Napi::Boolean::New(env, status.pending));
+  result.Set("nextUpdateMs", Napi::Number::New(env, static_cast<double>(status.next_update_ms)));
+  result.Set("requested", Napi::Number::New(env, static_cast<double>(status.requested)));
+  result.Set("sent", Napi::Number::New(env, static_cast<double>(status.sent)));
+  result.Set("coalesced", Napi::Number::New(env, static_cast<double>(status.coalesced)));
+  result.Set("skipped", Napi::Number::New(env, static_cast<double>(status.skipped)));
+  result.Set("failed", Napi::Number::New(env, static_cast<double>(status.failed)));
+  result.Set("activity", activity);
+  return result;
+}
+
+// { key: value, ... }; every pair must match. Absent means no filter.
+static bool LobbyFilterFromValue(const Napi::Value& value, LobbyFilter& filter) {
+  if (value.IsUndefined() || value.IsNull()) return true;
+  if (!value.IsObject()) return false;
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Array keys = object.GetPropertyNames();
+  for (uint32_t i = 0; i < keys.Length(); i++) {
+    std::string key = keys.Get(i).As<Napi::String>();
+    if (!object.Get(key).IsString()) return false;
+    filter.emplace_back(key, object.Get(key).As<Napi::String>());
+  }
+  return true;
+}
+
+static Napi::Object LobbyToObject(Napi::Env env, const LobbyInfo& lobby) {
+  Napi::Object metadata = Napi::Object::New(env);
+  for (const auto& pair : lobby.metadata) {
+    metadata.Set(pair.first, Napi::String::New(env, pair.second));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("id", Napi::String::New(env, std::to_string(lobby.id)));
+  result.Set("metadata", metadata);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(lobby.version)));
+  result.Set("updatedAt", Napi::Number::New(env, static_cast<double>(lobby.updated_ms)));
+  result.Set("memberCount", Napi::Number::New(env, static_cast<double>(lobby.member_count)));
+  return result;
+}
+
+Napi::Value DiscordAddon::GetLobbies(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getLobbies");
+  Napi::Env env = info.Env();
+
+  LobbyFilter filter;
+  if (!LobbyFilterFromValue(info[0], filter)) {
+    Napi::TypeError::New(env, "Expected a filter of string metadata values").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  auto lobbies = client.GetLobbies(filter);
+
+  ScopedLatency marshal(METRIC_HISTOGRAM("napi.get_lobbies_us"));
+  Napi::Array result = Napi::Array::New(env, lobbies.size());
+  uint32_t index = 0;
+  for (const auto& lobby : lobbies) {
+    result.Set(index++, LobbyToObject(env, lobby));
+  }
+  return result;
+}
+
+Napi::Value DiscordAddon::GetLobbyIds(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getLobbyIds");
+  Napi::Env env = info.Env();
+
+  LobbyFilter filter;
+  if (!LobbyFilterFromValue(info[0], filter)) {
+    Napi::TypeError::New(env, "Expected a filter of string metadata values").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  auto ids = client.FindLobbies(filter);
+
+  Napi::Array result = Napi::Array::New(env, ids.size());
+  uint32_t index = 0;
+  for (uint64_t id : ids) {
+    result.Set(index++, Napi::String::New(env, std::to_string(id)));
+  }
+  return result;
+}
+
+Napi::Value DiscordAddon::GetLobby(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getLobby");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint64_t lobby_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id)) {
+    Napi::TypeError::New(env, "Invalid lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  LobbyInfo lobby;
+  if (!client.GetLobby(lobby_id, lobby)) return env.Null();
+  return LobbyToObject(env, lobby);
+}
+
+Napi::Value DiscordAddon::SyncLobbies(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "syncLobbies");
+  Napi::Env env = info.Env();
+  return Napi::Number::New(env, static_cast<double>(client.SyncLobbies()));
+}
+
+Napi::Value DiscordAddon::GetLobbyMembers(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getLobbyMembers");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint64_t lobby_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id)) {
+    Napi::TypeError::New(env, "Invalid lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<uint64_t> members;
+  if (!client.GetLobbyMembers(lobby_id, members)) return env.Null();
+  Napi::Array result = Napi::Array::New(env, members.size());
+  uint32_t index = 0;
+  for (uint64_t member_id : members) {
+    result.Set(index++, Napi::String::New(env, std::to_string(member_id)));
+  }
+  return result;
+}
+
+Napi::Value DiscordAddon::IsLobbyMember(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "isLobbyMember");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID and user ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint64_t lobby_id, user_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id) || !IsValidUint64(info[1].As<Napi::String>(), user_id)) {
+    Napi::TypeError::New(env, "Invalid lobby or user ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, client.IsLobbyMember(lobby_id, user_id));
+}
+
+static Napi::Object RelationshipToObject(Napi::Env env, const Relationship& relationship) {
+  Napi::Object object = Napi::Object::New(env);
+  object.Set("id", Napi::String::New(env, std::to_string(relationship.user_id)));
+  object.Set("username", Napi::String::New(env, relationship.username));
+  object.Set("displayName", Napi::String::New(env, relationship.display_name));
+  object.Set("status", Napi::String::New(env, kFriendStatusNames[static_cast<int>(relationship.status)]));
+  object.Set("relationship", Napi::String::New(env, kRelationshipKindNames[static_cast<int>(relationship.kind)]));
+  return object;
+}
+
+static Napi::Array RelationshipsToArray(Napi::Env env, const std::vector<Relationship>& relationships) {
+  Napi::Array array = Napi::Array::New(env, relationships.size());
+  uint32_t index = 0;
+  for (const Relationship& relationship : relationships) {
+    array.Set(index++, RelationshipToObject(env, relationship));
+  }
+  return array;
+}
+
+// Sorted and filtered in native code; counts are per status for the kinds asked for
+Napi::Value DiscordAddon::GetFriends(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getFriends");
+  Napi::Env env = info.Env();
+
+  RelationshipFilter filter;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (options.Get("statuses").IsArray() &&
+        !ReadNameMask(options.Get("statuses").As<Napi::Array>(), kFriendStatusNames, filter.statuses)) {
+      Napi::TypeError::New(env, "statuses must be online, idle, dnd or offline").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    if (options.Get("relationships").IsArray() &&
+        !ReadNameMask(options.Get("relationships").As<Napi::Array>(), kRelationshipKindNames, filter.kinds)) {
+      Napi::TypeError::New(env, "relationships must be friend, incoming, outgoing, blocked or other")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    filter.name = ReadStringOption(options, "name", filter.name);
+    filter.offset = ReadUint32Option(options, "offset", filter.offset);
+    filter.limit = ReadUint32Option(options, "limit", filter.limit);
+  }
+
+  RelationshipPage page = client.GetFriends(filter);
+  Napi::Object counts = Napi::Object::New(env);
+  for (size_t status = 0; status < kFriendStatuses; status++) {
+    counts.Set(kFriendStatusNames[status], Napi::Number::New(env, static_cast<double>(page.counts[status])));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(page.version)));
+  result.Set("total", Napi::Number::New(env, static_cast<double>(page.total)));
+  result.Set("counts", counts);
+  result.Set("friends", RelationshipsToArray(env, page.relationships));
+  return result;
+}
+
+Napi::Value DiscordAddon::GetFriendChanges(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getFriendChanges");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().DoubleValue() < 0) {
+    Napi::TypeError::New(env, "Expected the version last seen").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  RelationshipChanges changes = client.GetFriendChanges(static_cast<uint64_t>(info[0].As<Napi::Number>().Int64Value()));
+
+  Napi::Array removed = Napi::Array::New(env, changes.removed.size());
+  uint32_t index = 0;
+  for (uint64_t user_id : changes.removed) {
+    removed.Set(index++, Napi::String::New(env, std::to_string(user_id)));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("version", Napi::Number::New(env, static_cast<double>(changes.version)));
+  result.Set("full", Napi::Boolean::New(env, changes.full));
+  result.Set("changed", RelationshipsToArray(env, changes.changed));
+  result.Set("removed", removed);
+  return result;
+}
+
+// Resolves with up to limit messages older than beforeId, oldest first;
+// nextBeforeId continues further back
+Napi::Value DiscordAddon::GetHistory(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getHistory");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint64_t lobby_id;
+  if (!IsValidUint64(info[0].As<Napi::String>(), lobby_id)) {
+    Napi::TypeError::New(env, "Invalid lobby ID").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint64_t before_id = 0;
+  if (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsNull()) {
+    if (!info[1].IsString() || !IsValidUint64(info[1].As<Napi::String>(), before_id)) {
+      Napi::TypeError::New(env, "Invalid beforeId").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+  uint32_t limit = 50;
+  if (info.Length() > 2 && info[2].IsNumber()) {
+    int64_t requested = info[2].As<Napi::Number>().Int64Value();
+    if (requested < 1) {
+      Napi::RangeError::New(env, "Limit must be at least 1").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    limit = static_cast<uint32_t>(std::min<int64_t>(requested, client.GetHistoryOptions().max_per_lobby));
+  }
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.GetHistory(lobby_id, before_id, limit, [bridge = js_bridge, deferred](const HistoryPage& page) {
+    bridge->Post([deferred, page](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (!page.ok) {
+        deferred->Reject(Napi::Error::New(env, page.error).Value());
+        return;
+      }
+      Napi::Array messages = Napi::Array::New(env, page.messages.size());
+      uint32_t index = 0;
+      for (const HistoryMessage& message : page.messages) {
+        Napi::Object message_obj = Napi::Object::New(env);
+        message_obj.Set("id", Napi::String::New(env, std::to_string(message.id)));
+        message_obj.Set("lobbyId", Napi::String::New(env, std::to_string(message.lobby_id)));
+        message_obj.Set("authorId", Napi::String::New(env, std::to_string(message.author_id)));
+        message_obj.Set("content", Napi::String::New(env, message.content));
+        message_obj.Set("timestamp", Napi::Number::New(env, static_cast<double>(message.sent_ms)));
+        messages.Set(index++, message_obj);
+      }
+      Napi::Object page_obj = Napi::Object::New(env);
+      page_obj.Set("messages", messages);
+      page_obj.Set("hasMore", Napi::Boolean::New(env, page.has_more));
+      page_obj.Set("cached", Napi::Boolean::New(env, page.cached));
+      page_obj.Set("nextBeforeId", page.has_more && !page.messages.empty()
+                                       ? Napi::Value(Napi::String::New(env, std::to_string(page.messages.front().id)))
+                                       : env.Null());
+      deferred->Resolve(page_obj);
+    });
+  });
+  return deferred->Promise();
+}
+
+Napi::Value DiscordAddon::ConfigureHistory(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureHistory");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  HistoryOptions history = client.GetHistoryOptions();
+  history.max_per_lobby = ReadUint32Option(options, "maxPerLobby", history.max_per_lobby);
+  history.max_lobbies = ReadUint32Option(options, "maxLobbies", history.max_lobbies);
+  history.max_fetch = ReadUint32Option(options, "maxFetch", history.max_fetch);
+  if (history.max_per_lobby == 0 || history.max_lobbies == 0 || history.max_fetch == 0) {
+    Napi::RangeError::New(env, "History limits must be at least 1").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  client.ConfigureHistory(history);
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::GetHistoryState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getHistoryState");
+  Napi::Env env = info.Env();
+  HistoryStatus status = client.GetHistoryStatus();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("lobbies", Napi::Number::New(env, static_cast<double>(status.lobbies)));
+  result.Set("messages", Napi::Number::New(env, static_cast<double>(status.messages)));
+  result.Set("hits", Napi::Number::New(env, static_cast<double>(status.hits)));
+  result.Set("misses", Napi::Number::New(env, static_cast<double>(status.misses)));
+  result.Set("fetches", Napi::Number::New(env, static_cast<double>(status.fetches)));
+  return result;
+}
+
+Napi::Value DiscordAddon::ConfigureMessageLog(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureMessageLog");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  MessageLogOptions log = client.GetMessageLogOptions();
+  log.max_messages = ReadUint32Option(options, "maxMessages", log.max_messages);
+  log.max_open = ReadUint32Option(options, "maxOpenFiles", log.max_open);
+  log.log.sync_interval_ms = ReadUint32Option(options, "syncIntervalMs", log.log.sync_interval_ms);
+  log.log.sync_batch = ReadUint32Option(options, "syncBatch", log.log.sync_batch);
+  if (log.max_messages == 0 || log.max_open == 0) {
+    Napi::RangeError::New(env, "Message log limits must be at least 1").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  std::string path = ReadStringOption(options, "path", client.GetMessageLogStatus().path);
+
+  std::string error;
+  if (!client.OpenMessageLog(path, log, error)) {
+    Napi::Error::New(env, "Failed to open message log: " + error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::GetMessageLogState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getMessageLogState");
+  Napi::Env env = info.Env();
+  MessageLogStatus status = client.GetMessageLogStatus();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("persistent", Napi::Boolean::New(env, status.persistent));
+  result.Set("path", Napi::String::New(env, status.path));
+  result.Set("openLobbies", Napi::Number::New(env, static_cast<double>(status.open_lobbies)));
+  result.Set("appended", Napi::Number::New(env, static_cast<double>(status.appended)));
+  result.Set("compactions", Napi::Number::New(env, static_cast<double>(status.compactions)));
+  result.Set("indexRebuilds", Napi::Number::New(env, static_cast<double>(status.index_rebuilds)));
+  return result;
+}
+
+Napi::Value DiscordAddon::SearchMessages(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "searchMessages");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected search query").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  SearchQuery query;
+  query.text = info[0].As<Napi::String>();
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    Napi::Value lobby_ids = options.Get("lobbyIds");
+    if (!lobby_ids.IsUndefined() && !lobby_ids.IsNull()) {
+      if (!lobby_ids.IsArray()) {
+        Napi::TypeError::New(env, "lobbyIds must be an array").ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      Napi::Array ids = lobby_ids.As<Napi::Array>();
+      for (uint32_t i = 0; i < ids.Length(); i++) {
+        uint64_t lobby_id;
+        if (!ids.Get(i).IsString() || !IsValidUint64(ids.Get(i).As<Napi::String>(), lobby_id)) {
+          Napi::TypeError::New(env, "Invalid lobby ID at index " + std::to_string(i)).ThrowAsJavaScriptException();
+          return env.Null();
+        }
+        query.channel_ids.push_back(lobby_id);
+      }
+    }
+    query.limit = ReadUint32Option(options, "limit", query.limit);
+    if (query.limit == 0) {
+      Napi::RangeError::New(env, "Limit must be at least 1").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    query.limit = std::min<uint32_t>(query.limit, 500);
+  }
+
+  auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+  client.SearchMessages(std::move(query), [bridge = js_bridge, deferred](const SearchResult& result) {
+    bridge->Post([deferred, result](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      if (!result.ok) {
+        deferred->Reject(Napi::Error::New(env, result.error).Value());
+        return;
+      }
+      Napi::Array results = Napi::Array::New(env, result.hits.size());
+      uint32_t index = 0;
+      for (const SearchDocument& hit : result.hits) {
+        Napi::Object hit_obj = Napi::Object::New(env);
+        hit_obj.Set("id", Napi::String::New(env, std::to_string(hit.message_id)));
+        hit_obj.Set("channelId", Napi::String::New(env, std::to_string(hit.channel_id)));
+        hit_obj.Set("kind", Napi::String::New(env, hit.lobby ? "lobby" : "dm"));
+        hit_obj.Set("authorId", Napi::String::New(env, std::to_string(hit.author_id)));
+        hit_obj.Set("authorName", Napi::String::New(env, hit.author_name));
+        hit_obj.Set("content", Napi::String::New(env, hit.content));
+        hit_obj.Set("timestamp", Napi::Number::New(env, static_cast<double>(hit.sent_ms)));
+        results.Set(index++, hit_obj);
+      }
+      Napi::Object result_obj = Napi::Object::New(env);
+      result_obj.Set("results", results);
+      result_obj.Set("total", Napi::Number::New(env, result.total));
+      result_obj.Set("tookMs", Napi::Number::New(env, result.took_us / 1000.0));
+      deferred->Resolve(result_obj);
+    });
+  });
+  return deferred->Promise();
+}
+
+Napi::Value DiscordAddon::ConfigureSearch(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureSearch");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  SearchOptions search = client.GetSearchOptions();
+  search.max_documents = ReadUint32Option(info[0].As<Napi::Object>(), "maxDocuments", search.max_documents);
+  if (search.max_documents == 0) {
+    Napi::RangeError::New(env, "maxDocuments must be at least 1").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  client.ConfigureSearch(search);
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::GetSearchState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getSearchState");
+  Napi::Env env = info.Env();
+  SearchStatus status = client.GetSearchStatus();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("documents", Napi::Number::New(env, static_cast<double>(status.documents)));
+  result.Set("terms", Napi::Number::New(env, static_cast<double>(status.terms)));
+  result.Set("postingsBytes", Napi::Number::New(env, static_cast<double>(status.postings_bytes)));
+  result.Set("pending", Napi::Number::New(env, static_cast<double>(status.pending)));
+  result.Set("searches", Napi::Number::New(env, static_cast<double>(status.searches)));
+  return result;
+}
+
+Napi::Value DiscordAddon::QuickSearch(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "quickSearch");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected search query").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  uint32_t kinds = kAllNameKinds;
+  if (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsNull()) {
+    if (!info[1].IsArray()) {
+      Napi::TypeError::New(env, "kinds must be an array").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    if (!ReadNameMask(info[1].As<Napi::Array>(), kNameKindNames, kinds)) {
+      Napi::TypeError::New(env, "kinds must be guild, channel, lobby or friend").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+  uint32_t limit = 20;
+  if (info.Length() > 2 && info[2].IsNumber()) {
+    int64_t requested = info[2].As<Napi::Number>().Int64Value();
+    if (requested < 1) {
+      Napi::RangeError::New(env, "Limit must be at least 1").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    limit = static_cast<uint32_t>(std::min<int64_t>(requested, 200));
+  }
+
+  std::vector<NameMatch> matches = client.QuickSearch(info[0].As<Napi::String>(), kinds, limit);
+  Napi::Array result = Napi::Array::New(env, matches.size());
+  uint32_t index = 0;
+  for (const NameMatch& match : matches) {
+    Napi::Object match_obj = Napi::Object::New(env);
+    match_obj.Set("kind", Napi::String::New(env, kNameKindNames[static_cast<int>(match.kind)]));
+    match_obj.Set("id", Napi::String::New(env, match.entry.id));
+    match_obj.Set("name", Napi::String::New(env, match.entry.name));
+    match_obj.Set("guildId", match.entry.parent_id.empty() ? env.Null()
+                                                          : Napi::Value(Napi::String::New(env, match.entry.parent_id)));
+    match_obj.Set("score", Napi::Number::New(env, match.score));
+    result.Set(index++, match_obj);
+  }
+  return result;
+}
+
+Napi::Value DiscordAddon::GetQuickSearchState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getQuickSearchState");
+  Napi::Env env = info.Env();
+  NameIndexStatus status = client.GetNameIndexStatus();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("names", Napi::Number::New(env, static_cast<double>(status.names)));
+  result.Set("trigrams", Napi::Number::New(env, static_cast<double>(status.trigrams)));
+  result.Set("searches", Napi::Number::New(env, static_cast<double>(status.searches)));
+  return result;
+}
+
+Napi::Value DiscordAddon::Disconnect(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "disconnect");
+  Napi::Env env = info.Env();
+  client.Disconnect();
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::Shutdown(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "shutdown");
+  Napi::Env env = info.Env();
+  uint32_t timeout_ms = kExitShutdownTimeoutMs;
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    timeout_ms = ReadUint32Option(info[0].As<Napi::Object>(), "timeoutMs", timeout_ms);
+  }
+
+  ShutdownReport report = DiscordClient::Shutdown(timeout_ms);
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("performed", Napi::Boolean::New(env, report.performed));
+  result.Set("withinDeadline", Napi::Boolean::New(env, report.within_deadline));
+  result.Set("abandonedRequests", Napi::Number::New(env, report.abandoned_requests));
+  result.Set("totalMs", Napi::Number::New(env, report.total_ms));
+  Napi::Object stages = Napi::Object::New(env);
+  for (const auto& stage : report.stages) {
+    stages.Set(stage.name, Napi::Number::New(env, stage.ms));
+  }
+  result.Set("stages", stages);
+  return result;
+}
+
+Napi::Value DiscordAddon::SetLogLevel(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setLogLevel");
+  Napi::Env env = info.Env();
+  Logger& logger = Logger::Instance();
+  LogLevel previous = logger.Level();
+
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "Expected log level").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  LogLevel level;
+  if (info[0].IsNumber()) {
+    int value = info[0].As<Napi::Number>().Int32Value();
+    if (value < static_cast<int>(LogLevel::Trace) || value > static_cast<int>(LogLevel::Off)) {
+      Napi::RangeError::New(env, "Log level must be between 0 (trace) and 5 (off)").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    level = static_cast<LogLevel>(value);
+  } else if (!info[0].IsString() || !Logger::ParseLevel(info[0].As<Napi::String>(), level)) {
+    Napi::TypeError::New(env, "Expected one of: trace, debug, info, warn, error, off").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  logger.SetLevel(level);
+  // The previous level comes back in the form it was set with: a number, or a
+  // name spelled the way ParseLevel takes it (lowercase)
+  if (info[0].IsNumber()) {
+    return Napi::Number::New(env, static_cast<int>(previous));
+  }
+  std::string name = Logger::LevelName(previous);
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return Napi::String::New(env, name);
+}
+
+Napi::Value DiscordAddon::FlushLogs(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "flushLogs");
+  Napi::Env env = info.Env();
+  Logger::Instance().Flush();
+  return env.Undefined();
+}
+
+Napi::Value DiscordAddon::GetMetrics(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getMetrics");
+  Napi::Env env = info.Env();
+  Metrics::Snapshot snap = Metrics::Instance().Collect();
+
+  Napi::Object counters = Napi::Object::New(env);
+  for (const auto& counter : snap.counters) {
+    counters.Set(counter.first, Napi::Number::New(env, static_cast<double>(counter.second)));
+  }
+
+  Napi::Object gauges = Napi::Object::New(env);
+  for (const auto& gauge : snap.gauges) {
+    Napi::Object gauge_obj = Napi::Object::New(env);
+    gauge_obj.Set("value", Napi::Number::New(env, static_cast<double>(gauge.second.first)));
+    gauge_obj.Set("max", Napi::Number::New(env, static_cast<double>(gauge.second.second)));
+    gauges.Set(gauge.first, gauge_obj);
+  }
+
+  // Histogram values are microseconds
+  Napi::Object histograms = Napi::Object::New(env);
+  for (const auto& entry : snap.histograms) {
+    const HistogramSnapshot& h = entry.second;
+    Napi::Object histogram_obj = Napi::Object::New(env);
+    histogram_obj.Set("count", Napi::Number::New(env, static_cast<double>(h.count)));
+    histogram_obj.Set("min", Napi::Number::New(env, static_cast<double>(h.min)));
+    histogram_obj.Set("max", Napi::Number::New(env, static_cast<double>(h.max)));
+    histogram_obj.Set("mean", Napi::Number::New(env, h.mean));
+    histogram_obj.Set("p50", Napi::Number::New(env, static_cast<double>(h.p50)));
+    histogram_obj.Set("p90", Napi::Number::New(env, static_cast<double>(h.p90)));
+    histogram_obj.Set("p99", Napi::Number::New(env, static_cast<double>(h.p99)));
+    histogram_obj.Set("p999", Napi::Number::New(env, static_cast<double>(h.p999)));
+    histograms.Set(entry.first, histogram_obj);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("uptimeMs", Napi::Number::New(env, static_cast<double>(snap.uptime_ms)));
+  result.Set("counters", counters);
+  result.Set("gauges", gauges);
+  result.Set("histograms", histograms);
+  return result;
+}
+
+Napi::Value DiscordAddon::StartTracing(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+#ifdef DISCORD_ENABLE_TRACING
+  size_t capacity = 65536;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    if (options.Has("bufferSize") && options.Get("bufferSize").IsNumber()) {
+      capacity = options.Get("bufferSize").As<Napi::Number>().Uint32Value();
+    }
+  }
+  Tracer::Instance().Start(capacity);
+  return Napi::Boolean::New(env, true);
+#else
+  LOG_WARN("⚠️  Tracing was compiled out (build without DISCORD_ENABLE_TRACING)");
+  return Napi::Boolean::New(env, false);
+#endif
+}
+
+Napi::Value DiscordAddon::StopTracing(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Tracer::Instance().Stop();
+  return Napi::Number::New(env, static_cast<double>(Tracer::Instance().EventCount()));
+}
+
+Napi::Value DiscordAddon::ExportTrace(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::string json = Tracer::Instance().ExportJson();
+
+  // Without a path the caller gets the JSON back and decides where it goes
+  if (info.Length() < 1 || !info[0].IsString()) {
+    return Napi::String::New(env, json);
+  }
+
+  std::string path = info[0].As<Napi::String>();
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out || !out.write(json.data(), json.size())) {
+    Napi::Error::New(env, "Failed to write trace file: " + path).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  LOG_INFO("🧭 Wrote trace (" << Tracer::Instance().EventCount() << " spans) to " << path);
+  return Napi::String::New(env, path);
+}
+
+Napi::Value DiscordAddon::ConfigureFlightRecorder(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureFlightRecorder");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  FlightRecorder& recorder = FlightRecorder::Instance();
+  std::string dump_path = recorder.DumpPath();
+  if (options.Has("dumpPath") && options.Get("dumpPath").IsString()) {
+    dump_path = options.Get("dumpPath").As<Napi::String>();
+  }
+  bool crash_handlers = true;
+  if (options.Has("crashHandlers") && options.Get("crashHandlers").IsBoolean()) {
+    crash_handlers = options.Get("crashHandlers").As<Napi::Boolean>();
+  }
+
+  recorder.Configure(dump_path, crash_handlers);
+  return Napi::String::New(env, recorder.DumpPath());
+}
+
+Napi::Value DiscordAddon::DumpFlightRecorder(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "dumpFlightRecorder");
+  Napi::Env env = info.Env();
+  FlightRecorder& recorder = FlightRecorder::Instance();
+
+  std::string path = recorder.DumpPath();
+  if (info.Length() > 0 && info[0].IsString()) {
+    path = info[0].As<Napi::String>();
+  }
+
+  if (!recorder.Dump(path)) {
+    Napi::Error::New(env, "Failed to write flight recorder dump: " + path).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  LOG_INFO("🛩️  Flight recorder dumped to " << path);
+  return Napi::String::New(env, path);
+}
+
+Napi::Value DiscordAddon::GetFlightRecords(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getFlightRecords");
+  Napi::Env env = info.Env();
+
+  // With a path, decode a previous dump; otherwise read the live ring
+  std::vector<FlightRecord> records;
+  if (info.Length() > 0 && info[0].IsString()) {
+    std::string path = info[0].As<Napi::String>();
+    if (!FlightRecorder::ReadDump(path, records)) {
+      Napi::Error::New(env, "Not a flight recorder dump: " + path).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  } else {
+    records = FlightRecorder::Instance().Snapshot();
+  }
+
+  Napi::Array result = Napi::Array::New(env, records.size());
+  uint32_t index = 0;
+  for (const auto& record : records) {
+    Napi::Object record_obj = Napi::Object::New(env);
+    record_obj.Set("seq", Napi::Number::New(env, static_cast<double>(record.seq)));
+    record_obj.Set("timeMs", Napi::Number::New(env, record.timestamp_ns / 1e6));
+    record_obj.Set("kind", Napi::String::New(env, FlightRecorder::KindName(record.kind)));
+    record_obj.Set("tag", Napi::String::New(env, std::string(record.tag, strnlen(record.tag, sizeof(record.tag)))));
+    record_obj.Set("code", Napi::Number::New(env, record.code));
+    record_obj.Set("value", Napi::Number::New(env, static_cast<double>(record.value)));
+    record_obj.Set("value2", Napi::Number::New(env, static_cast<double>(record.value2)));
+    result.Set(index++, record_obj);
+  }
+  return result;
+}
+
+Napi::Value DiscordAddon::On(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "on");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "Expected event name and listener function").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string type = info[0].As<Napi::String>();
+  listeners->emplace(type, Napi::Persistent(info[1].As<Napi::Function>()));
+  return env.Undefined();
+}
+
+Napi::Value DiscordAddon::Off(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "off");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "Expected event name").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // Without a listener argument every listener for the event is removed
+  std::string type = info[0].As<Napi::String>();
+  auto range = listeners->equal_range(type);
+  for (auto it = range.first; it != range.second;) {
+    if (info.Length() < 2 || it->second.Value().StrictEquals(info[1])) {
+      it = listeners->erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return env.Undefined();
+}
+
+Napi::Value DiscordAddon::ConfigureWatchdog(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureWatchdog");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  WatchdogOptions watchdog = client.GetWatchdogOptions();
+  watchdog.pump_stall_ms = ReadUint32Option(options, "pumpStallMs", watchdog.pump_stall_ms);
+  watchdog.request_stall_ms = ReadUint32Option(options, "requestStallMs", watchdog.request_stall_ms);
+  watchdog.check_interval_ms = ReadUint32Option(options, "checkIntervalMs", watchdog.check_interval_ms);
+  watchdog.auto_retry = ReadBoolOption(options, "autoRetry", watchdog.auto_retry);
+  watchdog.max_retries = ReadUint32Option(options, "maxRetries", watchdog.max_retries);
+  client.ConfigureWatchdog(watchdog);
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::GetInFlightRequests(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getInFlightRequests");
+  Napi::Env env = info.Env();
+  auto requests = client.GetInFlightRequests();
+
+  Napi::Array result = Napi::Array::New(env, requests.size());
+  uint32_t index = 0;
+  for (const auto& request : requests) {
+    Napi::Object request_obj = Napi::Object::New(env);
+    request_obj.Set("id", Napi::Number::New(env, static_cast<double>(request.id)));
+    request_obj.Set("op", Napi::String::New(env, request.op));
+    request_obj.Set("attempt", Napi::Number::New(env, request.attempt));
+    request_obj.Set("ageMs", Napi::Number::New(env, static_cast<double>(request.age_ms)));
+    result.Set(index++, request_obj);
+  }
+  return result;
+}
+
+Napi::Value DiscordAddon::WhenReady(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "whenReady");
+  return ReadinessPromise(info.Env());
+}
+
+Napi::Value DiscordAddon::GetStartupTimings(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getStartupTimings");
+  return StartupTimingsToObject(info.Env(), client.GetStartupTimings());
+}
+
+Napi::Value DiscordAddon::SetSdkLibraryPath(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setSdkLibraryPath");
+  Napi::Env env = info.Env();
+
+  // Without an argument this just reports where the SDK is (or will be) loaded from
+  if (info.Length() > 0) {
+    if (!info[0].IsString()) {
+      Napi::TypeError::New(env, "Expected SDK library path").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    if (sdk::IsLoaded()) {
+      Napi::Error::New(env, "Discord SDK is already loaded from " + sdk::LibraryPath()).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    sdk::SetLibraryPath(info[0].As<Napi::String>());
+  }
+  return Napi::String::New(env, sdk::LibraryPath());
+}
+
+Napi::Value DiscordAddon::ConfigureReconnect(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureReconnect");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  ReconnectOptions reconnect = client.GetReconnectOptions();
+  reconnect.enabled = ReadBoolOption(options, "enabled", reconnect.enabled);
+  reconnect.base_delay_ms = ReadUint32Option(options, "baseDelayMs", reconnect.base_delay_ms);
+  reconnect.max_delay_ms = ReadUint32Option(options, "maxDelayMs", reconnect.max_delay_ms);
+  reconnect.max_attempts = ReadUint32Option(options, "maxAttempts", reconnect.max_attempts);
+  client.ConfigureReconnect(reconnect);
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::SetToken(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setToken");
+  Napi::Env env = info.Env();
+
+  TokenInfo token;
+  if (info.Length() < 1 || !TokenInfoFromValue(info[0], token)) {
+    Napi::TypeError::New(env, "Expected { accessToken, refreshToken?, expiresIn? }").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!client.UpdateToken(token)) {
+    Napi::Error::New(env, "Failed to update token").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::RefreshToken(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "refreshToken");
+  Napi::Env env = info.Env();
+  return Napi::Boolean::New(env, client.RefreshToken());
+}
+
+Napi::Value DiscordAddon::SetTokenRefresher(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "setTokenRefresher");
+  Napi::Env env = info.Env();
+
+  // null/undefined falls back to the SDK's own refresh-token exchange
+  if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+    client.SetTokenRefresher(nullptr);
+    return env.Undefined();
+  }
+  if (!info[0].IsFunction()) {
+    Napi::TypeError::New(env, "Expected refresher function or null").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  auto refresher = std::make_shared<Napi::FunctionReference>(Napi::Persistent(info[0].As<Napi::Function>()));
+  client.SetTokenRefresher([bridge = js_bridge, refresher](const std::string& refresh_token, TokenRefreshDone done) {
+    return bridge->Post([refresher, refresh_token, done](Napi::Env env) {
+      Napi::HandleScope scope(env);
+      try {
+        Napi::Value result = refresher->Call({ Napi::String::New(env, refresh_token) });
+        SettleTokenRefresh(env, result, done);
+      } catch (const Napi::Error& e) {
+        done(false, TokenInfo(), e.Message());
+      }
+    });
+  });
+  return env.Undefined();
+}
+
+Napi::Value DiscordAddon::ConfigureTokenRefresh(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureTokenRefresh");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  TokenRefreshOptions refresh = client.GetTokenRefreshOptions();
+  refresh.refresh_margin_s = ReadUint32Option(options, "refreshMarginSec", refresh.refresh_margin_s);
+  refresh.retry_base_ms = ReadUint32Option(options, "retryBaseMs", refresh.retry_base_ms);
+  refresh.retry_max_ms = ReadUint32Option(options, "retryMaxMs", refresh.retry_max_ms);
+  client.ConfigureTokenRefresh(refresh);
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::GetTokenState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getTokenState");
+  Napi::Env env = info.Env();
+  TokenStatus status = client.GetTokenStatus();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("hasToken", Napi::Boolean::New(env, status.has_token));
+  result.Set("hasRefreshToken", Napi::Boolean::New(env, status.has_refresh_token));
+  result.Set("refreshing", Napi::Boolean::New(env, status.refreshing));
+  result.Set("expiresInMs", status.expiry_known ? Napi::Number::New(env, static_cast<double>(status.expires_in_ms))
+                                                : env.Null());
+  result.Set("nextRefreshMs", Napi::Number::New(env, static_cast<double>(status.next_refresh_ms)));
+  result.Set("refreshes", Napi::Number::New(env, static_cast<double>(status.refreshes)));
+  result.Set("failures", Napi::Number::New(env, static_cast<double>(status.failures)));
+  return result;
+}
+
+Napi::Value DiscordAddon::GetConnectionState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getConnectionState");
+  Napi::Env env = info.Env();
+  bool caches_stale = false;
+  ConnectionInfo connection = client.GetConnectionInfo(caches_stale);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("state", Napi::String::New(env, ConnectionManager::StateName(connection.state)));
+  result.Set("attempt", Napi::Number::New(env, connection.attempt));
+  result.Set("lastError", Napi::Number::New(env, connection.last_error));
+  result.Set("lastErrorDetail", Napi::Number::New(env, connection.last_error_detail));
+  result.Set("downMs", Napi::Number::New(env, static_cast<double>(connection.down_ms)));
+  result.Set("nextRetryMs", Napi::Number::New(env, static_cast<double>(connection.next_retry_ms)));
+  result.Set("outages", Napi::Number::New(env, static_cast<double>(connection.outages)));
+  result.Set("stale", Napi::Boolean::New(env, caches_stale));
+  return result;
+}
+
+static RouteLimit RouteLimitFromObject(const Napi::Object& options, RouteLimit limit) {
+  limit.rate_per_s = ReadDoubleOption(options, "ratePerSec", limit.rate_per_s);
+  limit.burst = ReadUint32Option(options, "burst", limit.burst);
+  return limit;
+}
+
+Napi::Value DiscordAddon::ConfigureScheduler(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "configureScheduler");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "Expected options object").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options = info[0].As<Napi::Object>();
+  SchedulerOptions scheduler = client.GetSchedulerOptions();
+  scheduler.default_limit = RouteLimitFromObject(options, scheduler.default_limit);
+  scheduler.interactive_reserve = ReadUint32Option(options, "interactiveReserve", scheduler.interactive_reserve);
+  scheduler.max_queued = ReadUint32Option(options, "maxQueued", scheduler.max_queued);
+  scheduler.high_water = ReadUint32Option(options, "highWater", scheduler.high_water);
+  scheduler.low_water = ReadUint32Option(options, "lowWater", scheduler.low_water);
+
+  // routes: { GetGuildChannels: { ratePerSec, burst }, ... } override the default per SDK call
+  std::vector<std::pair<std::string, RouteLimit>> routes;
+  if (options.Has("routes") && options.Get("routes").IsObject()) {
+    Napi::Object table = options.Get("routes").As<Napi::Object>();
+    Napi::Array names = table.GetPropertyNames();
+    for (uint32_t i = 0; i < names.Length(); i++) {
+      std::string name = names.Get(i).As<Napi::String>();
+      if (!table.Get(name).IsObject()) continue;
+      routes.emplace_back(name, RouteLimitFromObject(table.Get(name).As<Napi::Object>(), scheduler.default_limit));
+    }
+  }
+  client.ConfigureScheduler(scheduler, routes);
+
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Value DiscordAddon::GetSchedulerState(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "getSchedulerState");
+  Napi::Env env = info.Env();
+  SchedulerStatus status = client.GetSchedulerStatus();
+
+  Napi::Object queued = Napi::Object::New(env);
+  for (int p = 0; p < static_cast<int>(RequestPriority::Count); p++) {
+    queued.Set(RequestPriorityName(static_cast<RequestPriority>(p)), Napi::Number::New(env, status.queued[p]));
+  }
+
+  Napi::Array routes = Napi::Array::New(env, status.routes.size());
+  uint32_t index = 0;
+  for (const auto& route : status.routes) {
+    Napi::Object route_obj = Napi::Object::New(env);
+    route_obj.Set("route", Napi::String::New(env, route.route));
+    route_obj.Set("tokens", Napi::Number::New(env, route.tokens));
+    route_obj.Set("queued", Napi::Number::New(env, route.queued));
+    route_obj.Set("pausedMs", Napi::Number::New(env, static_cast<double>(route.paused_ms)));
+    route_obj.Set("dispatched", Napi::Number::New(env, static_cast<double>(route.dispatched)));
+    route_obj.Set("rateLimited", Napi::Number::New(env, static_cast<double>(route.rate_limited)));
+    routes.Set(index++, route_obj);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("queued", queued);
+  result.Set("backpressure", Napi::Boolean::New(env, status.backpressure));
+  result.Set("rejected", Napi::Number::New(env, static_cast<double>(status.rejected)));
+  result.Set("routes", routes);
+  return result;
+}
+
+Napi::Value DiscordAddon::PrefetchGuildChannels(const Napi::CallbackInfo& info) {
+  TRACE_SCOPE("napi", "prefetchGuildChannels");
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "Expected an array of guild IDs").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  RequestPriority priority = RequestPriority::Prefetch;
+  if (info.Length() >= 2 && info[1].IsString() &&
+      !ParseRequestPriority(info[1].As<Napi::String>(), priority)) {
+    Napi::TypeError::New(env, "Priority must be 'interactive', 'prefetch' or 'background'").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Array ids = info[0].As<Napi::Array>();
+  std::vector<std::string> guild_ids;
+  guild_ids.reserve(ids.Length());
+  for (uint32_t i = 0; i < ids.Length(); i++) {
+    if (ids.Get(i).IsString()) {
+      guild_ids.push_back(ids.Get(i).As<Napi::String>());
+    }
+  }
+  return Napi::Number::New(env, client.PrefetchGuildChannels(guild_ids, priority));
 }
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
@@ -0,0 +1,74 @@
+#include "events.h"
+#include "metrics.h"
+#include <map>
+#include <memory>
+#include <mutex>
+
+static std::mutex g_sink_mutex;
+static std::map<uint64_t, std::shared_ptr<EventSink>> g_sinks;
+static uint64_t g_next_sink_id = 1;
+
+NativeEvent& NativeEvent::String(const std::string& key, std::string value) {
+  EventField field;
+  field.key = key;
+  field.type = EventField::Type::String;
+  field.string_value = std::move(value);
+  fields_.push_back(std::move(field));
+  return *this;
+}
+
+NativeEvent& NativeEvent::Number(const std::string& key, double value) {
+  EventField field;
+  field.key = key;
+  field.type = EventField::Type::Number;
+  field.number_value = value;
+  fields_.push_back(std::move(field));
+  return *this;
+}
+
+NativeEvent& NativeEvent::Bool(const std::string& key, bool value) {
+  EventField field;
+  field.key = key;
+  field.type = EventField::Type::Bool;
+  field.bool_value = value;
+  fields_.push_back(std::move(field));
+  return *this;
+}
+
+NativeEvent& NativeEvent::StringList(const std::string& key, std::vector<std::string> value) {
+  EventField field;
+  field.key = key;
+  field.type = EventField::Type::StringList;
+  field.list_value = std::move(value);
+  fields_.push_back(std::move(field));
+  return *this;
+}
+
+uint64_t AddEventSink(EventSink sink) {
+  std::lock_guard<std::mutex> lock(g_sink_mutex);
+  uint64_t sink_id = g_next_sink_id++;
+  g_sinks.emplace(sink_id, std::make_shared<EventSink>(std::move(sink)));
+  return sink_id;
+}
+
+void RemoveEventSink(uint64_t sink_id) {
+  std::lock_guard<std::mutex> lock(g_sink_mutex);
+  g_sinks.erase(sink_id);
+}
+
+void EmitEvent(NativeEvent event) {
+  // Copy the sinks out so a slow sink never holds up adding or removing one
+  std::vector<std::shared_ptr<EventSink>> sinks;
+  {
+    std::lock_guard<std::mutex> lock(g_sink_mutex);
+    sinks.reserve(g_sinks.size());
+    for (const auto& entry : g_sinks) sinks.push_back(entry.second);
+  }
+  if (sinks.empty()) {
+    METRIC_COUNTER("events.dropped").Add();
+    return;
+  }
+  METRIC_COUNTER("events.emitted").Add();
+  for (size_t i = 0; i + 1 < sinks.size(); i++) (*sinks[i])(event);
+  (*sinks.back())(std::move(event));
+}
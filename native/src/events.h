@@ -0,0 +1,50 @@
+#ifndef DISCORD_EVENTS_H
+#define DISCORD_EVENTS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// N-API-free event payload so DiscordClient and its helpers can raise events
+// from any thread; discord_social_sdk.cc converts them to JS objects on the
+// main thread.
+struct EventField {
+  enum class Type { String, Number, Bool, StringList };
+
+  std::string key;
+  Type type;
+  std::string string_value;
+  double number_value = 0;
+  bool bool_value = false;
+  std::vector<std::string> list_value;
+};
+
+class NativeEvent {
+public:
+  explicit NativeEvent(std::string type) : type_(std::move(type)) {}
+
+  NativeEvent& String(const std::string& key, std::string value);
+  NativeEvent& Number(const std::string& key, double value);
+  NativeEvent& Bool(const std::string& key, bool value);
+  NativeEvent& StringList(const std::string& key, std::vector<std::string> value);
+
+  const std::string& Type() const { return type_; }
+  const std::vector<EventField>& Fields() const { return fields_; }
+
+private:
+  std::string type_;
+  std::vector<EventField> fields_;
+};
+
+using EventSink = std::function<void(NativeEvent)>;
+
+// Every installed sink gets every event; each DiscordAddon instance installs
+// its own, so one going away leaves the others' listeners intact. Sinks must be
+// safe to call from any thread. Events emitted while no sink is installed are
+// dropped.
+uint64_t AddEventSink(EventSink sink);
+void RemoveEventSink(uint64_t sink_id);  // unknown ids are ignored
+void EmitEvent(NativeEvent event);
+
+#endif // DISCORD_EVENTS_H
@@ -0,0 +1,73 @@
+#include "fan_out.h"
+#include "metrics.h"
+#include <chrono>
+#include <memory>
+
+// One FanOutSend call
+struct FanOutBatch {
+  std::vector<SendDestination> destinations;
+  std::string content;  // shared by every send
+  uint32_t window;
+  FanOutSendFn send;
+  std::function<void(const FanOutResult& result)> done;
+
+  FanOutResult result;
+  size_t next = 0;
+  size_t outstanding = 0;
+  size_t settled = 0;
+  bool launching = false;
+  std::chrono::steady_clock::time_point started;
+};
+
+static void Launch(const std::shared_ptr<FanOutBatch>& batch) {
+  // Synchronous results re-enter here; the outer loop picks up their slots
+  if (batch->launching) return;
+  batch->launching = true;
+  while (batch->next < batch->destinations.size() && batch->outstanding < batch->window) {
+    size_t index = batch->next++;
+    batch->outstanding++;
+    auto sent_at = std::chrono::steady_clock::now();
+    batch->send(index, batch->destinations[index], batch->content, [batch, index, sent_at](const SendResult& sent) {
+      FanOutItem& item = batch->result.items[index];
+      item.ok = sent.ok;
+      item.message_id = sent.message_id;
+      item.error = sent.error;
+      item.latency_us = ElapsedMicros(sent_at);
+      (sent.ok ? batch->result.sent : batch->result.failed)++;
+      batch->outstanding--;
+      if (++batch->settled == batch->destinations.size()) {
+        batch->result.latency_us = ElapsedMicros(batch->started);
+        METRIC_HISTOGRAM("send.fan_out_us").Record(batch->result.latency_us);
+        auto done = std::move(batch->done);
+        done(batch->result);
+        return;
+      }
+      Launch(batch);
+    });
+  }
+  batch->launching = false;
+}
+
+void FanOutSend(std::vector<SendDestination> destinations, std::string content, uint32_t window, FanOutSendFn send,
+                std::function<void(const FanOutResult& result)> done) {
+  auto batch = std::make_shared<FanOutBatch>();
+  batch->window = window ? window : 1;
+  batch->send = std::move(send);
+  batch->done = std::move(done);
+  batch->content = std::move(content);
+  batch->started = std::chrono::steady_clock::now();
+  batch->result.sent = 0;
+  batch->result.failed = 0;
+  batch->result.latency_us = 0;
+  for (const SendDestination& destination : destinations) {
+    batch->result.items.push_back({ destination, false, 0, "", 0 });
+  }
+  batch->destinations = std::move(destinations);
+  METRIC_HISTOGRAM("send.fan_out_size").Record(batch->destinations.size());
+
+  if (batch->destinations.empty()) {
+    batch->done(batch->result);
+    return;
+  }
+  Launch(batch);
+}
@@ -0,0 +1,38 @@
+#ifndef DISCORD_FAN_OUT_H
+#define DISCORD_FAN_OUT_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "send_pipeline.h"
+
+struct FanOutItem {
+  SendDestination destination;
+  bool ok;
+  uint64_t message_id;  // 0 on failure
+  std::string error;
+  uint64_t latency_us;  // from this item's send to its result
+};
+
+struct FanOutResult {
+  std::vector<FanOutItem> items;  // in the order the destinations were given
+  uint32_t sent;
+  uint32_t failed;
+  uint64_t latency_us;            // whole batch
+};
+
+// Sends one item; done must run exactly once, possibly synchronously
+using FanOutSendFn = std::function<void(size_t index, const SendDestination& destination, const std::string& content,
+                                        SendDone done)>;
+
+// Sends the same content to every destination with up to window sends
+// outstanding, so a batch costs about one round trip per window rather than
+// one per destination. done runs once, after the last result.
+//
+// Like ConnectionManager, requires the client state lock; send's results are
+// expected under it too.
+void FanOutSend(std::vector<SendDestination> destinations, std::string content, uint32_t window, FanOutSendFn send,
+                std::function<void(const FanOutResult& result)> done);
+
+#endif // DISCORD_FAN_OUT_H
@@ -0,0 +1,223 @@
+#include "flight_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#define FR_OPEN(path) _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define FR_WRITE _write
+#define FR_CLOSE _close
+#else
+#include <unistd.h>
+#define FR_OPEN(path) open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)
+#define FR_WRITE write
+#define FR_CLOSE close
+#endif
+
+static uint64_t SteadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FlightRecorder& FlightRecorder::Instance() {
+  static FlightRecorder instance;
+  return instance;
+}
+
+void FlightRecorder::Record(FlightEvent kind, const char* tag, uint32_t code, uint64_t value,
+                            uint64_t value2) {
+  uint64_t seq = next_.fetch_add(1, std::memory_order_relaxed);
+  size_t index = seq & (kCapacity - 1);
+
+  published_[index].store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  FlightRecord& record = records_[index];
+  record.seq = seq;
+  record.timestamp_ns = SteadyNowNs();
+  record.kind = static_cast<uint16_t>(kind);
+  record.reserved = 0;
+  record.code = code;
+  record.value = value;
+  record.value2 = value2;
+  size_t i = 0;
+  if (tag) {
+    for (; i < sizeof(record.tag) - 1 && tag[i]; i++) record.tag[i] = tag[i];
+  }
+  for (; i < sizeof(record.tag); i++) record.tag[i] = '\0';
+
+  published_[index].store(seq, std::memory_order_release);
+}
+
+std::vector<FlightRecord> FlightRecorder::Snapshot() const {
+  std::vector<FlightRecord> out;
+  out.reserve(kCapacity);
+  for (size_t i = 0; i < kCapacity; i++) {
+    uint64_t before = published_[i].load(std::memory_order_acquire);
+    if (before == 0) continue;
+    FlightRecord copy = records_[i];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (published_[i].load(std::memory_order_relaxed) != before || copy.seq != before) continue;
+    out.push_back(copy);
+  }
+  std::sort(out.begin(), out.end(),
+            [](const FlightRecord& a, const FlightRecord& b) { return a.seq < b.seq; });
+  return out;
+}
+
+bool FlightRecorder::DumpRaw(const char* path) const {
+  if (!path || !path[0]) return false;
+
+  int fd = FR_OPEN(path);
+  if (fd < 0) return false;
+
+  FlightDumpHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "DLFRv1", 6);
+  header.record_size = sizeof(FlightRecord);
+  header.capacity = kCapacity;
+  header.next_seq = next_.load(std::memory_order_relaxed);
+  header.steady_ns = SteadyNowNs();
+  header.wall_ms = static_cast<uint64_t>(std::time(nullptr)) * 1000;
+
+  bool ok = FR_WRITE(fd, &header, sizeof(header)) == static_cast<int>(sizeof(header));
+  const char* data = reinterpret_cast<const char*>(records_);
+  size_t remaining = sizeof(records_);
+  while (ok && remaining > 0) {
+    unsigned int chunk = remaining > (1u << 20) ? (1u << 20) : static_cast<unsigned int>(remaining);
+    int written = FR_WRITE(fd, data, chunk);
+    if (written <= 0) {
+      ok = false;
+      break;
+    }
+    data += written;
+    remaining -= static_cast<size_t>(written);
+  }
+  FR_CLOSE(fd);
+  return ok;
+}
+
+bool FlightRecorder::Dump(const std::string& path) const {
+  return DumpRaw(path.c_str());
+}
+
+bool FlightRecorder::DumpToConfiguredPath() const {
+  return DumpRaw(dump_path_);
+}
+
+std::string FlightRecorder::DumpPath() const {
+  return dump_path_;
+}
+
+bool FlightRecorder::ReadDump(const std::string& path, std::vector<FlightRecord>& out) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+
+  FlightDumpHeader header;
+  bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+            std::memcmp(header.magic, "DLFRv1", 6) == 0 &&
+            header.record_size == sizeof(FlightRecord);
+  if (ok) {
+    std::vector<FlightRecord> records(header.capacity);
+    ok = std::fread(records.data(), sizeof(FlightRecord), records.size(), file) == records.size();
+    if (ok) {
+      out.clear();
+      for (const FlightRecord& record : records) {
+        if (record.seq != 0) out.push_back(record);
+      }
+      std::sort(out.begin(), out.end(),
+                [](const FlightRecord& a, const FlightRecord& b) { return a.seq < b.seq; });
+    }
+  }
+  std::fclose(file);
+  return ok;
+}
+
+const char* FlightRecorder::KindName(uint16_t kind) {
+  switch (static_cast<FlightEvent>(kind)) {
+    case FlightEvent::SdkCall: return "sdkCall";
+    case FlightEvent::SdkCallback: return "sdkCallback";
+    case FlightEvent::Status: return "status";
+    case FlightEvent::Timing: return "timing";
+    case FlightEvent::Lifecycle: return "lifecycle";
+    case FlightEvent::Stall: return "stall";
+    case FlightEvent::Error: return "error";
+  }
+  return "unknown";
+}
+
+// ---------------------------------------------------------------------------
+// Fatal signal handling: dump once, then hand the signal back to whoever had it
+// ---------------------------------------------------------------------------
+
+static const int kFatalSignals[] = { SIGSEGV, SIGILL, SIGFPE, SIGABRT,
+#ifndef _WIN32
+                                     SIGBUS
+#endif
+};
+static std::atomic<bool> g_signal_dumped{false};
+
+void FlightRecorderSignalDump() {
+  if (g_signal_dumped.exchange(true)) return;
+  FlightRecorder& recorder = FlightRecorder::Instance();
+  recorder.DumpRaw(recorder.dump_path_);
+}
+
+#ifdef _WIN32
+static void OnFatalSignal(int sig) {
+  FlightRecorderSignalDump();
+  std::signal(sig, SIG_DFL);
+  std::raise(sig);
+}
+
+static void InstallCrashHandlers() {
+  for (int sig : kFatalSignals) {
+    std::signal(sig, OnFatalSignal);
+  }
+}
+#else
+static struct sigaction g_previous_actions[sizeof(kFatalSignals) / sizeof(kFatalSignals[0])];
+
+static void OnFatalSignal(int sig, siginfo_t* info, void*) {
+  FlightRecorderSignalDump();
+
+  // Restore the previous disposition (Node/V8 or the default). Faults re-fire
+  // when the instruction is retried; signals sent with kill() need re-raising.
+  for (size_t i = 0; i < sizeof(kFatalSignals) / sizeof(kFatalSignals[0]); i++) {
+    if (kFatalSignals[i] == sig) {
+      sigaction(sig, &g_previous_actions[i], nullptr);
+    }
+  }
+  if (!info || info->si_code <= 0) {
+    raise(sig);
+  }
+}
+
+static void InstallCrashHandlers() {
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_sigaction = OnFatalSignal;
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset(&action.sa_mask);
+  for (size_t i = 0; i < sizeof(kFatalSignals) / sizeof(kFatalSignals[0]); i++) {
+    sigaction(kFatalSignals[i], &action, &g_previous_actions[i]);
+  }
+}
+#endif
+
+void FlightRecorder::Configure(const std::string& dump_path, bool crash_handlers) {
+  static std::atomic<bool> handlers_installed{false};
+
+  std::strncpy(dump_path_, dump_path.c_str(), sizeof(dump_path_) - 1);
+  dump_path_[sizeof(dump_path_) - 1] = '\0';
+
+  if (crash_handlers && !dump_path.empty() && !handlers_installed.exchange(true)) {
+    InstallCrashHandlers();
+  }
+}
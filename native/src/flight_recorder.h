@@ -0,0 +1,79 @@
+#ifndef DISCORD_FLIGHT_RECORDER_H
+#define DISCORD_FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class FlightEvent : uint16_t {
+  SdkCall = 1,      // request issued to the SDK
+  SdkCallback = 2,  // request completed (value = latency ns, code = success)
+  Status = 3,       // client status transition (code = status, value = error)
+  Timing = 4,       // slow operation worth remembering (value = duration ns)
+  Lifecycle = 5,    // init / disconnect / shutdown milestones
+  Stall = 6,        // watchdog detected a stall (value = age ns)
+  Error = 7
+};
+
+// Fixed-size on-disk record; dumps are a header followed by these verbatim.
+struct FlightRecord {
+  uint64_t seq;           // 0 = empty slot
+  uint64_t timestamp_ns;  // steady clock
+  uint16_t kind;
+  uint16_t reserved;
+  uint32_t code;
+  uint64_t value;
+  uint64_t value2;
+  char tag[24];
+};
+static_assert(sizeof(FlightRecord) == 64, "FlightRecord layout is part of the dump format");
+
+struct FlightDumpHeader {
+  char magic[8];  // "DLFRv1"
+  uint32_t record_size;
+  uint32_t capacity;
+  uint64_t next_seq;
+  uint64_t steady_ns;  // steady clock at dump time, to relate record timestamps
+  uint64_t wall_ms;    // wall clock at dump time
+};
+
+// Always-on ring of the last kCapacity interesting events. Recording is a
+// single atomic increment plus a 64-byte copy, so it stays enabled in
+// production. All storage is static so a fatal-signal handler can dump it
+// with nothing but open/write.
+class FlightRecorder {
+public:
+  static constexpr size_t kCapacity = 4096;  // power of two
+
+  static FlightRecorder& Instance();
+
+  void Record(FlightEvent kind, const char* tag, uint32_t code = 0, uint64_t value = 0,
+              uint64_t value2 = 0);
+
+  // Where crash/stall dumps go; installs fatal-signal handlers when asked
+  void Configure(const std::string& dump_path, bool crash_handlers);
+  std::string DumpPath() const;
+
+  // Returns false if the file could not be written
+  bool Dump(const std::string& path) const;
+  bool DumpToConfiguredPath() const;
+
+  // Oldest first; skips slots that are mid-write
+  std::vector<FlightRecord> Snapshot() const;
+  static bool ReadDump(const std::string& path, std::vector<FlightRecord>& out);
+  static const char* KindName(uint16_t kind);
+
+private:
+  FlightRecorder() = default;
+
+  friend void FlightRecorderSignalDump();
+  bool DumpRaw(const char* path) const;  // async-signal-safe
+
+  FlightRecord records_[kCapacity] = {};
+  std::atomic<uint64_t> published_[kCapacity] = {};  // seq once a slot is complete
+  std::atomic<uint64_t> next_{1};
+  char dump_path_[1024] = {};
+};
+
+#endif // DISCORD_FLIGHT_RECORDER_H
@@ -0,0 +1,270 @@
+#include "lobby_registry.h"
+#include "events.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+static uint64_t WallMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Keys whose value was added, removed or changed
+static std::vector<std::string> DiffMetadata(const LobbyMetadata& from, const LobbyMetadata& to) {
+  std::vector<std::string> changed;
+  auto a = from.begin();
+  auto b = to.begin();
+  while (a != from.end() || b != to.end()) {
+    if (b == to.end() || (a != from.end() && a->first < b->first)) {
+      changed.push_back((a++)->first);
+    } else if (a == from.end() || b->first < a->first) {
+      changed.push_back((b++)->first);
+    } else {
+      if (a->second != b->second) changed.push_back(a->first);
+      ++a;
+      ++b;
+    }
+  }
+  return changed;
+}
+
+static std::vector<std::string> SortedIds(const std::unordered_set<uint64_t>& ids) {
+  std::vector<uint64_t> sorted(ids.begin(), ids.end());
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::string> strings;
+  strings.reserve(sorted.size());
+  for (uint64_t id : sorted) strings.push_back(std::to_string(id));
+  return strings;
+}
+
+LobbyRegistry::LobbyRegistry(Backend backend) : backend_(std::move(backend)) {}
+
+size_t LobbyRegistry::Sync() {
+  auto started = std::chrono::steady_clock::now();
+  std::vector<uint64_t> ids = backend_.list_ids();
+  std::unordered_set<uint64_t> present(ids.begin(), ids.end());
+
+  std::vector<uint64_t> gone;
+  for (const auto& entry : lobbies_) {
+    if (!present.count(entry.first)) gone.push_back(entry.first);
+  }
+  for (uint64_t lobby_id : gone) Remove(lobby_id);
+  for (uint64_t lobby_id : ids) Read(lobby_id, true);
+  FlushMemberDiffs();
+
+  METRIC_HISTOGRAM("lobby.sync_us").Record(ElapsedMicros(started));
+  LOG_DEBUG("🏠 Lobby registry synced: " << lobbies_.size() << " lobbies (" << gone.size() << " gone)");
+  return lobbies_.size();
+}
+
+void LobbyRegistry::Refresh(uint64_t lobby_id) {
+  Read(lobby_id, !lobbies_.count(lobby_id));
+}
+
+void LobbyRegistry::Read(uint64_t lobby_id, bool with_members) {
+  LobbyMetadata metadata;
+  std::vector<uint64_t> members;
+  METRIC_COUNTER("lobby.reads").Add();
+  if (!backend_.read(lobby_id, metadata, with_members ? &members : nullptr)) {
+    Remove(lobby_id);
+    return;
+  }
+  Apply(lobby_id, std::move(metadata));
+  if (with_members) ApplyMembers(lobby_id, members);
+}
+
+void LobbyRegistry::Clear() {
+  for (const auto& entry : lobbies_) backend_.release(entry.first);
+  lobbies_.clear();
+  index_.clear();
+  rosters_.clear();
+  dirty_rosters_.clear();
+  METRIC_GAUGE("lobby.count").Set(0);
+}
+
+void LobbyRegistry::Apply(uint64_t lobby_id, LobbyMetadata metadata) {
+  auto it = lobbies_.find(lobby_id);
+  bool added = it == lobbies_.end();
+  std::vector<std::string> changed = DiffMetadata(added ? LobbyMetadata() : it->second.metadata, metadata);
+  if (!added && changed.empty()) return;  // an update that touched something we do not track
+
+  if (added) {
+    it = lobbies_.emplace(lobby_id, LobbyInfo{ lobby_id, {}, 0, 0, 0 }).first;
+    METRIC_GAUGE("lobby.count").Set(static_cast<int64_t>(lobbies_.size()));
+  } else {
+    Unindex(lobby_id, it->second.metadata);
+  }
+  Index(lobby_id, metadata);
+  it->second.metadata = std::move(metadata);
+  it->second.version++;
+  it->second.updated_ms = WallMillis();
+
+  EmitEvent(NativeEvent("lobbyChanged")
+                .String("lobbyId", std::to_string(lobby_id))
+                .String("change", added ? "added" : "updated")
+                .StringList("keys", changed));
+}
+
+void LobbyRegistry::Remove(uint64_t lobby_id) {
+  auto it = lobbies_.find(lobby_id);
+  if (it == lobbies_.end()) return;
+  Unindex(lobby_id, it->second.metadata);
+  lobbies_.erase(it);
+  rosters_.erase(lobby_id);
+  dirty_rosters_.erase(lobby_id);  // lobbyChanged says it all
+  backend_.release(lobby_id);
+  METRIC_GAUGE("lobby.count").Set(static_cast<int64_t>(lobbies_.size()));
+  EmitEvent(NativeEvent("lobbyChanged")
+                .String("lobbyId", std::to_string(lobby_id))
+                .String("change", "removed")
+                .StringList("keys", {}));
+}
+
+// A full read only reports what differs from the roster we had
+void LobbyRegistry::ApplyMembers(uint64_t lobby_id, const std::vector<uint64_t>& members) {
+  Roster& roster = rosters_[lobby_id];
+  std::unordered_set<uint64_t> fresh(members.begin(), members.end());
+  std::vector<uint64_t> gone;
+  for (uint64_t member_id : roster.members) {
+    if (!fresh.count(member_id)) gone.push_back(member_id);
+  }
+  for (uint64_t member_id : gone) OnMemberRemoved(lobby_id, member_id);
+  for (uint64_t member_id : fresh) OnMemberAdded(lobby_id, member_id);
+}
+
+void LobbyRegistry::OnMemberAdded(uint64_t lobby_id, uint64_t member_id) {
+  if (!lobbies_.count(lobby_id)) {
+    Read(lobby_id, true);  // the member callback beat the lobby's own
+    return;
+  }
+  Roster& roster = rosters_[lobby_id];
+  if (!roster.members.insert(member_id).second) return;
+  // Left and came back within one batch: to a listener it only changed
+  if (roster.removed.erase(member_id)) {
+    roster.updated.insert(member_id);
+  } else {
+    roster.added.insert(member_id);
+  }
+  dirty_rosters_.insert(lobby_id);
+}
+
+void LobbyRegistry::OnMemberRemoved(uint64_t lobby_id, uint64_t member_id) {
+  auto it = rosters_.find(lobby_id);
+  if (it == rosters_.end()) return;
+  Roster& roster = it->second;
+  if (!roster.members.erase(member_id)) return;
+  roster.updated.erase(member_id);
+  // Joined and left within one batch: nothing to report
+  if (!roster.added.erase(member_id)) roster.removed.insert(member_id);
+  dirty_rosters_.insert(lobby_id);
+}
+
+void LobbyRegistry::OnMemberUpdated(uint64_t lobby_id, uint64_t member_id) {
+  auto it = rosters_.find(lobby_id);
+  if (it == rosters_.end() || !it->second.members.count(member_id)) return;
+  if (!it->second.added.count(member_id)) it->second.updated.insert(member_id);
+  dirty_rosters_.insert(lobby_id);
+}
+
+void LobbyRegistry::FlushMemberDiffs() {
+  for (uint64_t lobby_id : dirty_rosters_) {
+    auto it = rosters_.find(lobby_id);
+    if (it == rosters_.end()) continue;
+    Roster& roster = it->second;
+    if (roster.added.empty() && roster.removed.empty() && roster.updated.empty()) continue;
+    roster.version++;
+    METRIC_COUNTER("lobby.member_diffs").Add();
+    EmitEvent(NativeEvent("lobbyMembers")
+                  .String("lobbyId", std::to_string(lobby_id))
+                  .StringList("added", SortedIds(roster.added))
+                  .StringList("removed", SortedIds(roster.removed))
+                  .StringList("updated", SortedIds(roster.updated))
+                  .Number("memberCount", static_cast<double>(roster.members.size()))
+                  .Number("version", static_cast<double>(roster.version)));
+    roster.added.clear();
+    roster.removed.clear();
+    roster.updated.clear();
+  }
+  dirty_rosters_.clear();
+}
+
+void LobbyRegistry::Index(uint64_t lobby_id, const LobbyMetadata& metadata) {
+  for (const auto& pair : metadata) {
+    index_[pair.first][pair.second].insert(lobby_id);
+  }
+}
+
+void LobbyRegistry::Unindex(uint64_t lobby_id, const LobbyMetadata& metadata) {
+  for (const auto& pair : metadata) {
+    auto key = index_.find(pair.first);
+    if (key == index_.end()) continue;
+    auto value = key->second.find(pair.second);
+    if (value == key->second.end()) continue;
+    value->second.erase(lobby_id);
+    if (value->second.empty()) {
+      key->second.erase(value);
+      if (key->second.empty()) index_.erase(key);
+    }
+  }
+}
+
+std::vector<uint64_t> LobbyRegistry::Find(const LobbyFilter& filter) const {
+  std::vector<uint64_t> found;
+  if (filter.empty()) {
+    found.reserve(lobbies_.size());
+    for (const auto& entry : lobbies_) found.push_back(entry.first);
+    return found;
+  }
+
+  // Walk the smallest posting set and probe the others
+  std::vector<const std::set<uint64_t>*> sets;
+  for (const auto& pair : filter) {
+    auto key = index_.find(pair.first);
+    if (key == index_.end()) return found;
+    auto value = key->second.find(pair.second);
+    if (value == key->second.end()) return found;
+    sets.push_back(&value->second);
+  }
+  std::sort(sets.begin(), sets.end(),
+            [](const std::set<uint64_t>* a, const std::set<uint64_t>* b) { return a->size() < b->size(); });
+  for (uint64_t lobby_id : *sets[0]) {
+    bool all = std::all_of(sets.begin() + 1, sets.end(),
+                           [lobby_id](const std::set<uint64_t>* set) { return set->count(lobby_id) != 0; });
+    if (all) found.push_back(lobby_id);
+  }
+  return found;
+}
+
+std::vector<LobbyInfo> LobbyRegistry::List(const LobbyFilter& filter) const {
+  std::vector<LobbyInfo> lobbies;
+  for (uint64_t lobby_id : Find(filter)) {
+    lobbies.push_back(lobbies_.at(lobby_id));
+    auto roster = rosters_.find(lobby_id);
+    lobbies.back().member_count = roster == rosters_.end() ? 0 : roster->second.members.size();
+  }
+  return lobbies;
+}
+
+bool LobbyRegistry::Get(uint64_t lobby_id, LobbyInfo& out) const {
+  auto it = lobbies_.find(lobby_id);
+  if (it == lobbies_.end()) return false;
+  out = it->second;
+  auto roster = rosters_.find(lobby_id);
+  out.member_count = roster == rosters_.end() ? 0 : roster->second.members.size();
+  return true;
+}
+
+bool LobbyRegistry::IsMember(uint64_t lobby_id, uint64_t user_id) const {
+  auto it = rosters_.find(lobby_id);
+  return it != rosters_.end() && it->second.members.count(user_id) != 0;
+}
+
+bool LobbyRegistry::Members(uint64_t lobby_id, std::vector<uint64_t>& out) const {
+  auto it = rosters_.find(lobby_id);
+  if (it == rosters_.end()) return false;
+  out.assign(it->second.members.begin(), it->second.members.end());
+  std::sort(out.begin(), out.end());
+  return true;
+}
@@ -0,0 +1,96 @@
+#ifndef DISCORD_LOBBY_REGISTRY_H
+#define DISCORD_LOBBY_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using LobbyMetadata = std::map<std::string, std::string>;
+using LobbyFilter = std::vector<std::pair<std::string, std::string>>;  // key = value, all must match
+
+struct LobbyInfo {
+  uint64_t id;
+  LobbyMetadata metadata;
+  uint64_t version;     // bumped whenever the metadata changes
+  uint64_t updated_ms;  // Unix epoch milliseconds of the last change
+  size_t member_count;
+};
+
+// The lobbies this client is in, with their metadata parsed once and kept
+// current from the SDK's lobby callbacks, so listing them is a map read.
+// Metadata is indexed by key and value for "every lobby with project=X".
+//
+// Each lobby's member set is read once and then patched from the member
+// added / removed / updated callbacks. The changes are batched, so a burst of
+// joins becomes one lobbyMembers event per lobby when FlushMemberDiffs runs.
+//
+// Like ConnectionManager, every method requires the client state lock.
+class LobbyRegistry {
+public:
+  struct Backend {
+    std::function<std::vector<uint64_t>()> list_ids;
+    // False if the client no longer has the lobby. members is null when only
+    // the metadata is wanted.
+    std::function<bool(uint64_t lobby_id, LobbyMetadata& metadata, std::vector<uint64_t>* members)> read;
+    // The lobby is no longer tracked; whatever the backend cached for it can go
+    std::function<void(uint64_t lobby_id)> release;
+  };
+
+  explicit LobbyRegistry(Backend backend);
+
+  // Reconciles with the SDK's lobby list (after Ready or a reconnect): every
+  // lobby and roster is re-read, gone ones are dropped. Returns how many are tracked.
+  size_t Sync();
+  // Lobby created or updated; the roster is only read for a lobby not seen before
+  void Refresh(uint64_t lobby_id);
+  void Remove(uint64_t lobby_id);
+
+  void OnMemberAdded(uint64_t lobby_id, uint64_t member_id);
+  void OnMemberRemoved(uint64_t lobby_id, uint64_t member_id);
+  void OnMemberUpdated(uint64_t lobby_id, uint64_t member_id);
+  // Emits the roster changes collected since the last flush
+  void FlushMemberDiffs();
+  // The client went away; forgets everything without events
+  void Clear();
+
+  std::vector<LobbyInfo> List(const LobbyFilter& filter = {}) const;
+  std::vector<uint64_t> Find(const LobbyFilter& filter) const;
+  bool Get(uint64_t lobby_id, LobbyInfo& out) const;
+  size_t Size() const { return lobbies_.size(); }
+  bool Contains(uint64_t lobby_id) const { return lobbies_.count(lobby_id) != 0; }
+  bool IsMember(uint64_t lobby_id, uint64_t user_id) const;
+  // Sorted; false if the lobby is not tracked
+  bool Members(uint64_t lobby_id, std::vector<uint64_t>& out) const;
+
+private:
+  struct Roster {
+    std::unordered_set<uint64_t> members;
+    uint64_t version = 0;  // bumped by every flushed diff, so a listener can spot a gap
+    // Net changes since the last flush
+    std::unordered_set<uint64_t> added;
+    std::unordered_set<uint64_t> removed;
+    std::unordered_set<uint64_t> updated;
+  };
+
+  void Read(uint64_t lobby_id, bool with_members);
+  void ApplyMembers(uint64_t lobby_id, const std::vector<uint64_t>& members);
+  // Applies a fresh read; emits lobbyChanged if anything differs
+  void Apply(uint64_t lobby_id, LobbyMetadata metadata);
+  void Index(uint64_t lobby_id, const LobbyMetadata& metadata);
+  void Unindex(uint64_t lobby_id, const LobbyMetadata& metadata);
+
+  Backend backend_;
+  std::map<uint64_t, LobbyInfo> lobbies_;  // ordered, so listings are stable
+  // key -> value -> lobbies
+  std::unordered_map<std::string, std::unordered_map<std::string, std::set<uint64_t>>> index_;
+  std::unordered_map<uint64_t, Roster> rosters_;
+  std::unordered_set<uint64_t> dirty_rosters_;
+};
+
+#endif // DISCORD_LOBBY_REGISTRY_H
@@ -0,0 +1,213 @@
+#include "logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+Logger& Logger::Instance() {
+  static Logger instance;
+  return instance;
+}
+
+Logger::Logger()
+    : slots_(new Slot[kCapacity]),
+      level_(static_cast<int>(LogLevel::Info)),
+      start_(std::chrono::steady_clock::now()) {
+  for (size_t i = 0; i < kCapacity; i++) {
+    slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // Initial level can be raised before JS gets a chance to call setLogLevel()
+  LogLevel env_level;
+  const char* env = std::getenv("DISCORD_NATIVE_LOG_LEVEL");
+  if (env && ParseLevel(env, env_level)) {
+    level_.store(static_cast<int>(env_level), std::memory_order_relaxed);
+  }
+
+  running_.store(true, std::memory_order_release);
+  writer_ = std::thread(&Logger::WriterLoop, this);
+}
+
+Logger::~Logger() {
+  Shutdown();
+}
+
+void Logger::SetLevel(LogLevel level) {
+  level_.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::Level() const {
+  return static_cast<LogLevel>(level_.load(std::memory_order_relaxed));
+}
+
+void Logger::Write(LogLevel level, const std::string& message) {
+  // Writer is gone (process teardown) - fall back to a direct write
+  if (!running_.load(std::memory_order_acquire)) {
+    std::fprintf(level >= LogLevel::Error ? stderr : stdout, "[discord-native] %s %s\n",
+                 LevelName(level), message.c_str());
+    return;
+  }
+
+  uint64_t pos = tail_.load(std::memory_order_relaxed);
+  Slot* slot = nullptr;
+  for (;;) {
+    slot = &slots_[pos & (kCapacity - 1)];
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Ring is full - never block the caller on I/O
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = tail_.load(std::memory_order_relaxed);
+    }
+  }
+
+  size_t length = std::min(message.size(), kTextSize);
+  if (length < message.size()) {
+    // Don't cut a UTF-8 sequence in half
+    while (length > 0 && (static_cast<unsigned char>(message[length]) & 0xC0) == 0x80) {
+      length--;
+    }
+  }
+  std::memcpy(slot->text, message.data(), length);
+  slot->length = static_cast<uint16_t>(length);
+  slot->level = level;
+  slot->elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_).count();
+  slot->seq.store(pos + 1, std::memory_order_release);
+
+  // Wake the writer early for problems or when the ring is filling up;
+  // everything else is picked up on the next batch
+  if (level >= LogLevel::Warn ||
+      pos + 1 - head_.load(std::memory_order_relaxed) >= kCapacity / 2) {
+    wake_cv_.notify_one();
+  }
+}
+
+size_t Logger::Drain() {
+  std::string out;
+  std::string err;
+  size_t count = 0;
+  uint64_t pos = head_.load(std::memory_order_relaxed);
+
+  for (;;) {
+    Slot& slot = slots_[pos & (kCapacity - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+      break;
+    }
+
+    char prefix[64];
+    int n = std::snprintf(prefix, sizeof(prefix), "[discord-native +%lld.%03llds] %-5s ",
+                          static_cast<long long>(slot.elapsed_us / 1000000),
+                          static_cast<long long>((slot.elapsed_us / 1000) % 1000),
+                          LevelName(slot.level));
+    std::string& target = slot.level >= LogLevel::Error ? err : out;
+    target.append(prefix, n > 0 ? static_cast<size_t>(n) : 0);
+    target.append(slot.text, slot.length);
+    target.push_back('\n');
+
+    slot.seq.store(pos + kCapacity, std::memory_order_release);
+    pos++;
+    count++;
+  }
+  head_.store(pos, std::memory_order_release);
+
+  uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped > reported_dropped_) {
+    err += "[discord-native] WARN  log ring full, dropped " +
+           std::to_string(dropped - reported_dropped_) + " records\n";
+    reported_dropped_ = dropped;
+  }
+
+  // One write + one flush per batch instead of one per line
+  if (!out.empty()) {
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+  }
+  if (!err.empty()) {
+    std::fwrite(err.data(), 1, err.size(), stderr);
+    std::fflush(stderr);
+  }
+  return count;
+}
+
+void Logger::WriterLoop() {
+  while (running_.load(std::memory_order_acquire)) {
+    size_t written = Drain();
+    NotifyDrained();
+    if (written == 0) {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_cv_.wait_for(lock, std::chrono::milliseconds(20));
+    }
+  }
+  Drain();
+  NotifyDrained();
+}
+
+// Under the lock Flush() holds between reading head_ and waiting, so a drain
+// that lands in that gap cannot notify before Flush() is waiting
+void Logger::NotifyDrained() {
+  std::lock_guard<std::mutex> lock(wake_mutex_);
+  drained_cv_.notify_all();
+}
+
+void Logger::Flush() {
+  uint64_t target = tail_.load(std::memory_order_acquire);
+  wake_cv_.notify_one();
+
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (running_.load(std::memory_order_acquire) &&
+         head_.load(std::memory_order_acquire) < target) {
+    if (drained_cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+      break;
+    }
+  }
+}
+
+void Logger::Shutdown() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  wake_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+size_t Logger::Depth() const {
+  return static_cast<size_t>(tail_.load(std::memory_order_relaxed) -
+                             head_.load(std::memory_order_relaxed));
+}
+
+bool Logger::ParseLevel(const std::string& name, LogLevel& out) {
+  std::string lower;
+  for (char c : name) lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+
+  if (lower == "trace") out = LogLevel::Trace;
+  else if (lower == "debug") out = LogLevel::Debug;
+  else if (lower == "info") out = LogLevel::Info;
+  else if (lower == "warn" || lower == "warning") out = LogLevel::Warn;
+  else if (lower == "error") out = LogLevel::Error;
+  else if (lower == "off" || lower == "none") out = LogLevel::Off;
+  else return false;
+  return true;
+}
+
+const char* Logger::LevelName(LogLevel level) {
+  switch (level) {
+    case LogLevel::Trace: return "TRACE";
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO";
+    case LogLevel::Warn: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    case LogLevel::Off: return "OFF";
+  }
+  return "?";
+}
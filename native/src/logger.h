@@ -0,0 +1,108 @@
+#ifndef DISCORD_LOGGER_H
+#define DISCORD_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Statements below this level are compiled out entirely (0 = keep everything).
+// Override from binding.gyp, e.g. "defines": ["DISCORD_LOG_COMPILE_LEVEL=2"].
+#ifndef DISCORD_LOG_COMPILE_LEVEL
+#define DISCORD_LOG_COMPILE_LEVEL 0
+#endif
+
+enum class LogLevel : int {
+  Trace = 0,
+  Debug = 1,
+  Info = 2,
+  Warn = 3,
+  Error = 4,
+  Off = 5
+};
+
+// Leveled logger backed by a bounded lock-free ring and a writer thread.
+// Producers never block and never touch stdout: a full ring drops the record
+// and bumps a counter. The writer drains in batches and flushes once per batch.
+class Logger {
+public:
+  static Logger& Instance();
+
+  bool Enabled(LogLevel level) const {
+    return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+  }
+
+  void SetLevel(LogLevel level);
+  LogLevel Level() const;
+
+  void Write(LogLevel level, const std::string& message);
+
+  // Block until everything enqueued before the call has been written.
+  void Flush();
+  // Drain the ring and stop the writer thread. Safe to call more than once.
+  void Shutdown();
+
+  uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  size_t Depth() const;
+
+  static bool ParseLevel(const std::string& name, LogLevel& out);
+  static const char* LevelName(LogLevel level);
+
+private:
+  Logger();
+  ~Logger();
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  static constexpr size_t kCapacity = 1024;  // power of two
+  static constexpr size_t kTextSize = 240;
+
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    LogLevel level;
+    uint16_t length;
+    int64_t elapsed_us;
+    char text[kTextSize];
+  };
+
+  void WriterLoop();
+  size_t Drain();
+  void NotifyDrained();
+
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<uint64_t> tail_{0};
+  alignas(64) std::atomic<uint64_t> head_{0};
+  std::atomic<int> level_;
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t reported_dropped_ = 0;  // writer thread only
+  std::atomic<bool> running_{false};
+
+  std::chrono::steady_clock::time_point start_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable drained_cv_;
+  std::thread writer_;
+};
+
+#define DISCORD_LOG(level, expr)                                              \
+  do {                                                                        \
+    if (static_cast<int>(level) >= DISCORD_LOG_COMPILE_LEVEL &&               \
+        Logger::Instance().Enabled(level)) {                                  \
+      std::ostringstream discord_log_stream_;                                 \
+      discord_log_stream_ << expr;                                            \
+      Logger::Instance().Write(level, discord_log_stream_.str());             \
+    }                                                                         \
+  } while (0)
+
+#define LOG_TRACE(expr) DISCORD_LOG(LogLevel::Trace, expr)
+#define LOG_DEBUG(expr) DISCORD_LOG(LogLevel::Debug, expr)
+#define LOG_INFO(expr) DISCORD_LOG(LogLevel::Info, expr)
+#define LOG_WARN(expr) DISCORD_LOG(LogLevel::Warn, expr)
+#define LOG_ERROR(expr) DISCORD_LOG(LogLevel::Error, expr)
+
+#endif // DISCORD_LOGGER_H
@@ -0,0 +1,234 @@
+#include "message_history.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+
+static bool IdLess(const HistoryMessage& message, uint64_t id) {
+  return message.id < id;
+}
+
+MessageHistory::MessageHistory(FetchFn fetch, Store store, SeenFn seen)
+    : fetch_(std::move(fetch)), store_(std::move(store)), seen_(std::move(seen)) {}
+
+MessageHistory::Lobby& MessageHistory::Find(uint64_t lobby_id) {
+  auto it = lobbies_.find(lobby_id);
+  if (it != lobbies_.end()) return it->second;
+  Lobby& lobby = lobbies_[lobby_id];
+  lobby.last_used = ++clock_;
+  std::vector<HistoryMessage> stored;
+  bool more = false;
+  if (store_.read && store_.read(lobby_id, 0, options_.max_per_lobby, stored, more) && !stored.empty()) {
+    for (const HistoryMessage& message : stored) {
+      Insert(lobby, message);
+    }
+    lobby.stale = true;
+    METRIC_HISTOGRAM("history.loaded").Record(stored.size());
+    if (seen_) seen_(stored);
+  }
+  return lobby;
+}
+
+MessageHistory::Lobby& MessageHistory::Touch(uint64_t lobby_id) {
+  Lobby& lobby = Find(lobby_id);
+  lobby.last_used = ++clock_;
+  EvictIfFull(lobby_id);
+  return lobby;
+}
+
+size_t MessageHistory::OlderThan(const Lobby& lobby, uint64_t before_id) {
+  if (!before_id) return lobby.messages.size();
+  return std::lower_bound(lobby.messages.begin(), lobby.messages.end(), before_id, IdLess) - lobby.messages.begin();
+}
+
+uint32_t MessageHistory::FetchCap() const {
+  return std::min(options_.max_fetch, options_.max_per_lobby);
+}
+
+// The SDK only returns a lobby's newest messages, so reaching further back
+// means asking for everything newer as well
+uint32_t MessageHistory::FetchLimitFor(const Lobby& lobby, const Query& query) const {
+  size_t older = OlderThan(lobby, query.before_id);
+  size_t cap = FetchCap();
+  // A cursor older than anything held is an unknown distance back
+  if (query.before_id && (lobby.messages.empty() || query.before_id < lobby.messages.front().id)) {
+    return static_cast<uint32_t>(cap);
+  }
+  size_t newer = lobby.messages.size() - older;
+  return static_cast<uint32_t>(std::min(newer + query.limit, cap));
+}
+
+bool MessageHistory::SdkHasMore(const Lobby& lobby) const {
+  return !lobby.complete && lobby.fetched_limit < FetchCap();
+}
+
+bool MessageHistory::TryServe(uint64_t lobby_id, const Lobby& lobby, const Query& query, bool cached) {
+  size_t in_memory = OlderThan(lobby, query.before_id);
+  if (lobby.complete || in_memory >= query.limit) {
+    Serve(lobby, query, cached);
+    return true;
+  }
+  bool exhausted = FetchLimitFor(lobby, query) <= lobby.fetched_limit;  // a fetch would add nothing
+
+  // The store reaches past what memory keeps
+  std::vector<HistoryMessage> stored;
+  bool more = false;
+  if (store_.read && store_.read(lobby_id, query.before_id, query.limit, stored, more) &&
+      (stored.size() >= query.limit || (exhausted && stored.size() > in_memory))) {
+    METRIC_COUNTER("history.store_reads").Add();
+    if (seen_) seen_(stored);
+    HistoryPage page{ true, "", std::move(stored), more || SdkHasMore(lobby), true };
+    query.done(page);
+    return true;
+  }
+  if (!exhausted) return false;
+  Serve(lobby, query, cached);
+  return true;
+}
+
+void MessageHistory::Serve(const Lobby& lobby, const Query& query, bool cached) {
+  size_t end = OlderThan(lobby, query.before_id);
+  size_t start = end > query.limit ? end - query.limit : 0;
+  HistoryPage page{ true, "", {}, start > 0 || SdkHasMore(lobby), cached };
+  page.messages.assign(lobby.messages.begin() + start, lobby.messages.begin() + end);
+  query.done(page);
+}
+
+void MessageHistory::Get(uint64_t lobby_id, uint64_t before_id, uint32_t limit, HistoryDone done) {
+  Lobby& lobby = Touch(lobby_id);
+  Query query{ before_id, limit, std::move(done) };
+  if (TryServe(lobby_id, lobby, query, true)) {
+    hits_++;
+    METRIC_COUNTER("history.hits").Add();
+    // Catch up on what was sent while this lobby was only on disk
+    if (lobby.stale) StartFetch(lobby_id, lobby, FetchCap());
+    return;
+  }
+  misses_++;
+  METRIC_COUNTER("history.misses").Add();
+  uint32_t fetch_limit = FetchLimitFor(lobby, query);
+  lobby.waiting.push_back(std::move(query));
+  StartFetch(lobby_id, lobby, fetch_limit);
+}
+
+void MessageHistory::StartFetch(uint64_t lobby_id, Lobby& lobby, uint32_t limit) {
+  // A fetch in flight is re-evaluated when it lands; a deeper one follows if needed
+  if (lobby.fetching) return;
+  lobby.fetching = limit;
+  fetches_++;
+  LOG_DEBUG("📜 Fetching " << limit << " messages of lobby " << lobby_id);
+  fetch_(lobby_id, limit);
+}
+
+void MessageHistory::OnFetched(uint64_t lobby_id, bool ok, const std::string& error,
+                               const std::vector<HistoryMessage>& messages) {
+  auto it = lobbies_.find(lobby_id);
+  if (it == lobbies_.end() || !it->second.fetching) return;  // forgotten meanwhile
+  Lobby& lobby = it->second;
+  uint32_t limit = lobby.fetching;
+  lobby.fetching = 0;
+  std::vector<Query> waiting;
+  waiting.swap(lobby.waiting);
+
+  if (!ok) {
+    LOG_WARN("⚠️  Failed to fetch history of lobby " << lobby_id << ": " << error);
+    for (Query& query : waiting) {
+      query.done({ false, error, {}, false, false });
+    }
+    return;
+  }
+
+  std::vector<HistoryMessage> added;
+  for (const HistoryMessage& message : messages) {
+    if (Insert(lobby, message)) added.push_back(message);
+  }
+  lobby.fetched_limit = std::max(lobby.fetched_limit, limit);
+  lobby.stale = false;
+  if (messages.size() < limit) lobby.complete = true;  // the SDK had no more
+  Trim(lobby);
+  METRIC_HISTOGRAM("history.fetch_added").Record(added.size());
+  if (seen_ && !added.empty()) seen_(added);
+  if (store_.append && !added.empty()) store_.append(lobby_id, std::move(added));
+
+  uint32_t next_limit = 0;
+  for (Query& query : waiting) {
+    if (!TryServe(lobby_id, lobby, query, false)) {
+      next_limit = std::max(next_limit, FetchLimitFor(lobby, query));
+      lobby.waiting.push_back(std::move(query));
+    }
+  }
+  if (!lobby.waiting.empty()) StartFetch(lobby_id, lobby, next_limit);
+}
+
+bool MessageHistory::Add(const HistoryMessage& message) {
+  Lobby& lobby = Find(message.lobby_id);
+  bool added = Insert(lobby, message);
+  Trim(lobby);
+  EvictIfFull(message.lobby_id);
+  if (added && seen_) seen_({ message });
+  if (added && store_.append) store_.append(message.lobby_id, { message });
+  return added;
+}
+
+bool MessageHistory::Insert(Lobby& lobby, const HistoryMessage& message) {
+  // Live messages are the newest, so the common case is an append
+  if (lobby.messages.empty() || lobby.messages.back().id < message.id) {
+    lobby.messages.push_back(message);
+  } else {
+    auto at = std::lower_bound(lobby.messages.begin(), lobby.messages.end(), message.id, IdLess);
+    if (at != lobby.messages.end() && at->id == message.id) return false;
+    lobby.messages.insert(at, message);
+  }
+  messages_++;
+  return true;
+}
+
+void MessageHistory::Trim(Lobby& lobby) {
+  while (lobby.messages.size() > options_.max_per_lobby) {
+    lobby.messages.pop_front();
+    lobby.complete = false;
+    messages_--;
+  }
+}
+
+void MessageHistory::EvictIfFull(uint64_t keep) {
+  while (lobbies_.size() > options_.max_lobbies) {
+    // Lobbies with reads in progress stay
+    auto victim = lobbies_.end();
+    for (auto it = lobbies_.begin(); it != lobbies_.end(); ++it) {
+      if (it->first == keep || it->second.fetching || !it->second.waiting.empty()) continue;
+      if (victim == lobbies_.end() || it->second.last_used < victim->second.last_used) victim = it;
+    }
+    if (victim == lobbies_.end()) return;
+    messages_ -= victim->second.messages.size();
+    lobbies_.erase(victim);
+    METRIC_COUNTER("history.evictions").Add();
+  }
+}
+
+void MessageHistory::Forget(uint64_t lobby_id) {
+  auto it = lobbies_.find(lobby_id);
+  if (it == lobbies_.end()) return;
+  std::vector<Query> waiting;
+  waiting.swap(it->second.waiting);
+  messages_ -= it->second.messages.size();
+  lobbies_.erase(it);
+  for (Query& query : waiting) {
+    query.done({ false, "Lobby is no longer available", {}, false, false });
+  }
+}
+
+void MessageHistory::FailPending(const std::string& error) {
+  std::vector<Query> failed;
+  for (auto& entry : lobbies_) {
+    entry.second.fetching = 0;
+    for (Query& query : entry.second.waiting) failed.push_back(std::move(query));
+    entry.second.waiting.clear();
+  }
+  for (Query& query : failed) {
+    query.done({ false, error, {}, false, false });
+  }
+}
+
+HistoryStatus MessageHistory::Status() const {
+  return { lobbies_.size(), messages_, hits_, misses_, fetches_ };
+}
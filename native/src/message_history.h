@@ -0,0 +1,136 @@
+#ifndef DISCORD_MESSAGE_HISTORY_H
+#define DISCORD_MESSAGE_HISTORY_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct HistoryMessage {
+  uint64_t id;  // snowflake, so ordering by ID is ordering by time
+  uint64_t lobby_id;
+  uint64_t author_id;
+  uint64_t sent_ms;  // Unix epoch milliseconds
+  std::string content;
+};
+
+struct HistoryOptions {
+  uint32_t max_per_lobby = 1000;  // oldest messages are dropped past this
+  uint32_t max_lobbies = 64;      // least recently read lobbies are dropped past this
+  uint32_t max_fetch = 200;       // largest limit asked of the SDK
+};
+
+struct HistoryPage {
+  bool ok;
+  std::string error;
+  std::vector<HistoryMessage> messages;  // oldest first
+  bool has_more;                         // older messages may exist before messages.front()
+  bool cached;                           // served without an SDK call
+};
+
+using HistoryDone = std::function<void(const HistoryPage& page)>;
+
+struct HistoryStatus {
+  size_t lobbies;
+  size_t messages;
+  uint64_t hits;     // pages served from memory
+  uint64_t misses;   // pages that waited on a fetch
+  uint64_t fetches;
+};
+
+// Per-lobby message history, ordered by snowflake ID, that merges messages
+// seen live with ones fetched from the SDK. Each lobby is a bounded sorted
+// deque: live messages append at the back, older fetched ones at the front,
+// and the oldest fall off once max_per_lobby is reached. A page is a binary
+// search plus a copy; the SDK is only asked when memory cannot cover it, and
+// concurrent reads of one lobby share a fetch.
+//
+// An optional store (MessageLog) sits below memory: every new message is
+// handed to it, a lobby not in memory is loaded from it, and pages deeper
+// than memory holds are read from it. A lobby loaded from the store is served
+// at once and refreshed from the SDK in the background.
+//
+// seen is told about every message history learns of (live, fetched, or read
+// from the store), for the search index.
+//
+// Like ConnectionManager, every method requires the client state lock.
+class MessageHistory {
+public:
+  // Asks the SDK for the newest limit messages of a lobby; the owner reports
+  // back through OnFetched
+  using FetchFn = std::function<void(uint64_t lobby_id, uint32_t limit)>;
+
+  struct Store {
+    std::function<void(uint64_t lobby_id, std::vector<HistoryMessage> messages)> append;
+    // Up to limit messages older than before_id, oldest first; more if there are older ones
+    std::function<bool(uint64_t lobby_id, uint64_t before_id, uint32_t limit, std::vector<HistoryMessage>& out,
+                       bool& more)> read;
+  };
+
+  using SeenFn = std::function<void(const std::vector<HistoryMessage>& messages)>;
+
+  explicit MessageHistory(FetchFn fetch, Store store = Store(), SeenFn seen = SeenFn());
+
+  void Configure(const HistoryOptions& options) { options_ = options; }
+  HistoryOptions Options() const { return options_; }
+
+  // A live message; false if it is already known
+  bool Add(const HistoryMessage& message);
+  void OnFetched(uint64_t lobby_id, bool ok, const std::string& error, const std::vector<HistoryMessage>& messages);
+
+  // Up to limit messages older than before_id (0 = the newest). done may run
+  // synchronously when the page is in memory.
+  void Get(uint64_t lobby_id, uint64_t before_id, uint32_t limit, HistoryDone done);
+
+  void Forget(uint64_t lobby_id);
+  // Fails reads waiting on a fetch (disconnect); what is in memory stays
+  void FailPending(const std::string& error);
+  HistoryStatus Status() const;
+
+private:
+  struct Query {
+    uint64_t before_id;
+    uint32_t limit;
+    HistoryDone done;
+  };
+
+  struct Lobby {
+    std::deque<HistoryMessage> messages;  // ascending ID
+    bool complete = false;                // holds the lobby's first message
+    uint32_t fetched_limit = 0;           // largest fetch so far
+    uint32_t fetching = 0;                // limit of the fetch in flight, 0 if none
+    bool stale = false;                   // loaded from the store; newer messages may be missing
+    std::vector<Query> waiting;
+    uint64_t last_used = 0;
+  };
+
+  Lobby& Find(uint64_t lobby_id);  // creates the lobby, loading it from the store
+  Lobby& Touch(uint64_t lobby_id);
+  static size_t OlderThan(const Lobby& lobby, uint64_t before_id);
+  uint32_t FetchCap() const;
+  uint32_t FetchLimitFor(const Lobby& lobby, const Query& query) const;
+  bool SdkHasMore(const Lobby& lobby) const;
+  // Answers the query from memory or the store if they cover it as well as the SDK could
+  bool TryServe(uint64_t lobby_id, const Lobby& lobby, const Query& query, bool cached);
+  void Serve(const Lobby& lobby, const Query& query, bool cached);
+  void StartFetch(uint64_t lobby_id, Lobby& lobby, uint32_t limit);
+  bool Insert(Lobby& lobby, const HistoryMessage& message);  // false if already there
+  void Trim(Lobby& lobby);
+  void EvictIfFull(uint64_t keep);  // keep = the lobby being used
+
+  FetchFn fetch_;
+  Store store_;
+  SeenFn seen_;
+  HistoryOptions options_;
+  std::unordered_map<uint64_t, Lobby> lobbies_;
+  uint64_t clock_ = 0;  // for least-recently-used eviction
+  size_t messages_ = 0;
+
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t fetches_ = 0;
+};
+
+#endif // DISCORD_MESSAGE_HISTORY_H
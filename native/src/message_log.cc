@@ -0,0 +1,487 @@
+#include "message_log.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <direct.h>
+#include <windows.h>
+#define ML_MKDIR(path) _mkdir(path)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ML_MKDIR(path) mkdir(path, 0700)
+#endif
+
+static const char kIndexMagic[8] = { 'D', 'L', 'M', 'I', 'v', '1', 0, 0 };
+static const size_t kIndexHeader = 16;        // magic, u64 entry count
+static const uint32_t kIndexStride = 64;      // records per index entry
+static const size_t kInitialEntries = 256;
+static const auto kSyncTimeout = std::chrono::seconds(2);
+
+struct IndexEntry {
+  uint64_t id;      // first record of the block
+  uint64_t offset;  // where that record starts in the log
+};
+
+// The <lobby>.idx mapping: header, then capacity entries. Values are in host
+// byte order; the file never leaves this machine and is rebuilt if it is off.
+struct MappedIndex {
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+  char* base = nullptr;
+  size_t capacity = 0;
+
+  uint64_t& Count() { return *reinterpret_cast<uint64_t*>(base + 8); }
+  IndexEntry* Entries() { return reinterpret_cast<IndexEntry*>(base + kIndexHeader); }
+};
+
+static void UnmapIndex(MappedIndex& index) {
+  if (!index.base) return;
+#ifdef _WIN32
+  UnmapViewOfFile(index.base);
+  CloseHandle(index.mapping);
+  index.mapping = nullptr;
+#else
+  munmap(index.base, kIndexHeader + index.capacity * sizeof(IndexEntry));
+#endif
+  index.base = nullptr;
+}
+
+// Maps the file with room for capacity entries, growing it if needed
+static bool MapIndex(MappedIndex& index, size_t capacity) {
+  UnmapIndex(index);
+  uint64_t bytes = kIndexHeader + capacity * sizeof(IndexEntry);
+#ifdef _WIN32
+  index.mapping = CreateFileMappingA(index.file, nullptr, PAGE_READWRITE, static_cast<DWORD>(bytes >> 32),
+                                     static_cast<DWORD>(bytes), nullptr);
+  if (!index.mapping) return false;
+  index.base = static_cast<char*>(MapViewOfFile(index.mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(bytes)));
+  if (!index.base) {
+    CloseHandle(index.mapping);
+    index.mapping = nullptr;
+    return false;
+  }
+#else
+  struct stat info;
+  if (fstat(index.fd, &info) != 0) return false;
+  if (static_cast<uint64_t>(info.st_size) < bytes && ftruncate(index.fd, static_cast<off_t>(bytes)) != 0) return false;
+  void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, index.fd, 0);
+  if (base == MAP_FAILED) return false;
+  index.base = static_cast<char*>(base);
+#endif
+  index.capacity = capacity;
+  return true;
+}
+
+static void CloseIndex(MappedIndex& index) {
+  UnmapIndex(index);
+#ifdef _WIN32
+  if (index.file != INVALID_HANDLE_VALUE) CloseHandle(index.file);
+  index.file = INVALID_HANDLE_VALUE;
+#else
+  if (index.fd >= 0) close(index.fd);
+  index.fd = -1;
+#endif
+}
+
+static bool OpenIndex(const std::string& path, MappedIndex& index) {
+  uint64_t size = 0;
+#ifdef _WIN32
+  index.file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (index.file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(index.file, &file_size)) size = static_cast<uint64_t>(file_size.QuadPart);
+#else
+  index.fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+  if (index.fd < 0) return false;
+  struct stat info;
+  if (fstat(index.fd, &info) == 0) size = static_cast<uint64_t>(info.st_size);
+#endif
+  size_t capacity = size > kIndexHeader ? (size - kIndexHeader) / sizeof(IndexEntry) : 0;
+  if (!MapIndex(index, std::max(capacity, kInitialEntries))) {
+    CloseIndex(index);
+    return false;
+  }
+  // A new or unrecognized file starts empty; the caller rebuilds it from the log
+  if (std::memcmp(index.base, kIndexMagic, sizeof(kIndexMagic)) != 0 || index.Count() > index.capacity) {
+    std::memcpy(index.base, kIndexMagic, sizeof(kIndexMagic));
+    index.Count() = 0;
+  }
+  return true;
+}
+
+static bool PushIndex(MappedIndex& index, const IndexEntry& entry) {
+  if (index.Count() == index.capacity && !MapIndex(index, index.capacity * 2)) return false;
+  index.Entries()[index.Count()] = entry;
+  index.Count()++;
+  return true;
+}
+
+// Record layout: u64 id, u64 author id, u64 sent_ms, then the content
+static void PutInt(std::string& out, uint64_t value) {
+  for (int i = 0; i < 8; i++) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static uint64_t GetInt(const std::string& in, size_t offset) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(static_cast<uint8_t>(in[offset + i])) << (8 * i);
+  return value;
+}
+
+static std::string MessageRecord(const HistoryMessage& message) {
+  std::string record;
+  record.reserve(24 + message.content.size());
+  PutInt(record, message.id);
+  PutInt(record, message.author_id);
+  PutInt(record, message.sent_ms);
+  record += message.content;
+  return record;
+}
+
+static bool ParseMessage(uint64_t lobby_id, const std::string& record, HistoryMessage& out) {
+  if (record.size() < 24) return false;
+  out.id = GetInt(record, 0);
+  out.lobby_id = lobby_id;
+  out.author_id = GetInt(record, 8);
+  out.sent_ms = GetInt(record, 16);
+  out.content.assign(record, 24, std::string::npos);
+  return true;
+}
+
+static bool IdLess(const HistoryMessage& a, const HistoryMessage& b) {
+  return a.id < b.id;
+}
+
+struct MessageLog::LobbyFile {
+  std::string log_path;
+  std::string index_path;
+  std::string held_path;
+  RecordLog log;
+  MappedIndex index;
+  uint64_t first_id = 0;  // 0 while the log is empty
+  uint64_t last_id = 0;
+  uint64_t records = 0;
+  // Arrived out of order (before first_id, or into a gap); also in held_log
+  // until the next compaction merges them into log
+  std::map<uint64_t, HistoryMessage> held;
+  RecordLog held_log;
+  uint64_t last_used = 0;
+
+  ~LobbyFile() { CloseIndex(index); }
+};
+
+MessageLog::MessageLog() = default;
+
+MessageLog::~MessageLog() {
+  Close();
+}
+
+bool MessageLog::Open(const std::string& dir, std::string* error) {
+  Close();
+  if (ML_MKDIR(dir.c_str()) != 0 && errno != EEXIST) {
+    if (error) *error = "Cannot create " + dir + ": " + std::strerror(errno);
+    return false;
+  }
+  dir_ = dir;
+  LOG_INFO("📜 Message log opened at " << dir);
+  return true;
+}
+
+void MessageLog::Close() {
+  if (!IsOpen()) return;
+  // No compaction here: this runs at shutdown, and held messages are already
+  // on disk for the next session to merge
+  files_.clear();  // each RecordLog writes out what it buffered as it closes
+  dir_.clear();
+  METRIC_GAUGE("messagelog.open_files").Set(0);
+}
+
+MessageLog::LobbyFile* MessageLog::File(uint64_t lobby_id) {
+  auto it = files_.find(lobby_id);
+  if (it != files_.end()) {
+    it->second->last_used = ++clock_;
+    return it->second.get();
+  }
+  if (!IsOpen()) return nullptr;
+
+  CloseIdle();
+  std::unique_ptr<LobbyFile> file(new LobbyFile());
+  std::string base = dir_ + "/" + std::to_string(lobby_id);
+  file->log_path = base + ".log";
+  file->index_path = base + ".idx";
+  file->held_path = base + ".held";
+  if (!Load(lobby_id, *file)) return nullptr;
+  file->last_used = ++clock_;
+  LobbyFile* raw = file.get();
+  files_[lobby_id] = std::move(file);
+  METRIC_GAUGE("messagelog.open_files").Set(static_cast<int64_t>(files_.size()));
+  return raw;
+}
+
+bool MessageLog::Load(uint64_t lobby_id, LobbyFile& file) {
+  ScopedLatency latency(METRIC_HISTOGRAM("messagelog.open_us"));
+  if (!OpenIndex(file.index_path, file.index)) {
+    LOG_WARN("⚠️  Cannot map " << file.index_path);
+    return false;
+  }
+
+  // Only the records from the last indexed one on are read, and they must
+  // start with it; anything else means the index is out of date
+  uint64_t count = file.index.Count();
+  IndexEntry last = count ? file.index.Entries()[count - 1] : IndexEntry{ 0, 0 };
+  bool matched = count == 0;
+  uint64_t tail = 0;
+  std::string error;
+  bool opened = file.log.Open(file.log_path, options_.log, [&](const std::string& record) {
+    HistoryMessage message;
+    if (!ParseMessage(lobby_id, record, message)) return;
+    if (tail++ == 0 && count) matched = message.id == last.id;
+    file.last_id = message.id;
+  }, &error, last.offset);
+  if (!opened) {
+    LOG_WARN("⚠️  Cannot open message log: " << error);
+    return false;
+  }
+
+  if (!matched || (count == 0 && tail > 0) || tail > kIndexStride) {
+    RebuildIndex(file);
+  } else {
+    file.records = count ? (count - 1) * kIndexStride + tail : 0;
+    file.first_id = count ? file.index.Entries()[0].id : 0;
+  }
+
+  // Held messages not merged yet; ones a compaction merged just before a
+  // crash are deduplicated by the next one
+  RecordLog::Read(file.held_path, 0, UINT64_MAX, [&](uint64_t, const std::string& record) {
+    HistoryMessage message;
+    if (ParseMessage(lobby_id, record, message)) file.held[message.id] = std::move(message);
+  });
+  return true;
+}
+
+void MessageLog::RebuildIndex(LobbyFile& file) {
+  index_rebuilds_++;
+  METRIC_COUNTER("messagelog.index_rebuilds").Add();
+  file.index.Count() = 0;
+  file.records = 0;
+  file.first_id = 0;
+  file.last_id = 0;
+  RecordLog::Read(file.log_path, 0, UINT64_MAX, [&](uint64_t offset, const std::string& record) {
+    if (record.size() < 24) return;
+    uint64_t id = GetInt(record, 0);
+    if (file.records++ % kIndexStride == 0) PushIndex(file.index, { id, offset });
+    if (!file.first_id) file.first_id = id;
+    file.last_id = id;
+  });
+  LOG_INFO("📜 Rebuilt index of " << file.log_path << " (" << file.records << " messages)");
+}
+
+// IDs of the records in the index block that would hold id
+static void ReadBlock(const std::string& path, MappedIndex& index, uint64_t id, size_t& block,
+                      std::unordered_set<uint64_t>& ids) {
+  const IndexEntry* entries = index.Entries();
+  size_t count = index.Count();
+  size_t found = std::upper_bound(entries, entries + count, id,
+                                  [](uint64_t id, const IndexEntry& entry) { return id < entry.id; }) - entries;
+  found = found ? found - 1 : 0;
+  if (found == block) return;
+  block = found;
+  ids.clear();
+  if (count == 0) return;
+  uint64_t to = found + 1 < count ? entries[found + 1].offset : UINT64_MAX;
+  RecordLog::Read(path, entries[found].offset, to, [&](uint64_t, const std::string& record) {
+    if (record.size() >= 24) ids.insert(GetInt(record, 0));
+  });
+}
+
+void MessageLog::Append(uint64_t lobby_id, std::vector<HistoryMessage> messages) {
+  LobbyFile* file = File(lobby_id);
+  if (!file) return;
+  std::sort(messages.begin(), messages.end(), IdLess);
+  uint64_t appended = 0;
+  uint64_t held = 0;
+  size_t block = SIZE_MAX;
+  std::unordered_set<uint64_t> block_ids;
+  for (HistoryMessage& message : messages) {
+    if (message.id > file->last_id) {
+      uint64_t offset = file->log.Append(MessageRecord(message));
+      if (file->records % kIndexStride == 0) PushIndex(file->index, { message.id, offset });
+      if (!file->records) file->first_id = message.id;
+      file->records++;
+      file->last_id = message.id;
+      appended++;
+      continue;
+    }
+    if (file->held.count(message.id)) continue;
+    if (message.id >= file->first_id) {
+      // Inside the logged range: already there, or backfill for a gap (live
+      // messages were logged while it was being fetched). One not yet written
+      // out looks missing and is held twice; reads and compaction dedupe.
+      ReadBlock(file->log_path, file->index, message.id, block, block_ids);
+      if (block_ids.count(message.id)) continue;
+    }
+    Hold(*file, std::move(message));
+    held++;
+  }
+  appended_ += appended;
+  METRIC_COUNTER("messagelog.appended").Add(appended);
+  METRIC_COUNTER("messagelog.held").Add(held);
+
+  if (file->held.size() >= kIndexStride || file->records > options_.max_messages + options_.max_messages / 4) {
+    Compact(lobby_id, *file);
+  }
+}
+
+void MessageLog::Hold(LobbyFile& file, HistoryMessage message) {
+  std::string error;
+  if (!file.held_log.IsOpen() && !file.held_log.Open(file.held_path, options_.log, [](const std::string&) {}, &error)) {
+    LOG_WARN("⚠️  Cannot open held messages, keeping them in memory: " << error);
+  }
+  file.held_log.Append(MessageRecord(message));
+  file.held[message.id] = std::move(message);
+}
+
+// Rewrites the log with the newest max_messages, held messages merged in order
+void MessageLog::Compact(uint64_t lobby_id, LobbyFile& file) {
+  auto started = std::chrono::steady_clock::now();
+  auto deadline = started + kSyncTimeout;  // for the whole compaction, not per sync
+  // The file is read back below, so everything appended must be in it
+  if (!file.log.Sync(deadline)) {
+    LOG_WARN("⚠️  Postponing compaction of " << file.log_path << ": the log is not synced");
+    return;
+  }
+
+  // Whole blocks that fall outside max_messages are not read at all
+  uint64_t skip = file.records > options_.max_messages ? (file.records - options_.max_messages) / kIndexStride : 0;
+  uint64_t from = skip < file.index.Count() ? file.index.Entries()[skip].offset : 0;
+  std::vector<HistoryMessage> messages;
+  RecordLog::Read(file.log_path, from, UINT64_MAX, [&](uint64_t, const std::string& record) {
+    HistoryMessage message;
+    if (ParseMessage(lobby_id, record, message)) messages.push_back(std::move(message));
+  });
+  for (const auto& entry : file.held) {
+    messages.push_back(entry.second);  // copied: they stay held if the rewrite does not land
+  }
+  std::stable_sort(messages.begin(), messages.end(), IdLess);
+  messages.erase(std::unique(messages.begin(), messages.end(),
+                             [](const HistoryMessage& a, const HistoryMessage& b) { return a.id == b.id; }),
+                 messages.end());
+  if (messages.size() > options_.max_messages) {
+    messages.erase(messages.begin(), messages.end() - options_.max_messages);
+  }
+
+  std::vector<std::string> records;
+  records.reserve(messages.size());
+  for (const HistoryMessage& message : messages) {
+    records.push_back(MessageRecord(message));
+  }
+  std::vector<uint64_t> offsets;
+  uint64_t before = file.records;
+  file.log.Rewrite(std::move(records), &offsets);
+  // Reads go to the file, so the new layout must be there before the index says so
+  bool synced = file.log.Sync(deadline);
+  if (!synced) {
+    LOG_WARN("⚠️  Compacted " << file.log_path << " is not on disk yet; reads may miss messages until it is");
+  }
+
+  file.index.Count() = 0;
+  for (size_t i = 0; i < offsets.size(); i += kIndexStride) {
+    PushIndex(file.index, { messages[i].id, offsets[i] });
+  }
+  file.records = messages.size();
+  file.first_id = messages.empty() ? 0 : messages.front().id;
+  file.last_id = messages.empty() ? 0 : messages.back().id;
+  // Only once the merged log is down; a crash before this replays them again
+  if (synced && !file.held.empty()) {
+    file.held.clear();
+    file.held_log.Close();
+    std::remove(file.held_path.c_str());
+  }
+
+  compactions_++;
+  METRIC_HISTOGRAM("messagelog.compact_us").Record(ElapsedMicros(started));
+  LOG_DEBUG("📜 Compacted " << file.log_path << ": " << before << " -> " << file.records << " messages");
+}
+
+bool MessageLog::Read(uint64_t lobby_id, uint64_t before_id, uint32_t limit, std::vector<HistoryMessage>& out,
+                      bool& more) {
+  out.clear();
+  more = false;
+  LobbyFile* file = File(lobby_id);
+  if (!file) return false;
+  ScopedLatency latency(METRIC_HISTOGRAM("messagelog.read_us"));
+  if (!before_id) before_id = UINT64_MAX;
+  file->log.Sync(std::chrono::steady_clock::now() + kSyncTimeout);
+
+  // Blocks from end on start at or after before_id. The last block before
+  // them may hold just one older message, so one extra block is read.
+  const IndexEntry* entries = file->index.Entries();
+  size_t count = file->index.Count();
+  size_t end = std::lower_bound(entries, entries + count, before_id,
+                                [](const IndexEntry& entry, uint64_t id) { return entry.id < id; }) - entries;
+  size_t blocks = limit / kIndexStride + 2;
+  size_t first = end > blocks ? end - blocks : 0;
+  if (end > 0) {
+    uint64_t to = end < count ? entries[end].offset : UINT64_MAX;
+    RecordLog::Read(file->log_path, entries[first].offset, to, [&](uint64_t, const std::string& record) {
+      HistoryMessage message;
+      if (ParseMessage(lobby_id, record, message) && message.id < before_id) out.push_back(std::move(message));
+    });
+  }
+  more = first > 0;
+
+  // Held messages that fall in the range read (or anywhere below it, once
+  // the read reached the start of the file)
+  uint64_t lowest = first > 0 ? entries[first].id : 0;
+  auto held = file->held.lower_bound(lowest);
+  if (held != file->held.end() && held->first < before_id) {
+    for (; held != file->held.end() && held->first < before_id; ++held) {
+      out.push_back(held->second);
+    }
+    std::stable_sort(out.begin(), out.end(), IdLess);
+    out.erase(std::unique(out.begin(), out.end(),
+                          [](const HistoryMessage& a, const HistoryMessage& b) { return a.id == b.id; }),
+              out.end());
+  }
+  if (out.size() > limit) {
+    out.erase(out.begin(), out.end() - limit);
+    more = true;
+  }
+  return true;
+}
+
+void MessageLog::CloseIdle() {
+  while (!files_.empty() && files_.size() >= std::max<uint32_t>(options_.max_open, 1)) {
+    auto victim = files_.begin();
+    for (auto it = files_.begin(); it != files_.end(); ++it) {
+      if (it->second->last_used < victim->second->last_used) victim = it;
+    }
+    files_.erase(victim);
+  }
+}
+
+bool MessageLog::Sync(std::chrono::steady_clock::time_point deadline) {
+  bool ok = true;
+  for (auto& entry : files_) {
+    ok = entry.second->log.Sync(deadline) && ok;
+  }
+  return ok;
+}
+
+MessageLogStatus MessageLog::Status() const {
+  return { IsOpen(), dir_, files_.size(), appended_, compactions_, index_rebuilds_ };
+}
@@ -0,0 +1,90 @@
+#ifndef DISCORD_MESSAGE_LOG_H
+#define DISCORD_MESSAGE_LOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "message_history.h"
+#include "record_log.h"
+
+struct MessageLogOptions {
+  uint32_t max_messages = 5000;  // per lobby; compaction keeps the newest
+  uint32_t max_open = 16;        // lobby files kept open; the least recently used are closed
+  RecordLogOptions log;
+};
+
+struct MessageLogStatus {
+  bool persistent;
+  std::string path;
+  size_t open_lobbies;
+  uint64_t appended;
+  uint64_t compactions;
+  uint64_t index_rebuilds;
+};
+
+// Lobby messages on disk, one append-only file per lobby in a directory, so
+// history survives a restart. Each <lobby>.log is a RecordLog (one record per
+// message, group-committed fsync) kept in ascending snowflake order, which
+// makes an append O(1). Next to it, <lobby>.idx is a memory-mapped sparse
+// index holding the ID and file offset of every kIndexStride-th record; a
+// page older than some ID is a binary search over the index plus one short
+// read, however long the file is. The index is only a cache: it is checked
+// against the log when a lobby is opened and rebuilt if it does not match.
+//
+// Messages that do not extend the log are held aside: ones older than its
+// start (scrolling back), and backfill for a gap inside it (live messages
+// logged while an older page was still being fetched). They go to their own
+// small <lobby>.held RecordLog, so they survive a restart, and the next
+// compaction merges them in order and trims the file to max_messages.
+//
+// Like ConnectionManager, every method requires the client state lock.
+class MessageLog {
+public:
+  MessageLog();
+  ~MessageLog();
+
+  void Configure(const MessageLogOptions& options) { options_ = options; }
+  MessageLogOptions Options() const { return options_; }
+
+  // Keeps lobby logs in dir, creating it if needed
+  bool Open(const std::string& dir, std::string* error);
+  // Closes every lobby file, writing out what is buffered. Nothing is
+  // compacted, so after a successful Sync() this does not wait on the disk.
+  void Close();
+  bool IsOpen() const { return !dir_.empty(); }
+
+  // messages may be in any order; ones already logged are skipped. A message
+  // inside the logged ID range costs a read of its index block to tell.
+  void Append(uint64_t lobby_id, std::vector<HistoryMessage> messages);
+
+  // Up to limit messages older than before_id (0 = the newest), oldest first.
+  // more is set if the log holds older ones.
+  bool Read(uint64_t lobby_id, uint64_t before_id, uint32_t limit, std::vector<HistoryMessage>& out, bool& more);
+
+  bool Sync(std::chrono::steady_clock::time_point deadline);
+  MessageLogStatus Status() const;
+
+private:
+  struct LobbyFile;
+
+  LobbyFile* File(uint64_t lobby_id);  // opens on first use; null if it cannot
+  bool Load(uint64_t lobby_id, LobbyFile& file);
+  void RebuildIndex(LobbyFile& file);
+  void Hold(LobbyFile& file, HistoryMessage message);
+  void Compact(uint64_t lobby_id, LobbyFile& file);
+  void CloseIdle();
+
+  MessageLogOptions options_;
+  std::string dir_;
+  std::unordered_map<uint64_t, std::unique_ptr<LobbyFile>> files_;
+  uint64_t clock_ = 0;  // for closing the least recently used file
+
+  uint64_t appended_ = 0;
+  uint64_t compactions_ = 0;
+  uint64_t index_rebuilds_ = 0;
+};
+
+#endif // DISCORD_MESSAGE_LOG_H
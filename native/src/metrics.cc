@@ -0,0 +1,160 @@
+#include "metrics.h"
+
+void Gauge::Set(int64_t value) {
+  value_.store(value, std::memory_order_relaxed);
+  UpdateMax(value);
+}
+
+void Gauge::Add(int64_t delta) {
+  UpdateMax(value_.fetch_add(delta, std::memory_order_relaxed) + delta);
+}
+
+void Gauge::UpdateMax(int64_t value) {
+  int64_t current = max_.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+size_t Histogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<size_t>(value);
+  }
+
+  int msb = 63;
+  while (!(value >> msb)) msb--;
+  if (msb >= kMaxValueBits) {
+    return kBucketCount - 1;
+  }
+
+  int shift = msb - kSubBucketBits;
+  size_t sub = static_cast<size_t>(value >> shift) - kSubBuckets;
+  return (static_cast<size_t>(shift) + 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::BucketMidpoint(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  int shift = static_cast<int>(index / kSubBuckets) - 1;
+  uint64_t sub = index % kSubBuckets;
+  uint64_t low = (kSubBuckets + sub) << shift;
+  uint64_t width = uint64_t(1) << shift;
+  return low + width / 2;
+}
+
+void Histogram::Record(uint64_t value) {
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t current = min_.load(std::memory_order_relaxed);
+  while (value < current &&
+         !min_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+  current = max_.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snap;
+
+  // Copy the buckets first so percentiles are computed over a consistent total
+  std::vector<uint64_t> counts(kBucketCount);
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBucketCount; i++) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+
+  snap.count = total;
+  if (total == 0) {
+    return snap;
+  }
+
+  snap.min = min_.load(std::memory_order_relaxed);
+  snap.max = max_.load(std::memory_order_relaxed);
+  snap.mean = static_cast<double>(sum_.load(std::memory_order_relaxed)) /
+              static_cast<double>(count_.load(std::memory_order_relaxed));
+
+  const struct { double quantile; uint64_t* out; } targets[] = {
+    { 0.50, &snap.p50 }, { 0.90, &snap.p90 }, { 0.99, &snap.p99 }, { 0.999, &snap.p999 },
+  };
+
+  uint64_t seen = 0;
+  size_t next = 0;
+  for (size_t i = 0; i < kBucketCount && next < 4; i++) {
+    seen += counts[i];
+    while (next < 4 && seen >= static_cast<uint64_t>(targets[next].quantile * total + 0.5)) {
+      uint64_t value = BucketMidpoint(i);
+      if (value < snap.min) value = snap.min;
+      if (value > snap.max) value = snap.max;
+      *targets[next].out = value;
+      next++;
+    }
+  }
+  return snap;
+}
+
+Metrics& Metrics::Instance() {
+  static Metrics instance;
+  return instance;
+}
+
+Metrics::Metrics() : start_(std::chrono::steady_clock::now()) {}
+
+Counter& Metrics::GetCounter(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slot = counters_[name];
+  if (!slot) slot.reset(new Counter());
+  return *slot;
+}
+
+Gauge& Metrics::GetGauge(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slot = gauges_[name];
+  if (!slot) slot.reset(new Gauge());
+  return *slot;
+}
+
+Histogram& Metrics::GetHistogram(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slot = histograms_[name];
+  if (!slot) slot.reset(new Histogram());
+  return *slot;
+}
+
+void Metrics::RegisterProbe(const std::string& name, std::function<int64_t()> probe) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  probes_[name] = std::move(probe);
+}
+
+Metrics::Snapshot Metrics::Collect() {
+  // Probes may read other subsystems; sample them outside the registry lock
+  std::vector<std::pair<std::string, std::function<int64_t()>>> probes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    probes.assign(probes_.begin(), probes_.end());
+  }
+  for (auto& probe : probes) {
+    GetGauge(probe.first).Set(probe.second());
+  }
+
+  Snapshot snap;
+  snap.uptime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_).count();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : counters_) {
+    snap.counters.emplace_back(entry.first, entry.second->Value());
+  }
+  for (auto& entry : gauges_) {
+    snap.gauges.emplace_back(entry.first, std::make_pair(entry.second->Value(), entry.second->Max()));
+  }
+  for (auto& entry : histograms_) {
+    snap.histograms.emplace_back(entry.first, entry.second->Snapshot());
+  }
+  return snap;
+}
@@ -0,0 +1,132 @@
+#ifndef DISCORD_METRICS_H
+#define DISCORD_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Counter {
+public:
+  void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Current value plus high-water mark, e.g. for queue depths.
+class Gauge {
+public:
+  void Set(int64_t value);
+  void Add(int64_t delta);
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+  int64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+private:
+  void UpdateMax(int64_t value);
+
+  std::atomic<int64_t> value_{0};
+  std::atomic<int64_t> max_{0};
+};
+
+struct HistogramSnapshot {
+  uint64_t count = 0;
+  uint64_t min = 0;
+  uint64_t max = 0;
+  double mean = 0;
+  uint64_t p50 = 0;
+  uint64_t p90 = 0;
+  uint64_t p99 = 0;
+  uint64_t p999 = 0;
+};
+
+// HDR-style log-linear histogram: every power of two is split into
+// 2^kSubBucketBits linear sub-buckets, giving ~3% relative error across the
+// whole range with a fixed array of atomic counters. Recording is wait-free.
+class Histogram {
+public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr int kMaxValueBits = 48;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  static constexpr size_t kBucketCount = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  void Record(uint64_t value);
+  HistogramSnapshot Snapshot() const;
+
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketMidpoint(size_t index);
+
+private:
+  std::atomic<uint64_t> buckets_[kBucketCount] = {};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> min_{UINT64_MAX};
+  std::atomic<uint64_t> max_{0};
+};
+
+// Process-wide registry. Lookups by name take a lock, so hot paths should go
+// through the METRIC_* macros below, which resolve the name once per call site.
+class Metrics {
+public:
+  static Metrics& Instance();
+
+  Counter& GetCounter(const std::string& name);
+  Gauge& GetGauge(const std::string& name);
+  Histogram& GetHistogram(const std::string& name);
+
+  // Sampled at snapshot time instead of being pushed on every change
+  void RegisterProbe(const std::string& name, std::function<int64_t()> probe);
+
+  struct Snapshot {
+    int64_t uptime_ms = 0;
+    std::vector<std::pair<std::string, uint64_t>> counters;
+    std::vector<std::pair<std::string, std::pair<int64_t, int64_t>>> gauges;  // value, max
+    std::vector<std::pair<std::string, HistogramSnapshot>> histograms;
+  };
+  Snapshot Collect();
+
+private:
+  Metrics();
+
+  std::mutex mutex_;
+  std::chrono::steady_clock::time_point start_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+  std::map<std::string, std::function<int64_t()>> probes_;
+};
+
+// Records the elapsed time of a scope in microseconds.
+class ScopedLatency {
+public:
+  explicit ScopedLatency(Histogram& histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedLatency() {
+    histogram_.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_).count());
+  }
+
+private:
+  Histogram& histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+inline uint64_t ElapsedMicros(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - since).count();
+}
+
+#define METRIC_COUNTER(name) \
+  ([]() -> Counter& { static Counter& metric = Metrics::Instance().GetCounter(name); return metric; }())
+#define METRIC_GAUGE(name) \
+  ([]() -> Gauge& { static Gauge& metric = Metrics::Instance().GetGauge(name); return metric; }())
+#define METRIC_HISTOGRAM(name) \
+  ([]() -> Histogram& { static Histogram& metric = Metrics::Instance().GetHistogram(name); return metric; }())
+
+#endif // DISCORD_METRICS_H
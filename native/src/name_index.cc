@@ -0,0 +1,244 @@
+#include "name_index.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+
+static const uint8_t kDeadSlot = 0xFF;
+static const size_t kMinRebuildDrops = 1024;
+
+// " General-Chat!" -> " general chat": a leading space marks the first word start
+static std::string Fold(const std::string& name) {
+  std::string folded(1, ' ');
+  folded.reserve(name.size() + 1);
+  for (char c : name) {
+    unsigned char byte = static_cast<unsigned char>(c);
+    if ((byte >= 'a' && byte <= 'z') || (byte >= '0' && byte <= '9') || byte >= 0x80) {
+      folded.push_back(c);
+    } else if (byte >= 'A' && byte <= 'Z') {
+      folded.push_back(static_cast<char>(byte + 32));
+    } else if (folded.back() != ' ') {
+      folded.push_back(' ');
+    }
+  }
+  if (folded.size() > 1 && folded.back() == ' ') folded.pop_back();
+  return folded;
+}
+
+static uint32_t Gram(unsigned char a, unsigned char b, unsigned char c) {
+  return (static_cast<uint32_t>(a) << 16) | (static_cast<uint32_t>(b) << 8) | c;
+}
+
+// Every trigram, plus (space, letter, 0) per word start; distinct and sorted
+static std::vector<uint32_t> NameGrams(const std::string& folded) {
+  std::vector<uint32_t> grams;
+  const unsigned char* text = reinterpret_cast<const unsigned char*>(folded.data());
+  for (size_t i = 0; i + 1 < folded.size(); i++) {
+    if (text[i] == ' ') grams.push_back(Gram(' ', text[i + 1], 0));
+    if (i + 2 < folded.size()) grams.push_back(Gram(text[i], text[i + 1], text[i + 2]));
+  }
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  return grams;
+}
+
+// One letter can only be looked up as a word start; anything longer by its trigrams
+static std::vector<uint32_t> QueryGrams(const std::string& folded) {
+  if (folded.size() == 2) return { Gram(' ', static_cast<unsigned char>(folded[1]), 0) };
+  std::vector<uint32_t> grams;
+  const unsigned char* text = reinterpret_cast<const unsigned char*>(folded.data());
+  for (size_t i = 0; i + 2 < folded.size(); i++) {
+    grams.push_back(Gram(text[i], text[i + 1], text[i + 2]));
+  }
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  return grams;
+}
+
+std::string NameIndex::Key(NameKind kind, const std::string& id) {
+  return static_cast<char>('0' + static_cast<int>(kind)) + id;
+}
+
+void NameIndex::Put(NameKind kind, const NameEntry& entry) {
+  auto it = by_key_.find(Key(kind, entry.id));
+  if (it != by_key_.end()) {
+    const NameEntry& current = slots_[it->second].entry;
+    if (current.name == entry.name && current.parent_id == entry.parent_id) return;
+    Drop(it->second);
+  }
+  Add(kind, entry);
+  RebuildIfSparse();
+}
+
+void NameIndex::Remove(NameKind kind, const std::string& id) {
+  auto it = by_key_.find(Key(kind, id));
+  if (it == by_key_.end()) return;
+  Drop(it->second);
+  RebuildIfSparse();
+}
+
+void NameIndex::Replace(NameKind kind, const std::string& parent_id, const std::vector<NameEntry>& entries) {
+  std::unordered_set<std::string> keep;
+  for (const NameEntry& entry : entries) {
+    keep.insert(entry.id);
+  }
+  auto group = groups_.find(Key(kind, parent_id));
+  if (group != groups_.end()) {
+    std::vector<uint32_t> gone;
+    for (uint32_t slot : group->second) {
+      if (!keep.count(slots_[slot].entry.id)) gone.push_back(slot);
+    }
+    for (uint32_t slot : gone) {
+      Drop(slot);
+    }
+  }
+
+  for (const NameEntry& entry : entries) {
+    auto it = by_key_.find(Key(kind, entry.id));
+    if (it != by_key_.end()) {
+      const NameEntry& current = slots_[it->second].entry;
+      if (current.name == entry.name && current.parent_id == parent_id) continue;
+      Drop(it->second);
+    }
+    Add(kind, { entry.id, entry.name, parent_id });
+  }
+  RebuildIfSparse();
+}
+
+void NameIndex::Add(NameKind kind, const NameEntry& entry) {
+  uint32_t slot = static_cast<uint32_t>(slots_.size());
+  std::string folded = Fold(entry.name);
+  folded.resize(std::min<size_t>(folded.size(), UINT16_MAX));
+  slots_.push_back({ kind, entry });
+  kinds_.push_back(static_cast<uint8_t>(kind));
+  folded_at_.push_back(static_cast<uint32_t>(folded_.size()));
+  folded_size_.push_back(static_cast<uint16_t>(folded.size()));
+  folded_ += folded;
+  by_key_[Key(kind, entry.id)] = slot;
+  groups_[Key(kind, entry.parent_id)].insert(slot);
+  for (uint32_t gram : NameGrams(folded)) {
+    grams_[gram].push_back(slot);
+  }
+  live_++;
+}
+
+void NameIndex::Drop(uint32_t slot) {
+  if (kinds_[slot] == kDeadSlot) return;
+  Slot& entry = slots_[slot];
+  kinds_[slot] = kDeadSlot;
+  by_key_.erase(Key(entry.kind, entry.entry.id));
+  auto group = groups_.find(Key(entry.kind, entry.entry.parent_id));
+  if (group != groups_.end()) {
+    group->second.erase(slot);
+    if (group->second.empty()) groups_.erase(group);
+  }
+  // Posting lists keep the slot number until the next rebuild
+  entry.entry = NameEntry();
+  live_--;
+}
+
+// Dead slots cost a check in every list they sit in; renumber once they
+// outnumber live ones
+void NameIndex::RebuildIfSparse() {
+  size_t dead = slots_.size() - live_;
+  if (dead < kMinRebuildDrops || dead < live_) return;
+  auto started = std::chrono::steady_clock::now();
+  std::vector<Slot> slots;
+  slots.swap(slots_);
+  std::vector<uint8_t> kinds;
+  kinds.swap(kinds_);
+  folded_at_.clear();
+  folded_size_.clear();
+  folded_.clear();
+  by_key_.clear();
+  groups_.clear();
+  grams_.clear();
+  live_ = 0;
+  for (size_t slot = 0; slot < slots.size(); slot++) {
+    if (kinds[slot] != kDeadSlot) Add(slots[slot].kind, slots[slot].entry);
+  }
+  counts_.clear();
+  METRIC_HISTOGRAM("names.rebuild_us").Record(ElapsedMicros(started));
+  LOG_DEBUG("🔤 Rebuilt name index: " << slots.size() << " -> " << live_ << " slots");
+}
+
+std::vector<NameMatch> NameIndex::Search(const std::string& query, uint32_t kinds, uint32_t limit) {
+  auto started = std::chrono::steady_clock::now();
+  searches_++;
+  std::string folded = Fold(query);
+  if (folded.size() < 2 || limit == 0) return {};
+  std::vector<uint32_t> query_grams = QueryGrams(folded);
+  size_t need = query_grams.size() <= 2 ? query_grams.size() : (query_grams.size() + 1) / 2;
+
+  // Count shared grams per slot; touched_ remembers which counters to reset
+  counts_.resize(slots_.size());
+  touched_.clear();
+  for (uint32_t gram : query_grams) {
+    auto it = grams_.find(gram);
+    if (it == grams_.end()) continue;
+    for (uint32_t slot : it->second) {
+      uint8_t kind = kinds_[slot];
+      if (kind == kDeadSlot || !(kinds & (1u << kind))) continue;
+      if (counts_[slot]++ == 0) touched_.push_back(slot);
+    }
+  }
+
+  // The best limit so far, as a heap with the weakest on top; ties go to the older slot
+  using Ranked = std::pair<double, uint32_t>;
+  auto better = [](const Ranked& a, const Ranked& b) { return a.first != b.first ? a.first > b.first : a.second < b.second; };
+  std::vector<Ranked> ranked;
+  ranked.reserve(limit + 1);
+  std::string_view query_text(folded.data(), folded.size());
+  std::string_view inner = query_text.substr(1);
+  for (uint32_t slot : touched_) {
+    uint16_t shared = counts_[slot];
+    counts_[slot] = 0;
+    if (shared < need) continue;
+    double score = static_cast<double>(shared) / query_grams.size();
+    // Only an exact match gets 3, and the length is known without reading the name
+    size_t size = folded_size_[slot];
+    double penalty = std::min<size_t>(size, 100) / 1000.0;
+    if (ranked.size() == limit && !better({ score + (size == query_text.size() ? 3 : 2) - penalty, slot }, ranked.front())) {
+      continue;
+    }
+    std::string_view name(folded_.data() + folded_at_[slot], size);
+    if (name == query_text) {
+      score += 3;
+    } else if (name.compare(0, query_text.size(), query_text) == 0) {
+      score += 2;
+    } else if (name.find(query_text) != std::string_view::npos) {
+      score += 1.5;  // starts a later word
+    } else if (name.find(inner) != std::string_view::npos) {
+      score += 1;
+    }
+    // Among equals, the shorter name is the closer one
+    score -= penalty;
+    Ranked candidate(score, slot);
+    if (ranked.size() == limit) {
+      if (!better(candidate, ranked.front())) continue;
+      std::pop_heap(ranked.begin(), ranked.end(), better);
+      ranked.back() = candidate;
+    } else {
+      ranked.push_back(candidate);
+    }
+    std::push_heap(ranked.begin(), ranked.end(), better);
+  }
+
+  std::sort(ranked.begin(), ranked.end(), [this](const Ranked& a, const Ranked& b) {
+    if (a.first != b.first) return a.first > b.first;
+    return slots_[a.second].entry.name < slots_[b.second].entry.name;
+  });
+  std::vector<NameMatch> matches;
+  matches.reserve(ranked.size());
+  for (const Ranked& match : ranked) {
+    const Slot& slot = slots_[match.second];
+    matches.push_back({ slot.kind, slot.entry, match.first });
+  }
+  METRIC_HISTOGRAM("names.search_us").Record(ElapsedMicros(started));
+  return matches;
+}
+
+NameIndexStatus NameIndex::Status() const {
+  return { live_, grams_.size(), searches_ };
+}
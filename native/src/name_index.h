@@ -0,0 +1,88 @@
+#ifndef DISCORD_NAME_INDEX_H
+#define DISCORD_NAME_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum class NameKind : uint8_t { Guild = 0, Channel = 1, Lobby = 2, Friend = 3 };
+
+inline uint32_t NameKindBit(NameKind kind) {
+  return 1u << static_cast<uint32_t>(kind);
+}
+static const uint32_t kAllNameKinds = 0xF;
+
+struct NameEntry {
+  std::string id;
+  std::string name;
+  std::string parent_id;  // the guild, for channels
+};
+
+struct NameMatch {
+  NameKind kind;
+  NameEntry entry;
+  double score;  // higher is better; an exact match scores about 4
+};
+
+struct NameIndexStatus {
+  size_t names;
+  size_t trigrams;
+  uint64_t searches;
+};
+
+// Fuzzy type-ahead over the names of cached guilds, channels, lobbies and
+// friends. Names are folded (ASCII lowercase, punctuation to spaces) and
+// every three-byte window goes into a posting list, plus one key per word
+// start so one- and two-letter queries still narrow by word prefix. A query
+// counts how many of its trigrams each name shares; names sharing at least
+// half are ranked by that overlap with bonuses for prefix, word-prefix and
+// substring matches. Only the posting lists of the query's trigrams are read.
+//
+// Updates are incremental: a removed or renamed entry leaves a dead slot that
+// searches skip, and the lists are rebuilt once dead slots outnumber live ones.
+//
+// Like ConnectionManager, every method requires the client state lock.
+class NameIndex {
+public:
+  // Adds or renames one entry
+  void Put(NameKind kind, const NameEntry& entry);
+  void Remove(NameKind kind, const std::string& id);
+  // Every entry of kind under parent_id becomes entries (a refetched list)
+  void Replace(NameKind kind, const std::string& parent_id, const std::vector<NameEntry>& entries);
+
+  // Best matches first; kinds is a mask of NameKindBit()
+  std::vector<NameMatch> Search(const std::string& query, uint32_t kinds, uint32_t limit);
+  NameIndexStatus Status() const;
+
+private:
+  struct Slot {
+    NameKind kind;
+    NameEntry entry;
+  };
+
+  static std::string Key(NameKind kind, const std::string& id);
+  void Add(NameKind kind, const NameEntry& entry);
+  void Drop(uint32_t slot);
+  void RebuildIfSparse();
+
+  std::vector<Slot> slots_;
+  // Per slot, kept apart from slots_ so a search touches little memory:
+  // the kind (kDeadSlot once dropped) and where its folded name sits in folded_
+  std::vector<uint8_t> kinds_;
+  std::vector<uint32_t> folded_at_;
+  std::vector<uint16_t> folded_size_;
+  std::string folded_;
+  std::unordered_map<std::string, uint32_t> by_key_;                   // kind + id
+  std::unordered_map<std::string, std::unordered_set<uint32_t>> groups_;  // kind + parent ID
+  std::unordered_map<uint32_t, std::vector<uint32_t>> grams_;           // ascending slots
+  size_t live_ = 0;
+
+  // Reused by every search
+  std::vector<uint16_t> counts_;
+  std::vector<uint32_t> touched_;
+  uint64_t searches_ = 0;
+};
+
+#endif // DISCORD_NAME_INDEX_H
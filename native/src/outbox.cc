@@ -0,0 +1,414 @@
+#include "outbox.h"
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+
+// Record layout: u8 kind, u16 nonce length, nonce, then per kind
+//   'E' enqueue: u8 target, u64 destination id, u64 created_ms, u32 length, content
+//   'S' sent:    u64 message id
+//   'F' failed:  nothing
+static const char kEnqueued = 'E';
+static const char kSent = 'S';
+static const char kFailed = 'F';
+
+static void PutInt(std::string& out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static bool GetInt(const std::string& in, size_t& offset, int bytes, uint64_t& value) {
+  if (offset + bytes > in.size()) return false;
+  value = 0;
+  for (int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(static_cast<uint8_t>(in[offset + i])) << (8 * i);
+  offset += bytes;
+  return true;
+}
+
+static bool GetBytes(const std::string& in, size_t& offset, uint64_t length, std::string& out) {
+  if (offset + length > in.size()) return false;
+  out.assign(in, offset, length);
+  offset += length;
+  return true;
+}
+
+static std::string RecordHeader(char kind, const std::string& nonce) {
+  std::string out(1, kind);
+  PutInt(out, nonce.size(), 2);
+  out += nonce;
+  return out;
+}
+
+static std::string EnqueueRecord(const std::string& nonce, const SendDestination& destination, uint64_t created_ms,
+                                 const std::string& content) {
+  std::string record = RecordHeader(kEnqueued, nonce);
+  PutInt(record, static_cast<uint64_t>(destination.target), 1);
+  PutInt(record, destination.id, 8);
+  PutInt(record, created_ms, 8);
+  PutInt(record, content.size(), 4);
+  record += content;
+  return record;
+}
+
+static uint64_t WallMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Same jittered doubling as reconnects: between half and all of the capped delay
+static uint32_t RetryDelayMs(const OutboxOptions& options, uint32_t attempt, std::mt19937_64& rng) {
+  uint64_t cap = options.retry_base_ms;
+  for (uint32_t i = 1; i < attempt && cap < options.retry_max_ms; i++) {
+    cap *= 2;
+  }
+  cap = std::min<uint64_t>(cap, options.retry_max_ms);
+  std::uniform_int_distribution<uint64_t> jitter(0, cap / 2);
+  return static_cast<uint32_t>(cap - cap / 2 + jitter(rng));
+}
+
+static uint64_t MillisUntil(std::chrono::steady_clock::time_point at, std::chrono::steady_clock::time_point now) {
+  if (at <= now) return 0;
+  return static_cast<uint64_t>(std::chrono::ceil<std::chrono::milliseconds>(at - now).count());
+}
+
+const char* OutboxStateName(OutboxState state) {
+  switch (state) {
+    case OutboxState::Queued: return "queued";
+    case OutboxState::Sending: return "sending";
+    case OutboxState::Sent: return "sent";
+    case OutboxState::Failed: return "failed";
+    default: return "unknown";
+  }
+}
+
+Outbox::Outbox(TimerQueue& timers, LockedRunner run_locked, SubmitFn submit)
+    : timers_(timers), run_locked_(std::move(run_locked)), submit_(std::move(submit)), rng_(std::random_device{}()) {}
+
+int Outbox::Open(const std::string& path, std::string* error) {
+  Close();
+
+  EntryList restored;
+  std::unordered_map<std::string, EntryList::iterator> index;
+  bool opened = log_.Open(path, options_.log, [&](const std::string& record) { Replay(record, restored, index); },
+                          error);
+  if (!opened) return -1;
+
+  // Restored messages predate anything queued in memory before the file was opened
+  int count = 0;
+  for (auto it = restored.begin(); it != restored.end();) {
+    auto next = std::next(it);
+    if (by_nonce_.count(it->nonce)) {
+      restored.erase(it);
+    } else {
+      count++;
+    }
+    it = next;
+  }
+  for (const Entry& entry : entries_) {
+    log_.Append(EnqueueRecord(entry.nonce, entry.destination, entry.created_ms, entry.content));
+  }
+  entries_.splice(entries_.begin(), restored);
+  by_nonce_.clear();
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    by_nonce_[it->nonce] = it;
+  }
+
+  LOG_INFO("📮 Outbox opened at " << path << " (" << count << " unsent messages restored)");
+  METRIC_GAUGE("outbox.pending").Set(static_cast<int64_t>(entries_.size()));
+  MaybeCompact();
+  Flush();
+  return count;
+}
+
+void Outbox::Close() {
+  log_.Close();
+}
+
+void Outbox::Replay(const std::string& record, EntryList& restored,
+                    std::unordered_map<std::string, EntryList::iterator>& index) {
+  size_t offset = 1;
+  uint64_t nonce_size;
+  std::string nonce;
+  if (record.empty() || !GetInt(record, offset, 2, nonce_size) || !GetBytes(record, offset, nonce_size, nonce)) {
+    METRIC_COUNTER("outbox.bad_records").Add();
+    return;
+  }
+
+  switch (record[0]) {
+    case kEnqueued: {
+      Entry entry;
+      uint64_t target, content_size;
+      bool ok = GetInt(record, offset, 1, target) && GetInt(record, offset, 8, entry.destination.id) &&
+                GetInt(record, offset, 8, entry.created_ms) && GetInt(record, offset, 4, content_size) &&
+                GetBytes(record, offset, content_size, entry.content);
+      if (!ok || index.count(nonce)) return;
+      entry.nonce = nonce;
+      entry.destination.target = target ? SendTarget::Lobby : SendTarget::User;
+      entry.queued_at = std::chrono::steady_clock::now();
+      index[nonce] = restored.insert(restored.end(), std::move(entry));
+      break;
+    }
+    case kSent: {
+      uint64_t message_id = 0;
+      GetInt(record, offset, 8, message_id);
+      auto it = index.find(nonce);
+      if (it != index.end()) {
+        restored.erase(it->second);
+        index.erase(it);
+      }
+      RememberSent(nonce, message_id);
+      break;
+    }
+    case kFailed: {
+      auto it = index.find(nonce);
+      if (it != index.end()) {
+        restored.erase(it->second);
+        index.erase(it);
+      }
+      break;
+    }
+    default:
+      METRIC_COUNTER("outbox.bad_records").Add();
+      break;
+  }
+}
+
+std::string Outbox::Enqueue(std::string nonce, const SendDestination& destination, std::string content,
+                            SendDone done) {
+  if (nonce.empty()) {
+    char generated[40];
+    std::snprintf(generated, sizeof(generated), "%016llx-%llu", static_cast<unsigned long long>(rng_()),
+                  static_cast<unsigned long long>(++nonce_counter_));
+    nonce = generated;
+  }
+
+  // Dedupe: the same nonce never produces a second message
+  auto sent = sent_ids_.find(nonce);
+  if (sent != sent_ids_.end()) {
+    deduped_++;
+    METRIC_COUNTER("outbox.deduped").Add();
+    if (done) done({ true, sent->second, "", 0, false });
+    return nonce;
+  }
+  auto pending = by_nonce_.find(nonce);
+  if (pending != by_nonce_.end()) {
+    deduped_++;
+    METRIC_COUNTER("outbox.deduped").Add();
+    if (done) pending->second->waiters.push_back(std::move(done));
+    return nonce;
+  }
+
+  if (entries_.size() >= options_.max_pending) {
+    METRIC_COUNTER("outbox.rejected").Add();
+    if (done) done({ false, 0, "Outbox is full", 0, false });
+    return nonce;
+  }
+
+  Entry entry;
+  entry.nonce = nonce;
+  entry.destination = destination;
+  entry.content = std::move(content);
+  entry.created_ms = WallMillis();
+  entry.queued_at = std::chrono::steady_clock::now();
+  if (done) entry.waiters.push_back(std::move(done));
+
+  if (log_.IsOpen()) {
+    log_.Append(EnqueueRecord(nonce, destination, entry.created_ms, entry.content));
+  }
+
+  auto it = entries_.insert(entries_.end(), std::move(entry));
+  by_nonce_[nonce] = it;
+  METRIC_GAUGE("outbox.pending").Set(static_cast<int64_t>(entries_.size()));
+  Transition(*it, OutboxState::Queued, nullptr);
+  Flush();
+  return nonce;
+}
+
+void Outbox::SetOnline(bool online) {
+  if (online_ == online) return;
+  online_ = online;
+  if (!online && retry_timer_) {
+    // Backoffs still hold; the next Ready's Flush re-arms the timer
+    timers_.Cancel(retry_timer_);
+    retry_timer_ = 0;
+  }
+  if (online && !entries_.empty()) {
+    LOG_INFO("📮 Connection ready, flushing " << entries_.size() << " queued messages");
+  }
+  Flush();
+}
+
+void Outbox::Flush() {
+  if (!online_) return;
+  auto now = std::chrono::steady_clock::now();
+  auto next_retry = std::chrono::steady_clock::time_point::max();
+  // Marked first, submitted after: a submit may settle synchronously. A
+  // message backing off holds back everything still queued after it to the
+  // same destination; what the pipeline already has goes on regardless.
+  std::vector<std::string> ready;
+  std::vector<SendDestination> backing_off;
+  for (Entry& entry : entries_) {
+    if (entry.state != OutboxState::Queued) continue;
+    bool held = std::any_of(backing_off.begin(), backing_off.end(), [&](const SendDestination& destination) {
+      return destination.target == entry.destination.target && destination.id == entry.destination.id;
+    });
+    if (held) continue;
+    if (entry.retry_at > now) {
+      backing_off.push_back(entry.destination);
+      next_retry = std::min(next_retry, entry.retry_at);
+      continue;
+    }
+    Transition(entry, OutboxState::Sending, nullptr);
+    ready.push_back(entry.nonce);
+  }
+  if (!backing_off.empty()) ScheduleRetry(next_retry);
+  for (const std::string& nonce : ready) {
+    auto it = by_nonce_.find(nonce);
+    if (it == by_nonce_.end() || it->second->state != OutboxState::Sending) continue;
+    Entry& entry = *it->second;
+    submit_(entry.nonce, entry.destination, entry.content);
+  }
+}
+
+void Outbox::ScheduleRetry(std::chrono::steady_clock::time_point at) {
+  if (retry_timer_ && retry_timer_at_ <= at) return;
+  if (retry_timer_) timers_.Cancel(retry_timer_);
+  retry_timer_at_ = at;
+  uint64_t delay_ms = MillisUntil(at, std::chrono::steady_clock::now());
+  retry_timer_ = timers_.Schedule(static_cast<uint32_t>(delay_ms), [this]() {
+    run_locked_([this]() {
+      retry_timer_ = 0;
+      Flush();
+    });
+  });
+}
+
+void Outbox::OnResult(const std::string& nonce, const SendResult& result) {
+  auto found = by_nonce_.find(nonce);
+  if (found == by_nonce_.end()) return;
+  auto it = found->second;
+  if (it->state != OutboxState::Sending) return;
+
+  if (result.ok) {
+    Settle(it, result);
+    return;
+  }
+
+  // Failures caused by going offline do not count against the message
+  if (result.retryable && online_) it->attempts++;
+  if (result.retryable && it->attempts < options_.max_attempts) {
+    METRIC_COUNTER("outbox.requeued").Add();
+    if (online_) {
+      uint32_t delay_ms = RetryDelayMs(options_, it->attempts, rng_);
+      it->retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+      LOG_DEBUG("📮 Send " << nonce << " failed (" << result.error << "), retrying in " << delay_ms << "ms");
+    }
+    Transition(*it, OutboxState::Queued, &result);
+    Flush();
+    return;
+  }
+  Settle(it, result);
+}
+
+void Outbox::Settle(EntryList::iterator it, const SendResult& result) {
+  Entry entry = std::move(*it);
+  by_nonce_.erase(entry.nonce);
+  entries_.erase(it);
+  METRIC_GAUGE("outbox.pending").Set(static_cast<int64_t>(entries_.size()));
+
+  if (result.ok) {
+    sent_++;
+    METRIC_HISTOGRAM("outbox.delivery_us").Record(ElapsedMicros(entry.queued_at));
+    RememberSent(entry.nonce, result.message_id);
+    if (log_.IsOpen()) {
+      std::string record = RecordHeader(kSent, entry.nonce);
+      PutInt(record, result.message_id, 8);
+      log_.Append(std::move(record));
+    }
+  } else {
+    failed_++;
+    METRIC_COUNTER("outbox.failed").Add();
+    FlightRecorder::Instance().Record(FlightEvent::Error, "OutboxFailed", entry.attempts);
+    if (log_.IsOpen()) {
+      log_.Append(RecordHeader(kFailed, entry.nonce));
+    }
+  }
+  Transition(entry, result.ok ? OutboxState::Sent : OutboxState::Failed, &result);
+
+  for (SendDone& waiter : entry.waiters) {
+    waiter(result);
+  }
+  MaybeCompact();
+}
+
+void Outbox::Transition(Entry& entry, OutboxState state, const SendResult* result) {
+  entry.state = state;
+  NativeEvent event("outboxState");
+  event.String("nonce", entry.nonce)
+      .String("state", OutboxStateName(state))
+      .String("destination", entry.destination.target == SendTarget::User ? "user" : "lobby")
+      .String("targetId", std::to_string(entry.destination.id))
+      .Number("attempts", entry.attempts);
+  uint64_t retry_in_ms = MillisUntil(entry.retry_at, std::chrono::steady_clock::now());
+  if (state == OutboxState::Queued && retry_in_ms) event.Number("retryInMs", static_cast<double>(retry_in_ms));
+  if (result && result->ok) {
+    event.String("messageId", std::to_string(result->message_id));
+  } else if (result) {
+    event.String("error", result->error);
+  }
+  EmitEvent(std::move(event));
+}
+
+void Outbox::RememberSent(const std::string& nonce, uint64_t message_id) {
+  if (options_.remember_sent == 0) return;
+  if (sent_ids_.emplace(nonce, message_id).second) {
+    sent_order_.push_back(nonce);
+  }
+  while (sent_order_.size() > options_.remember_sent) {
+    sent_ids_.erase(sent_order_.front());
+    sent_order_.pop_front();
+  }
+}
+
+void Outbox::MaybeCompact() {
+  if (!log_.IsOpen() || log_.Bytes() < options_.compact_bytes) return;
+  // Only worth it once most records describe settled messages
+  size_t live = entries_.size() + sent_order_.size();
+  if (log_.Records() < live * 2) return;
+
+  std::vector<std::string> records;
+  records.reserve(live);
+  for (const std::string& nonce : sent_order_) {
+    std::string record = RecordHeader(kSent, nonce);
+    PutInt(record, sent_ids_[nonce], 8);
+    records.push_back(std::move(record));
+  }
+  for (const Entry& entry : entries_) {
+    records.push_back(EnqueueRecord(entry.nonce, entry.destination, entry.created_ms, entry.content));
+  }
+  LOG_DEBUG("📮 Compacting outbox: " << log_.Records() << " records -> " << records.size());
+  log_.Rewrite(std::move(records));
+}
+
+bool Outbox::Sync(std::chrono::steady_clock::time_point deadline) {
+  return !log_.IsOpen() || log_.Sync(deadline);
+}
+
+OutboxStatus Outbox::Status() {
+  auto now = std::chrono::steady_clock::now();
+  OutboxStatus status;
+  status.persistent = log_.IsOpen();
+  status.path = status.persistent ? log_.Path() : "";
+  status.file_bytes = status.persistent ? log_.Bytes() : 0;
+  status.sent = sent_;
+  status.failed = failed_;
+  status.deduped = deduped_;
+  for (const Entry& entry : entries_) {
+    status.messages.push_back({ entry.nonce, entry.destination, entry.state, entry.attempts,
+                                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    now - entry.queued_at).count()),
+                                entry.state == OutboxState::Queued ? MillisUntil(entry.retry_at, now) : 0 });
+  }
+  return status;
+}
@@ -0,0 +1,135 @@
+#ifndef DISCORD_OUTBOX_H
+#define DISCORD_OUTBOX_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "record_log.h"
+#include "send_pipeline.h"
+#include "timer_queue.h"
+
+enum class OutboxState { Queued, Sending, Sent, Failed };
+
+const char* OutboxStateName(OutboxState state);
+
+struct OutboxOptions {
+  uint32_t max_pending = 1000;
+  uint32_t max_attempts = 5;         // retryable failures while online before giving up
+  uint32_t retry_base_ms = 1000;     // first retry after an online failure waits between half and all of this
+  uint32_t retry_max_ms = 30000;     // cap for the doubling delay
+  uint32_t remember_sent = 1000;     // sent nonces kept (and persisted) for dedupe
+  uint64_t compact_bytes = 1 << 20;  // rewrite the file past this size once it is mostly settled
+  RecordLogOptions log;
+};
+
+struct OutboxMessage {
+  std::string nonce;
+  SendDestination destination;
+  OutboxState state;
+  uint32_t attempts;
+  uint64_t age_ms;
+  uint64_t retry_in_ms;  // left on a backoff, 0 if none
+};
+
+struct OutboxStatus {
+  bool persistent;
+  std::string path;
+  uint64_t file_bytes;
+  uint64_t sent;
+  uint64_t failed;
+  uint64_t deduped;
+  std::vector<OutboxMessage> messages;  // oldest first
+};
+
+// Messages waiting to be sent, in order. Sends are accepted whether or not the
+// client is connected; while online, queued messages are handed to the send
+// pipeline in order. A transient failure caused by going offline puts a
+// message back in the queue for the next Ready; one while online is retried
+// after a jittered, doubling delay. Later messages to the same destination
+// that are still queued wait behind it; ones already handed to the pipeline
+// are not recalled and may land first. With a file open, every enqueue and
+// outcome is appended to a RecordLog (batched fsync), so messages queued at
+// exit are restored and sent by the next session. A caller-chosen nonce makes
+// a resend idempotent: a nonce still queued joins the pending send, one
+// already sent settles with the original message ID.
+//
+// Like ConnectionManager, every method requires the client state lock, and
+// the retry timer re-enters through run_locked.
+class Outbox {
+public:
+  using SubmitFn = std::function<void(const std::string& nonce, const SendDestination& destination,
+                                      const std::string& content)>;
+  using LockedRunner = std::function<void(std::function<void()>)>;
+
+  Outbox(TimerQueue& timers, LockedRunner run_locked, SubmitFn submit);
+
+  void Configure(const OutboxOptions& options) { options_ = options; }
+  OutboxOptions Options() const { return options_; }
+
+  // Restores unsent messages from path (creating it if needed); returns how many
+  // were restored, or -1 with error set
+  int Open(const std::string& path, std::string* error);
+  void Close();
+
+  // done settles once the message is sent or given up on. An empty nonce gets a
+  // generated one; the nonce in use is returned.
+  std::string Enqueue(std::string nonce, const SendDestination& destination, std::string content, SendDone done);
+  void OnResult(const std::string& nonce, const SendResult& result);
+
+  // Online = the connection is Ready; going online flushes the queue
+  void SetOnline(bool online);
+
+  bool Sync(std::chrono::steady_clock::time_point deadline);
+  OutboxStatus Status();
+
+private:
+  struct Entry {
+    std::string nonce;
+    SendDestination destination;
+    std::string content;
+    uint64_t created_ms;  // wall clock, survives restarts
+    std::chrono::steady_clock::time_point queued_at;
+    OutboxState state = OutboxState::Queued;
+    uint32_t attempts = 0;
+    std::chrono::steady_clock::time_point retry_at{};  // not resubmitted before this
+    std::vector<SendDone> waiters;
+  };
+  using EntryList = std::list<Entry>;
+
+  void Flush();
+  void ScheduleRetry(std::chrono::steady_clock::time_point at);
+  void Settle(EntryList::iterator it, const SendResult& result);
+  void Transition(Entry& entry, OutboxState state, const SendResult* result);
+  void RememberSent(const std::string& nonce, uint64_t message_id);
+  void MaybeCompact();
+  void Replay(const std::string& record, EntryList& restored,
+              std::unordered_map<std::string, EntryList::iterator>& index);
+
+  TimerQueue& timers_;
+  LockedRunner run_locked_;
+  SubmitFn submit_;
+  OutboxOptions options_;
+  RecordLog log_;
+  bool online_ = false;
+  uint64_t retry_timer_ = 0;
+  std::chrono::steady_clock::time_point retry_timer_at_{};
+  std::mt19937_64 rng_;
+  uint64_t nonce_counter_ = 0;
+
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> by_nonce_;
+  std::deque<std::string> sent_order_;  // oldest first, bounded by remember_sent
+  std::unordered_map<std::string, uint64_t> sent_ids_;
+
+  uint64_t sent_ = 0;
+  uint64_t failed_ = 0;
+  uint64_t deduped_ = 0;
+};
+
+#endif // DISCORD_OUTBOX_H
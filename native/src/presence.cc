@@ -0,0 +1,156 @@
+#include "presence.h"
+#include "events.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+
+std::vector<std::string> DiffPresence(const PresenceActivity& from, const PresenceActivity& to) {
+  std::vector<std::string> changed;
+  if (from.cleared != to.cleared) changed.push_back("cleared");
+  if (from.details != to.details) changed.push_back("details");
+  if (from.state != to.state) changed.push_back("state");
+  if (from.start_ms != to.start_ms) changed.push_back("startTimestamp");
+  if (from.large_image != to.large_image) changed.push_back("largeImageKey");
+  if (from.large_text != to.large_text) changed.push_back("largeImageText");
+  if (from.small_image != to.small_image) changed.push_back("smallImageKey");
+  if (from.small_text != to.small_text) changed.push_back("smallImageText");
+  return changed;
+}
+
+static bool SamePresence(const PresenceActivity& a, const PresenceActivity& b) {
+  // Field values are irrelevant once both are cleared
+  if (a.cleared && b.cleared) return true;
+  return DiffPresence(a, b).empty();
+}
+
+PresenceEngine::PresenceEngine(TimerQueue& timers, ConnectionManager::LockedRunner run_locked, IssueFn issue)
+    : timers_(timers), run_locked_(std::move(run_locked)), issue_(std::move(issue)) {}
+
+bool PresenceEngine::Set(const PresenceActivity& activity) {
+  requested_++;
+  if (SamePresence(activity, desired_)) {
+    skipped_++;
+    METRIC_COUNTER("presence.skipped").Add();
+    return false;
+  }
+  if (dirty_) {
+    // The previous request never went out
+    coalesced_++;
+    coalesced_since_issue_++;
+    METRIC_COUNTER("presence.coalesced").Add();
+  }
+  desired_ = activity;
+  dirty_ = !SamePresence(desired_, Target());
+  MaybeFlush();
+  return true;
+}
+
+void PresenceEngine::MaybeFlush() {
+  if (!online_ || in_flight_ || !dirty_) return;
+  auto now = Clock::now();
+  if (now < next_allowed_) {
+    ScheduleFlush(next_allowed_);
+    return;
+  }
+  Issue();
+}
+
+void PresenceEngine::Issue() {
+  CancelTimer();
+  std::vector<std::string> changed = DiffPresence(applied_, desired_);
+  sending_ = desired_;
+  dirty_ = false;
+  in_flight_ = true;
+  in_flight_id_ = next_id_++;
+  issued_at_ = Clock::now();
+  next_allowed_ = issued_at_ + std::chrono::milliseconds(options_.min_interval_ms);
+  LOG_DEBUG("🎮 Updating rich presence (" << changed.size() << " fields, " << coalesced_since_issue_
+            << " coalesced)");
+  issue_(in_flight_id_, sending_);
+}
+
+void PresenceEngine::OnComplete(uint64_t update_id, bool ok, const std::string& error, uint32_t retry_after_ms) {
+  if (!in_flight_ || update_id != in_flight_id_) return;  // forgotten by SetOnline(false)
+  in_flight_ = false;
+  auto now = Clock::now();
+  uint64_t latency_us = ElapsedMicros(issued_at_);
+
+  NativeEvent event("presenceUpdated");
+  event.Bool("ok", ok)
+      .Bool("cleared", sending_.cleared)
+      .StringList("changed", DiffPresence(applied_, sending_))
+      .Number("coalesced", coalesced_since_issue_)
+      .Number("latencyMs", latency_us / 1000.0);
+  coalesced_since_issue_ = 0;
+
+  if (ok) {
+    applied_ = sending_;
+    failures_ = 0;
+    sent_++;
+    METRIC_COUNTER("presence.sent").Add();
+    METRIC_HISTOGRAM("presence.update_us").Record(latency_us);
+  } else {
+    failures_++;
+    failed_++;
+    METRIC_COUNTER("presence.failed").Add();
+    LOG_WARN("⚠️  Rich presence update failed: " << error);
+    event.String("error", error);
+    // A server pause wins; otherwise back off so a persistent error is not hammered
+    uint64_t delay_ms = retry_after_ms;
+    if (!delay_ms) {
+      delay_ms = static_cast<uint64_t>(options_.min_interval_ms) << std::min<uint32_t>(failures_, 8);
+      delay_ms = std::min<uint64_t>(delay_ms, options_.max_retry_delay_ms);
+    }
+    next_allowed_ = std::max(next_allowed_, now + std::chrono::milliseconds(delay_ms));
+  }
+  EmitEvent(std::move(event));
+
+  dirty_ = !SamePresence(desired_, applied_);
+  MaybeFlush();
+}
+
+void PresenceEngine::SetOnline(bool online) {
+  if (online_ == online) return;
+  online_ = online;
+  if (!online) {
+    CancelTimer();
+    in_flight_ = false;
+    dirty_ = !SamePresence(desired_, applied_);
+    return;
+  }
+  // Whatever the last session had is gone
+  applied_ = PresenceActivity();
+  dirty_ = !SamePresence(desired_, applied_);
+  MaybeFlush();
+}
+
+void PresenceEngine::ScheduleFlush(Clock::time_point at) {
+  if (timer_ && timer_at_ <= at) return;
+  CancelTimer();
+  auto delay_us = std::chrono::duration_cast<std::chrono::microseconds>(at - Clock::now()).count();
+  uint32_t delay_ms = static_cast<uint32_t>(std::max<int64_t>(1, (delay_us + 999) / 1000));
+  uint64_t generation = generation_;
+  timer_at_ = at;
+  timer_ = timers_.Schedule(delay_ms, [this, generation]() {
+    run_locked_([this, generation]() {
+      if (generation != generation_) return;
+      timer_ = 0;
+      MaybeFlush();
+    });
+  });
+}
+
+void PresenceEngine::CancelTimer() {
+  generation_++;
+  if (timer_) timers_.Cancel(timer_);
+  timer_ = 0;
+}
+
+PresenceStatus PresenceEngine::Status() const {
+  auto now = Clock::now();
+  uint64_t next_ms = next_allowed_ > now
+      ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(next_allowed_ - now).count())
+      : 0;
+  return { online_, in_flight_, dirty_ || in_flight_, next_ms, requested_, sent_, coalesced_, skipped_, failed_,
+           applied_ };
+}
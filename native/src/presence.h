@@ -0,0 +1,112 @@
+#ifndef DISCORD_PRESENCE_H
+#define DISCORD_PRESENCE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "connection.h"
+#include "timer_queue.h"
+
+// What the user is doing, as shown on their profile. cleared = no activity.
+struct PresenceActivity {
+  bool cleared = true;
+  std::string details;
+  std::string state;
+  uint64_t start_ms = 0;  // Unix epoch milliseconds; 0 = no elapsed timer
+  std::string large_image;
+  std::string large_text;
+  std::string small_image;
+  std::string small_text;
+};
+
+// Names of the fields that differ, empty if the two are the same
+std::vector<std::string> DiffPresence(const PresenceActivity& from, const PresenceActivity& to);
+
+struct PresenceOptions {
+  uint32_t min_interval_ms = 4000;     // Discord accepts about 5 presence updates per 20 s
+  uint32_t max_retry_delay_ms = 60000; // backoff cap after failed updates
+};
+
+struct PresenceStatus {
+  bool online;
+  bool in_flight;
+  bool pending;            // the latest request is not applied yet
+  uint64_t next_update_ms; // until the next update may go out
+  uint64_t requested;
+  uint64_t sent;
+  uint64_t coalesced;      // requests replaced before they went out
+  uint64_t skipped;        // requests that changed nothing
+  uint64_t failed;
+  PresenceActivity applied;
+};
+
+// Rate-limited rich presence. Editors report activity far faster than Discord
+// takes it, so only the latest request is kept: the first change after a quiet
+// period goes out at once, later ones wait for min_interval_ms and are
+// coalesced into one trailing update. Requests identical to the latest one are
+// dropped, and an update is only sent when it differs from what Discord has.
+// One update is in flight at a time.
+//
+// Like ConnectionManager, every method requires the client state lock, and
+// the flush timer re-enters through run_locked.
+class PresenceEngine {
+public:
+  // Hands one update to the SDK; the owner reports back through OnComplete
+  // with the same update_id
+  using IssueFn = std::function<void(uint64_t update_id, const PresenceActivity& activity)>;
+
+  PresenceEngine(TimerQueue& timers, ConnectionManager::LockedRunner run_locked, IssueFn issue);
+
+  void Configure(const PresenceOptions& options) { options_ = options; }
+  PresenceOptions Options() const { return options_; }
+
+  // False if it changes nothing
+  bool Set(const PresenceActivity& activity);
+  void OnComplete(uint64_t update_id, bool ok, const std::string& error, uint32_t retry_after_ms);
+
+  // A new session starts without presence, so going online re-sends the
+  // latest activity; going offline forgets the update in flight
+  void SetOnline(bool online);
+  PresenceStatus Status() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void MaybeFlush();
+  void Issue();
+  void ScheduleFlush(Clock::time_point at);
+  void CancelTimer();
+  const PresenceActivity& Target() const { return in_flight_ ? sending_ : applied_; }
+
+  TimerQueue& timers_;
+  ConnectionManager::LockedRunner run_locked_;
+  IssueFn issue_;
+  PresenceOptions options_;
+
+  bool online_ = false;
+  PresenceActivity desired_;   // latest request
+  PresenceActivity sending_;   // update in flight
+  PresenceActivity applied_;   // what Discord has
+  bool dirty_ = false;         // desired_ differs from Target()
+  bool in_flight_ = false;
+  uint64_t in_flight_id_ = 0;
+  uint64_t next_id_ = 1;
+  Clock::time_point issued_at_;
+  Clock::time_point next_allowed_;
+  uint32_t failures_ = 0;      // consecutive
+  uint32_t coalesced_since_issue_ = 0;
+
+  uint64_t timer_ = 0;
+  Clock::time_point timer_at_;
+  uint64_t generation_ = 0;    // bumped when the timer is cancelled
+
+  uint64_t requested_ = 0;
+  uint64_t sent_ = 0;
+  uint64_t coalesced_ = 0;
+  uint64_t skipped_ = 0;
+  uint64_t failed_ = 0;
+};
+
+#endif // DISCORD_PRESENCE_H
@@ -0,0 +1,386 @@
+#include "record_log.h"
+#include "logger.h"
+#include "metrics.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#define RL_OPEN_APPEND(path) _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define RL_OPEN_TRUNC(path) _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define RL_WRITE _write
+#define RL_CLOSE _close
+#define RL_SYNC _commit
+#define RL_TRUNCATE _chsize_s
+#else
+#include <unistd.h>
+#define RL_OPEN_APPEND(path) open(path, O_WRONLY | O_CREAT | O_APPEND, 0600)
+#define RL_OPEN_TRUNC(path) open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)
+#define RL_WRITE write
+#define RL_CLOSE close
+#define RL_SYNC fsync
+#define RL_TRUNCATE ftruncate
+#endif
+
+static const char kMagic[8] = { 'D', 'L', 'R', 'L', 'v', '1', 0, 0 };
+static const size_t kFrameHeader = 8;          // u32 length, u32 crc
+static const uint32_t kMaxRecord = 16 << 20;   // anything larger is corruption
+static const uint32_t kRetryDelayMs = 500;      // after a failed write
+
+uint32_t Crc32(const char* data, size_t size) {
+  static uint32_t table[256];
+  static bool built = [] {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    return true;
+  }();
+  (void)built;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static void PutU32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static uint32_t GetU32(const char* p) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+  return value;
+}
+
+static void Frame(std::string& out, const std::string& record) {
+  PutU32(out, static_cast<uint32_t>(record.size()));
+  PutU32(out, Crc32(record.data(), record.size()));
+  out += record;
+}
+
+static bool WriteAll(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    auto written = RL_WRITE(fd, data.data() + offset, static_cast<unsigned>(data.size() - offset));
+    if (written <= 0) return false;
+    offset += static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// A new or renamed file is only durable once its directory entry is
+static void SyncParentDir(const std::string& path) {
+#ifndef _WIN32
+  size_t slash = path.find_last_of('/');
+  std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  int fd = open(dir.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  fsync(fd);
+  close(fd);
+#endif
+}
+
+// Visits frames from offset on, stopping before to or at the first one that is
+// cut short or fails its checksum; returns the offset just past the last visited
+static uint64_t ScanFrames(FILE* file, uint64_t offset, uint64_t to, const RecordLog::OffsetVisitor& visit) {
+  if (offset < sizeof(kMagic)) offset = sizeof(kMagic);
+  if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0) return offset;
+  char header[kFrameHeader];
+  std::string body;
+  while (offset < to && std::fread(header, 1, kFrameHeader, file) == kFrameHeader) {
+    uint32_t length = GetU32(header);
+    uint32_t crc = GetU32(header + 4);
+    if (length > kMaxRecord) break;
+    body.resize(length);
+    if (std::fread(&body[0], 1, length, file) != length || Crc32(body.data(), length) != crc) break;
+    visit(offset, body);
+    offset += kFrameHeader + length;
+  }
+  return offset;
+}
+
+RecordLog::~RecordLog() {
+  Close();
+}
+
+bool RecordLog::Open(const std::string& path, const RecordLogOptions& options, const Visitor& visit,
+                     std::string* error, uint64_t from) {
+  Close();
+
+  uint64_t size = 0;
+  uint64_t offset = sizeof(kMagic);
+  uint64_t records = 0;
+  if (FILE* file = std::fopen(path.c_str(), "rb")) {
+    char magic[sizeof(kMagic)];
+    size_t got = std::fread(magic, 1, sizeof(magic), file);
+    if (std::memcmp(magic, kMagic, got) != 0) {
+      std::fclose(file);
+      if (error) *error = "Not a record log: " + path;
+      return false;
+    }
+    // A prefix of the header is a file created just before a crash: start it over
+    if (got > 0 && got < sizeof(kMagic)) {
+      LOG_WARN("⚠️  " << path << " has a torn header; starting it over");
+      METRIC_COUNTER("recordlog.truncated").Add();
+    }
+    if (got == sizeof(kMagic)) {
+      std::fseek(file, 0, SEEK_END);
+      size = static_cast<uint64_t>(std::ftell(file));
+      // The hint is only trusted if it leads cleanly to the end of the file. A
+      // stale one can point mid-frame, and a scan that stops early from there
+      // says nothing about where the torn tail starts: replay everything instead.
+      std::vector<std::string> tail;
+      bool replay_all = from <= sizeof(kMagic) || from > size;
+      if (!replay_all) {
+        offset = ScanFrames(file, from, UINT64_MAX, [&](uint64_t, const std::string& record) {
+          tail.push_back(record);
+        });
+        if (offset != size) {
+          LOG_WARN("⚠️  Replaying all of " << path << ": offset " << from << " does not lead to a clean end");
+          METRIC_COUNTER("recordlog.full_replays").Add();
+          replay_all = true;
+        }
+      }
+      if (replay_all) {
+        tail.clear();
+        offset = ScanFrames(file, 0, UINT64_MAX, [&](uint64_t, const std::string& record) {
+          visit(record);
+          records++;
+        });
+      } else {
+        for (const std::string& record : tail) {
+          visit(record);
+        }
+        records = tail.size();
+      }
+    }
+    std::fclose(file);
+  }
+  bool fresh = size == 0;
+
+  int fd = RL_OPEN_APPEND(path.c_str());
+  if (fd < 0) {
+    if (error) *error = "Cannot open " + path;
+    return false;
+  }
+  if (fresh) {
+    if (RL_TRUNCATE(fd, 0) != 0 || !WriteAll(fd, std::string(kMagic, sizeof(kMagic))) || RL_SYNC(fd) != 0) {
+      RL_CLOSE(fd);
+      if (error) *error = "Cannot write " + path;
+      return false;
+    }
+    SyncParentDir(path);
+  } else if (offset < size) {
+    LOG_WARN("⚠️  Truncating " << size - offset << " torn bytes from " << path);
+    METRIC_COUNTER("recordlog.truncated").Add();
+    if (RL_TRUNCATE(fd, static_cast<long>(offset)) != 0) {
+      LOG_WARN("⚠️  Could not truncate " << path << "; new records follow the torn tail");
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  path_ = path;
+  options_ = options;
+  fd_ = fd;
+  bytes_ = offset;
+  durable_bytes_ = offset;
+  records_ = records;
+  running_ = true;
+  thread_ = std::thread(&RecordLog::Loop, this);
+  return true;
+}
+
+void RecordLog::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+    running_ = false;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) thread_.join();  // the loop writes what is left before exiting
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ >= 0) RL_CLOSE(fd_);
+  fd_ = -1;
+}
+
+bool RecordLog::IsOpen() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_;
+}
+
+std::string RecordLog::Path() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return path_;
+}
+
+uint64_t RecordLog::Append(std::string record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_) return 0;
+  uint64_t offset = bytes_;
+  size_t before = buffer_.size();
+  Frame(buffer_, record);
+  bytes_ += buffer_.size() - before;
+  records_++;
+  buffered_++;
+  appended_seq_++;
+  if (buffered_ == 1 || buffered_ >= options_.sync_batch) cv_.notify_all();
+  return offset;
+}
+
+void RecordLog::Rewrite(std::vector<std::string> records, std::vector<uint64_t>* offsets) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_) return;
+  // Everything buffered so far is superseded by the new contents
+  rewrite_.clear();
+  for (const std::string& record : records) {
+    if (offsets) offsets->push_back(sizeof(kMagic) + rewrite_.size());
+    Frame(rewrite_, record);
+  }
+  rewrite_pending_ = true;
+  buffer_.clear();
+  buffered_ = 0;
+  bytes_ = sizeof(kMagic) + rewrite_.size();
+  records_ = records.size();
+  appended_seq_++;
+  cv_.notify_all();
+}
+
+bool RecordLog::Sync(std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t target = appended_seq_;
+  if (synced_seq_ >= target) return true;
+  sync_requested_ = true;
+  cv_.notify_all();
+  // A failed attempt at the write that covers target wakes us with false; the
+  // writer retries it, so a later Sync() may still succeed
+  uint64_t failures = failures_;
+  synced_cv_.wait_until(lock, deadline, [&] {
+    return synced_seq_ >= target || (failures_ != failures && failed_seq_ >= target) || !running_;
+  });
+  return synced_seq_ >= target;
+}
+
+uint64_t RecordLog::Bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+uint64_t RecordLog::Records() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return records_;
+}
+
+bool RecordLog::Read(const std::string& path, uint64_t from, uint64_t to, const OffsetVisitor& visit) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+  char magic[sizeof(kMagic)];
+  bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+            std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  if (ok) ScanFrames(file, from, to, visit);
+  std::fclose(file);
+  return ok;
+}
+
+void RecordLog::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    cv_.wait(lock, [&] { return !running_ || buffered_ > 0 || rewrite_pending_ || synced_seq_ < appended_seq_; });
+    if (!running_) break;
+    // Group commit: give more appends a chance to share this fsync, unless
+    // someone is already waiting on it
+    cv_.wait_for(lock, std::chrono::milliseconds(options_.sync_interval_ms), [&] {
+      return !running_ || buffered_ >= options_.sync_batch || rewrite_pending_ || sync_requested_;
+    });
+    if (!WriteBatch(lock)) {
+      cv_.wait_for(lock, std::chrono::milliseconds(kRetryDelayMs), [&] { return !running_; });
+    }
+  }
+  if (!WriteBatch(lock)) {
+    LOG_ERROR("❌ Closing " << path_ << " with unwritten records");
+  }
+}
+
+bool RecordLog::WriteBatch(std::unique_lock<std::mutex>& lock) {
+  sync_requested_ = false;
+  if (buffered_ == 0 && !rewrite_pending_) {
+    synced_seq_ = appended_seq_;
+    synced_cv_.notify_all();
+    return true;
+  }
+  std::string buffer;
+  buffer.swap(buffer_);
+  uint32_t buffered = buffered_;
+  buffered_ = 0;
+  bool rewrite = rewrite_pending_;
+  std::string body;
+  body.swap(rewrite_);
+  rewrite_pending_ = false;
+  uint64_t target = appended_seq_;
+  uint64_t durable = durable_bytes_;
+  std::string path = path_;
+  int fd = fd_;
+  lock.unlock();
+
+  auto started = std::chrono::steady_clock::now();
+  bool ok;
+  if (rewrite) {
+    std::string temp = path + ".tmp";
+    int temp_fd = RL_OPEN_TRUNC(temp.c_str());
+    ok = temp_fd >= 0 && WriteAll(temp_fd, std::string(kMagic, sizeof(kMagic)) + body + buffer) &&
+         RL_SYNC(temp_fd) == 0;
+    if (temp_fd >= 0) RL_CLOSE(temp_fd);
+#ifdef _WIN32
+    ok = ok && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && std::rename(temp.c_str(), path.c_str()) == 0;
+#endif
+    if (ok) {
+      SyncParentDir(path);
+      durable = sizeof(kMagic) + body.size() + buffer.size();
+      // The old descriptor points at the replaced file; if reopening fails,
+      // the next batch tries again
+      if (fd >= 0) RL_CLOSE(fd);
+      fd = RL_OPEN_APPEND(path.c_str());
+    }
+    METRIC_COUNTER("recordlog.rewrites").Add();
+  } else {
+    if (fd < 0) fd = RL_OPEN_APPEND(path.c_str());
+    ok = fd >= 0 && WriteAll(fd, buffer) && RL_SYNC(fd) == 0;
+    if (ok) {
+      durable += buffer.size();
+    } else if (fd >= 0) {
+      RL_TRUNCATE(fd, static_cast<long>(durable));  // no half-written frame ahead of the retry
+    }
+  }
+  METRIC_HISTOGRAM("recordlog.sync_us").Record(ElapsedMicros(started));
+
+  lock.lock();
+  fd_ = fd;
+  if (ok) {
+    durable_bytes_ = durable;
+    synced_seq_ = target;
+  } else {
+    METRIC_COUNTER("recordlog.write_errors").Add();
+    LOG_ERROR("❌ Failed to write " << path << "; retrying in " << kRetryDelayMs << " ms");
+    // Back in front of whatever was appended since, unless a newer Rewrite()
+    // has superseded all of it
+    if (!rewrite_pending_) {
+      if (rewrite) {
+        rewrite_.swap(body);
+        rewrite_pending_ = true;
+      }
+      buffer_.insert(0, buffer);
+      buffered_ += buffered;
+    }
+    failed_seq_ = target;
+    failures_++;
+  }
+  synced_cv_.notify_all();
+  return ok;
+}
@@ -0,0 +1,92 @@
+#ifndef DISCORD_RECORD_LOG_H
+#define DISCORD_RECORD_LOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// CRC-32 (IEEE), as used to frame records
+uint32_t Crc32(const char* data, size_t size);
+
+struct RecordLogOptions {
+  uint32_t sync_interval_ms = 50;  // appends are written and fsynced together at most this late
+  uint32_t sync_batch = 64;        // ... or as soon as this many are buffered
+};
+
+// Append-only file of length + CRC32 framed records with group commit: a
+// writer thread batches appends into one write() and one fsync. Replay stops
+// at the first torn or corrupt record and truncates the file there, so a
+// crash mid-append loses at most the unsynced tail. Rewrite() swaps in a
+// compacted file atomically (write temp, fsync, rename, fsync the directory).
+// A failed write is retried after a pause; Sync() callers waiting on it are
+// told it failed rather than released as if it were durable.
+//
+// Thread-safe; Append() never waits for the disk.
+class RecordLog {
+public:
+  using Visitor = std::function<void(const std::string& record)>;
+  using OffsetVisitor = std::function<void(uint64_t offset, const std::string& record)>;
+
+  RecordLog() = default;
+  ~RecordLog();
+
+  // Opens or creates path and replays every intact record through visit.
+  // A nonzero from (an offset returned by Append) skips the records before it
+  // as known good, so only the tail is read; Records() then counts the tail.
+  bool Open(const std::string& path, const RecordLogOptions& options, const Visitor& visit, std::string* error,
+            uint64_t from = 0);
+  // Syncs what is buffered and closes the file
+  void Close();
+  bool IsOpen();
+  std::string Path();
+
+  // Returns the offset the record will occupy in the file
+  uint64_t Append(std::string record);
+  // Replaces the whole file with records; appends made after the call are kept.
+  // offsets, if given, receives where each record will be.
+  void Rewrite(std::vector<std::string> records, std::vector<uint64_t>* offsets = nullptr);
+
+  // Blocks until everything appended so far is on disk; false if the deadline
+  // passes or the write covering it failed
+  bool Sync(std::chrono::steady_clock::time_point deadline);
+
+  uint64_t Bytes();    // file size including buffered records
+  uint64_t Records();  // records in the file, including buffered ones
+
+  // Visits the intact records of a log file whose offsets fall in [from, to),
+  // without opening it for writing. Only what has been synced is visible.
+  static bool Read(const std::string& path, uint64_t from, uint64_t to, const OffsetVisitor& visit);
+
+private:
+  void Loop();
+  bool WriteBatch(std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;       // wakes the writer
+  std::condition_variable synced_cv_;
+  std::thread thread_;
+  bool running_ = false;
+  RecordLogOptions options_;
+
+  std::string path_;
+  int fd_ = -1;
+  std::string buffer_;               // framed, not yet written
+  uint32_t buffered_ = 0;
+  bool rewrite_pending_ = false;
+  std::string rewrite_;              // framed replacement file body
+  bool sync_requested_ = false;      // a Sync() caller is waiting; skip the batching window
+  uint64_t appended_seq_ = 0;        // bumped per Append/Rewrite
+  uint64_t synced_seq_ = 0;
+  uint64_t failed_seq_ = 0;          // target of the last failed write
+  uint64_t failures_ = 0;
+  uint64_t durable_bytes_ = 0;       // file size as of the last successful write
+  uint64_t bytes_ = 0;
+  uint64_t records_ = 0;
+};
+
+#endif // DISCORD_RECORD_LOG_H
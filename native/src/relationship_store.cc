@@ -0,0 +1,153 @@
+#include "relationship_store.h"
+#include "events.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+static const size_t kMaxTombstones = 4096;
+
+static std::string Fold(const std::string& text) {
+  std::string folded(text);
+  for (char& c : folded) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + 32);
+  }
+  return folded;
+}
+
+RelationshipStore::RelationshipStore(Backend backend) : backend_(std::move(backend)) {}
+
+RelationshipStore::SortKey RelationshipStore::KeyOf(const Relationship& relationship) {
+  return { Fold(relationship.display_name), relationship.user_id };
+}
+
+bool RelationshipStore::NameMatches(const Relationship& relationship, const std::string& folded) {
+  return folded.empty() || Fold(relationship.display_name).find(folded) != std::string::npos ||
+         Fold(relationship.username).find(folded) != std::string::npos;
+}
+
+size_t RelationshipStore::Sync() {
+  auto started = std::chrono::steady_clock::now();
+  std::vector<uint64_t> ids = backend_.list_ids();
+  std::unordered_set<uint64_t> present(ids.begin(), ids.end());
+
+  std::vector<uint64_t> gone;
+  for (const auto& entry : entries_) {
+    if (!present.count(entry.first)) gone.push_back(entry.first);
+  }
+  for (uint64_t user_id : gone) Remove(user_id);
+  for (uint64_t user_id : ids) Refresh(user_id);
+
+  METRIC_HISTOGRAM("relationships.sync_us").Record(ElapsedMicros(started));
+  LOG_DEBUG("👥 Relationships synced: " << entries_.size() << " (" << gone.size() << " gone)");
+  return entries_.size();
+}
+
+void RelationshipStore::Refresh(uint64_t user_id) {
+  Relationship relationship{ user_id, RelationshipKind::Other, "", "", FriendStatus::Offline, 0 };
+  METRIC_COUNTER("relationships.reads").Add();
+  if (!backend_.read(user_id, relationship)) {
+    Remove(user_id);
+    return;
+  }
+  relationship.user_id = user_id;
+  Apply(std::move(relationship));
+}
+
+void RelationshipStore::Apply(Relationship relationship) {
+  auto it = entries_.find(relationship.user_id);
+  if (it != entries_.end()) {
+    const Relationship& current = it->second;
+    if (current.kind == relationship.kind && current.status == relationship.status &&
+        current.username == relationship.username && current.display_name == relationship.display_name) {
+      return;  // a user update that touched something we do not keep
+    }
+    by_status_[static_cast<size_t>(current.status)].erase(KeyOf(current));
+    by_version_.erase(current.version);
+  }
+  relationship.version = ++version_;
+  by_status_[static_cast<size_t>(relationship.status)].insert(KeyOf(relationship));
+  by_version_[relationship.version] = relationship.user_id;
+  entries_[relationship.user_id] = std::move(relationship);
+  METRIC_GAUGE("relationships.count").Set(static_cast<int64_t>(entries_.size()));
+}
+
+void RelationshipStore::Remove(uint64_t user_id) {
+  auto it = entries_.find(user_id);
+  if (it == entries_.end()) return;
+  by_status_[static_cast<size_t>(it->second.status)].erase(KeyOf(it->second));
+  by_version_.erase(it->second.version);
+  entries_.erase(it);
+
+  tombstones_.emplace_back(++version_, user_id);
+  if (tombstones_.size() > kMaxTombstones) {
+    forgotten_ = tombstones_.front().first;
+    tombstones_.pop_front();
+  }
+  METRIC_GAUGE("relationships.count").Set(static_cast<int64_t>(entries_.size()));
+}
+
+// Listeners see everything go, then come back with the next Sync()
+void RelationshipStore::Clear() {
+  std::vector<uint64_t> ids;
+  ids.reserve(entries_.size());
+  for (const auto& entry : entries_) ids.push_back(entry.first);
+  for (uint64_t user_id : ids) Remove(user_id);
+}
+
+void RelationshipStore::Flush() {
+  if (flushed_ == version_) return;
+  flushed_ = version_;
+  METRIC_COUNTER("relationships.flushes").Add();
+  EmitEvent(NativeEvent("relationshipsChanged")
+                .Number("version", static_cast<double>(version_))
+                .Number("count", static_cast<double>(entries_.size())));
+}
+
+bool RelationshipStore::Get(uint64_t user_id, Relationship& out) const {
+  auto it = entries_.find(user_id);
+  if (it == entries_.end()) return false;
+  out = it->second;
+  return true;
+}
+
+RelationshipPage RelationshipStore::List(const RelationshipFilter& filter) const {
+  RelationshipPage page{ version_, 0, {}, {} };
+  std::string name = Fold(filter.name);
+  for (size_t status = 0; status < kFriendStatuses; status++) {
+    bool wanted = filter.statuses & (1u << status);
+    for (const SortKey& key : by_status_[status]) {
+      const Relationship& relationship = entries_.at(key.second);
+      if (!(filter.kinds & (1u << static_cast<uint32_t>(relationship.kind)))) continue;
+      page.counts[status]++;
+      if (!wanted || !NameMatches(relationship, name)) continue;
+      if (page.total++ < filter.offset) continue;
+      if (filter.limit == 0 || page.relationships.size() < filter.limit) page.relationships.push_back(relationship);
+    }
+  }
+  return page;
+}
+
+RelationshipChanges RelationshipStore::Changes(uint64_t since) const {
+  RelationshipChanges changes{ version_, since < forgotten_ || since > version_, {}, {} };
+  if (changes.full) {
+    changes.changed.reserve(entries_.size());
+    for (const auto& entry : entries_) changes.changed.push_back(entry.second);
+    return changes;
+  }
+  for (auto it = by_version_.upper_bound(since); it != by_version_.end(); ++it) {
+    changes.changed.push_back(entries_.at(it->second));
+  }
+  auto first = std::upper_bound(tombstones_.begin(), tombstones_.end(), since,
+                                [](uint64_t version, const std::pair<uint64_t, uint64_t>& tombstone) {
+                                  return version < tombstone.first;
+                                });
+  for (auto it = first; it != tombstones_.end(); ++it) {
+    // Removed and back again: the entry in changed says it all
+    if (!entries_.count(it->second)) changes.removed.push_back(it->second);
+  }
+  std::sort(changes.removed.begin(), changes.removed.end());
+  changes.removed.erase(std::unique(changes.removed.begin(), changes.removed.end()), changes.removed.end());
+  return changes;
+}
@@ -0,0 +1,106 @@
+#ifndef DISCORD_RELATIONSHIP_STORE_H
+#define DISCORD_RELATIONSHIP_STORE_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class FriendStatus : uint8_t { Online = 0, Idle = 1, Dnd = 2, Offline = 3 };
+static const size_t kFriendStatuses = 4;
+
+enum class RelationshipKind : uint8_t { Friend = 0, Incoming = 1, Outgoing = 2, Blocked = 3, Other = 4 };
+
+struct Relationship {
+  uint64_t user_id;
+  RelationshipKind kind;
+  std::string username;
+  std::string display_name;  // global name, else username
+  FriendStatus status;
+  uint64_t version;  // store version of the last change
+};
+
+struct RelationshipFilter {
+  uint32_t statuses = 0xF;  // bit per FriendStatus
+  uint32_t kinds = 1;       // bit per RelationshipKind; friends only by default
+  std::string name;         // case-insensitive substring of username or display name
+  uint32_t offset = 0;
+  uint32_t limit = 0;       // 0 = all
+};
+
+struct RelationshipPage {
+  uint64_t version;
+  size_t total;  // matches before offset and limit
+  std::array<size_t, kFriendStatuses> counts;  // per status, for the kinds filter alone
+  std::vector<Relationship> relationships;    // by status, then display name
+};
+
+struct RelationshipChanges {
+  uint64_t version;
+  bool full;  // since was too old; changed holds everything and removed is empty
+  std::vector<Relationship> changed;
+  std::vector<uint64_t> removed;
+};
+
+// Friends, pending requests and blocks, read once and then kept current from
+// the relationship created / deleted and user updated callbacks, so listing
+// them is a walk over memory instead of one SDK call per friend. Entries are
+// indexed by status, each status kept sorted by display name, so "online
+// friends" is already in order.
+//
+// Every change takes the next store version. A listener that remembers the
+// version it last saw gets only what changed since (Changes()); removals are
+// remembered for the last kMaxTombstones of them. relationshipsChanged is
+// emitted at most once per Flush().
+//
+// Like ConnectionManager, every method requires the client state lock.
+class RelationshipStore {
+public:
+  struct Backend {
+    std::function<std::vector<uint64_t>()> list_ids;
+    // False if the relationship no longer exists
+    std::function<bool(uint64_t user_id, Relationship& out)> read;
+  };
+
+  explicit RelationshipStore(Backend backend);
+
+  // Re-reads every relationship (after Ready or a reconnect); returns how many there are
+  size_t Sync();
+  // Created, or the user's name or presence changed
+  void Refresh(uint64_t user_id);
+  void Remove(uint64_t user_id);
+  // The client went away
+  void Clear();
+  // Emits relationshipsChanged if anything changed since the last flush
+  void Flush();
+
+  bool Contains(uint64_t user_id) const { return entries_.count(user_id) != 0; }
+  bool Get(uint64_t user_id, Relationship& out) const;
+  RelationshipPage List(const RelationshipFilter& filter) const;
+  RelationshipChanges Changes(uint64_t since) const;
+  uint64_t Version() const { return version_; }
+  size_t Size() const { return entries_.size(); }
+
+private:
+  using SortKey = std::pair<std::string, uint64_t>;  // folded display name, user ID
+
+  void Apply(Relationship relationship);
+  static SortKey KeyOf(const Relationship& relationship);
+  static bool NameMatches(const Relationship& relationship, const std::string& folded);
+
+  Backend backend_;
+  std::map<uint64_t, Relationship> entries_;
+  std::array<std::set<SortKey>, kFriendStatuses> by_status_;
+  std::map<uint64_t, uint64_t> by_version_;  // version -> user ID, live entries only
+  std::deque<std::pair<uint64_t, uint64_t>> tombstones_;  // version, user ID; oldest first
+  uint64_t version_ = 0;
+  uint64_t forgotten_ = 0;  // newest version whose removal is no longer remembered
+  uint64_t flushed_ = 0;
+};
+
+#endif // DISCORD_RELATIONSHIP_STORE_H
@@ -0,0 +1,262 @@
+#include "request_scheduler.h"
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include <algorithm>
+#include <unordered_set>
+
+static const int kClasses = static_cast<int>(RequestPriority::Count);
+
+const char* RequestPriorityName(RequestPriority priority) {
+  switch (priority) {
+    case RequestPriority::Interactive: return "interactive";
+    case RequestPriority::Prefetch: return "prefetch";
+    case RequestPriority::Background: return "background";
+    default: return "unknown";
+  }
+}
+
+bool ParseRequestPriority(const std::string& name, RequestPriority& out) {
+  for (int p = 0; p < kClasses; p++) {
+    if (name == RequestPriorityName(static_cast<RequestPriority>(p))) {
+      out = static_cast<RequestPriority>(p);
+      return true;
+    }
+  }
+  return false;
+}
+
+RequestScheduler::RequestScheduler(TimerQueue& timers, ConnectionManager::LockedRunner run_locked)
+    : timers_(timers), run_locked_(std::move(run_locked)) {
+  Metrics& metrics = Metrics::Instance();
+  for (int p = 0; p < kClasses; p++) {
+    std::string name = RequestPriorityName(static_cast<RequestPriority>(p));
+    depth_[p] = &metrics.GetGauge("scheduler.queued." + name);
+    wait_[p] = &metrics.GetHistogram("scheduler.wait." + name + "_us");
+  }
+}
+
+void RequestScheduler::Configure(const SchedulerOptions& options) {
+  options_ = options;
+  if (options_.low_water > options_.high_water) options_.low_water = options_.high_water;
+  for (auto& entry : buckets_) {
+    if (!entry.second.custom_limit) entry.second.limit = options_.default_limit;
+  }
+  Pump();  // a higher rate may free queued work right away
+}
+
+void RequestScheduler::SetRouteLimit(const std::string& route, const RouteLimit& limit) {
+  Bucket& bucket = BucketFor(route);
+  bucket.limit = limit;
+  bucket.custom_limit = true;
+  bucket.tokens = std::min(bucket.tokens, static_cast<double>(limit.burst));
+  Pump();
+}
+
+RequestScheduler::Bucket& RequestScheduler::BucketFor(const std::string& route) {
+  auto it = buckets_.find(route);
+  if (it != buckets_.end()) return it->second;
+  Bucket& bucket = buckets_[route];
+  bucket.limit = options_.default_limit;
+  bucket.tokens = bucket.limit.burst;
+  bucket.refilled = Clock::now();
+  return bucket;
+}
+
+void RequestScheduler::Refill(Bucket& bucket, Clock::time_point now) {
+  double elapsed_s = std::chrono::duration<double>(now - bucket.refilled).count();
+  bucket.refilled = now;
+  bucket.tokens = std::min(static_cast<double>(bucket.limit.burst), bucket.tokens + elapsed_s * bucket.limit.rate_per_s);
+}
+
+bool RequestScheduler::TryTake(Bucket& bucket, RequestPriority priority, Clock::time_point now) {
+  if (now < bucket.paused_until) return false;
+  if (bucket.limit.rate_per_s <= 0) return true;  // unlimited route
+  Refill(bucket, now);
+
+  // Bulk work leaves a reserve, but never so much that it can't run at all
+  double floor = 0;
+  if (priority != RequestPriority::Interactive && bucket.limit.burst > 0) {
+    floor = std::min(options_.interactive_reserve, bucket.limit.burst - 1);
+  }
+  if (bucket.tokens < 1 + floor) return false;
+  bucket.tokens -= 1;
+  return true;
+}
+
+bool RequestScheduler::Submit(const char* route, RequestPriority priority, uint64_t key, IssueFn issue) {
+  int p = static_cast<int>(priority);
+
+  if (key != 0) {
+    for (int q = 0; q < kClasses; q++) {
+      auto& queue = queues_[q];
+      auto it = std::find_if(queue.begin(), queue.end(), [&](const Entry& entry) {
+        return entry.key == key && std::string(entry.route) == route;
+      });
+      if (it == queue.end()) continue;
+      if (q <= p) {
+        METRIC_COUNTER("scheduler.coalesced").Add();
+        return true;
+      }
+      // Already queued as bulk work and now someone is waiting on it
+      Entry promoted = std::move(*it);
+      queue.erase(it);
+      queues_[p].push_back(std::move(promoted));
+      METRIC_COUNTER("scheduler.promoted").Add();
+      Pump();
+      return true;
+    }
+  }
+
+  if (priority != RequestPriority::Interactive && queues_[p].size() >= options_.max_queued) {
+    rejected_++;
+    METRIC_COUNTER("scheduler.rejected").Add();
+    LOG_WARN("⚠️  Rejecting " << RequestPriorityName(priority) << " " << route << " request: "
+             << queues_[p].size() << " already queued");
+    EmitEvent(NativeEvent("requestRejected").String("route", route).String("priority", RequestPriorityName(priority))
+                  .Number("queued", queues_[p].size()));
+    return false;
+  }
+
+  BucketFor(route).queued++;
+  queues_[p].push_back({ route, key, std::move(issue), Clock::now() });
+  Pump();
+  return true;
+}
+
+void RequestScheduler::Pump() {
+  auto now = Clock::now();
+  std::vector<IssueFn> ready;
+  bool waiting = false;
+
+  for (int p = 0; p < kClasses; p++) {
+    auto& queue = queues_[p];
+    // Once a route is out of tokens the rest of its entries in this class wait
+    // too, so requests never overtake each other within a route
+    std::unordered_set<std::string> blocked;
+    for (auto it = queue.begin(); it != queue.end() && blocked.size() < buckets_.size();) {
+      if (!blocked.count(it->route)) {
+        Bucket& bucket = BucketFor(it->route);
+        if (TryTake(bucket, static_cast<RequestPriority>(p), now)) {
+          bucket.queued--;
+          bucket.dispatched++;
+          wait_[p]->Record(std::chrono::duration_cast<std::chrono::microseconds>(now - it->queued_at).count());
+          ready.push_back(std::move(it->issue));
+          it = queue.erase(it);
+          continue;
+        }
+        blocked.insert(it->route);
+      }
+      ++it;
+    }
+    depth_[p]->Set(static_cast<int64_t>(queue.size()));
+    waiting = waiting || !queue.empty();
+  }
+
+  if (waiting) {
+    ScheduleRefill(now);
+  }
+  UpdateBackpressure();
+
+  // Issued last: state is consistent even if an issuer submits again
+  for (auto& issue : ready) {
+    issue();
+  }
+}
+
+void RequestScheduler::ScheduleRefill(Clock::time_point now) {
+  Clock::time_point earliest = Clock::time_point::max();
+  for (auto& entry : buckets_) {
+    Bucket& bucket = entry.second;
+    if (bucket.queued == 0) continue;
+    Clock::time_point at = std::max(now, bucket.paused_until);
+    if (bucket.limit.rate_per_s > 0 && bucket.tokens < 1) {
+      auto wait = std::chrono::duration<double>((1 - bucket.tokens) / bucket.limit.rate_per_s);
+      at = std::max(at, now + std::chrono::duration_cast<Clock::duration>(wait));
+    }
+    earliest = std::min(earliest, at);
+  }
+  if (earliest == Clock::time_point::max()) return;
+  if (timer_ && timer_at_ <= earliest) return;
+
+  if (timer_) timers_.Cancel(timer_);
+  // Round up so the bucket has the token by the time the timer fires
+  auto delay_us = std::chrono::duration_cast<std::chrono::microseconds>(earliest - now).count();
+  uint32_t delay_ms = static_cast<uint32_t>(std::max<int64_t>(1, (delay_us + 999) / 1000));
+  uint64_t generation = generation_;
+  timer_at_ = earliest;
+  timer_ = timers_.Schedule(delay_ms, [this, generation]() {
+    run_locked_([this, generation]() {
+      if (generation != generation_) return;
+      timer_ = 0;
+      Pump();
+    });
+  });
+}
+
+uint32_t RequestScheduler::QueuedBulk() const {
+  return static_cast<uint32_t>(queues_[static_cast<int>(RequestPriority::Prefetch)].size() +
+                               queues_[static_cast<int>(RequestPriority::Background)].size());
+}
+
+void RequestScheduler::UpdateBackpressure() {
+  uint32_t queued = QueuedBulk();
+  bool active = backpressure_ ? queued > options_.low_water : queued >= options_.high_water;
+  if (active == backpressure_) return;
+  backpressure_ = active;
+  METRIC_GAUGE("scheduler.backpressure").Set(active ? 1 : 0);
+  LOG_INFO((active ? "🚦 Backpressure on: " : "🚦 Backpressure off: ") << queued << " bulk requests queued");
+  EmitEvent(NativeEvent("backpressure").Bool("active", active).Number("queued", queued).Number("rejected", rejected_));
+}
+
+void RequestScheduler::OnRateLimited(const std::string& route, uint32_t retry_after_ms) {
+  Bucket& bucket = BucketFor(route);
+  auto until = Clock::now() + std::chrono::milliseconds(retry_after_ms);
+  bucket.paused_until = std::max(bucket.paused_until, until);
+  bucket.tokens = 0;
+  bucket.rate_limited++;
+  METRIC_COUNTER("scheduler.rate_limited").Add();
+  FlightRecorder::Instance().Record(FlightEvent::Error, route.c_str(), retry_after_ms);
+  LOG_WARN("⚠️  Rate limited on " << route << ", pausing it for " << retry_after_ms << "ms");
+  EmitEvent(NativeEvent("rateLimited").String("route", route).Number("retryAfterMs", retry_after_ms));
+  Pump();
+}
+
+void RequestScheduler::Clear() {
+  size_t dropped = 0;
+  for (int p = 0; p < kClasses; p++) {
+    dropped += queues_[p].size();
+    queues_[p].clear();
+    depth_[p]->Set(0);
+  }
+  for (auto& entry : buckets_) {
+    entry.second.queued = 0;
+  }
+  if (timer_) timers_.Cancel(timer_);
+  timer_ = 0;
+  generation_++;
+  if (dropped) {
+    METRIC_COUNTER("scheduler.dropped").Add(dropped);
+    LOG_DEBUG("🚦 Dropped " << dropped << " queued requests");
+  }
+  UpdateBackpressure();
+}
+
+SchedulerStatus RequestScheduler::Status() {
+  auto now = Clock::now();
+  SchedulerStatus status;
+  for (int p = 0; p < kClasses; p++) {
+    status.queued[p] = static_cast<uint32_t>(queues_[p].size());
+  }
+  status.backpressure = backpressure_;
+  status.rejected = rejected_;
+  for (auto& entry : buckets_) {
+    Bucket& bucket = entry.second;
+    Refill(bucket, now);
+    uint64_t paused_ms = bucket.paused_until > now
+        ? std::chrono::duration_cast<std::chrono::milliseconds>(bucket.paused_until - now).count() : 0;
+    status.routes.push_back({ entry.first, bucket.tokens, bucket.queued, paused_ms, bucket.dispatched,
+                              bucket.rate_limited });
+  }
+  return status;
+}
@@ -0,0 +1,125 @@
+#ifndef DISCORD_REQUEST_SCHEDULER_H
+#define DISCORD_REQUEST_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "connection.h"
+#include "metrics.h"
+#include "timer_queue.h"
+
+// Lower value = served first
+enum class RequestPriority { Interactive, Prefetch, Background, Count };
+
+const char* RequestPriorityName(RequestPriority priority);
+bool ParseRequestPriority(const std::string& name, RequestPriority& out);
+
+struct RouteLimit {
+  double rate_per_s = 5;  // sustained requests per second
+  uint32_t burst = 5;     // bucket size
+};
+
+struct SchedulerOptions {
+  RouteLimit default_limit;         // routes without a limit of their own
+  uint32_t interactive_reserve = 1; // tokens per bucket that only interactive requests may take
+  uint32_t max_queued = 500;        // per non-interactive class; further submits are rejected
+  uint32_t high_water = 50;         // queued prefetch + background requests that raise backpressure
+  uint32_t low_water = 10;          // ... and that clear it again
+};
+
+struct RouteStatus {
+  std::string route;
+  double tokens;
+  uint32_t queued;
+  uint64_t paused_ms;  // left on a server-imposed pause
+  uint64_t dispatched;
+  uint64_t rate_limited;
+};
+
+struct SchedulerStatus {
+  uint32_t queued[static_cast<int>(RequestPriority::Count)];
+  bool backpressure;
+  uint64_t rejected;
+  std::vector<RouteStatus> routes;
+};
+
+// Paces outgoing SDK requests with one token bucket per route (the SDK
+// function name) and serves queued work strictly by priority class, so a
+// click is not stuck behind bulk hydration. Prefetch/background requests may
+// not drain the last interactive_reserve tokens of a bucket. Requests keep
+// their submission order within a route and class.
+//
+// Like ConnectionManager, every method requires the client state lock, and
+// the refill timer re-enters through run_locked.
+class RequestScheduler {
+public:
+  using IssueFn = std::function<void()>;
+
+  RequestScheduler(TimerQueue& timers, ConnectionManager::LockedRunner run_locked);
+
+  void Configure(const SchedulerOptions& options);
+  SchedulerOptions Options() const { return options_; }
+  void SetRouteLimit(const std::string& route, const RouteLimit& limit);
+
+  // Issues now if the route has a token, otherwise queues. A non-zero key
+  // coalesces with a queued request for the same route and key, promoting it
+  // if this submit has the higher priority. False if the class is full.
+  bool Submit(const char* route, RequestPriority priority, uint64_t key, IssueFn issue);
+
+  // The server answered with a rate limit: hold the route for retry_after_ms
+  void OnRateLimited(const std::string& route, uint32_t retry_after_ms);
+
+  // Drops queued requests (disconnect); limits and counters are kept
+  void Clear();
+  SchedulerStatus Status();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Bucket {
+    RouteLimit limit;
+    bool custom_limit = false;
+    double tokens;
+    Clock::time_point refilled;
+    Clock::time_point paused_until;
+    uint32_t queued = 0;
+    uint64_t dispatched = 0;
+    uint64_t rate_limited = 0;
+  };
+
+  struct Entry {
+    const char* route;
+    uint64_t key;
+    IssueFn issue;
+    Clock::time_point queued_at;
+  };
+
+  Bucket& BucketFor(const std::string& route);
+  void Refill(Bucket& bucket, Clock::time_point now);
+  bool TryTake(Bucket& bucket, RequestPriority priority, Clock::time_point now);
+  void Pump();
+  void ScheduleRefill(Clock::time_point now);
+  void UpdateBackpressure();
+  uint32_t QueuedBulk() const;
+
+  TimerQueue& timers_;
+  ConnectionManager::LockedRunner run_locked_;
+  SchedulerOptions options_;
+
+  std::unordered_map<std::string, Bucket> buckets_;
+  std::deque<Entry> queues_[static_cast<int>(RequestPriority::Count)];
+  Gauge* depth_[static_cast<int>(RequestPriority::Count)];
+  Histogram* wait_[static_cast<int>(RequestPriority::Count)];
+
+  bool backpressure_ = false;
+  uint64_t rejected_ = 0;
+  uint64_t generation_ = 0;  // bumped by Clear() so a stale refill timer does nothing
+  uint64_t timer_ = 0;
+  Clock::time_point timer_at_;
+};
+
+#endif // DISCORD_REQUEST_SCHEDULER_H
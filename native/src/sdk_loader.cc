@@ -0,0 +1,151 @@
+#include "sdk_loader.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace sdk {
+
+#if defined(_WIN32)
+static const char* kLibraryName = "discord_partner_sdk.dll";
+#elif defined(__APPLE__)
+static const char* kLibraryName = "libdiscord_partner_sdk.dylib";
+#else
+static const char* kLibraryName = "libdiscord_partner_sdk.so";
+#endif
+
+static std::mutex g_load_mutex;
+static std::atomic<bool> g_loaded{false};
+static std::string g_library_path;  // explicit override, empty for the default search
+static FunctionTable g_table;
+
+// build/Release, where binding.gyp copies the SDK next to the .node file
+static std::string AddonDirectory() {
+#ifdef _WIN32
+  HMODULE module = nullptr;
+  char path[MAX_PATH];
+  if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                          reinterpret_cast<LPCSTR>(&AddonDirectory), &module) ||
+      GetModuleFileNameA(module, path, MAX_PATH) == 0) {
+    return "";
+  }
+  std::string file(path);
+#else
+  Dl_info info;
+  if (!dladdr(reinterpret_cast<void*>(&AddonDirectory), &info) || !info.dli_fname) {
+    return "";
+  }
+  std::string file(info.dli_fname);
+#endif
+  size_t slash = file.find_last_of("/\\");
+  return slash == std::string::npos ? "" : file.substr(0, slash);
+}
+
+static std::string ResolveLibraryPath() {
+  if (!g_library_path.empty()) return g_library_path;
+
+  const char* env_path = std::getenv("DISCORD_SDK_LIBRARY");
+  if (env_path && *env_path) return env_path;
+
+  std::string dir = AddonDirectory();
+  if (!dir.empty()) {
+    std::string bundled = dir + "/" + kLibraryName;
+    if (std::ifstream(bundled).good()) return bundled;
+  }
+  return kLibraryName;  // let the system loader search for it
+}
+
+void SetLibraryPath(const std::string& path) {
+  std::lock_guard<std::mutex> lock(g_load_mutex);
+  if (g_loaded.load(std::memory_order_acquire)) {
+    LOG_WARN("⚠️  SDK already loaded from " << ResolveLibraryPath() << ", ignoring new path " << path);
+    return;
+  }
+  g_library_path = path;
+}
+
+std::string LibraryPath() {
+  std::lock_guard<std::mutex> lock(g_load_mutex);
+  return ResolveLibraryPath();
+}
+
+bool Load(std::string* error) {
+  if (g_loaded.load(std::memory_order_acquire)) return true;
+
+  TRACE_SCOPE("sdk", "sdk::Load");
+  std::lock_guard<std::mutex> lock(g_load_mutex);
+  if (g_loaded.load(std::memory_order_relaxed)) return true;
+
+  auto started = std::chrono::steady_clock::now();
+  std::string path = ResolveLibraryPath();
+  LOG_DEBUG("📦 Loading Discord SDK from " << path);
+
+  // Once loaded the handle is never closed: SDK threads and callbacks outlive
+  // any owner we could give it. A library rejected below has run no SDK code
+  // yet, so it is closed again.
+#ifdef _WIN32
+  HMODULE handle = LoadLibraryExA(path.c_str(), nullptr, LOAD_WITH_ALTERED_SEARCH_PATH);
+  auto resolve = [handle](const char* name) { return reinterpret_cast<void*>(GetProcAddress(handle, name)); };
+  auto close = [handle]() { FreeLibrary(handle); };
+  std::string load_error = handle ? "" : "LoadLibrary failed with error " + std::to_string(GetLastError());
+#else
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  auto resolve = [handle](const char* name) { return dlsym(handle, name); };
+  auto close = [handle]() { dlclose(handle); };
+  std::string load_error = handle ? "" : dlerror();
+#endif
+
+  if (!handle) {
+    if (error) *error = "Failed to load Discord SDK from " + path + ": " + load_error;
+    LOG_ERROR("❌ Failed to load Discord SDK from " << path << ": " << load_error);
+    FlightRecorder::Instance().Record(FlightEvent::Error, "SdkLoad");
+    return false;
+  }
+
+  // Fill a scratch table so a partial resolve never becomes visible
+  FunctionTable table;
+  std::string missing;
+#define DISCORD_SDK_RESOLVE(name)                                             \
+  table.name = reinterpret_cast<decltype(table.name)>(resolve(#name));       \
+  if (!table.name) missing += (missing.empty() ? "" : ", ") + std::string(#name);
+  DISCORD_SDK_FUNCTIONS(DISCORD_SDK_RESOLVE)
+#undef DISCORD_SDK_RESOLVE
+
+  if (!missing.empty()) {
+    if (error) *error = "Discord SDK at " + path + " is missing: " + missing;
+    LOG_ERROR("❌ Discord SDK at " << path << " is missing: " << missing);
+    FlightRecorder::Instance().Record(FlightEvent::Error, "SdkLoad");
+    close();
+    return false;
+  }
+
+  g_table = table;
+  g_loaded.store(true, std::memory_order_release);
+
+  uint64_t elapsed_us = ElapsedMicros(started);
+  METRIC_HISTOGRAM("sdk.load_us").Record(elapsed_us);
+  FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "SdkLoaded", 0, elapsed_us * 1000);
+  LOG_INFO("📦 Loaded Discord SDK from " << path << " in " << elapsed_us / 1000 << "ms");
+  return true;
+}
+
+bool IsLoaded() {
+  return g_loaded.load(std::memory_order_acquire);
+}
+
+const FunctionTable& Api() {
+  return g_table;
+}
+
+}  // namespace sdk
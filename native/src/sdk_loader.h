@@ -0,0 +1,125 @@
+#ifndef DISCORD_SDK_LOADER_H
+#define DISCORD_SDK_LOADER_H
+
+#include <string>
+#include "cdiscord.h"  // Discord SDK C API (declarations only - nothing is linked)
+
+// Every cdiscord.h entry point the addon calls. They are resolved together the
+// first time the SDK is loaded; a missing symbol fails the whole load.
+#define DISCORD_SDK_FUNCTIONS(X)                  \
+  X(Discord_SetFreeThreaded)                      \
+  X(Discord_RunCallbacks)                         \
+  X(Discord_Free)                                 \
+  X(Discord_FreeProperties)                       \
+  X(Discord_Client_Init)                          \
+  X(Discord_Client_Drop)                          \
+  X(Discord_Client_SetApplicationId)              \
+  X(Discord_Client_SetStatusChangedCallback)      \
+  X(Discord_Client_UpdateToken)                   \
+  X(Discord_Client_RefreshToken)                  \
+  X(Discord_Client_Connect)                       \
+  X(Discord_Client_Disconnect)                    \
+  X(Discord_Client_GetCurrentUser)                \
+  X(Discord_Client_GetUser)                       \
+  X(Discord_Client_GetUserGuilds)                 \
+  X(Discord_Client_GetGuildChannels)              \
+  X(Discord_Client_SendUserMessage)               \
+  X(Discord_Client_SendLobbyMessage)              \
+  X(Discord_Client_SetMessageCreatedCallback)     \
+  X(Discord_Client_GetMessageHandle)              \
+  X(Discord_MessageHandle_Id)                     \
+  X(Discord_MessageHandle_Content)                \
+  X(Discord_MessageHandle_AuthorId)               \
+  X(Discord_MessageHandle_ChannelId)              \
+  X(Discord_MessageHandle_SentTimestamp)          \
+  X(Discord_MessageHandle_Drop)                   \
+  X(Discord_Client_GetLobbyMessagesWithLimit)     \
+  X(Discord_Client_GetLobbyIds)                   \
+  X(Discord_Client_GetLobbyHandle)                \
+  X(Discord_LobbyHandle_Metadata)                 \
+  X(Discord_LobbyHandle_LobbyMemberIds)           \
+  X(Discord_LobbyHandle_Drop)                     \
+  X(Discord_Client_SetLobbyCreatedCallback)       \
+  X(Discord_Client_SetLobbyUpdatedCallback)       \
+  X(Discord_Client_SetLobbyDeletedCallback)       \
+  X(Discord_Client_SetLobbyMemberAddedCallback)   \
+  X(Discord_Client_SetLobbyMemberRemovedCallback) \
+  X(Discord_Client_SetLobbyMemberUpdatedCallback) \
+  X(Discord_Client_UpdateRichPresence)            \
+  X(Discord_Client_ClearRichPresence)             \
+  X(Discord_Activity_Init)                        \
+  X(Discord_Activity_Drop)                        \
+  X(Discord_Activity_SetType)                     \
+  X(Discord_Activity_SetDetails)                  \
+  X(Discord_Activity_SetState)                    \
+  X(Discord_Activity_SetTimestamps)               \
+  X(Discord_Activity_SetAssets)                   \
+  X(Discord_ActivityTimestamps_Init)              \
+  X(Discord_ActivityTimestamps_Drop)              \
+  X(Discord_ActivityTimestamps_SetStart)          \
+  X(Discord_ActivityAssets_Init)                  \
+  X(Discord_ActivityAssets_Drop)                  \
+  X(Discord_ActivityAssets_SetLargeImage)         \
+  X(Discord_ActivityAssets_SetLargeText)          \
+  X(Discord_ActivityAssets_SetSmallImage)         \
+  X(Discord_ActivityAssets_SetSmallText)          \
+  X(Discord_Client_StartCall)                     \
+  X(Discord_Client_EndCall)                       \
+  X(Discord_Client_SetSelfMuteAll)                \
+  X(Discord_Client_SetSelfDeafAll)                \
+  X(Discord_Call_SetStatusChangedCallback)        \
+  X(Discord_Call_Drop)                            \
+  X(Discord_ClientResult_Successful)              \
+  X(Discord_ClientResult_Error)                   \
+  X(Discord_ClientResult_RetryAfter)              \
+  X(Discord_ClientResult_Retryable)               \
+  X(Discord_ClientResult_Drop)                    \
+  X(Discord_GuildMinimal_Id)                      \
+  X(Discord_GuildMinimal_Name)                    \
+  X(Discord_GuildChannel_Id)                      \
+  X(Discord_GuildChannel_Name)                    \
+  X(Discord_GuildChannel_Type)                    \
+  X(Discord_GuildChannel_Position)                \
+  X(Discord_GuildChannel_ParentId)                \
+  X(Discord_UserHandle_Id)                        \
+  X(Discord_UserHandle_Username)                  \
+  X(Discord_UserHandle_GlobalName)                \
+  X(Discord_UserHandle_Status)                    \
+  X(Discord_UserHandle_Avatar)                    \
+  X(Discord_UserHandle_Drop)                      \
+  X(Discord_Client_GetRelationships)              \
+  X(Discord_RelationshipHandle_Id)                \
+  X(Discord_RelationshipHandle_DiscordRelationshipType) \
+  X(Discord_RelationshipHandle_User)              \
+  X(Discord_RelationshipHandle_Drop)              \
+  X(Discord_Client_GetRelationshipHandle)         \
+  X(Discord_Client_SetRelationshipCreatedCallback) \
+  X(Discord_Client_SetRelationshipDeletedCallback) \
+  X(Discord_Client_SetUserUpdatedCallback)
+
+namespace sdk {
+
+// One pointer per entry point, named after the C function it resolves to
+struct FunctionTable {
+#define DISCORD_SDK_DECLARE(name) decltype(&::name) name = nullptr;
+  DISCORD_SDK_FUNCTIONS(DISCORD_SDK_DECLARE)
+#undef DISCORD_SDK_DECLARE
+};
+
+// Library to load instead of the default search (DISCORD_SDK_LIBRARY, then the
+// addon's own directory, then the system loader path). Ignored once loaded.
+void SetLibraryPath(const std::string& path);
+std::string LibraryPath();
+
+// Loads the library and resolves the table on first use; once that succeeds
+// later calls return immediately. A failed load is retried on the next call
+// (e.g. after SetLibraryPath). Thread-safe.
+bool Load(std::string* error = nullptr);
+bool IsLoaded();
+
+// Only valid after Load() returned true
+const FunctionTable& Api();
+
+}  // namespace sdk
+
+#endif // DISCORD_SDK_LOADER_H
@@ -0,0 +1,462 @@
+#include "search_index.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+
+static const char kAuthorField = '\x01';  // author name terms are stored behind this byte
+static const size_t kMaxTermBytes = 64;
+static const size_t kMinRebuildDrops = 1024;
+
+struct SearchIndex::Clause {
+  enum Kind { Term, Prefix, Phrase, AuthorPrefix, AuthorId, Channel } kind;
+  std::vector<std::string> words;
+  uint64_t id;
+};
+
+static bool IsWordByte(unsigned char c) {
+  // Bytes of multi-byte UTF-8 sequences count as letters, so non-ASCII words stay whole
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+// Lowercased words, in order
+static void Tokenize(const std::string& text, std::vector<std::string>& out) {
+  std::string word;
+  for (char c : text) {
+    unsigned char byte = static_cast<unsigned char>(c);
+    if (IsWordByte(byte)) {
+      if (word.size() < kMaxTermBytes) word.push_back(byte >= 'A' && byte <= 'Z' ? static_cast<char>(byte + 32) : c);
+    } else if (!word.empty()) {
+      out.push_back(std::move(word));
+      word.clear();
+    }
+  }
+  if (!word.empty()) out.push_back(std::move(word));
+}
+
+static bool ParseId(const std::string& text, uint64_t& out) {
+  if (text.empty() || text.size() > 20) return false;
+  out = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') return false;
+    out = out * 10 + static_cast<uint64_t>(c - '0');
+  }
+  return true;
+}
+
+static void PutVarint(std::string& out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+static uint32_t GetVarint(const std::string& in, size_t& offset) {
+  uint32_t value = 0;
+  for (int shift = 0; offset < in.size(); shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(in[offset++]);
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) break;
+  }
+  return value;
+}
+
+// A decoded postings list; positions[i] belongs to docs[i]
+struct DecodedPostings {
+  std::vector<uint32_t> docs;
+  std::vector<std::vector<uint32_t>> positions;
+};
+
+static void DecodeDocs(const std::string& bytes, std::vector<uint32_t>& docs) {
+  size_t offset = 0;
+  uint32_t doc = 0;
+  while (offset < bytes.size()) {
+    doc += GetVarint(bytes, offset);
+    docs.push_back(doc);
+    uint32_t count = GetVarint(bytes, offset);
+    for (uint32_t i = 0; i < count; i++) GetVarint(bytes, offset);
+  }
+}
+
+static void DecodePositions(const std::string& bytes, DecodedPostings& out) {
+  size_t offset = 0;
+  uint32_t doc = 0;
+  while (offset < bytes.size()) {
+    doc += GetVarint(bytes, offset);
+    out.docs.push_back(doc);
+    uint32_t count = GetVarint(bytes, offset);
+    std::vector<uint32_t> positions(count);
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      position += GetVarint(bytes, offset);
+      positions[i] = position;
+    }
+    out.positions.push_back(std::move(positions));
+  }
+}
+
+static std::vector<uint32_t> Intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+  std::vector<uint32_t> out;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+  return out;
+}
+
+SearchIndex::~SearchIndex() {
+  Stop();
+}
+
+void SearchIndex::Configure(const SearchOptions& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+}
+
+SearchOptions SearchIndex::Options() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_;
+}
+
+void SearchIndex::StartLocked() {
+  if (running_) return;
+  running_ = true;
+  thread_ = std::thread(&SearchIndex::Loop, this);
+}
+
+void SearchIndex::Add(SearchDocument document) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopped_) return;
+  StartLocked();
+  changes_.push_back({ false, std::move(document) });
+  cv_.notify_all();
+}
+
+void SearchIndex::RemoveChannel(uint64_t channel_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopped_ || !running_) return;
+  changes_.push_back({ true, { 0, channel_id, false, 0, "", 0, "" } });
+  cv_.notify_all();
+}
+
+void SearchIndex::Search(SearchQuery query, SearchDone done) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopped_) {
+      StartLocked();
+      jobs_.push_back({ std::move(query), std::move(done) });
+      cv_.notify_all();
+      return;
+    }
+  }
+  done({ false, "Search index stopped", {}, 0, 0 });
+}
+
+void SearchIndex::Stop() {
+  std::deque<Job> jobs;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    running_ = false;
+    jobs.swap(jobs_);
+    changes_.clear();
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) thread_.join();
+  for (Job& job : jobs) {
+    job.done({ false, "Search index stopped", {}, 0, 0 });
+  }
+}
+
+SearchStatus SearchIndex::Status() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SearchStatus status = status_;
+  status.pending = changes_.size();
+  return status;
+}
+
+void SearchIndex::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    cv_.wait(lock, [&] { return !running_ || !changes_.empty() || !jobs_.empty(); });
+    if (!running_) break;
+    std::vector<Change> changes;
+    changes.swap(changes_);
+    std::deque<Job> jobs;
+    jobs.swap(jobs_);
+    uint32_t max_documents = std::max<uint32_t>(options_.max_documents, 1);
+    lock.unlock();
+
+    // Changes first, so a search sees every message added before it was asked
+    for (Change& change : changes) {
+      if (change.remove_channel) {
+        DropChannel(change.document.channel_id);
+      } else {
+        Apply(change.document, max_documents);
+      }
+    }
+    RebuildIfSparse();
+    for (Job& job : jobs) {
+      SearchResult result = Run(job.query);
+      job.done(result);
+    }
+
+    lock.lock();
+    status_.documents = live_;
+    status_.terms = terms_.size();
+    status_.postings_bytes = postings_bytes_;
+    status_.searches += jobs.size();
+  }
+}
+
+void SearchIndex::IndexTerm(const std::string& term, uint32_t doc, const std::vector<uint32_t>& positions) {
+  Postings& postings = terms_[term];
+  size_t before = postings.bytes.size();
+  PutVarint(postings.bytes, doc - postings.last_doc);
+  PutVarint(postings.bytes, static_cast<uint32_t>(positions.size()));
+  uint32_t previous = 0;
+  for (uint32_t position : positions) {
+    PutVarint(postings.bytes, position - previous);
+    previous = position;
+  }
+  postings.last_doc = doc;
+  postings.docs++;
+  postings_bytes_ += postings.bytes.size() - before;
+}
+
+void SearchIndex::Apply(SearchDocument& document, uint32_t max_documents) {
+  if (by_message_.count(document.message_id)) return;
+  uint32_t doc = static_cast<uint32_t>(docs_.size());
+
+  // Each term is appended once per document, with all its positions
+  std::map<std::string, std::vector<uint32_t>> positions;
+  std::vector<std::string> words;
+  Tokenize(document.content, words);
+  for (uint32_t i = 0; i < words.size(); i++) {
+    positions[words[i]].push_back(i);
+  }
+  words.clear();
+  Tokenize(document.author_name, words);
+  for (uint32_t i = 0; i < words.size(); i++) {
+    positions[kAuthorField + words[i]].push_back(i);
+  }
+  for (const auto& entry : positions) {
+    IndexTerm(entry.first, doc, entry.second);
+  }
+
+  by_message_[document.message_id] = doc;
+  docs_.push_back({ std::move(document), true });
+  live_++;
+  while (live_ > max_documents) {
+    while (!docs_[oldest_live_].live) oldest_live_++;
+    Drop(static_cast<uint32_t>(oldest_live_));
+  }
+}
+
+void SearchIndex::Drop(uint32_t doc) {
+  Doc& entry = docs_[doc];
+  if (!entry.live) return;
+  entry.live = false;
+  by_message_.erase(entry.document.message_id);
+  // Postings keep pointing here until the next rebuild; only the text goes now
+  std::string().swap(entry.document.content);
+  std::string().swap(entry.document.author_name);
+  live_--;
+}
+
+void SearchIndex::DropChannel(uint64_t channel_id) {
+  for (size_t doc = oldest_live_; doc < docs_.size(); doc++) {
+    if (docs_[doc].live && docs_[doc].document.channel_id == channel_id) Drop(static_cast<uint32_t>(doc));
+  }
+}
+
+// Dropped documents still cost postings space and decode time; once they
+// outnumber live ones, the index is rebuilt from the live documents
+void SearchIndex::RebuildIfSparse() {
+  size_t dropped = docs_.size() - live_;
+  if (dropped < kMinRebuildDrops || dropped < live_) return;
+  auto started = std::chrono::steady_clock::now();
+  std::vector<Doc> docs;
+  docs.swap(docs_);
+  by_message_.clear();
+  terms_.clear();
+  live_ = 0;
+  oldest_live_ = 0;
+  postings_bytes_ = 0;
+  for (Doc& doc : docs) {
+    if (doc.live) Apply(doc.document, UINT32_MAX);
+  }
+  METRIC_HISTOGRAM("search.rebuild_us").Record(ElapsedMicros(started));
+  LOG_DEBUG("🔎 Rebuilt search index: " << docs.size() << " -> " << live_ << " documents");
+}
+
+bool SearchIndex::ParseQuery(const std::string& text, std::vector<Clause>& clauses, std::string& error) {
+  size_t i = 0;
+  while (i < text.size()) {
+    if (text[i] == ' ' || text[i] == '\t' || text[i] == '\n') {
+      i++;
+      continue;
+    }
+    if (text[i] == '"') {
+      size_t end = text.find('"', i + 1);
+      if (end == std::string::npos) end = text.size();
+      std::vector<std::string> words;
+      Tokenize(text.substr(i + 1, end - i - 1), words);
+      if (words.size() == 1) clauses.push_back({ Clause::Term, words, 0 });
+      if (words.size() > 1) clauses.push_back({ Clause::Phrase, words, 0 });
+      i = end + 1;
+      continue;
+    }
+    size_t end = text.find_first_of(" \t\n", i);
+    if (end == std::string::npos) end = text.size();
+    std::string token = text.substr(i, end - i);
+    i = end;
+
+    uint64_t id;
+    if (token.compare(0, 3, "in:") == 0) {
+      if (!ParseId(token.substr(3), id)) {
+        error = "Expected a channel ID after in:";
+        return false;
+      }
+      clauses.push_back({ Clause::Channel, {}, id });
+      continue;
+    }
+    if (token.compare(0, 5, "from:") == 0) {
+      std::string author = token.substr(5);
+      if (ParseId(author, id)) {
+        clauses.push_back({ Clause::AuthorId, {}, id });
+        continue;
+      }
+      // Names match as you type
+      std::vector<std::string> words;
+      Tokenize(author, words);
+      for (std::string& word : words) {
+        clauses.push_back({ Clause::AuthorPrefix, { kAuthorField + word }, 0 });
+      }
+      continue;
+    }
+    bool prefix = token.size() > 1 && token.back() == '*';
+    std::vector<std::string> words;
+    Tokenize(prefix ? token.substr(0, token.size() - 1) : token, words);
+    // "re-render" is the phrase "re render"
+    if (words.size() > 1) clauses.push_back({ Clause::Phrase, words, 0 });
+    if (words.size() == 1) clauses.push_back({ prefix ? Clause::Prefix : Clause::Term, words, 0 });
+  }
+  if (clauses.empty()) {
+    error = "Empty query";
+    return false;
+  }
+  return true;
+}
+
+SearchResult SearchIndex::Run(const SearchQuery& query) {
+  auto started = std::chrono::steady_clock::now();
+  SearchResult result{ true, "", {}, 0, 0 };
+  std::vector<Clause> clauses;
+  if (!ParseQuery(query.text, clauses, result.error)) {
+    result.ok = false;
+    return result;
+  }
+
+  // Each word, prefix or phrase narrows a sorted document list; smallest first
+  std::vector<std::vector<uint32_t>> sets;
+  std::vector<uint64_t> channels = query.channel_ids;
+  std::vector<uint64_t> authors;
+  for (const Clause& clause : clauses) {
+    std::vector<uint32_t> docs;
+    switch (clause.kind) {
+      case Clause::Term: {
+        auto it = terms_.find(clause.words[0]);
+        if (it != terms_.end()) DecodeDocs(it->second.bytes, docs);
+        break;
+      }
+      case Clause::Prefix:
+      case Clause::AuthorPrefix: {
+        const std::string& prefix = clause.words[0];
+        for (auto it = terms_.lower_bound(prefix); it != terms_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+             ++it) {
+          DecodeDocs(it->second.bytes, docs);
+        }
+        std::sort(docs.begin(), docs.end());
+        docs.erase(std::unique(docs.begin(), docs.end()), docs.end());
+        break;
+      }
+      case Clause::Phrase: {
+        std::vector<DecodedPostings> words(clause.words.size());
+        bool missing = false;
+        for (size_t w = 0; w < clause.words.size() && !missing; w++) {
+          auto it = terms_.find(clause.words[w]);
+          if (it == terms_.end()) {
+            missing = true;
+          } else {
+            DecodePositions(it->second.bytes, words[w]);
+          }
+        }
+        if (missing) break;
+        for (size_t d = 0; d < words[0].docs.size(); d++) {
+          uint32_t doc = words[0].docs[d];
+          std::vector<const std::vector<uint32_t>*> positions{ &words[0].positions[d] };
+          for (size_t w = 1; w < words.size(); w++) {
+            auto at = std::lower_bound(words[w].docs.begin(), words[w].docs.end(), doc);
+            if (at == words[w].docs.end() || *at != doc) break;
+            positions.push_back(&words[w].positions[at - words[w].docs.begin()]);
+          }
+          if (positions.size() < words.size()) continue;
+          for (uint32_t start : *positions[0]) {
+            bool matched = true;
+            for (size_t w = 1; w < positions.size() && matched; w++) {
+              matched = std::binary_search(positions[w]->begin(), positions[w]->end(), start + static_cast<uint32_t>(w));
+            }
+            if (matched) {
+              docs.push_back(doc);
+              break;
+            }
+          }
+        }
+        break;
+      }
+      case Clause::AuthorId:
+        authors.push_back(clause.id);
+        continue;
+      case Clause::Channel:
+        channels.push_back(clause.id);
+        continue;
+    }
+    sets.push_back(std::move(docs));
+  }
+
+  std::vector<uint32_t> candidates;
+  if (sets.empty()) {
+    // Only filters; every live document is a candidate
+    for (size_t doc = oldest_live_; doc < docs_.size(); doc++) {
+      candidates.push_back(static_cast<uint32_t>(doc));
+    }
+  } else {
+    std::sort(sets.begin(), sets.end(),
+              [](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) { return a.size() < b.size(); });
+    candidates = std::move(sets[0]);
+    for (size_t s = 1; s < sets.size() && !candidates.empty(); s++) {
+      candidates = Intersect(candidates, sets[s]);
+    }
+  }
+
+  std::sort(channels.begin(), channels.end());
+  std::vector<uint32_t> matches;
+  for (uint32_t doc : candidates) {
+    const Doc& entry = docs_[doc];
+    if (!entry.live) continue;
+    if (!channels.empty() && !std::binary_search(channels.begin(), channels.end(), entry.document.channel_id)) continue;
+    if (!authors.empty() && std::find(authors.begin(), authors.end(), entry.document.author_id) == authors.end()) continue;
+    matches.push_back(doc);
+  }
+
+  // Snowflake IDs order by time, so newest first is by message ID
+  result.total = static_cast<uint32_t>(matches.size());
+  size_t count = std::min<size_t>(matches.size(), query.limit);
+  auto newer = [this](uint32_t a, uint32_t b) { return docs_[a].document.message_id > docs_[b].document.message_id; };
+  std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), newer);
+  for (size_t i = 0; i < count; i++) {
+    result.hits.push_back(docs_[matches[i]].document);
+  }
+  result.took_us = ElapsedMicros(started);
+  METRIC_HISTOGRAM("search.query_us").Record(result.took_us);
+  return result;
+}
@@ -0,0 +1,132 @@
+#ifndef DISCORD_SEARCH_INDEX_H
+#define DISCORD_SEARCH_INDEX_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SearchDocument {
+  uint64_t message_id;
+  uint64_t channel_id;  // lobby ID, or the DM channel
+  bool lobby;
+  uint64_t author_id;
+  std::string author_name;
+  uint64_t sent_ms;
+  std::string content;
+};
+
+struct SearchOptions {
+  uint32_t max_documents = 100000;  // the oldest are dropped past this
+};
+
+struct SearchQuery {
+  std::string text;
+  std::vector<uint64_t> channel_ids;  // empty = every channel
+  uint32_t limit = 25;
+};
+
+struct SearchResult {
+  bool ok;
+  std::string error;
+  std::vector<SearchDocument> hits;  // newest first
+  uint32_t total;                    // matches before limit
+  uint64_t took_us;
+};
+
+using SearchDone = std::function<void(const SearchResult& result)>;
+
+struct SearchStatus {
+  size_t documents;
+  size_t terms;
+  uint64_t postings_bytes;
+  size_t pending;  // changes not yet applied
+  uint64_t searches;
+};
+
+// Inverted index over message content and author names. Each term's postings
+// list is varint-encoded: per document the gap from the previous document
+// number, then the term's positions as gaps. Terms are kept sorted, so a
+// prefix query is a range scan, and positions make phrase queries exact.
+//
+// Query syntax: words must all match, `word*` matches by prefix, "a b c" is a
+// phrase, from:name (or from:<user id>) filters by author and in:<channel id>
+// by channel.
+//
+// Thread-safe. Changes and searches are queued to a worker thread that owns
+// the index, so Add() never waits on a search and searches never run on the
+// caller's thread; done is called on the worker.
+class SearchIndex {
+public:
+  SearchIndex() = default;
+  ~SearchIndex();
+
+  void Configure(const SearchOptions& options);
+  SearchOptions Options();
+
+  // Already indexed messages are ignored
+  void Add(SearchDocument document);
+  void RemoveChannel(uint64_t channel_id);
+  void Search(SearchQuery query, SearchDone done);
+
+  // Fails queued searches and stops the worker; nothing is indexed after it
+  void Stop();
+  SearchStatus Status();
+
+private:
+  struct Change {
+    bool remove_channel;   // else add document
+    SearchDocument document;  // only channel_id is used for removals
+  };
+  struct Job {
+    SearchQuery query;
+    SearchDone done;
+  };
+  struct Doc {
+    SearchDocument document;
+    bool live;
+  };
+  struct Postings {
+    std::string bytes;
+    uint32_t last_doc = 0;
+    uint32_t docs = 0;
+  };
+  struct Clause;
+
+  void Loop();
+  void StartLocked();
+  static bool ParseQuery(const std::string& text, std::vector<Clause>& clauses, std::string& error);
+
+  // Worker thread only
+  void Apply(SearchDocument& document, uint32_t max_documents);
+  void Drop(uint32_t doc);
+  void DropChannel(uint64_t channel_id);
+  void RebuildIfSparse();
+  void IndexTerm(const std::string& term, uint32_t doc, const std::vector<uint32_t>& positions);
+  SearchResult Run(const SearchQuery& query);
+
+  std::mutex mutex_;  // guards the queues, not the index
+  std::condition_variable cv_;
+  std::thread thread_;
+  bool running_ = false;
+  bool stopped_ = false;
+  SearchOptions options_;
+  std::vector<Change> changes_;
+  std::deque<Job> jobs_;
+  SearchStatus status_{ 0, 0, 0, 0, 0 };  // published by the worker
+
+  std::vector<Doc> docs_;  // by document number, in arrival order
+  std::unordered_map<uint64_t, uint32_t> by_message_;
+  std::map<std::string, Postings> terms_;
+  size_t live_ = 0;
+  size_t oldest_live_ = 0;  // docs before this are all dropped
+  uint64_t postings_bytes_ = 0;
+};
+
+#endif // DISCORD_SEARCH_INDEX_H
@@ -0,0 +1,162 @@
+#include "send_pipeline.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+#include <vector>
+
+size_t MessageLength(const std::string& content) {
+  size_t length = 0;
+  for (char c : content) {
+    if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) length++;  // skip continuation bytes
+  }
+  return length;
+}
+
+SendPipeline::SendPipeline(IssueFn issue) : issue_(std::move(issue)) {}
+
+uint64_t SendPipeline::Send(const SendDestination& destination, std::string content, SendDone done) {
+  Pending pending{ next_id_++, destination, std::move(content), std::move(done), Clock::now(), 0 };
+
+  const char* rejected = nullptr;
+  if (pending.content.empty()) {
+    rejected = "Message content is empty";
+  } else if (MessageLength(pending.content) > options_.max_content_length) {
+    rejected = "Message content is too long";
+  } else {
+    auto it = lanes_.find(KeyFor(destination));
+    if (it != lanes_.end() && it->second.queue.size() >= options_.max_queued_per_destination) {
+      rejected = "Too many messages queued for this destination";
+    }
+  }
+  if (rejected) {
+    METRIC_COUNTER("send.rejected").Add();
+    Finish(pending, false, 0, rejected, false);
+    return 0;
+  }
+
+  uint64_t id = pending.id;
+  lanes_[KeyFor(destination)].queue.push_back(std::move(pending));
+  queued_++;
+  Pump();
+  return id;
+}
+
+void SendPipeline::Pump() {
+  std::vector<uint64_t> issued;
+  bool progress = true;
+  while (progress && queued_ > 0 && in_flight_.size() < options_.max_in_flight) {
+    progress = false;
+    // One send per lane per round, starting after the lane served last
+    auto it = lanes_.upper_bound(cursor_);
+    for (size_t visited = 0; visited < lanes_.size() && in_flight_.size() < options_.max_in_flight; visited++, ++it) {
+      if (it == lanes_.end()) it = lanes_.begin();
+      Lane& lane = it->second;
+      if (lane.queue.empty() || lane.in_flight >= options_.max_in_flight_per_destination) continue;
+      // A re-send waits for the lane to drain and then goes alone, so nothing
+      // issued after it is. Sends that were already in flight when it was rate
+      // limited are at the SDK and may still land first.
+      if (lane.retrying && lane.in_flight > 0) continue;
+
+      Pending pending = std::move(lane.queue.front());
+      lane.queue.pop_front();
+      lane.in_flight++;
+      queued_--;
+      cursor_ = it->first;
+      METRIC_HISTOGRAM("send.queue_wait_us").Record(ElapsedMicros(pending.queued_at));
+      issued.push_back(pending.id);
+      in_flight_.emplace(pending.id, std::move(pending));
+      progress = true;
+    }
+  }
+  UpdateGauges();
+
+  // Issued after the bookkeeping: an issuer may complete a send synchronously
+  for (uint64_t id : issued) {
+    auto it = in_flight_.find(id);
+    if (it == in_flight_.end()) continue;
+    SendDestination destination = it->second.destination;
+    std::string content = it->second.content;
+    issue_(id, destination, content);
+  }
+}
+
+void SendPipeline::OnSendComplete(uint64_t send_id, bool ok, uint64_t message_id, const std::string& error,
+                                  bool rate_limited, bool retryable) {
+  auto it = in_flight_.find(send_id);
+  if (it == in_flight_.end()) return;  // already failed by FailAll()
+  Pending pending = std::move(it->second);
+  in_flight_.erase(it);
+
+  auto lane_it = lanes_.find(KeyFor(pending.destination));
+  if (lane_it != lanes_.end()) {
+    Lane& lane = lane_it->second;
+    lane.in_flight--;
+    if (lane.retrying == pending.id) lane.retrying = 0;
+    if (!ok && rate_limited && pending.retries < options_.rate_limit_retries) {
+      // Back into its lane in submission order, ahead of anything sent after it;
+      // the scheduler holds the route until the pause ends
+      pending.retries++;
+      METRIC_COUNTER("send.retried").Add();
+      uint64_t id = pending.id;
+      auto position = std::find_if(lane.queue.begin(), lane.queue.end(),
+                                   [id](const Pending& queued) { return queued.id > id; });
+      lane.queue.insert(position, std::move(pending));
+      lane.retrying = lane.queue.front().id;
+      queued_++;
+      Pump();
+      return;
+    }
+    if (lane.queue.empty() && lane.in_flight == 0) {
+      lanes_.erase(lane_it);
+    }
+  }
+
+  Finish(pending, ok, message_id, error, retryable || rate_limited);
+  Pump();
+}
+
+void SendPipeline::Finish(Pending& pending, bool ok, uint64_t message_id, const std::string& error,
+                          bool retryable) {
+  uint64_t latency_us = ElapsedMicros(pending.queued_at);
+  if (ok) {
+    sent_++;
+    METRIC_COUNTER("send.sent").Add();
+    METRIC_HISTOGRAM("send.latency_us").Record(latency_us);
+  } else {
+    failed_++;
+    METRIC_COUNTER("send.failed").Add();
+    LOG_WARN("⚠️  Message send failed: " << error);
+  }
+  if (pending.done) {
+    pending.done({ ok, ok ? message_id : 0, ok ? "" : error, latency_us, !ok && retryable });
+  }
+}
+
+void SendPipeline::FailAll(const std::string& error) {
+  std::vector<Pending> failed;
+  for (auto& lane : lanes_) {
+    for (auto& pending : lane.second.queue) {
+      failed.push_back(std::move(pending));
+    }
+  }
+  for (auto& entry : in_flight_) {
+    failed.push_back(std::move(entry.second));
+  }
+  lanes_.clear();
+  in_flight_.clear();
+  queued_ = 0;
+  UpdateGauges();
+
+  for (auto& pending : failed) {
+    Finish(pending, false, 0, error, true);
+  }
+}
+
+SendPipelineStatus SendPipeline::Status() const {
+  return { queued_, static_cast<uint32_t>(in_flight_.size()), static_cast<uint32_t>(lanes_.size()), sent_, failed_ };
+}
+
+void SendPipeline::UpdateGauges() {
+  METRIC_GAUGE("send.queued").Set(queued_);
+  METRIC_GAUGE("send.in_flight").Set(static_cast<int64_t>(in_flight_.size()));
+}
@@ -0,0 +1,119 @@
+#ifndef DISCORD_SEND_PIPELINE_H
+#define DISCORD_SEND_PIPELINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+enum class SendTarget { User, Lobby };
+
+struct SendDestination {
+  SendTarget target;
+  uint64_t id;  // recipient user ID or lobby ID
+};
+
+struct SendResult {
+  bool ok;
+  uint64_t message_id;  // 0 on failure
+  std::string error;
+  uint64_t latency_us;  // from Send() to the SDK callback
+  bool retryable;       // the failure was transient (disconnect, server hiccup); sending again may work
+};
+
+using SendDone = std::function<void(const SendResult& result)>;
+
+// Length in code points, which is what Discord's message limit counts; the
+// UTF-8 byte count overstates it for anything outside ASCII
+size_t MessageLength(const std::string& content);
+
+struct SendPipelineOptions {
+  uint32_t max_in_flight = 16;                 // across all destinations
+  uint32_t max_in_flight_per_destination = 4;  // issued in order, may complete out of order
+  uint32_t max_queued_per_destination = 1000;
+  uint32_t max_content_length = 2000;          // Discord's message length limit, in code points
+  uint32_t rate_limit_retries = 3;             // re-sends after a rate-limited failure
+};
+
+struct SendPipelineStatus {
+  uint32_t queued;
+  uint32_t in_flight;
+  uint32_t destinations;
+  uint64_t sent;
+  uint64_t failed;
+};
+
+// Ordered, pipelined message sends. Each destination has its own FIFO lane;
+// up to max_in_flight_per_destination sends from a lane are handed to the SDK
+// at once, in submission order, and lanes share the global in-flight budget
+// round-robin so one busy chat cannot starve the others. Order is issue order:
+// sends in flight together may land in any order. A rate-limited send goes
+// back into its lane in submission order; once the sends already in flight
+// there have settled it is re-sent alone, and nothing queued behind it is
+// issued until it settles. Those earlier in-flight sends may have landed
+// before it.
+//
+// Like ConnectionManager, every method requires the client state lock.
+class SendPipeline {
+public:
+  // Hands one send to the SDK; the owner must eventually report back through
+  // OnSendComplete with the same send_id
+  using IssueFn = std::function<void(uint64_t send_id, const SendDestination& destination, const std::string& content)>;
+
+  explicit SendPipeline(IssueFn issue);
+
+  void Configure(const SendPipelineOptions& options) { options_ = options; }
+  SendPipelineOptions Options() const { return options_; }
+
+  // done runs exactly once - synchronously if the send is rejected up front.
+  // Returns the send ID, or 0 if rejected.
+  uint64_t Send(const SendDestination& destination, std::string content, SendDone done);
+  void OnSendComplete(uint64_t send_id, bool ok, uint64_t message_id, const std::string& error, bool rate_limited,
+                      bool retryable);
+
+  // Fails every queued and in-flight send as retryable (disconnect, shutdown)
+  void FailAll(const std::string& error);
+  SendPipelineStatus Status() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+  using LaneKey = std::pair<int, uint64_t>;
+
+  struct Pending {
+    uint64_t id;
+    SendDestination destination;
+    std::string content;
+    SendDone done;
+    Clock::time_point queued_at;
+    uint32_t retries;
+  };
+
+  struct Lane {
+    std::deque<Pending> queue;
+    uint32_t in_flight = 0;
+    uint64_t retrying = 0;  // the rate-limited send being re-sent, 0 if none
+  };
+
+  static LaneKey KeyFor(const SendDestination& destination) {
+    return { static_cast<int>(destination.target), destination.id };
+  }
+  void Pump();
+  void Finish(Pending& pending, bool ok, uint64_t message_id, const std::string& error, bool retryable);
+  void UpdateGauges();
+
+  IssueFn issue_;
+  SendPipelineOptions options_;
+  std::map<LaneKey, Lane> lanes_;
+  std::unordered_map<uint64_t, Pending> in_flight_;
+  LaneKey cursor_{ -1, 0 };  // last lane served, for round-robin
+  uint64_t next_id_ = 1;
+  uint32_t queued_ = 0;
+  uint64_t sent_ = 0;
+  uint64_t failed_ = 0;
+};
+
+#endif // DISCORD_SEND_PIPELINE_H
@@ -0,0 +1,39 @@
+#include "shutdown.h"
+#include "logger.h"
+#include "metrics.h"
+#include <mutex>
+
+static std::mutex g_hooks_mutex;
+static std::vector<std::pair<std::string, FlushHook>> g_flush_hooks;
+
+void RegisterFlushHook(const std::string& name, FlushHook hook) {
+  std::lock_guard<std::mutex> lock(g_hooks_mutex);
+  g_flush_hooks.emplace_back(name, std::move(hook));
+}
+
+void RunFlushHooks(std::chrono::steady_clock::time_point deadline, ShutdownReport& report) {
+  std::vector<std::pair<std::string, FlushHook>> hooks;
+  {
+    std::lock_guard<std::mutex> lock(g_hooks_mutex);
+    hooks = g_flush_hooks;
+  }
+
+  for (auto& hook : hooks) {
+    ShutdownStageTimer stage(report, "flush:" + hook.first);
+    try {
+      hook.second(deadline);
+    } catch (const std::exception& e) {
+      LOG_ERROR("❌ Flush hook '" << hook.first << "' threw: " << e.what());
+    }
+  }
+}
+
+ShutdownStageTimer::ShutdownStageTimer(ShutdownReport& report, std::string name)
+    : report_(report), name_(std::move(name)), start_(std::chrono::steady_clock::now()) {}
+
+ShutdownStageTimer::~ShutdownStageTimer() {
+  uint64_t elapsed_us = ElapsedMicros(start_);
+  Metrics::Instance().GetHistogram("shutdown." + name_ + "_us").Record(elapsed_us);
+  report_.stages.push_back({ name_, elapsed_us / 1000.0 });
+  LOG_DEBUG("🚪 Shutdown stage '" << name_ << "' took " << elapsed_us / 1000.0 << "ms");
+}
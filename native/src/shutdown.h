@@ -0,0 +1,44 @@
+#ifndef DISCORD_SHUTDOWN_H
+#define DISCORD_SHUTDOWN_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ShutdownStage {
+  std::string name;
+  double ms;
+};
+
+struct ShutdownReport {
+  bool performed = false;      // false if shutdown had already run
+  bool within_deadline = true;
+  uint32_t abandoned_requests = 0;  // still in flight when the drain deadline hit
+  double total_ms = 0;
+  std::vector<ShutdownStage> stages;
+};
+
+// Components with buffered state (queues, logs, persisted caches) register a
+// flush hook; shutdown runs them in registration order after in-flight SDK
+// requests have drained and before the client is dropped. Hooks must return by
+// the deadline they are given.
+using FlushHook = std::function<void(std::chrono::steady_clock::time_point deadline)>;
+
+void RegisterFlushHook(const std::string& name, FlushHook hook);
+void RunFlushHooks(std::chrono::steady_clock::time_point deadline, ShutdownReport& report);
+
+// Times one stage into the report and the shutdown.<name>_us histogram
+class ShutdownStageTimer {
+public:
+  ShutdownStageTimer(ShutdownReport& report, std::string name);
+  ~ShutdownStageTimer();
+
+private:
+  ShutdownReport& report_;
+  std::string name_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif // DISCORD_SHUTDOWN_H
@@ -0,0 +1,83 @@
+#include "timer_queue.h"
+#include "metrics.h"
+
+TimerQueue::~TimerQueue() {
+  Stop();
+}
+
+uint64_t TimerQueue::Schedule(uint32_t delay_ms, Task task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_) {
+    running_ = true;
+    thread_ = std::thread(&TimerQueue::Loop, this, generation_);
+  }
+
+  uint64_t id = next_id_++;
+  Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(delay_ms);
+  tasks_.emplace(std::make_pair(deadline, id), std::move(task));
+  deadlines_[id] = deadline;
+  METRIC_GAUGE("timers.pending").Set(static_cast<int64_t>(tasks_.size()));
+  cv_.notify_one();
+  return id;
+}
+
+bool TimerQueue::Cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = deadlines_.find(id);
+  if (it == deadlines_.end()) return false;
+  tasks_.erase(std::make_pair(it->second, id));
+  deadlines_.erase(it);
+  METRIC_GAUGE("timers.pending").Set(static_cast<int64_t>(tasks_.size()));
+  return true;
+}
+
+void TimerQueue::Stop() {
+  std::thread worker;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    generation_++;
+    tasks_.clear();
+    deadlines_.clear();
+    worker = std::move(thread_);
+  }
+  cv_.notify_all();
+  if (worker.joinable()) {
+    if (worker.get_id() == std::this_thread::get_id()) {
+      worker.detach();  // Stop() from inside a task; the loop exits once it returns
+    } else {
+      worker.join();
+    }
+  }
+}
+
+size_t TimerQueue::Pending() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tasks_.size();
+}
+
+void TimerQueue::Loop(uint64_t generation) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_ && generation_ == generation) {
+    if (tasks_.empty()) {
+      cv_.wait(lock);
+      continue;
+    }
+
+    auto next = tasks_.begin();
+    if (Clock::now() < next->first.first) {
+      cv_.wait_until(lock, next->first.first);
+      continue;  // re-check: an earlier task may have been added or this one cancelled
+    }
+
+    Task task = std::move(next->second);
+    deadlines_.erase(next->first.second);
+    tasks_.erase(next);
+    METRIC_GAUGE("timers.pending").Set(static_cast<int64_t>(tasks_.size()));
+
+    lock.unlock();
+    METRIC_COUNTER("timers.fired").Add();
+    task();
+    lock.lock();
+  }
+}
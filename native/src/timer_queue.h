@@ -0,0 +1,50 @@
+#ifndef DISCORD_TIMER_QUEUE_H
+#define DISCORD_TIMER_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+// One background thread that runs delayed tasks (reconnect backoff, refresh
+// deadlines, trailing flushes). Tasks run without the queue lock held, so they
+// may take other locks or schedule more work.
+class TimerQueue {
+public:
+  using Task = std::function<void()>;
+  using Clock = std::chrono::steady_clock;
+
+  TimerQueue() = default;
+  ~TimerQueue();
+
+  // Starts the thread on first use. Returns an id for Cancel().
+  uint64_t Schedule(uint32_t delay_ms, Task task);
+
+  // False if the task already ran or is running; callers that race with a
+  // running task must re-check their own state inside it.
+  bool Cancel(uint64_t id);
+
+  // Drops pending tasks and joins the thread; Schedule() restarts it
+  void Stop();
+  size_t Pending();
+
+private:
+  void Loop(uint64_t generation);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::thread thread_;
+  bool running_ = false;
+  uint64_t generation_ = 0;  // bumped by Stop() so a detached loop knows to exit
+  uint64_t next_id_ = 1;
+
+  std::map<std::pair<Clock::time_point, uint64_t>, Task> tasks_;  // ordered by deadline
+  std::unordered_map<uint64_t, Clock::time_point> deadlines_;     // id -> key in tasks_
+};
+
+#endif // DISCORD_TIMER_QUEUE_H
@@ -0,0 +1,151 @@
+#include "token_manager.h"
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+#include <algorithm>
+
+TokenManager::TokenManager(TimerQueue& timers, ConnectionManager::LockedRunner run_locked,
+                           StartRefreshFn start_refresh, ApplyFn apply)
+    : timers_(timers), run_locked_(std::move(run_locked)), start_refresh_(std::move(start_refresh)),
+      apply_(std::move(apply)), rng_(std::random_device{}()) {}
+
+void TokenManager::SetToken(const TokenInfo& token) {
+  CancelTimer();
+  token_ = token;
+  has_token_ = !token.access_token.empty();
+  expiry_reported_ = false;
+  failed_attempts_ = 0;
+  if (!has_token_ || token.expires_in_s == 0) return;
+
+  expires_at_ = std::chrono::steady_clock::now() + std::chrono::seconds(token.expires_in_s);
+  uint32_t lead_s = std::min(options_.refresh_margin_s, token.expires_in_s / 2);
+  Schedule((token.expires_in_s - lead_s) * 1000);
+  LOG_DEBUG("🔑 Token expires in " << token.expires_in_s << "s, refreshing " << lead_s << "s ahead");
+}
+
+void TokenManager::Reset() {
+  CancelTimer();
+  generation_++;
+  token_ = TokenInfo();
+  has_token_ = false;
+  refreshing_ = false;
+  failed_attempts_ = 0;
+  deferred_.clear();  // nothing should run against a client that is going away
+}
+
+bool TokenManager::IsExpired() const {
+  return has_token_ && token_.expires_in_s != 0 && std::chrono::steady_clock::now() >= expires_at_;
+}
+
+TokenStatus TokenManager::Status() const {
+  auto now = std::chrono::steady_clock::now();
+  TokenStatus status;
+  status.has_token = has_token_;
+  status.has_refresh_token = !token_.refresh_token.empty();
+  status.refreshing = refreshing_;
+  status.expiry_known = has_token_ && token_.expires_in_s != 0;
+  status.expires_in_ms = status.expiry_known
+      ? std::chrono::duration_cast<std::chrono::milliseconds>(expires_at_ - now).count() : 0;
+  status.next_refresh_ms = timer_ && timer_at_ > now
+      ? std::chrono::duration_cast<std::chrono::milliseconds>(timer_at_ - now).count() : 0;
+  status.refreshes = refreshes_;
+  status.failures = failures_;
+  return status;
+}
+
+bool TokenManager::RefreshNow(const char* reason) {
+  if (refreshing_) return true;
+  if (!has_token_) return false;
+
+  CancelTimer();
+  refreshing_ = true;
+  uint64_t generation = ++generation_;
+  LOG_INFO("🔑 Refreshing access token (" << reason << ")");
+  FlightRecorder::Instance().Record(FlightEvent::SdkCall, "TokenRefresh", failed_attempts_);
+  if (!start_refresh_(generation, token_.refresh_token)) {
+    refreshing_ = false;
+    LOG_WARN("⚠️  Token needs refreshing but there is no refresh token or refresher");
+    return false;
+  }
+  return true;
+}
+
+void TokenManager::OnRefreshed(uint64_t generation, const TokenInfo& token) {
+  if (generation != generation_ || !refreshing_) return;  // superseded or reset
+  refreshing_ = false;
+  refreshes_++;
+  METRIC_COUNTER("token.refreshes").Add();
+
+  // Keep the old refresh token if the provider did not rotate it
+  TokenInfo next = token;
+  if (next.refresh_token.empty()) next.refresh_token = token_.refresh_token;
+  apply_(next.access_token);
+  SetToken(next);
+
+  LOG_INFO("🔑 Access token refreshed" << (next.expires_in_s ? ", expires in " + std::to_string(next.expires_in_s) + "s" : ""));
+  EmitEvent(NativeEvent("tokenRefreshed").Number("expiresIn", next.expires_in_s));
+  RunDeferred();
+}
+
+void TokenManager::OnRefreshFailed(uint64_t generation, const std::string& error) {
+  if (generation != generation_ || !refreshing_) return;
+  refreshing_ = false;
+  failures_++;
+  failed_attempts_++;
+  METRIC_COUNTER("token.refresh_failures").Add();
+  FlightRecorder::Instance().Record(FlightEvent::Error, "TokenRefresh", failed_attempts_);
+
+  ReconnectOptions backoff;
+  backoff.base_delay_ms = options_.retry_base_ms;
+  backoff.max_delay_ms = options_.retry_max_ms;
+  uint32_t retry_ms = ConnectionManager::BackoffDelayMs(backoff, failed_attempts_, rng_);
+  LOG_WARN("⚠️  Token refresh failed: " << error << " - retrying in " << retry_ms << "ms");
+  EmitEvent(NativeEvent("tokenRefreshFailed").String("error", error).Number("attempt", failed_attempts_)
+                .Number("retryInMs", retry_ms));
+
+  if (IsExpired() && !expiry_reported_) {
+    expiry_reported_ = true;
+    LOG_ERROR("❌ Access token expired before it could be refreshed");
+    EmitEvent(NativeEvent("tokenExpired"));
+  }
+  Schedule(retry_ms);
+  RunDeferred();
+}
+
+void TokenManager::WithValidToken(std::function<void()> task) {
+  if (!IsExpired()) {
+    task();
+    return;
+  }
+  deferred_.push_back(std::move(task));
+  if (!RefreshNow("expired")) {
+    RunDeferred();
+  }
+}
+
+void TokenManager::Schedule(uint32_t delay_ms) {
+  CancelTimer();
+  uint64_t generation = generation_;
+  timer_at_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+  timer_ = timers_.Schedule(delay_ms, [this, generation]() {
+    run_locked_([this, generation]() {
+      if (generation != generation_) return;
+      timer_ = 0;
+      RefreshNow("scheduled");
+    });
+  });
+}
+
+void TokenManager::CancelTimer() {
+  if (timer_) timers_.Cancel(timer_);
+  timer_ = 0;
+}
+
+void TokenManager::RunDeferred() {
+  std::vector<std::function<void()>> tasks;
+  tasks.swap(deferred_);
+  for (auto& task : tasks) {
+    task();
+  }
+}
@@ -0,0 +1,107 @@
+#ifndef DISCORD_TOKEN_MANAGER_H
+#define DISCORD_TOKEN_MANAGER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "connection.h"
+#include "timer_queue.h"
+
+struct TokenInfo {
+  std::string access_token;
+  std::string refresh_token;  // empty when only a JS refresher can renew the token
+  uint32_t expires_in_s = 0;  // OAuth expires_in; 0 = unknown, never refreshed proactively
+};
+
+// A refresh performed outside the SDK (e.g. by the extension's OAuth code).
+// The refresher returns false if it could not start (its owner is gone);
+// done is then never called and the SDK's own exchange is used instead.
+using TokenRefreshDone = std::function<void(bool ok, const TokenInfo& token, const std::string& error)>;
+using TokenRefresher = std::function<bool(const std::string& refresh_token, TokenRefreshDone done)>;
+
+struct TokenRefreshOptions {
+  uint32_t refresh_margin_s = 300;  // refresh this long before expiry (capped at half the lifetime)
+  uint32_t retry_base_ms = 5000;    // failed refreshes back off like reconnects
+  uint32_t retry_max_ms = 300000;
+};
+
+struct TokenStatus {
+  bool has_token;
+  bool has_refresh_token;
+  bool refreshing;
+  int64_t expires_in_ms;    // negative once expired; only meaningful if expiry_known
+  bool expiry_known;
+  uint64_t next_refresh_ms; // 0 if nothing scheduled
+  uint64_t refreshes;
+  uint64_t failures;
+};
+
+// Tracks access-token expiry and renews it ahead of time. How a refresh is
+// performed (SDK RefreshToken or a JS callback) and how the new token is
+// pushed to the client (UpdateToken) are supplied by the owner; the manager
+// only decides when, retries failures and gates reconnects on a valid token.
+//
+// Like ConnectionManager, every method requires the client state lock, and
+// timers re-enter through run_locked.
+class TokenManager {
+public:
+  // Returns false if there is no way to refresh (no refresh token or JS
+  // refresher); otherwise must eventually report back through
+  // OnRefreshed/OnRefreshFailed with the generation it was given
+  using StartRefreshFn = std::function<bool(uint64_t generation, const std::string& refresh_token)>;
+  using ApplyFn = std::function<void(const std::string& access_token)>;
+
+  TokenManager(TimerQueue& timers, ConnectionManager::LockedRunner run_locked, StartRefreshFn start_refresh,
+               ApplyFn apply);
+
+  void Configure(const TokenRefreshOptions& options) { options_ = options; }
+  TokenRefreshOptions Options() const { return options_; }
+
+  // Adopts a token that is already in use by the client and schedules its refresh
+  void SetToken(const TokenInfo& token);
+  void Reset();
+
+  // False if no refresh could be started (already running counts as started)
+  bool RefreshNow(const char* reason);
+  void OnRefreshed(uint64_t generation, const TokenInfo& token);
+  void OnRefreshFailed(uint64_t generation, const std::string& error);
+
+  // Runs task now if the token is still valid, otherwise after a refresh
+  // attempt settles (successful or not)
+  void WithValidToken(std::function<void()> task);
+
+  bool IsExpired() const;
+  const std::string& AccessToken() const { return token_.access_token; }
+  const std::string& RefreshTokenValue() const { return token_.refresh_token; }
+  TokenStatus Status() const;
+
+private:
+  void Schedule(uint32_t delay_ms);
+  void CancelTimer();
+  void RunDeferred();
+
+  TimerQueue& timers_;
+  ConnectionManager::LockedRunner run_locked_;
+  StartRefreshFn start_refresh_;
+  ApplyFn apply_;
+  TokenRefreshOptions options_;
+  std::mt19937 rng_;
+
+  TokenInfo token_;
+  bool has_token_ = false;
+  std::chrono::steady_clock::time_point expires_at_;
+  bool refreshing_ = false;
+  bool expiry_reported_ = false;
+  uint64_t generation_ = 0;  // bumped by Reset() and by each refresh attempt
+  uint64_t timer_ = 0;
+  std::chrono::steady_clock::time_point timer_at_;
+  uint32_t failed_attempts_ = 0;
+  uint64_t refreshes_ = 0;
+  uint64_t failures_ = 0;
+  std::vector<std::function<void()>> deferred_;
+};
+
+#endif // DISCORD_TOKEN_MANAGER_H
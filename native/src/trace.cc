@@ -0,0 +1,121 @@
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+Tracer& Tracer::Instance() {
+  static Tracer instance;
+  return instance;
+}
+
+uint32_t Tracer::ThreadId() {
+  static std::atomic<uint32_t> next_tid{1};
+  thread_local uint32_t tid = next_tid.fetch_add(1, std::memory_order_relaxed);
+  return tid;
+}
+
+void Tracer::Start(size_t capacity) {
+  std::lock_guard<std::mutex> lock(control_mutex_);
+  if (enabled_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // The buffer is allocated once and never freed: a span that raced with
+  // Stop() may still be writing into it
+  if (!events_) {
+    size_t rounded = 1024;
+    while (rounded < capacity && rounded < (size_t(1) << 22)) rounded <<= 1;
+    events_.reset(new Event[rounded]);
+    capacity_ = rounded;
+  } else {
+    for (size_t i = 0; i < capacity_; i++) {
+      events_[i].seq.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  next_.store(0, std::memory_order_relaxed);
+  origin_ns_ = NowNs();
+  enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::Stop() {
+  std::lock_guard<std::mutex> lock(control_mutex_);
+  enabled_.store(false, std::memory_order_release);
+}
+
+void Tracer::Complete(const char* category, const char* name, uint64_t start_ns, uint64_t end_ns) {
+  if (!enabled_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Event& event = events_[index & (capacity_ - 1)];
+
+  // Seqlock-style publish so export never reads a half-written slot
+  event.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.category = category;
+  event.name = name;
+  event.start_ns = start_ns;
+  event.duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+  event.tid = ThreadId();
+  event.seq.store(index + 1, std::memory_order_release);
+}
+
+size_t Tracer::EventCount() const {
+  return static_cast<size_t>(std::min<uint64_t>(next_.load(std::memory_order_relaxed), capacity_));
+}
+
+static void AppendJsonString(std::string& out, const char* value) {
+  out.push_back('"');
+  for (const char* p = value; *p; p++) {
+    if (*p == '"' || *p == '\\') out.push_back('\\');
+    out.push_back(*p);
+  }
+  out.push_back('"');
+}
+
+std::string Tracer::ExportJson() const {
+  struct Copy {
+    const char* category;
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t tid;
+  };
+
+  std::vector<Copy> copies;
+  if (events_) {
+    copies.reserve(EventCount());
+    for (size_t i = 0; i < capacity_; i++) {
+      const Event& event = events_[i];
+      uint64_t before = event.seq.load(std::memory_order_acquire);
+      if (before == 0) continue;
+      Copy copy{ event.category, event.name, event.start_ns, event.duration_ns, event.tid };
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (event.seq.load(std::memory_order_relaxed) != before) continue;
+      if (copy.start_ns < origin_ns_) continue;
+      copies.push_back(copy);
+    }
+  }
+  std::sort(copies.begin(), copies.end(),
+            [](const Copy& a, const Copy& b) { return a.start_ns < b.start_ns; });
+
+  std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  char numbers[128];
+  bool first = true;
+  for (const Copy& copy : copies) {
+    if (!first) out.push_back(',');
+    first = false;
+    out += "{\"ph\":\"X\",\"pid\":1,\"name\":";
+    AppendJsonString(out, copy.name);
+    out += ",\"cat\":";
+    AppendJsonString(out, copy.category);
+    // Trace-event timestamps are microseconds; keep sub-microsecond precision
+    std::snprintf(numbers, sizeof(numbers), ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                  copy.tid, (copy.start_ns - origin_ns_) / 1000.0, copy.duration_ns / 1000.0);
+    out += numbers;
+  }
+  out += "]}";
+  return out;
+}
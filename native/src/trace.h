@@ -0,0 +1,94 @@
+#ifndef DISCORD_TRACE_H
+#define DISCORD_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Span recorder for Chrome trace-event / Perfetto export. Compiled in only
+// when DISCORD_ENABLE_TRACING is defined (binding.gyp's discord_tracing=1);
+// at runtime it stays off until startTracing() is called from JS.
+class Tracer {
+public:
+  static Tracer& Instance();
+
+  static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  bool Enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Capacity is rounded up to a power of two; the oldest spans are overwritten
+  void Start(size_t capacity);
+  void Stop();
+
+  // name and category must be string literals (only the pointer is stored)
+  void Complete(const char* category, const char* name, uint64_t start_ns, uint64_t end_ns);
+
+  size_t EventCount() const;
+  std::string ExportJson() const;
+
+private:
+  Tracer() = default;
+
+  struct Event {
+    std::atomic<uint64_t> seq{0};
+    const char* category;
+    const char* name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t tid;
+  };
+
+  static uint32_t ThreadId();
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint64_t> next_{0};
+  std::unique_ptr<Event[]> events_;
+  size_t capacity_ = 0;
+  uint64_t origin_ns_ = 0;
+  std::mutex control_mutex_;
+};
+
+class TraceScope {
+public:
+  TraceScope(const char* category, const char* name)
+      : category_(category), name_(name),
+        start_ns_(Tracer::Instance().Enabled() ? Tracer::NowNs() : 0) {}
+  ~TraceScope() {
+    if (start_ns_ != 0) {
+      Tracer::Instance().Complete(category_, name_, start_ns_, Tracer::NowNs());
+    }
+  }
+
+private:
+  const char* category_;
+  const char* name_;
+  uint64_t start_ns_;
+};
+
+#define DISCORD_TRACE_CONCAT_INNER(a, b) a##b
+#define DISCORD_TRACE_CONCAT(a, b) DISCORD_TRACE_CONCAT_INNER(a, b)
+
+#ifdef DISCORD_ENABLE_TRACING
+#define TRACE_SCOPE(category, name) \
+  TraceScope DISCORD_TRACE_CONCAT(discord_trace_scope_, __LINE__)(category, name)
+// For spans whose start was captured elsewhere, e.g. an SDK request round-trip
+#define TRACE_COMPLETE(category, name, start_ns)                                \
+  do {                                                                          \
+    if (Tracer::Instance().Enabled() && (start_ns) != 0) {                      \
+      Tracer::Instance().Complete(category, name, start_ns, Tracer::NowNs());   \
+    }                                                                           \
+  } while (0)
+#define TRACE_NOW() (Tracer::Instance().Enabled() ? Tracer::NowNs() : 0)
+#else
+#define TRACE_SCOPE(category, name) ((void)0)
+#define TRACE_COMPLETE(category, name, start_ns) ((void)0)
+#define TRACE_NOW() uint64_t(0)
+#endif
+
+#endif // DISCORD_TRACE_H
@@ -0,0 +1,258 @@
+#include "voice.h"
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+
+const char* VoiceStateName(VoiceState state) {
+  switch (state) {
+    case VoiceState::Idle: return "idle";
+    case VoiceState::Joining: return "joining";
+    case VoiceState::Connected: return "connected";
+    case VoiceState::Leaving: return "leaving";
+    default: return "unknown";
+  }
+}
+
+const char* CallStatusName(Discord_Call_Status status) {
+  switch (status) {
+    case Discord_Call_Status_Disconnected: return "disconnected";
+    case Discord_Call_Status_Joining: return "joining";
+    case Discord_Call_Status_Connecting: return "connecting";
+    case Discord_Call_Status_SignalingConnected: return "signalingConnected";
+    case Discord_Call_Status_Connected: return "connected";
+    case Discord_Call_Status_Reconnecting: return "reconnecting";
+    case Discord_Call_Status_Disconnecting: return "disconnecting";
+    default: return "unknown";
+  }
+}
+
+VoiceCall::VoiceCall(TimerQueue& timers, ConnectionManager::LockedRunner run_locked, Backend backend)
+    : timers_(timers), run_locked_(std::move(run_locked)), backend_(std::move(backend)) {}
+
+double VoiceCall::MillisSince(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+void VoiceCall::Join(uint64_t channel_id, VoiceDone done) {
+  switch (state_) {
+    case VoiceState::Idle:
+      join_waiters_.push_back(std::move(done));
+      Start(channel_id);
+      return;
+    case VoiceState::Connected:
+      if (channel_id == channel_id_) {
+        done(true, "", 0);
+        return;
+      }
+      break;
+    case VoiceState::Joining:
+      if (channel_id == channel_id_) {
+        join_waiters_.push_back(std::move(done));
+        return;
+      }
+      Settle(join_waiters_, false, "Superseded by a join to another lobby", MillisSince(started_));
+      break;
+    case VoiceState::Leaving:
+      break;
+  }
+
+  // Another lobby: it starts once the current call has ended
+  if (next_channel_id_ != channel_id) {
+    Settle(next_waiters_, false, "Superseded by a join to another lobby", 0);
+  }
+  next_channel_id_ = channel_id;
+  next_waiters_.push_back(std::move(done));
+  if (state_ != VoiceState::Leaving) BeginLeave();
+}
+
+void VoiceCall::Leave(VoiceDone done) {
+  // A queued join would undo the leave
+  Settle(next_waiters_, false, "Cancelled by leave", 0);
+  next_channel_id_ = 0;
+
+  switch (state_) {
+    case VoiceState::Idle:
+      done(true, "", 0);
+      return;
+    case VoiceState::Leaving:
+      leave_waiters_.push_back(std::move(done));
+      return;
+    case VoiceState::Joining:
+      Settle(join_waiters_, false, "Left before the call connected", MillisSince(started_));
+      break;
+    case VoiceState::Connected:
+      break;
+  }
+  leave_waiters_.push_back(std::move(done));
+  BeginLeave();
+}
+
+void VoiceCall::Start(uint64_t channel_id) {
+  channel_id_ = channel_id;
+  started_ = Clock::now();
+  call_status_ = Discord_Call_Status_Disconnected;
+  Transition(VoiceState::Joining);
+  FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "VoiceJoin", 0, channel_id);
+
+  if (!backend_.start_call(channel_id)) {
+    failures_++;
+    METRIC_COUNTER("voice.join_failures").Add();
+    Transition(VoiceState::Idle, "Could not start the call");
+    channel_id_ = 0;
+    Settle(join_waiters_, false, "Could not start the call", MillisSince(started_));
+    return;
+  }
+  // Both are global, so a fresh call picks up the current choice
+  if (self_mute_) backend_.set_mute(true);
+  if (self_deaf_) backend_.set_deaf(true);
+  ScheduleTimeout(options_.join_timeout_ms);
+}
+
+void VoiceCall::BeginLeave() {
+  CancelTimer();
+  started_ = Clock::now();
+  Transition(VoiceState::Leaving);
+  FlightRecorder::Instance().Record(FlightEvent::Lifecycle, "VoiceLeave", 0, channel_id_);
+  ScheduleTimeout(options_.leave_timeout_ms);
+  backend_.end_call(channel_id_);
+}
+
+void VoiceCall::FinishLeave() {
+  CancelTimer();
+  double elapsed_ms = MillisSince(started_);
+  METRIC_HISTOGRAM("voice.leave_us").Record(static_cast<uint64_t>(elapsed_ms * 1000));
+  Transition(VoiceState::Idle, "", elapsed_ms);
+  channel_id_ = 0;
+  call_status_ = Discord_Call_Status_Disconnected;
+  Settle(leave_waiters_, true, "", elapsed_ms);
+
+  if (state_ == VoiceState::Idle && next_channel_id_) {
+    uint64_t channel_id = next_channel_id_;
+    next_channel_id_ = 0;
+    join_waiters_.swap(next_waiters_);
+    Start(channel_id);
+  }
+}
+
+void VoiceCall::OnCallStatus(uint64_t channel_id, Discord_Call_Status status, Discord_Call_Error error,
+                             int32_t detail) {
+  if (state_ == VoiceState::Idle || channel_id != channel_id_) return;  // a call we already let go of
+  call_status_ = status;
+  LOG_DEBUG("🎙️  Call " << channel_id << " status: " << CallStatusName(status));
+
+  if (status == Discord_Call_Status_Connected && state_ == VoiceState::Joining) {
+    CancelTimer();
+    last_join_ms_ = MillisSince(started_);
+    joins_++;
+    connected_at_ = Clock::now();
+    METRIC_HISTOGRAM("voice.join_us").Record(static_cast<uint64_t>(last_join_ms_ * 1000));
+    LOG_INFO("🎙️  Joined voice in lobby " << channel_id << " (" << last_join_ms_ << " ms)");
+    Transition(VoiceState::Connected, "", last_join_ms_);
+    Settle(join_waiters_, true, "", last_join_ms_);
+    return;
+  }
+
+  if (status == Discord_Call_Status_Disconnected && state_ != VoiceState::Leaving) {
+    // Leaving waits for EndCall's callback instead
+    std::string reason = "Call disconnected (error=" + std::to_string(static_cast<int>(error)) +
+                         ", detail=" + std::to_string(detail) + ")";
+    bool joining = state_ == VoiceState::Joining;
+    CancelTimer();
+    if (joining) {
+      failures_++;
+      METRIC_COUNTER("voice.join_failures").Add();
+    }
+    LOG_WARN("⚠️  " << reason);
+    Transition(VoiceState::Idle, reason);
+    channel_id_ = 0;
+    if (joining) Settle(join_waiters_, false, reason, MillisSince(started_));
+    return;
+  }
+
+  // Intermediate statuses (connecting, reconnecting, ...) only update the event stream
+  Transition(state_);
+}
+
+void VoiceCall::OnCallEnded(uint64_t channel_id) {
+  if (state_ != VoiceState::Leaving || channel_id != channel_id_) return;
+  FinishLeave();
+}
+
+void VoiceCall::SetSelfMute(bool mute) {
+  self_mute_ = mute;
+  backend_.set_mute(mute);
+}
+
+void VoiceCall::SetSelfDeaf(bool deaf) {
+  self_deaf_ = deaf;
+  backend_.set_deaf(deaf);
+}
+
+void VoiceCall::Reset(const std::string& reason) {
+  CancelTimer();
+  double elapsed_ms = MillisSince(started_);
+  if (state_ != VoiceState::Idle) Transition(VoiceState::Idle, reason);
+  state_ = VoiceState::Idle;
+  channel_id_ = 0;
+  next_channel_id_ = 0;
+  call_status_ = Discord_Call_Status_Disconnected;
+  Settle(join_waiters_, false, reason, elapsed_ms);
+  Settle(next_waiters_, false, reason, 0);
+  Settle(leave_waiters_, true, "", elapsed_ms);  // the call is gone either way
+}
+
+void VoiceCall::Transition(VoiceState state, const std::string& error, double elapsed_ms) {
+  state_ = state;
+  NativeEvent event("voiceState");
+  event.String("state", VoiceStateName(state))
+      .String("channelId", std::to_string(channel_id_))
+      .String("callStatus", CallStatusName(call_status_));
+  if (elapsed_ms >= 0) event.Number("elapsedMs", elapsed_ms);
+  if (!error.empty()) event.String("error", error);
+  EmitEvent(std::move(event));
+}
+
+void VoiceCall::Settle(std::vector<VoiceDone>& waiters, bool ok, const std::string& error, double elapsed_ms) {
+  // Taken first: a waiter may start the next join or leave
+  std::vector<VoiceDone> settled;
+  settled.swap(waiters);
+  for (VoiceDone& done : settled) {
+    done(ok, error, elapsed_ms);
+  }
+}
+
+void VoiceCall::ScheduleTimeout(uint32_t delay_ms) {
+  CancelTimer();
+  uint64_t generation = generation_;
+  timer_ = timers_.Schedule(delay_ms, [this, generation]() {
+    run_locked_([this, generation]() {
+      if (generation != generation_) return;
+      timer_ = 0;
+      if (state_ == VoiceState::Joining) {
+        failures_++;
+        METRIC_COUNTER("voice.join_failures").Add();
+        LOG_WARN("⚠️  Timed out joining voice in lobby " << channel_id_);
+        Settle(join_waiters_, false, "Timed out joining voice", MillisSince(started_));
+        BeginLeave();
+      } else if (state_ == VoiceState::Leaving) {
+        LOG_WARN("⚠️  EndCall did not complete in time; treating the call as ended");
+        FinishLeave();
+      }
+    });
+  });
+}
+
+void VoiceCall::CancelTimer() {
+  generation_++;
+  if (timer_) timers_.Cancel(timer_);
+  timer_ = 0;
+}
+
+VoiceStatus VoiceCall::Status() const {
+  uint64_t connected_ms = state_ == VoiceState::Connected
+      ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - connected_at_).count())
+      : 0;
+  return { state_, channel_id_, CallStatusName(call_status_), self_mute_, self_deaf_, last_join_ms_, connected_ms,
+           joins_, failures_ };
+}
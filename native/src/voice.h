@@ -0,0 +1,110 @@
+#ifndef DISCORD_VOICE_H
+#define DISCORD_VOICE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "cdiscord.h"  // Discord_Call_Status / Discord_Call_Error
+#include "connection.h"
+#include "timer_queue.h"
+
+enum class VoiceState { Idle, Joining, Connected, Leaving };
+
+const char* VoiceStateName(VoiceState state);
+const char* CallStatusName(Discord_Call_Status status);
+
+struct VoiceOptions {
+  uint32_t join_timeout_ms = 15000;   // StartCall to Connected
+  uint32_t leave_timeout_ms = 5000;   // EndCall to its callback; the call is considered gone after this
+};
+
+struct VoiceStatus {
+  VoiceState state;
+  uint64_t channel_id;       // lobby the call is in (or joining / leaving), 0 when idle
+  std::string call_status;   // last SDK call status
+  bool self_mute;
+  bool self_deaf;
+  double last_join_ms;       // < 0 until a join succeeds
+  uint64_t connected_ms;     // time in the current call, 0 unless connected
+  uint64_t joins;
+  uint64_t failures;
+};
+
+// ok, error, and how long the join or leave took
+using VoiceDone = std::function<void(bool ok, const std::string& error, double elapsed_ms)>;
+
+// One voice call at a time, over the lobby call APIs. Join and Leave settle
+// when the SDK reports the outcome (call status Connected / EndCall callback),
+// not when the request is made; joining another lobby leaves the current call
+// first. Mute and deafen apply to every call and survive rejoining.
+//
+// Like ConnectionManager, every method requires the client state lock, and the
+// timeout timer re-enters through run_locked.
+class VoiceCall {
+public:
+  struct Backend {
+    std::function<bool(uint64_t channel_id)> start_call;  // false if the SDK refused
+    std::function<void(uint64_t channel_id)> end_call;    // completes through OnCallEnded
+    std::function<void(bool mute)> set_mute;
+    std::function<void(bool deaf)> set_deaf;
+  };
+
+  VoiceCall(TimerQueue& timers, ConnectionManager::LockedRunner run_locked, Backend backend);
+
+  void Configure(const VoiceOptions& options) { options_ = options; }
+  VoiceOptions Options() const { return options_; }
+
+  void Join(uint64_t channel_id, VoiceDone done);
+  void Leave(VoiceDone done);
+  void SetSelfMute(bool mute);
+  void SetSelfDeaf(bool deaf);
+
+  void OnCallStatus(uint64_t channel_id, Discord_Call_Status status, Discord_Call_Error error, int32_t detail);
+  void OnCallEnded(uint64_t channel_id);
+
+  // The client went away and took the call with it; fails anything pending
+  void Reset(const std::string& reason);
+  VoiceStatus Status() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void Start(uint64_t channel_id);
+  void BeginLeave();
+  void FinishLeave();
+  void Transition(VoiceState state, const std::string& error = "", double elapsed_ms = -1);
+  void Settle(std::vector<VoiceDone>& waiters, bool ok, const std::string& error, double elapsed_ms);
+  void ScheduleTimeout(uint32_t delay_ms);
+  void CancelTimer();
+  static double MillisSince(Clock::time_point since);
+
+  TimerQueue& timers_;
+  ConnectionManager::LockedRunner run_locked_;
+  Backend backend_;
+  VoiceOptions options_;
+
+  VoiceState state_ = VoiceState::Idle;
+  uint64_t channel_id_ = 0;
+  Discord_Call_Status call_status_ = Discord_Call_Status_Disconnected;
+  Clock::time_point started_;       // of the current join or leave
+  Clock::time_point connected_at_;
+  std::vector<VoiceDone> join_waiters_;
+  std::vector<VoiceDone> leave_waiters_;
+
+  // A join for another lobby waits for the current call to end
+  uint64_t next_channel_id_ = 0;
+  std::vector<VoiceDone> next_waiters_;
+
+  bool self_mute_ = false;
+  bool self_deaf_ = false;
+  double last_join_ms_ = -1;
+  uint64_t joins_ = 0;
+  uint64_t failures_ = 0;
+
+  uint64_t timer_ = 0;
+  uint64_t generation_ = 0;  // bumped when the timer is cancelled
+};
+
+#endif // DISCORD_VOICE_H
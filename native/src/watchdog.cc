@@ -0,0 +1,172 @@
+#include "watchdog.h"
+#include "events.h"
+#include "flight_recorder.h"
+#include "logger.h"
+#include "metrics.h"
+
+static int64_t SteadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Watchdog::~Watchdog() {
+  Stop();
+}
+
+void Watchdog::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) return;
+  running_ = true;
+  pump_stalled_ = false;
+  last_pump_ns_.store(SteadyNowNs(), std::memory_order_relaxed);
+  thread_ = std::thread(&Watchdog::Loop, this);
+}
+
+void Watchdog::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return;
+    running_ = false;
+    in_flight_.clear();
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void Watchdog::Configure(const WatchdogOptions& options) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+    if (options_.check_interval_ms == 0) options_.check_interval_ms = 1000;
+  }
+  cv_.notify_all();
+}
+
+WatchdogOptions Watchdog::Options() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_;
+}
+
+void Watchdog::NotePump() {
+  last_pump_ns_.store(SteadyNowNs(), std::memory_order_relaxed);
+}
+
+uint64_t Watchdog::BeginRequest(const char* op, RetryFn retry, uint32_t attempt) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t id = next_id_++;
+  in_flight_[id] = Entry{ op, std::chrono::steady_clock::now(), std::move(retry), attempt, false };
+  METRIC_GAUGE("requests.in_flight").Set(static_cast<int64_t>(in_flight_.size()));
+  return id;
+}
+
+void Watchdog::EndRequest(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = in_flight_.find(id);
+  if (it == in_flight_.end()) {
+    return;  // already abandoned by a retry
+  }
+  if (it->second.reported) {
+    uint64_t age_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - it->second.started).count();
+    LOG_INFO("✅ Stalled request " << it->second.op << " completed after " << age_ms << "ms");
+    EmitEvent(NativeEvent("stallCleared").String("kind", "request").String("op", it->second.op)
+                  .Number("elapsedMs", static_cast<double>(age_ms)));
+  }
+  in_flight_.erase(it);
+  METRIC_GAUGE("requests.in_flight").Set(static_cast<int64_t>(in_flight_.size()));
+}
+
+std::vector<InFlightRequest> Watchdog::InFlight() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto now = std::chrono::steady_clock::now();
+  std::vector<InFlightRequest> result;
+  result.reserve(in_flight_.size());
+  for (const auto& entry : in_flight_) {
+    result.push_back({ entry.first, entry.second.op, entry.second.attempt,
+                       static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           now - entry.second.started).count()) });
+  }
+  return result;
+}
+
+void Watchdog::Loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    cv_.wait_for(lock, std::chrono::milliseconds(options_.check_interval_ms));
+    if (!running_) break;
+
+    lock.unlock();
+    Check();
+    lock.lock();
+  }
+}
+
+void Watchdog::Check() {
+  std::vector<std::pair<RetryFn, uint32_t>> retries;
+  bool dump = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+
+    int64_t pump_age_ms = (SteadyNowNs() - last_pump_ns_.load(std::memory_order_relaxed)) / 1000000;
+    if (pump_age_ms >= options_.pump_stall_ms) {
+      if (!pump_stalled_) {
+        pump_stalled_ = true;
+        dump = true;
+        METRIC_COUNTER("watchdog.stalls").Add();
+        FlightRecorder::Instance().Record(FlightEvent::Stall, "RunCallbacks", 0,
+                                          static_cast<uint64_t>(pump_age_ms) * 1000000);
+        LOG_WARN("⏱️  RunCallbacks() has not been pumped for " << pump_age_ms << "ms");
+        EmitEvent(NativeEvent("stall").String("kind", "pump").String("op", "RunCallbacks")
+                      .Number("elapsedMs", static_cast<double>(pump_age_ms)));
+      }
+    } else if (pump_stalled_) {
+      pump_stalled_ = false;
+      EmitEvent(NativeEvent("stallCleared").String("kind", "pump").String("op", "RunCallbacks")
+                    .Number("elapsedMs", static_cast<double>(pump_age_ms)));
+    }
+
+    for (auto it = in_flight_.begin(); it != in_flight_.end();) {
+      Entry& entry = it->second;
+      uint64_t age_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.started).count();
+      if (entry.reported || age_ms < options_.request_stall_ms) {
+        ++it;
+        continue;
+      }
+
+      bool retrying = options_.auto_retry && entry.retry && entry.attempt < options_.max_retries;
+      entry.reported = true;
+      dump = true;
+      METRIC_COUNTER("watchdog.stalls").Add();
+      FlightRecorder::Instance().Record(FlightEvent::Stall, entry.op, entry.attempt, age_ms * 1000000);
+      LOG_WARN("⏱️  " << entry.op << " has been in flight for " << age_ms << "ms"
+               << (retrying ? " - retrying" : ""));
+      EmitEvent(NativeEvent("stall").String("kind", "request").String("op", entry.op)
+                    .Number("elapsedMs", static_cast<double>(age_ms))
+                    .Number("attempt", entry.attempt)
+                    .Bool("retrying", retrying));
+
+      if (retrying) {
+        // Abandon this attempt; a late callback still lands in the cache harmlessly
+        retries.emplace_back(std::move(entry.retry), entry.attempt + 1);
+        it = in_flight_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    METRIC_GAUGE("requests.in_flight").Set(static_cast<int64_t>(in_flight_.size()));
+  }
+
+  if (dump) {
+    FlightRecorder::Instance().DumpToConfiguredPath();
+  }
+
+  // Retries take the client lock, so they must run without ours
+  for (auto& retry : retries) {
+    METRIC_COUNTER("watchdog.retries").Add();
+    retry.first(retry.second);
+  }
+}
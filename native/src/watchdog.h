@@ -0,0 +1,78 @@
+#ifndef DISCORD_WATCHDOG_H
+#define DISCORD_WATCHDOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct WatchdogOptions {
+  uint32_t pump_stall_ms = 5000;      // RunCallbacks() not pumped for this long
+  uint32_t request_stall_ms = 15000;  // SDK request without a callback for this long
+  uint32_t check_interval_ms = 1000;
+  bool auto_retry = false;            // re-issue idempotent requests that stalled
+  uint32_t max_retries = 2;
+};
+
+struct InFlightRequest {
+  uint64_t id;
+  const char* op;
+  uint32_t attempt;
+  uint64_t age_ms;
+};
+
+// Background thread that turns silent hangs into `stall` events: it watches
+// the age of the last Discord_RunCallbacks() pump and of every in-flight SDK
+// request, and can re-issue idempotent fetches that never completed.
+class Watchdog {
+public:
+  // Called with the next attempt number when a stalled request is retried
+  using RetryFn = std::function<void(uint32_t attempt)>;
+
+  Watchdog() = default;
+  ~Watchdog();
+
+  void Start();
+  void Stop();
+  void Configure(const WatchdogOptions& options);
+  WatchdogOptions Options();
+
+  void NotePump();
+
+  // retry is empty for requests that are not safe to repeat
+  uint64_t BeginRequest(const char* op, RetryFn retry, uint32_t attempt = 0);
+  void EndRequest(uint64_t id);
+  std::vector<InFlightRequest> InFlight();
+
+private:
+  struct Entry {
+    const char* op;
+    std::chrono::steady_clock::time_point started;
+    RetryFn retry;
+    uint32_t attempt;
+    bool reported;
+  };
+
+  void Loop();
+  void Check();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::thread thread_;
+  bool running_ = false;
+  WatchdogOptions options_;
+
+  std::unordered_map<uint64_t, Entry> in_flight_;
+  uint64_t next_id_ = 1;
+
+  std::atomic<int64_t> last_pump_ns_{0};
+  bool pump_stalled_ = false;
+};
+
+#endif // DISCORD_WATCHDOG_H
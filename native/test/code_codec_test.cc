@@ -0,0 +1,180 @@
+#include "test.h"
+#include "code_codec.h"
+#include "events.h"
+#include <algorithm>
+#include <random>
+
+static std::string SampleCode(size_t lines) {
+  std::string code;
+  for (size_t i = 0; i < lines; i++) {
+    code += "for (int i = 0; i < " + std::to_string(i) + "; i++) total += values[i];\n";
+  }
+  return code;
+}
+
+static bool StartsSequence(unsigned char byte) {
+  return (byte & 0xC0) != 0x80;
+}
+
+// True if no UTF-8 sequence in text is cut short at either end
+static bool WholeUtf8(const std::string& text) {
+  size_t i = 0;
+  while (i < text.size()) {
+    unsigned char lead = static_cast<unsigned char>(text[i]);
+    if (!StartsSequence(lead)) return false;
+    size_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+    if (i + length > text.size()) return false;
+    for (size_t k = 1; k < length; k++) {
+      if (StartsSequence(static_cast<unsigned char>(text[i + k]))) return false;
+    }
+    i += length;
+  }
+  return true;
+}
+
+// Collects the reassembler's events while alive
+struct EventCapture {
+  std::vector<NativeEvent> events;
+  uint64_t sink_id;
+
+  EventCapture() : sink_id(AddEventSink([this](NativeEvent event) { events.push_back(std::move(event)); })) {}
+  ~EventCapture() { RemoveEventSink(sink_id); }
+
+  const NativeEvent* Last(const std::string& type) const {
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+      if (it->Type() == type) return &*it;
+    }
+    return nullptr;
+  }
+};
+
+static std::string Field(const NativeEvent& event, const std::string& key) {
+  for (const EventField& field : event.Fields()) {
+    if (field.key == key) return field.string_value;
+  }
+  return "";
+}
+
+TEST(Lz4RoundTrips) {
+  std::mt19937 rng(7);
+  std::string noise(3000, '\0');
+  for (char& c : noise) c = static_cast<char>(rng());
+  std::vector<std::string> inputs = { "", "a", "abcdefghijk", std::string(5000, 'x'), SampleCode(200), noise };
+  for (const std::string& input : inputs) {
+    std::string packed = Lz4Compress(input);
+    std::string unpacked;
+    CHECK(Lz4Decompress(packed, input.size(), unpacked));
+    CHECK(unpacked == input);
+  }
+  CHECK(Lz4Compress(SampleCode(200)).size() < SampleCode(200).size() / 2);
+}
+
+TEST(Lz4RejectsMalformedInput) {
+  std::string code = SampleCode(100);
+  std::string packed = Lz4Compress(code);
+  std::string out;
+  CHECK(!Lz4Decompress(packed, code.size() - 1, out));  // wrong size
+  CHECK(!Lz4Decompress(packed, code.size() + 1, out));
+  for (size_t cut : { size_t(1), size_t(2), packed.size() / 2, packed.size() - 1 }) {
+    CHECK(!Lz4Decompress(packed.substr(0, cut), code.size(), out));  // truncated
+  }
+  // Literal "ab", then a match whose offset is zero or reaches before the start
+  CHECK(!Lz4Decompress(std::string("\x20" "ab\x00\x00", 5), 6, out));
+  CHECK(!Lz4Decompress(std::string("\x20" "ab\x05\x00", 5), 6, out));
+  // A literal run longer than the input holds
+  CHECK(!Lz4Decompress(std::string("\xF0\xFF\xFF", 3), 600, out));
+  // A decoded size no block of this length could reach is refused up front
+  CHECK(!Lz4Decompress("x", static_cast<size_t>(-1), out));
+}
+
+TEST(Base64RoundTrips) {
+  std::string bytes;
+  for (int i = 0; i < 256; i++) bytes.push_back(static_cast<char>(i));
+  for (size_t length = 0; length <= 7; length++) {
+    std::string input = bytes.substr(250 - length, length);
+    std::string decoded;
+    CHECK(Base64Decode(Base64Encode(input), decoded));
+    CHECK(decoded == input);
+  }
+  std::string decoded;
+  CHECK(Base64Decode(Base64Encode(bytes), decoded) && decoded == bytes);
+  CHECK_EQ(Base64Encode("hello"), std::string("aGVsbG8="));
+  CHECK(!Base64Decode("aGV*bG8=", decoded));
+  CHECK(!Base64Decode("aGVsb", decoded));  // one dangling character is not a byte
+}
+
+TEST(CodeTextChunksKeepUtf8Whole) {
+  // No newlines, so every cut falls back to the UTF-8 boundary rule
+  std::string code;
+  for (int i = 0; i < 300; i++) code += i % 3 == 0 ? "\xC3\xA9" : i % 3 == 1 ? "\xE2\x82\xAC" : "\xF0\x9F\x91\x8B";
+  CodeShareOptions options;
+  options.compress = false;
+  options.max_message_bytes = 150;
+  EncodedCode encoded = EncodeCode(NewTransferId(), code, options);
+  CHECK(encoded.error.empty());
+  CHECK(encoded.messages.size() > 5);
+
+  std::string joined;
+  for (const std::string& message : encoded.messages) {
+    CHECK(message.size() <= options.max_message_bytes);
+    CodeChunkHeader header;
+    std::string payload;
+    CHECK(ParseCodeChunk(message, header, payload));
+    CHECK(!payload.empty() && WholeUtf8(payload));
+    joined += payload;
+  }
+  CHECK(joined == code);
+}
+
+TEST(CodeReassemblesOutOfOrderAndDuplicateChunks) {
+  for (bool compress : { false, true }) {
+    std::string code = SampleCode(300);
+    CodeShareOptions options;
+    options.compress = compress;
+    options.max_message_bytes = 400;
+    EncodedCode encoded = EncodeCode(NewTransferId(), code, options);
+    CHECK(encoded.encoding == (compress ? CodeEncoding::Lz4 : CodeEncoding::Text));
+    CHECK(encoded.messages.size() > 3);
+
+    EventCapture capture;
+    CodeReassembler reassembler;
+    std::vector<std::string> messages = encoded.messages;
+    std::reverse(messages.begin(), messages.end());
+    messages.insert(messages.begin() + 1, messages[0]);  // redelivered
+    for (const std::string& message : messages) {
+      CHECK(reassembler.Feed(1, 2, message));
+    }
+    const NativeEvent* received = capture.Last("codeReceived");
+    CHECK(received != nullptr);
+    if (received) CHECK(Field(*received, "content") == code);
+    CHECK(capture.Last("codeTransferFailed") == nullptr);
+    CHECK_EQ(reassembler.Pending(), 0u);
+  }
+}
+
+TEST(CodeRejectsOversizedRawBytes) {
+  EventCapture capture;
+  CodeReassembler reassembler;
+  // Claims 2^64-1 decoded bytes; once this made Feed() throw from its allocation
+  CHECK(reassembler.Feed(1, 2, "dvc1 abcdef0123456789 0/1 z 00000000 18446744073709551615 - x\nAAAA"));
+  const NativeEvent* failed = capture.Last("codeTransferFailed");
+  CHECK(failed != nullptr);
+  CHECK_EQ(reassembler.Pending(), 0u);
+
+  // Under the cap but more than the payload could ever decode to
+  CHECK(reassembler.Feed(1, 2, "dvc1 0123456789abcdef 0/1 z 00000000 1000000 - x\nAAAA"));
+  failed = capture.Last("codeTransferFailed");
+  CHECK(failed != nullptr && Field(*failed, "transferId") == "0123456789abcdef");
+  CHECK(capture.Last("codeReceived") == nullptr);
+}
+
+TEST(CodeIgnoresNonChunks) {
+  CodeReassembler reassembler;
+  CodeChunkHeader header;
+  std::string payload;
+  CHECK(!reassembler.Feed(1, 2, "hello there"));
+  CHECK(!ParseCodeChunk("dvc1 id 0/0 t 00000000 1 - x\nbody", header, payload));  // no chunks
+  CHECK(!ParseCodeChunk("dvc1 id 2/1 t\nbody", header, payload));                 // seq past total
+  CHECK(!ParseCodeChunk("dvc1 id 0/1 q 00000000 1 - x\nbody", header, payload));  // unknown encoding
+  CHECK(!ParseCodeChunk("dvc1 id 0/1 t", header, payload));                       // no payload line
+}
@@ -0,0 +1,20 @@
+#include "test.h"
+#include "events.h"
+#include <vector>
+
+TEST(EventsReachEverySink) {
+  std::vector<std::string> first, second;
+  uint64_t a = AddEventSink([&first](NativeEvent event) { first.push_back(event.Type()); });
+  uint64_t b = AddEventSink([&second](NativeEvent event) { second.push_back(event.Type()); });
+  CHECK(a != b);
+  EmitEvent(NativeEvent("ready"));
+  CHECK(first.size() == 1 && second.size() == 1);
+
+  // A short-lived instance going away leaves the live one's sink in place
+  RemoveEventSink(b);
+  RemoveEventSink(b);
+  EmitEvent(NativeEvent("disconnected"));
+  CHECK(first.size() == 2 && first[1] == "disconnected");
+  CHECK_EQ(second.size(), 1u);
+  RemoveEventSink(a);
+}
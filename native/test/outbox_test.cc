@@ -0,0 +1,133 @@
+#include "test.h"
+#include "outbox.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const SendDestination kUser = { SendTarget::User, 1 };
+static const SendDestination kLobby = { SendTarget::Lobby, 2 };
+
+// An outbox whose retry timer takes the same lock the test holds, the way
+// RunLocked takes the client state lock
+struct OutboxHarness {
+  std::mutex mutex;
+  TimerQueue timers;
+  std::vector<std::string> submitted;
+  Outbox outbox;
+
+  explicit OutboxHarness(const OutboxOptions& options)
+      : outbox(timers, [this](std::function<void()> task) {
+          std::lock_guard<std::mutex> lock(mutex);
+          task();
+        },
+        [this](const std::string& nonce, const SendDestination&, const std::string&) {
+          submitted.push_back(nonce);
+        }) {
+    outbox.Configure(options);
+  }
+
+  ~OutboxHarness() { timers.Stop(); }
+
+  // True once at least count messages have been submitted
+  bool WaitForSubmits(size_t count, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (submitted.size() >= count) return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+  }
+};
+
+static SendResult Failure(bool retryable) {
+  return { false, 0, "server hiccup", 0, retryable };
+}
+
+static SendResult Success(uint64_t message_id) {
+  return { true, message_id, "", 0, false };
+}
+
+TEST(OutboxBacksOffOnlineFailures) {
+  OutboxOptions options;
+  options.retry_base_ms = 200;
+  options.retry_max_ms = 200;
+  OutboxHarness harness(options);
+  {
+    std::lock_guard<std::mutex> lock(harness.mutex);
+    harness.outbox.SetOnline(true);
+    harness.outbox.Enqueue("a", kUser, "first", nullptr);
+    CHECK_EQ(harness.submitted.size(), 1u);
+    harness.outbox.OnResult("a", Failure(true));
+    CHECK_EQ(harness.submitted.size(), 1u);  // not resubmitted on the spot
+
+    // A later message to the same user waits behind the retry; other
+    // destinations are not held up
+    harness.outbox.Enqueue("b", kUser, "second", nullptr);
+    harness.outbox.Enqueue("c", kLobby, "elsewhere", nullptr);
+    CHECK(harness.submitted.size() == 2 && harness.submitted[1] == "c");
+    OutboxStatus status = harness.outbox.Status();
+    CHECK(status.messages.size() == 3 && status.messages[0].retry_in_ms > 0);
+  }
+  auto failed_at = std::chrono::steady_clock::now();
+  CHECK(harness.WaitForSubmits(4, std::chrono::seconds(5)));
+  CHECK(std::chrono::steady_clock::now() - failed_at >= std::chrono::milliseconds(90));  // at least half the delay
+
+  std::lock_guard<std::mutex> lock(harness.mutex);
+  CHECK(harness.submitted.size() == 4 && harness.submitted[2] == "a" && harness.submitted[3] == "b");
+}
+
+TEST(OutboxRetriesOfflineFailuresOnReady) {
+  OutboxOptions options;
+  options.retry_base_ms = 60000;
+  OutboxHarness harness(options);
+  std::lock_guard<std::mutex> lock(harness.mutex);
+  harness.outbox.SetOnline(true);
+  harness.outbox.Enqueue("a", kUser, "first", nullptr);
+  harness.outbox.SetOnline(false);
+  harness.outbox.OnResult("a", Failure(true));
+  harness.outbox.SetOnline(true);
+  CHECK(harness.submitted.size() == 2 && harness.submitted[1] == "a");
+  OutboxStatus status = harness.outbox.Status();
+  CHECK(status.messages.size() == 1 && status.messages[0].attempts == 0);
+}
+
+TEST(OutboxGivesUpAfterMaxAttempts) {
+  OutboxOptions options;
+  options.max_attempts = 3;
+  options.retry_base_ms = 10;
+  options.retry_max_ms = 20;
+  OutboxHarness harness(options);
+  bool settled = false;
+  bool ok = true;
+  {
+    std::lock_guard<std::mutex> lock(harness.mutex);
+    harness.outbox.SetOnline(true);
+    harness.outbox.Enqueue("a", kUser, "first", [&](const SendResult& result) {
+      settled = true;
+      ok = result.ok;
+    });
+  }
+  for (size_t attempt = 1; attempt <= 3; attempt++) {
+    CHECK(harness.WaitForSubmits(attempt, std::chrono::seconds(5)));
+    std::lock_guard<std::mutex> lock(harness.mutex);
+    harness.outbox.OnResult("a", Failure(true));
+  }
+  std::lock_guard<std::mutex> lock(harness.mutex);
+  CHECK(settled && !ok);
+  CHECK_EQ(harness.outbox.Status().failed, 1u);
+}
+
+TEST(OutboxDedupesSentNonce) {
+  OutboxHarness harness(OutboxOptions{});
+  std::lock_guard<std::mutex> lock(harness.mutex);
+  harness.outbox.SetOnline(true);
+  harness.outbox.Enqueue("a", kUser, "first", nullptr);
+  harness.outbox.OnResult("a", Success(42));
+  uint64_t message_id = 0;
+  harness.outbox.Enqueue("a", kUser, "first", [&](const SendResult& result) { message_id = result.message_id; });
+  CHECK_EQ(message_id, 42u);
+  CHECK_EQ(harness.submitted.size(), 1u);
+}
@@ -0,0 +1,205 @@
+#include "test.h"
+#include "record_log.h"
+#include <cstdio>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+static std::vector<std::string> Replay(const std::string& path, uint64_t from = 0, uint64_t* records = nullptr) {
+  std::vector<std::string> out;
+  RecordLog log;
+  std::string error;
+  bool opened = log.Open(path, {}, [&](const std::string& record) { out.push_back(record); }, &error, from);
+  CHECK(opened);
+  if (records) *records = log.Records();
+  return out;
+}
+
+static uint64_t FileSize(const std::string& path) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) return 0;
+  std::fseek(file, 0, SEEK_END);
+  uint64_t size = static_cast<uint64_t>(std::ftell(file));
+  std::fclose(file);
+  return size;
+}
+
+static void AppendRaw(const std::string& path, const std::string& bytes) {
+  FILE* file = std::fopen(path.c_str(), "ab");
+  std::fwrite(bytes.data(), 1, bytes.size(), file);
+  std::fclose(file);
+}
+
+TEST(RecordLogReplaysAppends) {
+  std::string path = TestDir() + "/log";
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) { CHECK(false); }, nullptr));
+    CHECK_EQ(log.Append("one"), 8u);
+    CHECK_EQ(log.Append("two"), 8u + 8 + 3);
+    CHECK(log.Sync(std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+  }
+  uint64_t records = 0;
+  std::vector<std::string> replayed = Replay(path, 0, &records);
+  CHECK_EQ(replayed.size(), 2u);
+  CHECK_EQ(records, 2u);
+  CHECK(replayed.size() == 2 && replayed[0] == "one" && replayed[1] == "two");
+}
+
+TEST(RecordLogReplaysTailFromOffset) {
+  std::string path = TestDir() + "/log";
+  uint64_t third = 0;
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    log.Append("a");
+    log.Append("b");
+    third = log.Append("c");
+    log.Append("d");
+  }
+  uint64_t records = 0;
+  std::vector<std::string> tail = Replay(path, third, &records);
+  CHECK_EQ(records, 2u);
+  CHECK(tail.size() == 2 && tail[0] == "c" && tail[1] == "d");
+}
+
+TEST(RecordLogTruncatesTornTail) {
+  std::string path = TestDir() + "/log";
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    log.Append("kept");
+  }
+  uint64_t intact = FileSize(path);
+  AppendRaw(path, std::string("\x05\0\0\0xx", 6));  // a header cut short by a crash
+
+  CHECK_EQ(Replay(path).size(), 1u);
+  CHECK_EQ(FileSize(path), intact);
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    log.Append("after");
+  }
+  std::vector<std::string> replayed = Replay(path);
+  CHECK(replayed.size() == 2 && replayed[1] == "after");
+}
+
+TEST(RecordLogRewriteKeepsLaterAppends) {
+  std::string path = TestDir() + "/log";
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    for (int i = 0; i < 10; i++) log.Append("old" + std::to_string(i));
+    std::vector<uint64_t> offsets;
+    log.Rewrite({ "x", "yy" }, &offsets);
+    CHECK(offsets.size() == 2 && offsets[0] == 8 && offsets[1] == 17);
+    CHECK_EQ(log.Append("z"), 8u + 9 + 10);
+    CHECK_EQ(log.Records(), 3u);
+  }
+  std::vector<std::string> replayed = Replay(path);
+  CHECK(replayed.size() == 3 && replayed[0] == "x" && replayed[1] == "yy" && replayed[2] == "z");
+}
+
+TEST(RecordLogReadVisitsRange) {
+  std::string path = TestDir() + "/log";
+  std::vector<uint64_t> offsets;
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    for (int i = 0; i < 5; i++) offsets.push_back(log.Append(std::to_string(i)));
+  }
+  std::vector<std::string> seen;
+  CHECK(RecordLog::Read(path, offsets[1], offsets[3], [&](uint64_t offset, const std::string& record) {
+    seen.push_back(record);
+  }));
+  CHECK(seen.size() == 2 && seen[0] == "1" && seen[1] == "2");
+}
+
+TEST(RecordLogRejectsForeignFile) {
+  std::string path = TestDir() + "/log";
+  AppendRaw(path, "not a record log at all");
+  RecordLog log;
+  std::string error;
+  CHECK(!log.Open(path, {}, [](const std::string&) {}, &error));
+  CHECK(!error.empty());
+}
+
+TEST(RecordLogIgnoresHintOffFrameBoundary) {
+  std::string path = TestDir() + "/log";
+  std::vector<uint64_t> offsets;
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    for (int i = 0; i < 5; i++) offsets.push_back(log.Append("record" + std::to_string(i)));
+  }
+  uint64_t size = FileSize(path);
+  // A stale index can point into the middle of a frame; nothing may be lost
+  uint64_t records = 0;
+  std::vector<std::string> replayed = Replay(path, offsets[2] + 3, &records);
+  CHECK_EQ(replayed.size(), 5u);
+  CHECK_EQ(records, 5u);
+  CHECK_EQ(FileSize(path), size);
+}
+
+TEST(RecordLogTruncatesTornTailAfterHint) {
+  std::string path = TestDir() + "/log";
+  uint64_t second = 0;
+  {
+    RecordLog log;
+    CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+    log.Append("a");
+    second = log.Append("b");
+    log.Append("c");
+  }
+  uint64_t intact = FileSize(path);
+  AppendRaw(path, std::string("\x09\0\0\0\0\0\0\0torn", 12));
+  CHECK_EQ(Replay(path, second).size(), 3u);  // replayed in full, then cut at the torn frame
+  CHECK_EQ(FileSize(path), intact);
+  CHECK_EQ(Replay(path, second).size(), 2u);  // clean again, so the hint holds
+}
+
+TEST(RecordLogRestartsTornHeader) {
+  std::string path = TestDir() + "/log";
+  AppendRaw(path, "DLR");  // created, then a crash before the header was complete
+  {
+    RecordLog log;
+    std::string error;
+    CHECK(log.Open(path, {}, [](const std::string&) { CHECK(false); }, &error));
+    CHECK_EQ(log.Append("first"), 8u);
+  }
+  std::vector<std::string> replayed = Replay(path);
+  CHECK(replayed.size() == 1 && replayed[0] == "first");
+}
+
+#ifndef _WIN32
+TEST(RecordLogReportsAndRetriesFailedWrite) {
+  std::string path = TestDir() + "/log";
+  RecordLog log;
+  CHECK(log.Open(path, {}, [](const std::string&) {}, nullptr));
+  log.Append("before");
+  CHECK(log.Sync(std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+  uint64_t intact = FileSize(path);
+
+  // Writes past this size now fail with EFBIG
+  struct rlimit saved;
+  getrlimit(RLIMIT_FSIZE, &saved);
+  struct rlimit limit = saved;
+  limit.rlim_cur = intact + 16;
+  std::signal(SIGXFSZ, SIG_IGN);
+  setrlimit(RLIMIT_FSIZE, &limit);
+  log.Append(std::string(100, 'x'));
+  auto started = std::chrono::steady_clock::now();
+  CHECK(!log.Sync(started + std::chrono::seconds(5)));
+  CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(4));  // told, not timed out
+  CHECK_EQ(FileSize(path), intact);  // the partial frame was cut off again
+  setrlimit(RLIMIT_FSIZE, &saved);
+
+  CHECK(log.Sync(std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+  log.Close();
+  std::vector<std::string> replayed = Replay(path);
+  CHECK(replayed.size() == 2 && replayed[1] == std::string(100, 'x'));
+}
+#endif
@@ -0,0 +1,128 @@
+#include "test.h"
+#include "relationship_store.h"
+#include <algorithm>
+#include <map>
+
+// What the SDK would report, editable by the test
+struct FakeRelationships {
+  std::map<uint64_t, Relationship> users;
+  RelationshipStore store;
+
+  FakeRelationships()
+      : store({ [this]() {
+                 std::vector<uint64_t> ids;
+                 for (const auto& user : users) ids.push_back(user.first);
+                 return ids;
+               },
+                [this](uint64_t user_id, Relationship& out) {
+                  auto it = users.find(user_id);
+                  if (it == users.end()) return false;
+                  out = it->second;
+                  return true;
+                } }) {}
+
+  void Put(uint64_t user_id, const std::string& name, FriendStatus status,
+           RelationshipKind kind = RelationshipKind::Friend) {
+    users[user_id] = { user_id, kind, name, name, status, 0 };
+  }
+};
+
+static std::vector<uint64_t> ChangedIds(const RelationshipChanges& changes) {
+  std::vector<uint64_t> ids;
+  for (const Relationship& relationship : changes.changed) ids.push_back(relationship.user_id);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+TEST(RelationshipChangesSinceVersion) {
+  FakeRelationships fake;
+  fake.Put(1, "ada", FriendStatus::Online);
+  fake.Put(2, "grace", FriendStatus::Offline);
+  fake.Put(3, "linus", FriendStatus::Idle);
+  CHECK_EQ(fake.store.Sync(), 3u);
+
+  RelationshipChanges changes = fake.store.Changes(0);
+  CHECK(!changes.full && changes.removed.empty());
+  CHECK_EQ(ChangedIds(changes).size(), 3u);
+  uint64_t seen = changes.version;
+  CHECK(fake.store.Changes(seen).changed.empty());
+
+  fake.Put(2, "grace", FriendStatus::Online);
+  fake.store.Refresh(2);
+  fake.store.Refresh(3);  // nothing we keep changed: no new version
+  changes = fake.store.Changes(seen);
+  CHECK(ChangedIds(changes) == std::vector<uint64_t>{ 2 });
+  CHECK_EQ(changes.version, seen + 1);
+}
+
+TEST(RelationshipChangesReportRemovals) {
+  FakeRelationships fake;
+  fake.Put(1, "ada", FriendStatus::Online);
+  fake.Put(2, "grace", FriendStatus::Online);
+  fake.Put(3, "linus", FriendStatus::Online);
+  fake.store.Sync();
+  uint64_t seen = fake.store.Version();
+
+  fake.users.erase(1);
+  fake.store.Sync();  // gone from the SDK
+  fake.store.Remove(2);
+  fake.store.Refresh(2);  // and back again
+  RelationshipChanges changes = fake.store.Changes(seen);
+  CHECK(!changes.full);
+  CHECK(changes.removed == std::vector<uint64_t>{ 1 });
+  CHECK(ChangedIds(changes) == std::vector<uint64_t>{ 2 });
+
+  // Removals before the listener's version are not repeated
+  CHECK(fake.store.Changes(changes.version).removed.empty());
+}
+
+TEST(RelationshipChangesFallBackToFull) {
+  FakeRelationships fake;
+  fake.Put(1, "ada", FriendStatus::Online);
+  fake.store.Sync();
+  uint64_t early = fake.store.Version();
+
+  // More removals than are remembered
+  for (uint64_t id = 100; id < 100 + 5000; id++) {
+    fake.Put(id, "user", FriendStatus::Offline);
+    fake.store.Refresh(id);
+    fake.users.erase(id);
+    fake.store.Remove(id);
+  }
+  RelationshipChanges changes = fake.store.Changes(early);
+  CHECK(changes.full && changes.removed.empty());
+  CHECK(ChangedIds(changes) == std::vector<uint64_t>{ 1 });
+
+  // A version from another session (or the future) also gets everything
+  changes = fake.store.Changes(fake.store.Version() + 10);
+  CHECK(changes.full && changes.changed.size() == 1);
+}
+
+TEST(RelationshipListOrdersByStatusThenName) {
+  FakeRelationships fake;
+  fake.Put(1, "Zed", FriendStatus::Online);
+  fake.Put(2, "amy", FriendStatus::Online);
+  fake.Put(3, "Bob", FriendStatus::Offline);
+  fake.Put(4, "carl", FriendStatus::Dnd);
+  fake.Put(5, "dan", FriendStatus::Online, RelationshipKind::Incoming);
+  fake.store.Sync();
+
+  RelationshipFilter filter;
+  RelationshipPage page = fake.store.List(filter);
+  CHECK_EQ(page.total, 4u);
+  CHECK(page.relationships.size() == 4 && page.relationships[0].user_id == 2 && page.relationships[1].user_id == 1 &&
+        page.relationships[2].user_id == 4 && page.relationships[3].user_id == 3);
+  CHECK(page.counts[0] == 2 && page.counts[2] == 1 && page.counts[3] == 1);
+
+  filter.statuses = 1u << static_cast<uint32_t>(FriendStatus::Online);
+  filter.offset = 1;
+  filter.limit = 1;
+  page = fake.store.List(filter);
+  CHECK(page.total == 2 && page.relationships.size() == 1 && page.relationships[0].user_id == 1);
+
+  filter = RelationshipFilter();
+  filter.kinds = 1u << static_cast<uint32_t>(RelationshipKind::Incoming);
+  filter.name = "DA";
+  page = fake.store.List(filter);
+  CHECK(page.total == 1 && page.relationships[0].user_id == 5);
+}
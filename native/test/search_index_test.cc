@@ -0,0 +1,133 @@
+#include "test.h"
+#include "search_index.h"
+#include <future>
+#include <vector>
+
+static const uint64_t kGeneral = 100;
+static const uint64_t kRandom = 200;
+
+static SearchDocument Document(uint64_t message_id, uint64_t channel_id, uint64_t author_id, const std::string& author,
+                               const std::string& content) {
+  return { message_id, channel_id, true, author_id, author, message_id * 1000, content };
+}
+
+// Searches run on the index's worker; this waits for the answer
+static SearchResult Find(SearchIndex& index, const std::string& text, std::vector<uint64_t> channel_ids = {},
+                         uint32_t limit = 25) {
+  auto promise = std::make_shared<std::promise<SearchResult>>();
+  std::future<SearchResult> answer = promise->get_future();
+  SearchQuery query;
+  query.text = text;
+  query.channel_ids = std::move(channel_ids);
+  query.limit = limit;
+  index.Search(std::move(query), [promise](const SearchResult& result) { promise->set_value(result); });
+  if (answer.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+    CHECK(false);
+    return { false, "timed out", {}, 0, 0 };
+  }
+  return answer.get();
+}
+
+static std::vector<uint64_t> Hits(SearchIndex& index, const std::string& text, std::vector<uint64_t> channel_ids = {}) {
+  SearchResult result = Find(index, text, std::move(channel_ids));
+  CHECK(result.ok);
+  std::vector<uint64_t> ids;
+  for (const SearchDocument& hit : result.hits) ids.push_back(hit.message_id);
+  return ids;
+}
+
+static void AddSample(SearchIndex& index) {
+  index.Add(Document(1, kGeneral, 10, "Ada Lovelace", "Hello world"));
+  index.Add(Document(2, kGeneral, 11, "Grace Hopper", "hello there, world"));
+  index.Add(Document(3, kRandom, 10, "Ada Lovelace", "the world says hello"));
+  index.Add(Document(4, kRandom, 12, "Linus", "re-render the widget"));
+  index.Add(Document(5, kGeneral, 12, "Linus", "rendering is slow"));
+}
+
+TEST(SearchIndexMatchesEveryWord) {
+  SearchIndex index;
+  AddSample(index);
+  std::vector<uint64_t> ids = Hits(index, "HELLO world");
+  CHECK(ids.size() == 3 && ids[0] == 3 && ids[1] == 2 && ids[2] == 1);  // newest first
+  CHECK(Hits(index, "hello widget").empty());
+  index.Stop();
+}
+
+TEST(SearchIndexMatchesPrefixes) {
+  SearchIndex index;
+  AddSample(index);
+  std::vector<uint64_t> ids = Hits(index, "rend*");
+  CHECK(ids.size() == 2 && ids[0] == 5 && ids[1] == 4);
+  CHECK(Hits(index, "rend").empty());  // without * a word must match whole
+  index.Stop();
+}
+
+TEST(SearchIndexMatchesPhrases) {
+  SearchIndex index;
+  AddSample(index);
+  std::vector<uint64_t> ids = Hits(index, "\"hello world\"");
+  CHECK(ids.size() == 1 && ids[0] == 1);
+  ids = Hits(index, "\"world says\" hello");
+  CHECK(ids.size() == 1 && ids[0] == 3);
+  ids = Hits(index, "re-render");  // a hyphenated word is the phrase "re render"
+  CHECK(ids.size() == 1 && ids[0] == 4);
+  CHECK(Hits(index, "render-re").empty());
+  index.Stop();
+}
+
+TEST(SearchIndexFiltersByAuthorAndChannel) {
+  SearchIndex index;
+  AddSample(index);
+  std::vector<uint64_t> ids = Hits(index, "hello from:ada");
+  CHECK(ids.size() == 2 && ids[0] == 3 && ids[1] == 1);
+  ids = Hits(index, "from:gra");  // filters alone search every message
+  CHECK(ids.size() == 1 && ids[0] == 2);
+  ids = Hits(index, "from:12");
+  CHECK(ids.size() == 2 && ids[0] == 5 && ids[1] == 4);
+  ids = Hits(index, "hello in:200");
+  CHECK(ids.size() == 1 && ids[0] == 3);
+  ids = Hits(index, "world", { kGeneral });
+  CHECK(ids.size() == 2 && ids[0] == 2 && ids[1] == 1);
+  index.Stop();
+}
+
+TEST(SearchIndexRejectsBadQueries) {
+  SearchIndex index;
+  AddSample(index);
+  SearchResult result = Find(index, "   ");
+  CHECK(!result.ok && result.error == "Empty query");
+  result = Find(index, "hello in:general");
+  CHECK(!result.ok && !result.error.empty());
+  index.Stop();
+}
+
+TEST(SearchIndexLimitsAndCounts) {
+  SearchIndex index;
+  for (uint64_t id = 1; id <= 50; id++) {
+    index.Add(Document(id, kGeneral, 10, "Ada", "status update " + std::to_string(id)));
+  }
+  index.Add(Document(7, kGeneral, 10, "Ada", "status update 7"));  // already indexed
+  SearchResult result = Find(index, "status", {}, 10);
+  CHECK(result.ok);
+  CHECK_EQ(result.total, 50u);
+  CHECK(result.hits.size() == 10 && result.hits[0].message_id == 50 && result.hits[9].message_id == 41);
+  index.Stop();
+}
+
+TEST(SearchIndexRemovesChannelsAndTrims) {
+  SearchOptions options;
+  options.max_documents = 3;
+  SearchIndex index;
+  index.Configure(options);
+  AddSample(index);
+  // Only the newest three are kept
+  std::vector<uint64_t> ids = Hits(index, "hello");
+  CHECK(ids.size() == 1 && ids[0] == 3);
+  index.RemoveChannel(kRandom);
+  CHECK(Hits(index, "hello").empty());
+  ids = Hits(index, "rendering");
+  CHECK(ids.size() == 1 && ids[0] == 5);
+  index.Stop();
+  SearchResult result = Find(index, "rendering");
+  CHECK(!result.ok);
+}
@@ -0,0 +1,100 @@
+#include "test.h"
+#include "send_pipeline.h"
+#include <vector>
+
+static const SendDestination kUser = { SendTarget::User, 1 };
+
+// Records issued sends and completion order; completions are driven by the test
+struct PipelineHarness {
+  std::vector<uint64_t> issued;
+  std::vector<std::string> delivered;  // contents, in the order their sends succeeded
+  SendPipeline pipeline;
+
+  PipelineHarness() : pipeline([this](uint64_t send_id, const SendDestination&, const std::string&) {
+    issued.push_back(send_id);
+  }) {}
+
+  uint64_t Send(const std::string& content) {
+    return pipeline.Send(kUser, content, [this, content](const SendResult& result) {
+      if (result.ok) delivered.push_back(content);
+    });
+  }
+
+  void Succeed(uint64_t send_id) { pipeline.OnSendComplete(send_id, true, send_id * 10, "", false, false); }
+  void RateLimit(uint64_t send_id) { pipeline.OnSendComplete(send_id, false, 0, "rate limited", true, true); }
+};
+
+TEST(MessageLengthCountsCodePoints) {
+  CHECK_EQ(MessageLength(""), 0u);
+  CHECK_EQ(MessageLength("hello"), 5u);
+  CHECK_EQ(MessageLength("h\xC3\xA9llo"), 5u);         // é is two bytes
+  CHECK_EQ(MessageLength("\xF0\x9F\x91\x8B hi"), 4u);  // 👋 is four
+}
+
+TEST(SendPipelineLimitsCodePoints) {
+  PipelineHarness harness;
+  std::string accented;
+  for (int i = 0; i < 2000; i++) accented += "\xC3\xA9";
+  CHECK(harness.Send(accented) != 0);  // 4000 bytes, but 2000 characters
+  CHECK_EQ(harness.Send(accented + "x"), 0u);
+}
+
+TEST(SendPipelineRetriesRateLimitedSendAlone) {
+  PipelineHarness harness;
+  uint64_t a = harness.Send("a");
+  uint64_t b = harness.Send("b");
+  CHECK_EQ(harness.issued.size(), 2u);
+
+  harness.RateLimit(a);
+  uint64_t c = harness.Send("c");
+  // a is re-sent once b has settled; c waits behind it instead of overtaking it
+  CHECK_EQ(harness.issued.size(), 2u);
+  harness.Succeed(b);
+  CHECK(harness.issued.size() == 3 && harness.issued[2] == a);
+
+  harness.Succeed(a);
+  CHECK(harness.issued.size() == 4 && harness.issued[3] == c);
+  harness.Succeed(c);
+  CHECK(harness.delivered.size() == 3 && harness.delivered[1] == "a" && harness.delivered[2] == "c");
+}
+
+TEST(SendPipelineRequeuesRateLimitedInOrder) {
+  PipelineHarness harness;
+  uint64_t a = harness.Send("a");
+  uint64_t b = harness.Send("b");
+  uint64_t c = harness.Send("c");
+
+  // Replies arrive out of order; the retries still go out as a, then b
+  harness.RateLimit(b);
+  harness.RateLimit(a);
+  CHECK_EQ(harness.issued.size(), 3u);
+  harness.Succeed(c);
+  CHECK(harness.issued.size() == 4 && harness.issued[3] == a);
+  harness.Succeed(a);
+  CHECK(harness.issued.size() == 5 && harness.issued[4] == b);
+  harness.Succeed(b);
+  CHECK_EQ(harness.pipeline.Status().in_flight, 0u);
+  CHECK(harness.delivered.size() == 3 && harness.delivered[1] == "a" && harness.delivered[2] == "b");
+}
+
+TEST(SendPipelineHoldsOnlyUnissuedSendsBehindRetry) {
+  PipelineHarness harness;
+  uint64_t a = harness.Send("a");
+  uint64_t b = harness.Send("b");
+  uint64_t c = harness.Send("c");
+  CHECK_EQ(harness.issued.size(), 3u);
+
+  // Only the first is rate limited; b and c were already at the SDK and land first
+  harness.RateLimit(a);
+  uint64_t d = harness.Send("d");
+  harness.Succeed(b);
+  CHECK_EQ(harness.issued.size(), 3u);
+  harness.Succeed(c);
+  CHECK(harness.issued.size() == 4 && harness.issued[3] == a);
+
+  // d was queued after the rate limit, so it waits for the retry
+  harness.Succeed(a);
+  CHECK(harness.issued.size() == 5 && harness.issued[4] == d);
+  harness.Succeed(d);
+  CHECK(harness.delivered == (std::vector<std::string>{ "b", "c", "a", "d" }));
+}
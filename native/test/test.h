@@ -0,0 +1,43 @@
+#ifndef DISCORD_TEST_H
+#define DISCORD_TEST_H
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+// A minimal test harness for the N-API-free parts of the addon. Tests
+// register themselves with TEST(); CHECK failures are reported and counted
+// but do not stop the test, so one run shows every broken expectation.
+
+struct TestRegistration {
+  TestRegistration(const char* name, std::function<void()> body);
+};
+
+void ReportFailure(const char* file, int line, const std::string& message);
+
+// A fresh, empty directory for the running test, removed when the run ends
+std::string TestDir();
+
+#define TEST(name)                                             \
+  static void name();                                          \
+  static TestRegistration name##_registration(#name, name);    \
+  static void name()
+
+#define CHECK(expr)                                            \
+  do {                                                         \
+    if (!(expr)) ReportFailure(__FILE__, __LINE__, #expr);     \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                   \
+  do {                                                                               \
+    auto&& test_actual_ = (actual);                                                  \
+    auto&& test_expected_ = (expected);                                              \
+    if (!(test_actual_ == test_expected_)) {                                         \
+      std::ostringstream test_message_;                                              \
+      test_message_ << #actual << " == " << #expected << " (got " << test_actual_    \
+                    << ", want " << test_expected_ << ")";                           \
+      ReportFailure(__FILE__, __LINE__, test_message_.str());                        \
+    }                                                                                \
+  } while (0)
+
+#endif // DISCORD_TEST_H
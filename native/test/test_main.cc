@@ -0,0 +1,68 @@
+#include "test.h"
+#include "events.h"
+#include "logger.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct TestCase {
+  const char* name;
+  std::function<void()> body;
+};
+
+static std::vector<TestCase>& Tests() {
+  static std::vector<TestCase> tests;
+  return tests;
+}
+
+static int g_failures = 0;
+static fs::path g_root;
+static int g_dirs = 0;
+
+TestRegistration::TestRegistration(const char* name, std::function<void()> body) {
+  Tests().push_back({ name, std::move(body) });
+}
+
+void ReportFailure(const char* file, int line, const std::string& message) {
+  g_failures++;
+  std::fprintf(stderr, "    %s:%d: CHECK failed: %s\n", file, line, message.c_str());
+}
+
+std::string TestDir() {
+  fs::path dir = g_root / std::to_string(++g_dirs);
+  fs::create_directories(dir);
+  return dir.string();
+}
+
+// native_tests [filter]: runs every test whose name contains filter
+int main(int argc, char** argv) {
+  const char* filter = argc > 1 ? argv[1] : "";
+  Logger::Instance().SetLevel(std::getenv("DISCORD_TEST_LOG") ? LogLevel::Debug : LogLevel::Off);
+  AddEventSink([](NativeEvent) {});
+  g_root = fs::temp_directory_path() / ("discord-native-tests-" + std::to_string(std::time(nullptr)));
+  fs::remove_all(g_root);
+
+  int run = 0;
+  int failed = 0;
+  for (const TestCase& test : Tests()) {
+    if (!std::strstr(test.name, filter)) continue;
+    int before = g_failures;
+    std::fprintf(stderr, "[ RUN  ] %s\n", test.name);
+    test.body();
+    bool ok = g_failures == before;
+    std::fprintf(stderr, "[ %s ] %s\n", ok ? " OK " : "FAIL", test.name);
+    run++;
+    if (!ok) failed++;
+  }
+
+  Logger::Instance().Shutdown();
+  std::error_code ignored;
+  fs::remove_all(g_root, ignored);
+  std::fprintf(stderr, "%d tests, %d failed\n", run, failed);
+  return failed == 0 && run > 0 ? 0 : 1;
+}